@@ -15,9 +15,68 @@
 // Official SVN repository and contact information can be found at
 // http://code.google.com/p/dolphin-emu/
 
+#include <algorithm>
 #include <cstring>
 
 #include "ChunkFile.h"
+#include "ThreadPools.h"
+#include "../ext/xxhash.h"
+
+PointerWrapBuffer::~PointerWrapBuffer() {
+	for (size_t i = 0; i < blocks_.size(); ++i) {
+		delete [] blocks_[i];
+	}
+}
+
+void PointerWrapBuffer::Write(const void *data, size_t size) {
+	const u8 *src = (const u8 *)data;
+	while (size > 0) {
+		if (ptr_ == end_) {
+			blocks_.push_back(new u8[BLOCK_SIZE]);
+			ptr_ = blocks_.back();
+			end_ = ptr_ + BLOCK_SIZE;
+		}
+
+		size_t n = std::min(size, (size_t)(end_ - ptr_));
+		memcpy(ptr_, src, n);
+		ptr_ += n;
+		src += n;
+		size -= n;
+		size_ += n;
+	}
+}
+
+void PointerWrapBuffer::Read(size_t pos, size_t size, u8 *dest) const {
+	while (size > 0) {
+		size_t block = pos / BLOCK_SIZE;
+		size_t offset = pos % BLOCK_SIZE;
+		size_t n = std::min(size, (size_t)BLOCK_SIZE - offset);
+		memcpy(dest, blocks_[block] + offset, n);
+		pos += n;
+		dest += n;
+		size -= n;
+	}
+}
+
+void PointerWrapBuffer::BeginSection(const char *title) {
+	Section section;
+	memset(section.title, 0, sizeof(section.title));
+	strncpy(section.title, title, sizeof(section.title));
+	section.depth = (u32)openSections_.size();
+	section.start = (u32)size_;
+	section.end = (u32)size_;
+
+	openSections_.push_back(sections_.size());
+	sections_.push_back(section);
+}
+
+void PointerWrapBuffer::EndSection() {
+	// Might not match up if the save failed part way.
+	if (!openSections_.empty()) {
+		sections_[openSections_.back()].end = (u32)size_;
+		openSections_.pop_back();
+	}
+}
 
 PointerWrapSection PointerWrap::Section(const char *title, int ver) {
 	return Section(title, ver, ver);
@@ -27,6 +86,9 @@ PointerWrapSection PointerWrap::Section(const char *title, int minVer, int ver)
 	char marker[16] = {0};
 	int foundVersion = ver;
 
+	if (buffer && mode == MODE_WRITE)
+		buffer->BeginSection(title);
+
 	strncpy(marker, title, sizeof(marker));
 	if (!ExpectVoid(marker, sizeof(marker)))
 	{
@@ -60,7 +122,14 @@ void PointerWrap::SetError(Error error_) {
 bool PointerWrap::ExpectVoid(void *data, int size) {
 	switch (mode) {
 	case MODE_READ:	if (memcmp(data, *ptr, size) != 0) return false; break;
-	case MODE_WRITE: memcpy(*ptr, data, size); break;
+	case MODE_WRITE:
+		if (buffer) {
+			// Moves the pointer itself.
+			buffer->Write(data, size);
+			return true;
+		}
+		memcpy(*ptr, data, size);
+		break;
 	case MODE_MEASURE: break;  // MODE_MEASURE - don't need to do anything
 	case MODE_VERIFY:
 		for (int i = 0; i < size; i++)
@@ -75,7 +144,13 @@ bool PointerWrap::ExpectVoid(void *data, int size) {
 void PointerWrap::DoVoid(void *data, int size) {
 	switch (mode) {
 	case MODE_READ:	memcpy(data, *ptr, size); break;
-	case MODE_WRITE: memcpy(*ptr, data, size); break;
+	case MODE_WRITE:
+		if (buffer) {
+			buffer->Write(data, size);
+			return;
+		}
+		memcpy(*ptr, data, size);
+		break;
 	case MODE_MEASURE: break;  // MODE_MEASURE - don't need to do anything
 	case MODE_VERIFY:
 		for (int i = 0; i < size; i++)
@@ -92,7 +167,13 @@ void PointerWrap::Do(std::string &x) {
 
 	switch (mode) {
 	case MODE_READ:		x = (char*)*ptr; break;
-	case MODE_WRITE:	memcpy(*ptr, x.c_str(), stringLen); break;
+	case MODE_WRITE:
+		if (buffer) {
+			buffer->Write(x.c_str(), stringLen);
+			return;
+		}
+		memcpy(*ptr, x.c_str(), stringLen);
+		break;
 	case MODE_MEASURE: break;
 	case MODE_VERIFY: _dbg_assert_msg_(COMMON, !strcmp(x.c_str(), (char*)*ptr), "Savestate verification failure: \"%s\" != \"%s\" (at %p).\n", x.c_str(), (char*)*ptr, ptr); break;
 	}
@@ -105,7 +186,13 @@ void PointerWrap::Do(std::wstring &x) {
 
 	switch (mode) {
 	case MODE_READ:		x = (wchar_t*)*ptr; break;
-	case MODE_WRITE:	memcpy(*ptr, x.c_str(), stringLen); break;
+	case MODE_WRITE:
+		if (buffer) {
+			buffer->Write(x.c_str(), stringLen);
+			return;
+		}
+		memcpy(*ptr, x.c_str(), stringLen);
+		break;
 	case MODE_MEASURE: break;
 	case MODE_VERIFY: _dbg_assert_msg_(COMMON, x == (wchar_t*)*ptr, "Savestate verification failure: \"%ls\" != \"%ls\" (at %p).\n", x.c_str(), (wchar_t*)*ptr, ptr); break;
 	}
@@ -158,6 +245,8 @@ void PointerWrap::DoMarker(const char *prevName, u32 arbitraryNumber) {
 PointerWrapSection::~PointerWrapSection() {
 	if (ver_ > 0) {
 		p_.DoMarker(title_);
+		if (p_.buffer && p_.mode == PointerWrap::MODE_WRITE)
+			p_.buffer->EndSection();
 	}
 }
 
@@ -220,6 +309,67 @@ CChunkFileReader::Error CChunkFileReader::GetFileTitle(const std::string &filena
 	return LoadFileHeader(pFile, header, title);
 }
 
+static bool DecompressChunk(const u8 *src, u32 compressedSize, u32 hash, u8 *dest, u32 size) {
+	if (XXH32(src, compressedSize, 0) != hash) {
+		return false;
+	}
+
+	size_t uncompSize;
+	if (snappy_uncompressed_length((const char *)src, compressedSize, &uncompSize) != SNAPPY_OK || uncompSize != size) {
+		return false;
+	}
+	return snappy_uncompress((const char *)src, compressedSize, (char *)dest, &uncompSize) == SNAPPY_OK && uncompSize == size;
+}
+
+CChunkFileReader::Error CChunkFileReader::LoadFileIndex(File::IOFile &pFile, const SChunkHeader &header, std::vector<SChunkIndexEntry> &chunks, std::vector<PointerWrapBuffer::Section> *sections) {
+	SChunkIndexHeader index;
+	if (!pFile.ReadArray(&index, 1)) {
+		ERROR_LOG(COMMON, "ChunkReader: Unable to read index");
+		return ERROR_BAD_FILE;
+	}
+
+	// Check the counts before allocating anything based on them.
+	const u64 indexSize = sizeof(index) + (u64)index.ChunkCount * sizeof(SChunkIndexEntry) + (u64)index.SectionCount * sizeof(PointerWrapBuffer::Section);
+	if (indexSize > header.ExpectedSize) {
+		ERROR_LOG(COMMON, "ChunkReader: Bad index size");
+		return ERROR_BAD_FILE;
+	}
+
+	chunks.resize(index.ChunkCount);
+	if (!chunks.empty() && !pFile.ReadArray(&chunks[0], chunks.size())) {
+		ERROR_LOG(COMMON, "ChunkReader: Unable to read index");
+		return ERROR_BAD_FILE;
+	}
+	if (sections) {
+		sections->resize(index.SectionCount);
+		if (!sections->empty() && !pFile.ReadArray(&(*sections)[0], sections->size())) {
+			ERROR_LOG(COMMON, "ChunkReader: Unable to read index");
+			return ERROR_BAD_FILE;
+		}
+	} else if (!pFile.Seek(index.SectionCount * sizeof(PointerWrapBuffer::Section), SEEK_CUR)) {
+		ERROR_LOG(COMMON, "ChunkReader: Unable to read index");
+		return ERROR_BAD_FILE;
+	}
+
+	// The chunks have to cover the whole state in order, and fill the rest of the file.
+	u64 pos = 0;
+	u64 compressedSize = 0;
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		if (chunks[i].Start != pos) {
+			ERROR_LOG(COMMON, "ChunkReader: Chunk %d out of order", (int)i);
+			return ERROR_BAD_FILE;
+		}
+		pos += chunks[i].Size;
+		compressedSize += chunks[i].CompressedSize;
+	}
+	if (pos != header.UncompressedSize || indexSize + compressedSize != header.ExpectedSize) {
+		ERROR_LOG(COMMON, "ChunkReader: Index doesn't match file size");
+		return ERROR_BAD_FILE;
+	}
+
+	return ERROR_NONE;
+}
+
 CChunkFileReader::Error CChunkFileReader::LoadFile(const std::string &filename, const char *gitVersion, u8 *&_buffer, size_t &sz, std::string *failureReason) {
 	if (!File::Exists(filename)) {
 		*failureReason = "LoadStateDoesntExist";
@@ -234,6 +384,46 @@ CChunkFileReader::Error CChunkFileReader::LoadFile(const std::string &filename,
 		return err;
 	}
 
+	if (header.Revision >= REVISION_INDEX) {
+		std::vector<SChunkIndexEntry> chunks;
+		err = LoadFileIndex(pFile, header, chunks, nullptr);
+		if (err != ERROR_NONE) {
+			return err;
+		}
+
+		std::vector<size_t> offsets(chunks.size() + 1, 0);
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			offsets[i + 1] = offsets[i] + chunks[i].CompressedSize;
+		}
+		std::vector<u8> compressed(offsets.back());
+		if (!compressed.empty() && !pFile.ReadBytes(&compressed[0], compressed.size())) {
+			ERROR_LOG(COMMON, "ChunkReader: Error reading file");
+			return ERROR_BAD_FILE;
+		}
+
+		// Every chunk stands alone, so they can all be checked and decompressed at once.
+		sz = header.UncompressedSize;
+		u8 *uncomp_buffer = new u8[sz];
+		std::vector<u8> valid(chunks.size(), 0);
+		GlobalThreadPool::Loop([&](int lower, int upper) {
+			for (int i = lower; i < upper; ++i) {
+				const SChunkIndexEntry &chunk = chunks[i];
+				valid[i] = DecompressChunk(compressed.data() + offsets[i], chunk.CompressedSize, chunk.Hash, uncomp_buffer + chunk.Start, chunk.Size) ? 1 : 0;
+			}
+		}, 0, (int)chunks.size());
+
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			if (!valid[i]) {
+				ERROR_LOG(COMMON, "ChunkReader: Chunk %d is corrupt", (int)i);
+				delete [] uncomp_buffer;
+				return ERROR_BAD_FILE;
+			}
+		}
+
+		_buffer = uncomp_buffer;
+		return ERROR_NONE;
+	}
+
 	// read the state
 	sz = header.ExpectedSize;
 	u8 *buffer = new u8[sz];
@@ -262,25 +452,129 @@ CChunkFileReader::Error CChunkFileReader::LoadFile(const std::string &filename,
 	return ERROR_NONE;
 }
 
-// Takes ownership of buffer.
-CChunkFileReader::Error CChunkFileReader::SaveFile(const std::string &filename, const std::string &title, const char *gitVersion, u8 *buffer, size_t sz) {
+CChunkFileReader::Error CChunkFileReader::GetFileSections(const std::string &filename, std::vector<PointerWrapBuffer::Section> *sections) {
+	File::IOFile pFile(filename, "rb");
+	SChunkHeader header;
+	Error err = LoadFileHeader(pFile, header, nullptr);
+	if (err != ERROR_NONE) {
+		return err;
+	}
+	if (header.Revision < REVISION_INDEX) {
+		ERROR_LOG(COMMON, "ChunkReader: File is too old to have an index");
+		return ERROR_BAD_FILE;
+	}
+
+	std::vector<SChunkIndexEntry> chunks;
+	return LoadFileIndex(pFile, header, chunks, sections);
+}
+
+CChunkFileReader::Error CChunkFileReader::LoadFileSection(const std::string &filename, const char *title, std::vector<u8> &data) {
+	File::IOFile pFile(filename, "rb");
+	SChunkHeader header;
+	Error err = LoadFileHeader(pFile, header, nullptr);
+	if (err != ERROR_NONE) {
+		return err;
+	}
+	if (header.Revision < REVISION_INDEX) {
+		ERROR_LOG(COMMON, "ChunkReader: File is too old to have an index");
+		return ERROR_BAD_FILE;
+	}
+
+	std::vector<SChunkIndexEntry> chunks;
+	std::vector<PointerWrapBuffer::Section> sections;
+	err = LoadFileIndex(pFile, header, chunks, &sections);
+	if (err != ERROR_NONE) {
+		return err;
+	}
+
+	const PointerWrapBuffer::Section *section = nullptr;
+	for (size_t i = 0; i < sections.size(); ++i) {
+		if (strncmp(sections[i].title, title, sizeof(sections[i].title)) == 0) {
+			section = &sections[i];
+			break;
+		}
+	}
+	if (!section || section->end < section->start || section->end > header.UncompressedSize) {
+		ERROR_LOG(COMMON, "ChunkReader: Section %s not found", title);
+		return ERROR_BAD_FILE;
+	}
+
+	data.resize(section->end - section->start);
+	const u64 dataStart = pFile.Tell();
+	u64 offset = 0;
+	std::vector<u8> compressed;
+	std::vector<u8> chunkData;
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		const SChunkIndexEntry &chunk = chunks[i];
+		const u32 from = std::max(chunk.Start, section->start);
+		const u32 to = std::min(chunk.Start + chunk.Size, section->end);
+		if (from < to) {
+			compressed.resize(chunk.CompressedSize);
+			chunkData.resize(chunk.Size);
+			if (!pFile.Seek(dataStart + offset, SEEK_SET) || !pFile.ReadBytes(&compressed[0], compressed.size())) {
+				ERROR_LOG(COMMON, "ChunkReader: Error reading file");
+				return ERROR_BAD_FILE;
+			}
+			if (!DecompressChunk(&compressed[0], chunk.CompressedSize, chunk.Hash, &chunkData[0], chunk.Size)) {
+				ERROR_LOG(COMMON, "ChunkReader: Chunk %d is corrupt", (int)i);
+				return ERROR_BAD_FILE;
+			}
+			memcpy(&data[from - section->start], &chunkData[from - chunk.Start], to - from);
+		}
+		offset += chunk.CompressedSize;
+	}
+
+	return ERROR_NONE;
+}
+
+CChunkFileReader::Error CChunkFileReader::SaveFile(const std::string &filename, const std::string &title, const char *gitVersion, const PointerWrapBuffer &buffer) {
 	INFO_LOG(COMMON, "ChunkReader: Writing %s", filename.c_str());
 
 	File::IOFile pFile(filename, "wb");
 	if (!pFile)
 	{
 		ERROR_LOG(COMMON, "ChunkReader: Error opening file for write");
-		delete[] buffer;
 		return ERROR_BAD_FILE;
 	}
 
-	bool compress = true;
+	const size_t sz = buffer.Size();
+	const std::vector<PointerWrapBuffer::Section> &sections = buffer.Sections();
+
+	// Split at the outer sections, so loading one of them takes little else.
+	std::vector<u32> cuts;
+	cuts.push_back(0);
+	cuts.push_back((u32)sz);
+	for (size_t i = 0; i < sections.size(); ++i) {
+		if (sections[i].depth <= CHUNK_MAX_DEPTH) {
+			cuts.push_back(sections[i].start);
+			cuts.push_back(sections[i].end);
+		}
+	}
+	std::sort(cuts.begin(), cuts.end());
+	cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+
+	std::vector<SChunkIndexEntry> chunks;
+	for (size_t i = 0; i + 1 < cuts.size(); ++i) {
+		for (u32 pos = cuts[i]; pos < cuts[i + 1]; pos += CHUNK_SIZE) {
+			SChunkIndexEntry chunk;
+			chunk.Start = pos;
+			chunk.Size = std::min((u32)CHUNK_SIZE, cuts[i + 1] - pos);
+			chunk.CompressedSize = 0;
+			chunk.Hash = 0;
+			chunks.push_back(chunk);
+		}
+	}
+
+	SChunkIndexHeader index;
+	index.ChunkCount = (u32)chunks.size();
+	index.SectionCount = (u32)sections.size();
+	const size_t indexSize = sizeof(index) + chunks.size() * sizeof(SChunkIndexEntry) + sections.size() * sizeof(PointerWrapBuffer::Section);
 
 	// Create header
 	SChunkHeader header;
-	header.Compress = compress ? 1 : 0;
+	header.Compress = 1;
 	header.Revision = REVISION_CURRENT;
-	header.ExpectedSize = (u32)sz;
+	header.ExpectedSize = (u32)indexSize;
 	header.UncompressedSize = (u32)sz;
 	strncpy(header.GitVersion, gitVersion, 32);
 	header.GitVersion[31] = '\0';
@@ -290,44 +584,55 @@ CChunkFileReader::Error CChunkFileReader::SaveFile(const std::string &filename,
 	strncpy(titleFixed, title.c_str(), sizeof(titleFixed));
 	titleFixed[sizeof(titleFixed) - 1] = '\0';
 
+	// The compressed sizes aren't known yet, so the header and index get written again at the end.
+	if (!pFile.WriteArray(&header, 1)) {
+		ERROR_LOG(COMMON, "ChunkReader: Failed writing header");
+		return ERROR_BAD_FILE;
+	}
+	if (!pFile.WriteArray(titleFixed, sizeof(titleFixed))) {
+		ERROR_LOG(COMMON, "ChunkReader: Failed writing title");
+		return ERROR_BAD_FILE;
+	}
+	bool indexWritten = pFile.WriteArray(&index, 1);
+	if (indexWritten && !chunks.empty())
+		indexWritten = pFile.WriteArray(&chunks[0], chunks.size());
+	if (indexWritten && !sections.empty())
+		indexWritten = pFile.WriteArray(&sections[0], sections.size());
+	if (!indexWritten) {
+		ERROR_LOG(COMMON, "ChunkReader: Failed writing index");
+		return ERROR_BAD_FILE;
+	}
+
 	// Write to file
-	if (compress) {
-		size_t comp_len = snappy_max_compressed_length(sz);
-		u8 *compressed_buffer = new u8[comp_len];
-		snappy_compress((const char *)buffer, sz, (char *)compressed_buffer, &comp_len);
-		delete [] buffer;
-		header.ExpectedSize = (u32)comp_len;
-		if (!pFile.WriteArray(&header, 1)) {
-			ERROR_LOG(COMMON, "ChunkReader: Failed writing header");
-			return ERROR_BAD_FILE;
-		}
-		if (!pFile.WriteArray(titleFixed, sizeof(titleFixed))) {
-			ERROR_LOG(COMMON, "ChunkReader: Failed writing title");
-			return ERROR_BAD_FILE;
-		}
-		if (!pFile.WriteBytes(&compressed_buffer[0], comp_len)) {
+	std::vector<u8> chunkData(CHUNK_SIZE);
+	std::vector<char> compressed(snappy_max_compressed_length(CHUNK_SIZE));
+	size_t comp_len = 0;
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		SChunkIndexEntry &chunk = chunks[i];
+		buffer.Read(chunk.Start, chunk.Size, &chunkData[0]);
+		size_t chunkLen = compressed.size();
+		snappy_compress((const char *)&chunkData[0], chunk.Size, &compressed[0], &chunkLen);
+		chunk.CompressedSize = (u32)chunkLen;
+		chunk.Hash = XXH32(&compressed[0], chunkLen, 0);
+
+		if (!pFile.WriteBytes(&compressed[0], chunkLen)) {
 			ERROR_LOG(COMMON, "ChunkReader: Failed writing compressed data");
 			return ERROR_BAD_FILE;
-		}	else {
-			INFO_LOG(COMMON, "Savestate: Compressed %i bytes into %i", (int)sz, (int)comp_len);
 		}
-		delete [] compressed_buffer;
-	} else {
-		if (!pFile.WriteArray(&header, 1))
-		{
-			ERROR_LOG(COMMON, "ChunkReader: Failed writing header");
-			delete[] buffer;
-			return ERROR_BAD_FILE;
-		}
-		if (!pFile.WriteBytes(&buffer[0], sz))
-		{
-			ERROR_LOG(COMMON, "ChunkReader: Failed writing data");
-			delete[] buffer;
-			return ERROR_BAD_FILE;
-		}
-		delete [] buffer;
+		comp_len += chunkLen;
+	}
+
+	header.ExpectedSize = (u32)(indexSize + comp_len);
+	if (!pFile.Seek(0, SEEK_SET) || !pFile.WriteArray(&header, 1)) {
+		ERROR_LOG(COMMON, "ChunkReader: Failed writing header");
+		return ERROR_BAD_FILE;
+	}
+	if (!pFile.Seek(sizeof(header) + sizeof(titleFixed) + sizeof(index), SEEK_SET) || (!chunks.empty() && !pFile.WriteArray(&chunks[0], chunks.size()))) {
+		ERROR_LOG(COMMON, "ChunkReader: Failed writing index");
+		return ERROR_BAD_FILE;
 	}
 
+	INFO_LOG(COMMON, "Savestate: Compressed %i bytes into %i, in %i chunks", (int)sz, (int)comp_len, (int)chunks.size());
 	INFO_LOG(COMMON, "ChunkReader: Done writing %s", filename.c_str());
 	return ERROR_NONE;
 }
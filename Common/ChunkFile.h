@@ -32,6 +32,7 @@
 #include <deque>
 #include <list>
 #include <set>
+#include <vector>
 #if defined(MACGNUSTD)
 #include <tr1/type_traits>
 #else
@@ -60,6 +61,55 @@ struct LinkedListItem : public T
 
 class PointerWrap;
 
+// Growable output for PointerWrap, so a save can be done in one pass without measuring first.
+// Kept in blocks so growing never copies, and so it can be compressed a block at a time.
+class PointerWrapBuffer : NonCopyable
+{
+public:
+	enum {
+		BLOCK_SIZE = 65536,
+	};
+
+	// Where a PointerWrapSection ended up, including its markers.
+	struct Section {
+		char title[16];
+		// 0 for the outermost sections.
+		u32 depth;
+		u32 start;
+		u32 end;
+	};
+
+	PointerWrapBuffer() : ptr_(nullptr), end_(nullptr), size_(0) {}
+	~PointerWrapBuffer();
+
+	void Write(const void *data, size_t size);
+	// Copies out a range, which may span blocks.
+	void Read(size_t pos, size_t size, u8 *dest) const;
+
+	void BeginSection(const char *title);
+	void EndSection();
+	// In the order they started.
+	const std::vector<Section> &Sections() const { return sections_; }
+
+	size_t Size() const { return size_; }
+	size_t BlockCount() const { return blocks_.size(); }
+	const u8 *Block(size_t i) const { return blocks_[i]; }
+	// All blocks are full except the last.
+	size_t BlockSize(size_t i) const {
+		return i + 1 < blocks_.size() ? (size_t)BLOCK_SIZE : size_ - i * BLOCK_SIZE;
+	}
+
+private:
+	friend class PointerWrap;
+
+	std::vector<u8 *> blocks_;
+	u8 *ptr_;
+	u8 *end_;
+	size_t size_;
+	std::vector<Section> sections_;
+	std::vector<size_t> openSections_;
+};
+
 class PointerWrapSection
 {
 public:
@@ -139,10 +189,14 @@ class PointerWrap
 	u8 **ptr;
 	Mode mode;
 	Error error;
+	// If set, writes go here instead of to ptr.
+	PointerWrapBuffer *buffer;
 
 public:
-	PointerWrap(u8 **ptr_, Mode mode_) : ptr(ptr_), mode(mode_), error(ERROR_NONE) {}
-	PointerWrap(unsigned char **ptr_, int mode_) : ptr((u8**)ptr_), mode((Mode)mode_), error(ERROR_NONE) {}
+	PointerWrap(u8 **ptr_, Mode mode_) : ptr(ptr_), mode(mode_), error(ERROR_NONE), buffer(nullptr) {}
+	PointerWrap(unsigned char **ptr_, int mode_) : ptr((u8**)ptr_), mode((Mode)mode_), error(ERROR_NONE), buffer(nullptr) {}
+	// Writes into a growable buffer, no need to measure first.
+	PointerWrap(PointerWrapBuffer *buffer_) : ptr(&buffer_->ptr_), mode(MODE_WRITE), error(ERROR_NONE), buffer(buffer_) {}
 
 	PointerWrapSection Section(const char *title, int ver);
 
@@ -630,6 +684,20 @@ class CChunkFileReader
 		}
 	}
 
+	// Saves in a single pass, the buffer grows as needed.
+	template<class T>
+	static Error SaveBuffer(PointerWrapBuffer &buffer, T &_class)
+	{
+		PointerWrap p(&buffer);
+		_class.DoState(p);
+
+		if (p.error != p.ERROR_FAILURE) {
+			return ERROR_NONE;
+		} else {
+			return ERROR_BROKEN_STATE;
+		}
+	}
+
 	// Load file template
 	template<class T>
 	static Error Load(const std::string &filename, const char *gitVersion, T& _class, std::string *failureReason)
@@ -655,14 +723,10 @@ class CChunkFileReader
 	template<class T>
 	static Error Save(const std::string &filename, const std::string &title, const char *gitVersion, T& _class)
 	{
-		// Get data
-		size_t const sz = MeasurePtr(_class);
-		u8 *buffer = new u8[sz];
-		Error error = SavePtr(buffer, _class);
-
-		// SaveFile takes ownership of buffer
+		PointerWrapBuffer buffer;
+		Error error = SaveBuffer(buffer, _class);
 		if (error == ERROR_NONE)
-			error = SaveFile(filename, title, gitVersion, buffer, sz);
+			error = SaveFile(filename, title, gitVersion, buffer);
 		return error;
 	}
 	
@@ -692,6 +756,16 @@ class CChunkFileReader
 
 	static Error GetFileTitle(const std::string &filename, std::string *title);
 
+	// Compresses and writes a buffer from SaveBuffer, in chunks split at the outer sections.
+	// Doesn't look at any state, so it can run on another thread.
+	static Error SaveFile(const std::string &filename, const std::string &title, const char *gitVersion, const PointerWrapBuffer &buffer);
+
+	// Lists the sections in a file, without decompressing anything.  Only for files with an index.
+	static Error GetFileSections(const std::string &filename, std::vector<PointerWrapBuffer::Section> *sections);
+	// Decompresses only the chunks holding the first section with this title.  The data starts with
+	// the section's header, so the same DoState can read it.  Only for files with an index.
+	static Error LoadFileSection(const std::string &filename, const char *title, std::vector<u8> &data);
+
 private:
 	struct SChunkHeader
 	{
@@ -705,10 +779,35 @@ class CChunkFileReader
 	enum {
 		REVISION_MIN = 4,
 		REVISION_TITLE = 5,
-		REVISION_CURRENT = REVISION_TITLE,
+		// Compressed in separate chunks, with an index of chunks and sections after the title.
+		REVISION_INDEX = 6,
+		REVISION_CURRENT = REVISION_INDEX,
+	};
+
+	enum {
+		// Big sections (memory) are split further, so they can be decompressed in parallel.
+		CHUNK_SIZE = 512 * 1024,
+		// Sections nested deeper than this stay in the chunk of their parent.
+		CHUNK_MAX_DEPTH = 1,
+	};
+
+	struct SChunkIndexHeader
+	{
+		u32 ChunkCount;
+		u32 SectionCount;
+	};
+
+	// Chunks are stored in order after the index, and cover the state without gaps.
+	struct SChunkIndexEntry
+	{
+		u32 Start;
+		u32 Size;
+		u32 CompressedSize;
+		// Of the compressed data.
+		u32 Hash;
 	};
 
 	static Error LoadFile(const std::string &filename, const char *gitVersion, u8 *&buffer, size_t &sz, std::string *failureReason);
-	static Error SaveFile(const std::string &filename, const std::string &title, const char *gitVersion, u8 *buffer, size_t sz);
 	static Error LoadFileHeader(File::IOFile &pFile, SChunkHeader &header, std::string *title);
+	static Error LoadFileIndex(File::IOFile &pFile, const SChunkHeader &header, std::vector<SChunkIndexEntry> &chunks, std::vector<PointerWrapBuffer::Section> *sections);
 };
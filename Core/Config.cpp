@@ -461,6 +461,7 @@ static ConfigSetting graphicsSettings[] = {
 	ConfigSetting("AnisotropyLevel", &g_Config.iAnisotropyLevel, 8, true, true),
 #endif
 	ReportedConfigSetting("VertexCache", &g_Config.bVertexCache, true, true, true),
+	ReportedConfigSetting("DisplayListCache", &g_Config.bDisplayListCache, true, true, true),
 	ReportedConfigSetting("TextureBackoffCache", &g_Config.bTextureBackoffCache, false, true, true),
 	ReportedConfigSetting("TextureSecondaryCache", &g_Config.bTextureSecondaryCache, false, true, true),
 	ReportedConfigSetting("VertexDecJit", &g_Config.bVertexDecoderJit, &DefaultJit, false),
@@ -167,6 +167,7 @@ struct Config {
 	int iWindowHeight;
 
 	bool bVertexCache;
+	bool bDisplayListCache;
 	bool bTextureBackoffCache;
 	bool bTextureSecondaryCache;
 	bool bVertexDecoderJit;
@@ -18,8 +18,10 @@
 
 #include <vector>
 #include <cstdio>
+#include <string>
 
 #include "base/logging.h"
+#include "base/timeutil.h"
 #include "profiler/profiler.h"
 
 #include "Common/MsgHandler.h"
@@ -31,6 +33,7 @@
 #include "Core/HLE/sceKernelThread.h"
 #include "Core/HLE/sceDisplay.h"
 #include "Core/MIPS/MIPS.h"
+#include "Core/Replay.h"
 #include "Core/Reporting.h"
 #include "Common/ChunkFile.h"
 
@@ -76,6 +79,8 @@ Event *eventTsPool = 0;
 int allocatedTsEvents = 0;
 // Optimization to skip MoveEvents when possible.
 volatile u32 hasTsEvents = 0;
+// While playing back a replay, threadsafe events wait here until the tick they were recorded at.
+std::vector<Event *> tsHeld;
 
 // Downcount has been moved to currentMIPS, to save a couple of clocks in every ARM JIT block
 // as we can already reach that structure through a register.
@@ -217,6 +222,8 @@ void Init()
 
 void Shutdown()
 {
+	// Replays are tied to this run's ticks.
+	ReplayAbort();
 	MoveEvents();
 	ClearPendingEvents();
 	UnregisterAllEvents();
@@ -554,14 +561,31 @@ void MoveEvents()
 
 	std::lock_guard<std::recursive_mutex> lk(externalEventSection);
 	// Move events from async queue into main queue
+	const bool playing = ReplayIsPlaying();
+	const bool recording = ReplayIsRecording();
 	while (tsFirst)
 	{
 		Event *next = tsFirst->next;
-		AddEventToQueue(tsFirst);
+		if (playing)
+			tsHeld.push_back(tsFirst);
+		else
+		{
+			if (recording)
+				ReplayRecordEvent(GetTicks(), event_types[tsFirst->type].name, tsFirst->userdata, tsFirst->time);
+			AddEventToQueue(tsFirst);
+		}
 		tsFirst = next;
 	}
 	tsLast = NULL;
 
+	if (!playing && !tsHeld.empty())
+	{
+		// Playback stopped, let them all through.
+		for (size_t i = 0; i < tsHeld.size(); ++i)
+			AddEventToQueue(tsHeld[i]);
+		tsHeld.clear();
+	}
+
 	// Move free events to threadsafe pool
 	while(allocatedTsEvents > 0 && eventPool)
 	{
@@ -573,6 +597,55 @@ void MoveEvents()
 	}
 }
 
+// Returns the held event that matches, waiting for it to arrive if need be.
+static Event *TakeHeldEvent(const std::string &name, u64 userdata)
+{
+	const double timeout = time_now_d() + 5.0;
+	for (;;)
+	{
+		for (size_t i = 0; i < tsHeld.size(); ++i)
+		{
+			Event *ev = tsHeld[i];
+			if (ev->userdata == userdata && name == event_types[ev->type].name)
+			{
+				tsHeld.erase(tsHeld.begin() + i);
+				return ev;
+			}
+		}
+
+		if (time_now_d() > timeout)
+			return NULL;
+		// The thread that sends it hasn't gotten there yet.
+		sleep_ms(1);
+		MoveEvents();
+	}
+}
+
+// Queues the events the replay says arrived now, with the timing they had when recorded.
+static void ReplayQueueEvents()
+{
+	std::string name;
+	u64 userdata;
+	s64 time;
+	while (ReplayPeekEvent(GetTicks(), name, userdata, time))
+	{
+		Event *ev = TakeHeldEvent(name, userdata);
+		if (!ev)
+		{
+			ERROR_LOG(TIME, "Replay out of sync: event %s never happened", name.c_str());
+			ReplayAbort();
+			break;
+		}
+		ev->time = time;
+		AddEventToQueue(ev);
+		ReplayPopEvent();
+	}
+
+	// If that ended the playback, the rest can go now.
+	if (!ReplayIsPlaying())
+		MoveEvents();
+}
+
 void ForceCheck()
 {
 	int cyclesExecuted = slicelength - currentMIPS->downcount;
@@ -590,8 +663,10 @@ void Advance()
 	globalTimer += cyclesExecuted;
 	currentMIPS->downcount = slicelength;
 
-	if (Common::AtomicLoadAcquire(hasTsEvents))
+	if (Common::AtomicLoadAcquire(hasTsEvents) || !tsHeld.empty())
 		MoveEvents();
+	if (ReplayIsPlaying())
+		ReplayQueueEvents();
 	ProcessFifoWaitEvents();
 
 	if (!first)
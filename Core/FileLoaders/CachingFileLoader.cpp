@@ -20,10 +20,11 @@
 #include "thread/threadutil.h"
 #include "base/timeutil.h"
 #include "Core/FileLoaders/CachingFileLoader.h"
+#include "Core/FileLoaders/ReadTrace.h"
 
 // Takes ownership of backend.
 CachingFileLoader::CachingFileLoader(FileLoader *backend)
-	: filesize_(0), filepos_(0), backend_(backend), exists_(-1), isDirectory_(-1), aheadThread_(false) {
+	: filesize_(0), filepos_(0), backend_(backend), exists_(-1), isDirectory_(-1), trace_(nullptr), aheadThread_(false) {
 	filesize_ = backend->FileSize();
 	if (filesize_ > 0) {
 		InitCache();
@@ -68,6 +69,10 @@ void CachingFileLoader::Seek(s64 absolutePos) {
 }
 
 size_t CachingFileLoader::ReadAt(s64 absolutePos, size_t bytes, void *data) {
+	if (trace_) {
+		trace_->Record(absolutePos, bytes);
+	}
+
 	size_t readSize = ReadFromCache(absolutePos, bytes, data);
 	// While in case the cache size is too small for the entire read.
 	while (readSize < bytes) {
@@ -85,6 +90,9 @@ void CachingFileLoader::InitCache() {
 	cacheSize_ = 0;
 	oldestGeneration_ = 0;
 	generation_ = 0;
+
+	lock_guard guard(backendMutex_);
+	trace_ = new ReadTrace(backend_->Path(), filesize_);
 }
 
 void CachingFileLoader::ShutdownCache() {
@@ -95,6 +103,10 @@ void CachingFileLoader::ShutdownCache() {
 		sleep_ms(1);
 	}
 
+	// This saves the trace for next time.
+	delete trace_;
+	trace_ = nullptr;
+
 	lock_guard guard(blocksMutex_);
 	for (auto block : blocks_) {
 		delete [] block.second.ptr;
@@ -247,10 +259,39 @@ void CachingFileLoader::StartReadAhead(s64 pos) {
 		return;
 	}
 
+	// If we've seen this load before, read what came next last time instead.
+	std::vector<ReadTrace::Entry> upcoming;
+	if (trace_) {
+		trace_->Predict(upcoming, TRACE_READAHEAD_BYTES);
+	}
+
 	aheadThread_ = true;
-	std::thread th([this, pos] {
+	std::thread th([this, pos, upcoming] {
 		setCurrentThreadName("FileLoaderReadAhead");
 
+		if (!upcoming.empty()) {
+			for (const ReadTrace::Entry &entry : upcoming) {
+				s64 cacheStartPos = entry.pos >> BLOCK_SHIFT;
+				s64 cacheEndPos = (entry.pos + entry.size - 1) >> BLOCK_SHIFT;
+				for (s64 i = cacheStartPos; i <= cacheEndPos; ++i) {
+					blocksMutex_.lock();
+					bool cached = blocks_.find(i) != blocks_.end();
+					bool full = cacheSize_ + 1 > MAX_BLOCKS_CACHED;
+					blocksMutex_.unlock();
+
+					if (full) {
+						aheadThread_ = false;
+						return;
+					}
+					if (!cached) {
+						SaveIntoCache(i << BLOCK_SHIFT, (size_t)((cacheEndPos - i + 1) << BLOCK_SHIFT), true);
+					}
+				}
+			}
+			aheadThread_ = false;
+			return;
+		}
+
 		lock_guard guard(blocksMutex_);
 		s64 cacheStartPos = pos >> BLOCK_SHIFT;
 		s64 cacheEndPos = cacheStartPos + BLOCK_READAHEAD - 1;
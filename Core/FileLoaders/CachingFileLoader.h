@@ -22,6 +22,8 @@
 #include "Common/CommonTypes.h"
 #include "Core/Loaders.h"
 
+class ReadTrace;
+
 class CachingFileLoader : public FileLoader {
 public:
 	CachingFileLoader(FileLoader *backend);
@@ -59,6 +61,8 @@ class CachingFileLoader : public FileLoader {
 		MAX_BLOCKS_PER_READ = 16,
 		MAX_BLOCKS_CACHED = 4096, // 256 MB
 		BLOCK_READAHEAD = 4,
+		// When following a trace from a previous run, read ahead up to this much.
+		TRACE_READAHEAD_BYTES = 4 * 1024 * 1024,
 	};
 
 	s64 filesize_;
@@ -81,6 +85,7 @@ class CachingFileLoader : public FileLoader {
 	};
 
 	std::map<s64, BlockInfo> blocks_;
+	ReadTrace *trace_;
 	recursive_mutex blocksMutex_;
 	mutable recursive_mutex backendMutex_;
 	bool aheadThread_;
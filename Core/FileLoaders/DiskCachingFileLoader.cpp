@@ -19,8 +19,11 @@
 #include <cstddef>
 #include <set>
 #include <string.h>
+#include "base/timeutil.h"
 #include "file/file_util.h"
 #include "file/free.h"
+#include "thread/thread.h"
+#include "thread/threadutil.h"
 #include "util/text/utf8.h"
 #include "Common/FileUtil.h"
 #include "Core/FileLoaders/DiskCachingFileLoader.h"
@@ -32,6 +35,7 @@ static const s64 SAFETY_FREE_DISK_SPACE = 768 * 1024 * 1024; // 768 MB
 static const u32 CACHE_SPACE_FLEX = 4;
 
 std::string DiskCachingFileLoaderCache::cacheDir_;
+size_t DiskCachingFileLoaderCache::ramTierSize_ = 32 * 1024 * 1024;
 
 std::map<std::string, DiskCachingFileLoaderCache *> DiskCachingFileLoader::caches_;
 recursive_mutex DiskCachingFileLoader::cachesMutex_;
@@ -92,6 +96,13 @@ size_t DiskCachingFileLoader::ReadAt(s64 absolutePos, size_t bytes, void *data)
 	return readSize;
 }
 
+DiskCachingFileLoaderStats DiskCachingFileLoader::GetStats() {
+	if (cache_ && cache_->IsValid()) {
+		return cache_->GetStats();
+	}
+	return DiskCachingFileLoaderStats();
+}
+
 std::vector<std::string> DiskCachingFileLoader::GetCachedPathsInUse() {
 	lock_guard guard(cachesMutex_);
 
@@ -130,7 +141,8 @@ void DiskCachingFileLoader::ShutdownCache() {
 }
 
 DiskCachingFileLoaderCache::DiskCachingFileLoaderCache(const std::string &path, u64 filesize)
-	: refCount_(0), filesize_(filesize), origPath_(path), f_(nullptr), fd_(0) {
+	: refCount_(0), filesize_(filesize), origPath_(path), ramBlocks_(0), maxRamBlocks_(0),
+	  prefetchThread_(false), prefetchStop_(false), f_(nullptr), fd_(0) {
 	InitCache(path);
 }
 
@@ -142,7 +154,8 @@ void DiskCachingFileLoaderCache::InitCache(const std::string &path) {
 	cacheSize_ = 0;
 	indexCount_ = 0;
 	oldestGeneration_ = 0;
-	maxBlocks_ = MAX_BLOCKS_LOWER_BOUND;
+	blockSize_ = DetermineBlockSize();
+	maxBlocks_ = CACHE_SPACE_LOWER_BOUND / blockSize_;
 	flags_ = 0;
 	generation_ = 0;
 
@@ -167,9 +180,31 @@ void DiskCachingFileLoaderCache::InitCache(const std::string &path) {
 			CloseFileHandle();
 		}
 	}
+
+	if (f_) {
+		// Block size comes from the file if it was loaded, so size the RAM tier after.
+		ramIndex_.resize(indexCount_);
+		maxRamBlocks_ = ramTierSize_ / blockSize_;
+		StartHotPrefetch();
+	}
 }
 
 void DiskCachingFileLoaderCache::ShutdownCache() {
+	{
+		lock_guard guard(lock_);
+		prefetchStop_ = true;
+	}
+	// We can't delete while the thread is running, so have to wait.
+	while (prefetchThread_) {
+		sleep_ms(1);
+	}
+
+	if (stats_.ramHits + stats_.diskHits + stats_.misses != 0) {
+		INFO_LOG(LOADER, "Disk cache for %s: %lld RAM hits, %lld disk hits, %lld misses (%lld KB in %0.3fs), %lld prefetched",
+			origPath_.c_str(), (long long)stats_.ramHits, (long long)stats_.diskHits, (long long)stats_.misses,
+			(long long)(stats_.backendBytes / 1024), stats_.backendSeconds, (long long)stats_.prefetched);
+	}
+
 	if (f_) {
 		bool failed = false;
 		if (fseek(f_, sizeof(FileHeader), SEEK_SET) != 0) {
@@ -191,12 +226,14 @@ void DiskCachingFileLoaderCache::ShutdownCache() {
 	index_.clear();
 	blockIndexLookup_.clear();
 	cacheSize_ = 0;
+	ClearRam();
 }
 
 size_t DiskCachingFileLoaderCache::ReadFromCache(s64 pos, size_t bytes, void *data) {
 	lock_guard guard(lock_);
 
-	if (!f_) {
+	// ReadAt() asks for the rest after a miss, which may be nothing.  Don't count that as a hit.
+	if (!f_ || bytes == 0) {
 		return 0;
 	}
 
@@ -208,17 +245,38 @@ size_t DiskCachingFileLoaderCache::ReadFromCache(s64 pos, size_t bytes, void *da
 
 	for (s64 i = cacheStartPos; i <= cacheEndPos; ++i) {
 		auto &info = index_[i];
-		if (info.block == INVALID_BLOCK) {
+		size_t toRead = std::min(bytes - readSize, (size_t)blockSize_ - offset);
+
+		// The RAM copy may outlive the block on disk, it's the same data.
+		const u8 *ram = FindInRam((u32)i);
+		if (ram) {
+			memcpy(p + readSize, ram + offset, toRead);
+			++stats_.ramHits;
+		} else if (info.block == INVALID_BLOCK) {
 			return readSize;
-		}
-		info.generation = generation_;
-		if (info.hits < std::numeric_limits<u16>::max()) {
-			++info.hits;
+		} else if (maxRamBlocks_ != 0) {
+			// Read the whole block, so it can be kept in RAM for next time.
+			u8 *buf = new u8[blockSize_];
+			if (!ReadBlockData(buf, info, 0, blockSize_)) {
+				delete [] buf;
+				return readSize;
+			}
+			memcpy(p + readSize, buf + offset, toRead);
+			SaveIntoRam((u32)i, buf);
+			delete [] buf;
+			++stats_.diskHits;
+		} else {
+			if (!ReadBlockData(p + readSize, info, offset, toRead)) {
+				return readSize;
+			}
+			++stats_.diskHits;
 		}
 
-		size_t toRead = std::min(bytes - readSize, (size_t)blockSize_ - offset);
-		if (!ReadBlockData(p + readSize, info, offset, toRead)) {
-			return readSize;
+		if (info.block != INVALID_BLOCK) {
+			info.generation = generation_;
+			if (info.hits < std::numeric_limits<u16>::max()) {
+				++info.hits;
+			}
 		}
 		readSize += toRead;
 
@@ -262,7 +320,13 @@ size_t DiskCachingFileLoaderCache::SaveIntoCache(FileLoader *backend, s64 pos, s
 		auto &info = index_[cacheStartPos];
 
 		u8 *buf = new u8[blockSize_];
+		double st = real_time_now();
 		size_t readBytes = backend->ReadAt(cacheStartPos * (u64)blockSize_, blockSize_, buf);
+		stats_.backendSeconds += real_time_now() - st;
+		stats_.backendBytes += readBytes;
+		if (readBytes != 0) {
+			SaveIntoRam((u32)cacheStartPos, buf);
+		}
 
 		// Check if it was written while we were busy.  Might happen if we thread.
 		if (info.block == INVALID_BLOCK && readBytes != 0) {
@@ -278,7 +342,10 @@ size_t DiskCachingFileLoaderCache::SaveIntoCache(FileLoader *backend, s64 pos, s
 		delete [] buf;
 	} else {
 		u8 *wholeRead = new u8[blocksToRead * blockSize_];
+		double st = real_time_now();
 		size_t readBytes = backend->ReadAt(cacheStartPos * (u64)blockSize_, blocksToRead * blockSize_, wholeRead);
+		stats_.backendSeconds += real_time_now() - st;
+		stats_.backendBytes += readBytes;
 
 		for (size_t i = 0; i < blocksToRead; ++i) {
 			auto &info = index_[cacheStartPos + i];
@@ -289,15 +356,22 @@ size_t DiskCachingFileLoaderCache::SaveIntoCache(FileLoader *backend, s64 pos, s
 				// TODO: Doing each index together would probably be better.
 				WriteIndexData((u32)cacheStartPos + (u32)i, info);
 			}
+			if (readBytes != 0) {
+				SaveIntoRam((u32)cacheStartPos + (u32)i, wholeRead + (i * blockSize_));
+			}
 
 			size_t toRead = std::min(bytes - readSize, (size_t)blockSize_ - offset);
 			memcpy(p + readSize, wholeRead + (i * blockSize_) + offset, toRead);
 			readSize += toRead;
+
+			// Don't need an offset after the first block.
+			offset = 0;
 		}
 		delete[] wholeRead;
 	}
 
 	cacheSize_ += blocksToRead;
+	stats_.misses += blocksToRead;
 	++generation_;
 
 	if (generation_ == std::numeric_limits<u16>::max()) {
@@ -420,7 +494,7 @@ bool DiskCachingFileLoaderCache::ReadBlockData(u8 *dest, BlockInfo &info, size_t
 	if (!f_) {
 		return false;
 	}
-	s64 blockOffset = GetBlockOffset(info.block);
+	s64 blockOffset = GetBlockOffset(info.block) + (s64)offset;
 
 	// Before we read, make sure the buffers are flushed.
 	// We might be trying to read an area we've recently written.
@@ -430,13 +504,13 @@ bool DiskCachingFileLoaderCache::ReadBlockData(u8 *dest, BlockInfo &info, size_t
 #ifdef ANDROID
 	if (lseek64(fd_, blockOffset, SEEK_SET) != blockOffset) {
 		failed = true;
-	} else if (read(fd_, dest + offset, size) != (ssize_t)size) {
+	} else if (read(fd_, dest, size) != (ssize_t)size) {
 		failed = true;
 	}
 #else
 	if (fseeko(f_, blockOffset, SEEK_SET) != 0) {
 		failed = true;
-	} else if (fread(dest + offset, size, 1, f_) != 1) {
+	} else if (fread(dest, size, 1, f_) != 1) {
 		failed = true;
 	}
 #endif
@@ -511,7 +585,9 @@ bool DiskCachingFileLoaderCache::LoadCacheFile(const std::string &path) {
 		valid = false;
 	} else if (header.filesize != filesize_) {
 		valid = false;
-	} else if (header.maxBlocks < MAX_BLOCKS_LOWER_BOUND || header.maxBlocks > MAX_BLOCKS_UPPER_BOUND) {
+	} else if (header.blockSize < MIN_BLOCK_SIZE || header.blockSize > MAX_BLOCK_SIZE || (header.blockSize & (header.blockSize - 1)) != 0) {
+		valid = false;
+	} else if ((u64)header.maxBlocks * header.blockSize < CACHE_SPACE_LOWER_BOUND || (u64)header.maxBlocks * header.blockSize > CACHE_SPACE_UPPER_BOUND) {
 		// This means it's not in our safety bounds, reject.
 		valid = false;
 	}
@@ -580,12 +656,15 @@ void DiskCachingFileLoaderCache::LoadCacheIndex() {
 }
 
 void DiskCachingFileLoaderCache::CreateCacheFile(const std::string &path) {
+	blockSize_ = DetermineBlockSize();
+	const u32 minBlocks = CACHE_SPACE_LOWER_BOUND / blockSize_;
+
 	maxBlocks_ = DetermineMaxBlocks();
-	if (maxBlocks_ < MAX_BLOCKS_LOWER_BOUND) {
-		GarbageCollectCacheFiles(MAX_BLOCKS_LOWER_BOUND * DEFAULT_BLOCK_SIZE);
+	if (maxBlocks_ < minBlocks) {
+		GarbageCollectCacheFiles(CACHE_SPACE_LOWER_BOUND);
 		maxBlocks_ = DetermineMaxBlocks();
 	}
-	if (maxBlocks_ < MAX_BLOCKS_LOWER_BOUND) {
+	if (maxBlocks_ < minBlocks) {
 		// There's not enough free space to cache, disable.
 		f_ = nullptr;
 		ERROR_LOG(LOADER, "Not enough free space; disabling disk cache");
@@ -603,8 +682,6 @@ void DiskCachingFileLoaderCache::CreateCacheFile(const std::string &path) {
 	fd_ = fileno(f_);
 #endif
 
-	blockSize_ = DEFAULT_BLOCK_SIZE;
-
 	FileHeader header;
 	memcpy(header.magic, CACHEFILE_MAGIC, sizeof(header.magic));
 	header.version = CACHE_VERSION;
@@ -726,16 +803,18 @@ u32 DiskCachingFileLoaderCache::DetermineMaxBlocks() {
 	const s64 freeBytes = FreeDiskSpace();
 	// We want to leave them some room for other stuff.
 	const u64 availBytes = std::max(0LL, freeBytes - SAFETY_FREE_DISK_SPACE);
-	const u64 freeBlocks = availBytes / (u64)DEFAULT_BLOCK_SIZE;
+	const u64 freeBlocks = availBytes / (u64)blockSize_;
+	const u32 lowerBound = CACHE_SPACE_LOWER_BOUND / blockSize_;
+	const u32 upperBound = CACHE_SPACE_UPPER_BOUND / blockSize_;
 
 	const u32 alreadyCachedCount = CountCachedFiles();
 	// This is how many more files of free space we will aim for.
 	const u32 flex = CACHE_SPACE_FLEX > alreadyCachedCount ? CACHE_SPACE_FLEX - alreadyCachedCount : 1;
 
 	const u64 freeBlocksWithFlex = freeBlocks / flex;
-	if (freeBlocksWithFlex > MAX_BLOCKS_LOWER_BOUND) {
-		if (freeBlocksWithFlex > MAX_BLOCKS_UPPER_BOUND) {
-			return MAX_BLOCKS_UPPER_BOUND;
+	if (freeBlocksWithFlex > lowerBound) {
+		if (freeBlocksWithFlex > upperBound) {
+			return upperBound;
 		}
 		// This might be smaller than what's free, but if they try to launch a second game,
 		// they'll be happier when it can be cached too.
@@ -747,6 +826,15 @@ u32 DiskCachingFileLoaderCache::DetermineMaxBlocks() {
 	return freeBlocks;
 }
 
+u32 DiskCachingFileLoaderCache::DetermineBlockSize() {
+	// Small images get small blocks so less is read for nothing, large ones bigger blocks to keep the index small.
+	u32 blockSize = MIN_BLOCK_SIZE;
+	while (blockSize < MAX_BLOCK_SIZE && (u64)filesize_ / blockSize > TARGET_INDEX_COUNT) {
+		blockSize <<= 1;
+	}
+	return blockSize;
+}
+
 u32 DiskCachingFileLoaderCache::CountCachedFiles() {
 	std::string dir = cacheDir_;
 	if (dir.empty()) {
@@ -804,3 +892,103 @@ void DiskCachingFileLoaderCache::GarbageCollectCacheFiles(u64 goalBytes) {
 
 	// At this point, we've done all we can.
 }
+
+const u8 *DiskCachingFileLoaderCache::FindInRam(u32 indexPos) {
+	if (indexPos >= ramIndex_.size() || ramIndex_[indexPos].data == nullptr) {
+		return nullptr;
+	}
+
+	RamBlock &ram = ramIndex_[indexPos];
+	ramLRU_.splice(ramLRU_.begin(), ramLRU_, ram.lruPos);
+	return ram.data;
+}
+
+void DiskCachingFileLoaderCache::SaveIntoRam(u32 indexPos, const u8 *src) {
+	if (maxRamBlocks_ == 0 || indexPos >= ramIndex_.size()) {
+		return;
+	}
+
+	RamBlock &ram = ramIndex_[indexPos];
+	if (ram.data != nullptr) {
+		memcpy(ram.data, src, blockSize_);
+		ramLRU_.splice(ramLRU_.begin(), ramLRU_, ram.lruPos);
+		return;
+	}
+
+	u8 *data = nullptr;
+	if (ramBlocks_ >= maxRamBlocks_) {
+		// Take over the least recently used block's buffer.
+		RamBlock &oldest = ramIndex_[ramLRU_.back()];
+		data = oldest.data;
+		oldest.data = nullptr;
+		ramLRU_.pop_back();
+	} else {
+		data = new u8[blockSize_];
+		++ramBlocks_;
+	}
+
+	memcpy(data, src, blockSize_);
+	ram.data = data;
+	ramLRU_.push_front(indexPos);
+	ram.lruPos = ramLRU_.begin();
+}
+
+void DiskCachingFileLoaderCache::ClearRam() {
+	for (u32 indexPos : ramLRU_) {
+		delete [] ramIndex_[indexPos].data;
+	}
+	ramIndex_.clear();
+	ramLRU_.clear();
+	ramBlocks_ = 0;
+}
+
+void DiskCachingFileLoaderCache::StartHotPrefetch() {
+	if (!f_ || maxRamBlocks_ == 0) {
+		return;
+	}
+
+	std::vector<u32> hot;
+	for (size_t i = 0; i < index_.size(); ++i) {
+		if (index_[i].block != INVALID_BLOCK && index_[i].hits >= HOT_BLOCK_HITS) {
+			hot.push_back((u32)i);
+		}
+	}
+	if (hot.empty()) {
+		return;
+	}
+
+	std::sort(hot.begin(), hot.end(), [this](u32 a, u32 b) {
+		return index_[a].hits > index_[b].hits;
+	});
+	// Leave half the RAM tier for whatever gets read this time.
+	if (hot.size() > maxRamBlocks_ / 2) {
+		hot.resize(maxRamBlocks_ / 2);
+	}
+
+	prefetchThread_ = true;
+	std::thread th([this, hot] {
+		setCurrentThreadName("DiskCachePrefetch");
+
+		u8 *buf = new u8[blockSize_];
+		for (u32 indexPos : hot) {
+			lock_guard guard(lock_);
+			if (prefetchStop_ || !f_) {
+				break;
+			}
+
+			BlockInfo &info = index_[indexPos];
+			if (info.block == INVALID_BLOCK || ramIndex_[indexPos].data != nullptr) {
+				continue;
+			}
+			if (!ReadBlockData(buf, info, 0, blockSize_)) {
+				break;
+			}
+			SaveIntoRam(indexPos, buf);
+			++stats_.prefetched;
+		}
+		delete [] buf;
+
+		prefetchThread_ = false;
+	});
+	th.detach();
+}
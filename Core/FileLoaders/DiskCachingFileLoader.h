@@ -18,6 +18,7 @@
 #pragma once
 
 #include <vector>
+#include <list>
 #include <map>
 #include "base/mutex.h"
 #include "Common/Common.h"
@@ -25,6 +26,20 @@
 
 class DiskCachingFileLoaderCache;
 
+struct DiskCachingFileLoaderStats {
+	DiskCachingFileLoaderStats() : ramHits(0), diskHits(0), misses(0), prefetched(0), backendBytes(0), backendSeconds(0.0) {
+	}
+
+	// These count blocks.
+	u64 ramHits;
+	u64 diskHits;
+	u64 misses;
+	u64 prefetched;
+	// What reading the misses from the backend cost.
+	u64 backendBytes;
+	double backendSeconds;
+};
+
 class DiskCachingFileLoader : public FileLoader {
 public:
 	DiskCachingFileLoader(FileLoader *backend);
@@ -47,6 +62,9 @@ class DiskCachingFileLoader : public FileLoader {
 	}
 	virtual size_t ReadAt(s64 absolutePos, size_t bytes, void *data) override;
 
+	// All zeros if the cache couldn't be used.
+	DiskCachingFileLoaderStats GetStats();
+
 	static std::vector<std::string> GetCachedPathsInUse();
 
 private:
@@ -64,8 +82,15 @@ class DiskCachingFileLoader : public FileLoader {
 	static recursive_mutex cachesMutex_;
 };
 
+// Two tiers: a bounded RAM LRU of recently used blocks, over a cache file on disk.
+// Blocks are sized per image, and blocks that were hot in previous sessions are
+// loaded into RAM in the background when the cache is opened.
+// There's no read trace here: this always sits under a CachingFileLoader, which records
+// the trace and reads ahead along it through this cache, filling it as it goes.
 class DiskCachingFileLoaderCache {
 public:
+	typedef DiskCachingFileLoaderStats Stats;
+
 	DiskCachingFileLoaderCache(const std::string &path, u64 filesize);
 	~DiskCachingFileLoaderCache();
 
@@ -85,6 +110,16 @@ class DiskCachingFileLoaderCache {
 		cacheDir_ = path;
 	}
 
+	// In bytes, per open image.  0 disables the RAM tier.
+	static void SetRamTierSize(size_t bytes) {
+		ramTierSize_ = bytes;
+	}
+
+	Stats GetStats() {
+		lock_guard guard(lock_);
+		return stats_;
+	}
+
 	size_t ReadFromCache(s64 pos, size_t bytes, void *data);
 	// Guaranteed to read at least one block into the cache.
 	size_t SaveIntoCache(FileLoader *backend, s64 pos, size_t bytes, void *data);
@@ -92,6 +127,7 @@ class DiskCachingFileLoaderCache {
 private:
 	void InitCache(const std::string &path);
 	void ShutdownCache();
+	u32 DetermineBlockSize();
 	bool MakeCacheSpaceFor(size_t blocks);
 	void RebalanceGenerations();
 	u32 AllocateBlock(u32 indexPos);
@@ -116,6 +152,11 @@ class DiskCachingFileLoaderCache {
 	u32 CountCachedFiles();
 	void GarbageCollectCacheFiles(u64 goalBytes);
 
+	const u8 *FindInRam(u32 indexPos);
+	void SaveIntoRam(u32 indexPos, const u8 *src);
+	void ClearRam();
+	void StartHotPrefetch();
+
 	// File format:
 	// 64 magic
 	// 32 version
@@ -123,7 +164,7 @@ class DiskCachingFileLoaderCache {
 	// 64 filesize
 	// 32 maxBlocks
 	// 32 flags
-	// index[filesize / blockSize] <-- ~500 KB for 4GB
+	// index[filesize / blockSize] <-- ~256 KB at most
 	//   32 (fileoffset - headersize) / blockSize -> -1=not present
 	//   16 generation?
 	//   16 hits?
@@ -132,10 +173,15 @@ class DiskCachingFileLoaderCache {
 
 	enum {
 		CACHE_VERSION = 3,
-		DEFAULT_BLOCK_SIZE = 65536,
+		MIN_BLOCK_SIZE = 16384,
+		MAX_BLOCK_SIZE = 262144,
+		// Block size is picked so the index has about this many entries.
+		TARGET_INDEX_COUNT = 32768,
 		MAX_BLOCKS_PER_READ = 16,
-		MAX_BLOCKS_LOWER_BOUND = 256, // 16 MB
-		MAX_BLOCKS_UPPER_BOUND = 8192, // 512 MB
+		CACHE_SPACE_LOWER_BOUND = 16 * 1024 * 1024,
+		CACHE_SPACE_UPPER_BOUND = 512 * 1024 * 1024,
+		// Blocks read at least this many times in earlier sessions get prefetched into RAM.
+		HOT_BLOCK_HITS = 4,
 		INVALID_BLOCK = 0xFFFFFFFF,
 		INVALID_INDEX = 0xFFFFFFFF,
 	};
@@ -177,8 +223,26 @@ class DiskCachingFileLoaderCache {
 	std::vector<BlockInfo> index_;
 	std::vector<u32> blockIndexLookup_;
 
+	// RAM tier, indexed like index_.  Most recently used at the front of ramLRU_.
+	struct RamBlock {
+		RamBlock() : data(nullptr) {
+		}
+
+		u8 *data;
+		std::list<u32>::iterator lruPos;
+	};
+	std::vector<RamBlock> ramIndex_;
+	std::list<u32> ramLRU_;
+	size_t ramBlocks_;
+	size_t maxRamBlocks_;
+
+	Stats stats_;
+	bool prefetchThread_;
+	bool prefetchStop_;
+
 	FILE *f_;
 	int fd_;
 
 	static std::string cacheDir_;
+	static size_t ramTierSize_;
 };
@@ -16,31 +16,46 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <algorithm>
+#include <cstring>
 #include "base/stringutil.h"
+#include "base/timeutil.h"
+#include "thread/thread.h"
 #include "Common/Common.h"
 #include "Core/FileLoaders/HTTPFileLoader.h"
 
 HTTPFileLoader::HTTPFileLoader(const std::string &filename)
-	: filesize_(0), filepos_(0), url_(filename), filename_(filename), connected_(false) {
-	if (!client_.Resolve(url_.Host().c_str(), url_.Port())) {
+	: filesize_(0), filepos_(0), url_(filename), filename_(filename), keepAlive_(true),
+	  requestSize_(INITIAL_REQUEST_SIZE), latency_(0.0), bytesPerSecond_(0.0), tailPos_(0), lastEnd_(-1), coalescedReads_(0) {
+	for (ServerConnection &conn : connections_) {
+		conn.client.keepAlive_ = true;
+		conn.resolved = false;
+		conn.connected = false;
+		conn.closedByServer = false;
+		conn.connects = 0;
+		conn.requests = 0;
+		conn.latency = 0.0;
+		conn.bytesPerSecond = 0.0;
+	}
+
+	ServerConnection *conn = &connections_[0];
+	if (!Connect(conn)) {
 		// TODO: Should probably set some flag?
 		return;
 	}
 
-	Connect();
-	int err = client_.SendRequest("HEAD", url_.Resource().c_str());
+	conn->requests++;
+	int err = conn->client.SendRequest("HEAD", url_.Resource().c_str());
 	if (err < 0) {
-		Disconnect();
+		Disconnect(conn);
 		return;
 	}
 
-	Buffer readbuf;
 	std::vector<std::string> responseHeaders;
-	int code = client_.ReadResponseHeaders(&readbuf, responseHeaders);
+	int code = conn->client.ReadResponseHeaders(&conn->readbuf, responseHeaders);
 	if (code != 200) {
 		// Leave size at 0, invalid.
 		ERROR_LOG(LOADER, "HTTP request failed, got %03d for %s", code, filename.c_str());
-		Disconnect();
+		Disconnect(conn);
 		return;
 	}
 
@@ -69,10 +84,20 @@ HTTPFileLoader::HTTPFileLoader(const std::string &filename)
 				acceptsRange = true;
 			}
 		}
+		if (startsWithNoCase(header, "Connection:")) {
+			std::string lowerHeader = header;
+			std::transform(lowerHeader.begin(), lowerHeader.end(), lowerHeader.begin(), tolower);
+			if (lowerHeader.find("close") != lowerHeader.npos) {
+				conn->closedByServer = true;
+			}
+		}
 	}
 
-	// TODO: Keepalive instead.
-	Disconnect();
+	if (conn->closedByServer) {
+		// Then there's no point sending more than one request per connection.
+		keepAlive_ = false;
+		Disconnect(conn);
+	}
 
 	if (!acceptsRange) {
 		WARN_LOG(LOADER, "HTTP server did not advertise support for range requests.");
@@ -85,7 +110,9 @@ HTTPFileLoader::HTTPFileLoader(const std::string &filename)
 }
 
 HTTPFileLoader::~HTTPFileLoader() {
-	Disconnect();
+	for (ServerConnection &conn : connections_) {
+		Disconnect(&conn);
+	}
 }
 
 bool HTTPFileLoader::Exists() {
@@ -109,38 +136,215 @@ void HTTPFileLoader::Seek(s64 absolutePos) {
 	filepos_ = absolutePos;
 }
 
+HTTPFileLoader::Stats HTTPFileLoader::GetStats() {
+	lock_guard guard(lock_);
+	Stats stats;
+	stats.connects = 0;
+	stats.requests = 0;
+	for (const ServerConnection &conn : connections_) {
+		stats.connects += conn.connects;
+		stats.requests += conn.requests;
+	}
+	stats.coalescedReads = coalescedReads_;
+	stats.requestSize = requestSize_;
+	return stats;
+}
+
 size_t HTTPFileLoader::ReadAt(s64 absolutePos, size_t bytes, void *data) {
+	lock_guard guard(lock_);
 	s64 absoluteEnd = std::min(absolutePos + (s64)bytes, filesize_);
 	if (absolutePos >= filesize_ || bytes == 0) {
 		// Read outside of the file or no read at all, just fail immediately.
 		return 0;
 	}
+	bytes = (size_t)(absoluteEnd - absolutePos);
+	const bool sequential = absolutePos == lastEnd_;
+	lastEnd_ = absoluteEnd;
+
+	// Start with anything that came along with the previous read.
+	u8 *dest = (u8 *)data;
+	size_t readBytes = 0;
+	const s64 tailEnd = tailPos_ + (s64)tail_.size();
+	if (absolutePos >= tailPos_ && absolutePos < tailEnd) {
+		readBytes = (size_t)(std::min(absoluteEnd, tailEnd) - absolutePos);
+		memcpy(dest, &tail_[(size_t)(absolutePos - tailPos_)], readBytes);
+		if (readBytes == bytes) {
+			coalescedReads_++;
+			filepos_ = absoluteEnd;
+			return bytes;
+		}
+	}
+
+	const s64 pos = absolutePos + readBytes;
+	const size_t wanted = bytes - readBytes;
+	// When reading along sequentially, the next read will most likely follow right after.
+	// Fetch that too in the same request, rather than making a round trip for it later.
+	size_t extra = 0;
+	if (sequential && wanted < requestSize_) {
+		extra = (size_t)std::min((s64)(requestSize_ - wanted), filesize_ - absoluteEnd);
+	}
+	std::vector<u8> fetched;
+	u8 *fetchDest = dest + readBytes;
+	if (extra != 0) {
+		fetched.resize(wanted + extra);
+		fetchDest = &fetched[0];
+	}
+
+	std::vector<Range> ranges;
+	for (size_t offset = 0; offset < wanted + extra; offset += requestSize_) {
+		Range range;
+		range.pos = pos + offset;
+		range.bytes = std::min(wanted + extra - offset, requestSize_);
+		range.dest = fetchDest + offset;
+		range.done = false;
+		ranges.push_back(range);
+	}
+
+	// Spread the requests over a few connections, each with several in flight at a time.
+	const size_t numConnections = std::min(ranges.size(), (size_t)MAX_CONNECTIONS);
+	std::vector<std::vector<Range *>> assigned(numConnections);
+	for (size_t i = 0; i < ranges.size(); ++i) {
+		assigned[i % numConnections].push_back(&ranges[i]);
+	}
+	for (ServerConnection &conn : connections_) {
+		conn.latency = 0.0;
+		conn.bytesPerSecond = 0.0;
+	}
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < numConnections; ++i) {
+		threads.push_back(std::thread(&HTTPFileLoader::FetchRanges, this, &connections_[i], assigned[i]));
+	}
+	FetchRanges(&connections_[0], assigned[0]);
+	for (std::thread &th : threads) {
+		th.join();
+	}
+	UpdateRequestSize();
 
-	Connect();
+	// Only what's contiguous from the start counts, the rest will be retried.
+	size_t fetchedBytes = 0;
+	for (const Range &range : ranges) {
+		if (!range.done) {
+			break;
+		}
+		fetchedBytes += range.bytes;
+	}
+	if (extra != 0) {
+		memcpy(dest + readBytes, &fetched[0], std::min(fetchedBytes, wanted));
+		if (fetchedBytes == fetched.size()) {
+			tail_.swap(fetched);
+			tailPos_ = pos;
+		}
+	}
+
+	readBytes += std::min(fetchedBytes, wanted);
+	filepos_ = absolutePos + readBytes;
+	return readBytes;
+}
+
+bool HTTPFileLoader::Connect(ServerConnection *conn) {
+	if (conn->connected) {
+		return true;
+	}
+	if (!conn->resolved) {
+		conn->resolved = conn->client.Resolve(url_.Host().c_str(), url_.Port());
+		if (!conn->resolved) {
+			return false;
+		}
+	}
+
+	conn->readbuf.clear();
+	conn->closedByServer = false;
+	conn->connected = conn->client.Connect();
+	if (conn->connected) {
+		conn->connects++;
+	}
+	return conn->connected;
+}
+
+void HTTPFileLoader::Disconnect(ServerConnection *conn) {
+	if (conn->connected) {
+		conn->client.Disconnect();
+	}
+	conn->connected = false;
+}
 
+void HTTPFileLoader::FetchRanges(ServerConnection *conn, const std::vector<Range *> &ranges) {
+	const size_t depth = keepAlive_ ? PIPELINE_DEPTH : 1;
+	// A connection left open from before may have timed out on the server, so try once more then.
+	bool mayRetry = conn->connected;
+	size_t sent = 0;
+	size_t received = 0;
+	size_t receivedBytes = 0;
+	double startTime = real_time_now();
+
+	while (received < ranges.size()) {
+		if (!Connect(conn)) {
+			return;
+		}
+		while (sent < ranges.size() && sent - received < depth) {
+			if (!SendRangeRequest(conn, *ranges[sent])) {
+				break;
+			}
+			++sent;
+		}
+
+		double waitTime = real_time_now();
+		if (sent == received || !ReadRangeResponse(conn, *ranges[received])) {
+			Disconnect(conn);
+			if (!mayRetry) {
+				return;
+			}
+			mayRetry = false;
+			sent = received;
+			continue;
+		}
+		if (received == 0) {
+			// Count the throughput from when the data started coming in.
+			conn->latency = ranges[0]->latency;
+			startTime = waitTime + conn->latency;
+		}
+		mayRetry = false;
+		receivedBytes += ranges[received]->bytes;
+		++received;
+
+		if (conn->closedByServer || !keepAlive_) {
+			// Anything else sent on this connection is lost, so send it again on a new one.
+			Disconnect(conn);
+			sent = received;
+		}
+	}
+
+	double elapsed = real_time_now() - startTime;
+	if (elapsed > 0.0) {
+		conn->bytesPerSecond = receivedBytes / elapsed;
+	}
+}
+
+bool HTTPFileLoader::SendRangeRequest(ServerConnection *conn, const Range &range) {
 	char requestHeaders[4096];
 	// Note that the Range header is *inclusive*.
 	snprintf(requestHeaders, sizeof(requestHeaders),
-		"Range: bytes=%lld-%lld\r\n", absolutePos, absoluteEnd - 1);
+		"Range: bytes=%lld-%lld\r\n", range.pos, range.pos + (s64)range.bytes - 1);
 
-	int err = client_.SendRequest("GET", url_.Resource().c_str(), requestHeaders, nullptr);
-	if (err < 0) {
-		Disconnect();
-		return 0;
-	}
+	conn->requests++;
+	return conn->client.SendRequest("GET", url_.Resource().c_str(), requestHeaders, nullptr) >= 0;
+}
 
-	Buffer readbuf;
+bool HTTPFileLoader::ReadRangeResponse(ServerConnection *conn, Range &range) {
+	const s64 rangeEnd = range.pos + (s64)range.bytes;
+	double st = real_time_now();
 	std::vector<std::string> responseHeaders;
-	int code = client_.ReadResponseHeaders(&readbuf, responseHeaders);
+	int code = conn->client.ReadResponseHeaders(&conn->readbuf, responseHeaders);
 	if (code != 206) {
 		ERROR_LOG(LOADER, "HTTP server did not respond with range, received code=%03d", code);
-		Disconnect();
-		return 0;
+		return false;
 	}
+	range.latency = real_time_now() - st;
 
 	// TODO: Expire cache via ETag, etc.
 	// We don't support multipart/byteranges responses.
 	bool supportedResponse = false;
+	bool delimited = false;
 	for (std::string header : responseHeaders) {
 		if (startsWithNoCase(header, "Content-Range:")) {
 			// TODO: More correctness.  Whitespace can be missing or different.
@@ -148,35 +352,79 @@ size_t HTTPFileLoader::ReadAt(s64 absolutePos, size_t bytes, void *data) {
 			std::string lowerHeader = header;
 			std::transform(lowerHeader.begin(), lowerHeader.end(), lowerHeader.begin(), tolower);
 			if (sscanf(lowerHeader.c_str(), "content-range: bytes %lld-%lld/%lld", &first, &last, &total) >= 2) {
-				if (first == absolutePos && last == absoluteEnd - 1) {
+				if (first == range.pos && last == rangeEnd - 1) {
 					supportedResponse = true;
 				} else {
-					ERROR_LOG(LOADER, "Unexpected HTTP range: got %lld-%lld, wanted %lld-%lld.", first, last, absolutePos, absoluteEnd - 1);
+					ERROR_LOG(LOADER, "Unexpected HTTP range: got %lld-%lld, wanted %lld-%lld.", first, last, range.pos, rangeEnd - 1);
 				}
 			} else {
 				ERROR_LOG(LOADER, "Unexpected HTTP range response: %s", header.c_str());
 			}
+		} else if (startsWithNoCase(header, "Connection:")) {
+			std::string lowerHeader = header;
+			std::transform(lowerHeader.begin(), lowerHeader.end(), lowerHeader.begin(), tolower);
+			if (lowerHeader.find("close") != lowerHeader.npos) {
+				conn->closedByServer = true;
+			}
+		} else if (startsWithNoCase(header, "Content-Length:")) {
+			delimited = true;
+		} else if (startsWithNoCase(header, "Transfer-Encoding:")) {
+			std::string lowerHeader = header;
+			std::transform(lowerHeader.begin(), lowerHeader.end(), lowerHeader.begin(), tolower);
+			if (lowerHeader.find("chunked") != lowerHeader.npos) {
+				delimited = true;
+			}
 		}
 	}
+	if (!delimited) {
+		// The entity is read until the server closes, so nothing else can be sent on this connection.
+		conn->closedByServer = true;
+	}
 
 	// TODO: Would be nice to read directly.
 	Buffer output;
-	int res = client_.ReadResponseEntity(&readbuf, responseHeaders, &output);
+	int res = conn->client.ReadResponseEntity(&conn->readbuf, responseHeaders, &output);
 	if (res != 0) {
 		ERROR_LOG(LOADER, "Unable to read HTTP response entity: %d", res);
-		// Let's take anything we got anyway.  Not worse than returning nothing?
+		return false;
 	}
 
-	// TODO: Keepalive instead.
-	Disconnect();
-
 	if (!supportedResponse) {
 		ERROR_LOG(LOADER, "HTTP server did not respond with the range we wanted.");
-		return 0;
+		return false;
+	}
+	if (output.size() != range.bytes) {
+		ERROR_LOG(LOADER, "HTTP response was %d bytes, wanted %d.", (int)output.size(), (int)range.bytes);
+		return false;
 	}
 
-	size_t readBytes = output.size();
-	output.Take(readBytes, (char *)data);
-	filepos_ = absolutePos + readBytes;
-	return readBytes;
+	output.Take(range.bytes, (char *)range.dest);
+	range.done = true;
+	return true;
+}
+
+void HTTPFileLoader::UpdateRequestSize() {
+	for (const ServerConnection &conn : connections_) {
+		if (conn.bytesPerSecond <= 0.0) {
+			continue;
+		}
+		if (bytesPerSecond_ == 0.0) {
+			latency_ = conn.latency;
+			bytesPerSecond_ = conn.bytesPerSecond;
+		} else {
+			latency_ = latency_ * 0.75 + conn.latency * 0.25;
+			bytesPerSecond_ = bytesPerSecond_ * 0.75 + conn.bytesPerSecond * 0.25;
+		}
+	}
+	if (bytesPerSecond_ == 0.0) {
+		return;
+	}
+
+	// Big enough that the wait for each response is at most about a third of the time it takes.
+	double target = bytesPerSecond_ * latency_ * 2.0;
+	size_t size = MIN_REQUEST_SIZE;
+	while (size < MAX_REQUEST_SIZE && size < target) {
+		size *= 2;
+	}
+	requestSize_ = size;
 }
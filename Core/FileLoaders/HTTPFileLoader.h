@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <vector>
+#include "base/mutex.h"
 #include "net/http_client.h"
 #include "net/resolve.h"
 #include "net/url.h"
@@ -45,25 +47,78 @@ class HTTPFileLoader : public FileLoader {
 	}
 	virtual size_t ReadAt(s64 absolutePos, size_t bytes, void *data) override;
 
+	struct Stats {
+		int connects;
+		int requests;
+		// Reads served entirely from data fetched along with an earlier read.
+		int coalescedReads;
+		size_t requestSize;
+	};
+
+	Stats GetStats();
+
 private:
-	void Connect() {
-		if (!connected_) {
-			connected_ = client_.Connect();
-		}
-	}
+	enum {
+		MAX_CONNECTIONS = 4,
+		// Requests sent on a connection before waiting for the first response.
+		PIPELINE_DEPTH = 4,
+		MIN_REQUEST_SIZE = 64 * 1024,
+		MAX_REQUEST_SIZE = 4 * 1024 * 1024,
+		INITIAL_REQUEST_SIZE = 256 * 1024,
+	};
 
-	void Disconnect() {
-		if (connected_) {
-			client_.Disconnect();
-		}
-		connected_ = false;
-	}
+	struct ServerConnection {
+		http::Client client;
+		// Anything received past the last response, i.e. the start of the next one.
+		Buffer readbuf;
+		bool resolved;
+		bool connected;
+		// The server said it would close the connection after a response.
+		bool closedByServer;
+		int connects;
+		int requests;
+		// Measured during the last fetch, or 0 if unused.
+		double latency;
+		double bytesPerSecond;
+	};
+
+	struct Range {
+		s64 pos;
+		size_t bytes;
+		u8 *dest;
+		bool done;
+		// Time spent waiting for the response headers.
+		double latency;
+	};
+
+	bool Connect(ServerConnection *conn);
+	void Disconnect(ServerConnection *conn);
+	// Reads the ranges in order over one connection, keeping several requests in flight.
+	void FetchRanges(ServerConnection *conn, const std::vector<Range *> &ranges);
+	bool SendRangeRequest(ServerConnection *conn, const Range &range);
+	bool ReadRangeResponse(ServerConnection *conn, Range &range);
+	void UpdateRequestSize();
 
 	s64 filesize_;
 	s64 filepos_;
 	Url url_;
 	net::AutoInit netInit_;
-	http::Client client_;
 	std::string filename_;
-	bool connected_;
+
+	ServerConnection connections_[MAX_CONNECTIONS];
+	// Cleared if the server doesn't keep connections open.
+	bool keepAlive_;
+
+	// Adaptive size of each range request, based on the measured latency and throughput.
+	size_t requestSize_;
+	double latency_;
+	double bytesPerSecond_;
+
+	// Extra data read past the end of the last sequential read, to coalesce the next ones.
+	std::vector<u8> tail_;
+	s64 tailPos_;
+	s64 lastEnd_;
+	int coalescedReads_;
+
+	recursive_mutex lock_;
 };
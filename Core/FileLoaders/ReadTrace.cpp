@@ -0,0 +1,204 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstring>
+#include "base/timeutil.h"
+#include "Common/FileUtil.h"
+#include "Common/Log.h"
+#include "Core/FileLoaders/ReadTrace.h"
+#include "Core/System.h"
+
+static const char *TRACEFILE_MAGIC = "ppssppRT";
+// Sequential reads are merged into one entry up to this size.
+static const u32 MAX_MERGED_SIZE = 4 * 1024 * 1024;
+
+std::string ReadTrace::traceDir_;
+
+ReadTrace::ReadTrace(const std::string &path, s64 filesize)
+	: origPath_(path), filesize_(filesize), cursor_(0), matched_(false) {
+	startTime_ = real_time_now();
+	if (Load(MakeTraceFilePath())) {
+		INFO_LOG(LOADER, "Loaded read trace for %s, %d entries", origPath_.c_str(), (int)previous_.size());
+	}
+}
+
+ReadTrace::~ReadTrace() {
+	// A short session (e.g. quit at the title screen) shouldn't replace a longer trace.
+	if (!current_.empty() && current_.size() >= previous_.size()) {
+		Save(MakeTraceFilePath());
+	}
+}
+
+void ReadTrace::Record(s64 pos, size_t bytes) {
+	if (bytes == 0) {
+		return;
+	}
+
+	lock_guard guard(lock_);
+	if (!current_.empty() && current_.back().pos + current_.back().size == pos && current_.back().size + bytes <= MAX_MERGED_SIZE) {
+		current_.back().size += (u32)bytes;
+	} else if (current_.size() < MAX_ENTRIES) {
+		Entry entry;
+		entry.pos = pos;
+		entry.size = (u32)std::min(bytes, (size_t)MAX_MERGED_SIZE);
+		entry.ms = (u32)((real_time_now() - startTime_) * 1000.0);
+		current_.push_back(entry);
+	}
+
+	size_t index = FindInPrevious(pos);
+	matched_ = index != previous_.size();
+	if (matched_) {
+		cursor_ = index;
+	}
+}
+
+void ReadTrace::Predict(std::vector<Entry> &upcoming, size_t maxBytes) {
+	lock_guard guard(lock_);
+	if (!matched_) {
+		// We've gone off the previous path, don't guess.
+		return;
+	}
+
+	const u32 untilMs = previous_[cursor_].ms + LOOKAHEAD_MS;
+	size_t total = 0;
+	for (size_t i = cursor_; i < previous_.size() && total < maxBytes; ++i) {
+		const Entry &entry = previous_[i];
+		if (entry.ms > untilMs) {
+			break;
+		}
+		upcoming.push_back(entry);
+		total += entry.size;
+	}
+}
+
+size_t ReadTrace::FindInPrevious(s64 pos) {
+	auto contains = [&](size_t i) {
+		return previous_[i].pos <= pos && pos < previous_[i].pos + (s64)previous_[i].size;
+	};
+
+	// Most of the time, it's right where we left off.
+	const size_t windowEnd = std::min(previous_.size(), cursor_ + SEARCH_WINDOW);
+	for (size_t i = cursor_; i < windowEnd; ++i) {
+		if (contains(i)) {
+			return i;
+		}
+	}
+	// Otherwise, it might be a load we've seen elsewhere in the trace.  Entries are never
+	// longer than MAX_MERGED_SIZE, so only those starting shortly before pos can contain it.
+	auto startsBefore = [&](u32 i, s64 p) {
+		return previous_[i].pos < p;
+	};
+	auto it = std::lower_bound(previousByPos_.begin(), previousByPos_.end(), pos - (s64)MAX_MERGED_SIZE + 1, startsBefore);
+	// Prefer the earliest in the trace, like reading it in order would.
+	size_t found = previous_.size();
+	for (; it != previousByPos_.end() && previous_[*it].pos <= pos; ++it) {
+		if (*it < found && contains(*it)) {
+			found = *it;
+		}
+	}
+	return found;
+}
+
+std::string ReadTrace::MakeTraceFilePath() {
+	std::string dir = traceDir_;
+	if (dir.empty()) {
+		dir = GetSysDirectory(DIRECTORY_CACHE);
+	}
+
+	static const char *const invalidChars = "?*:/\\^|<>\"'";
+	std::string filename = origPath_;
+	for (size_t i = 0; i < filename.size(); ++i) {
+		if (strchr(invalidChars, filename[i]) != nullptr) {
+			filename[i] = '_';
+		}
+	}
+
+	return dir + "/" + filename + ".pptrace";
+}
+
+bool ReadTrace::Load(const std::string &filename) {
+	FILE *fp = File::OpenCFile(filename, "rb");
+	if (!fp) {
+		return false;
+	}
+
+	FileHeader header;
+	bool valid = true;
+	if (fread(&header, sizeof(header), 1, fp) != 1) {
+		valid = false;
+	} else if (memcmp(header.magic, TRACEFILE_MAGIC, sizeof(header.magic)) != 0) {
+		valid = false;
+	} else if (header.version != TRACE_VERSION || header.filesize != filesize_) {
+		valid = false;
+	} else if (header.count == 0 || header.count > MAX_ENTRIES) {
+		valid = false;
+	}
+
+	if (valid) {
+		previous_.resize(header.count);
+		if (fread(&previous_[0], sizeof(Entry), previous_.size(), fp) != previous_.size()) {
+			ERROR_LOG(LOADER, "Read trace for %s is truncated, ignoring", origPath_.c_str());
+			previous_.clear();
+			valid = false;
+		}
+	}
+	for (size_t i = 0; valid && i < previous_.size(); ++i) {
+		if (previous_[i].size == 0 || previous_[i].size > MAX_MERGED_SIZE) {
+			ERROR_LOG(LOADER, "Read trace for %s is damaged, ignoring", origPath_.c_str());
+			previous_.clear();
+			valid = false;
+		}
+	}
+	fclose(fp);
+
+	if (valid) {
+		previousByPos_.resize(previous_.size());
+		for (size_t i = 0; i < previous_.size(); ++i) {
+			previousByPos_[i] = (u32)i;
+		}
+		std::stable_sort(previousByPos_.begin(), previousByPos_.end(), [&](u32 a, u32 b) {
+			return previous_[a].pos < previous_[b].pos;
+		});
+	}
+	return valid;
+}
+
+void ReadTrace::Save(const std::string &filename) {
+	FILE *fp = File::OpenCFile(filename, "wb");
+	if (!fp) {
+		ERROR_LOG(LOADER, "Could not save read trace for %s", origPath_.c_str());
+		return;
+	}
+
+	FileHeader header;
+	memcpy(header.magic, TRACEFILE_MAGIC, sizeof(header.magic));
+	header.version = TRACE_VERSION;
+	header.count = (u32)current_.size();
+	header.filesize = filesize_;
+
+	bool failed = fwrite(&header, sizeof(header), 1, fp) != 1;
+	if (!failed && fwrite(&current_[0], sizeof(Entry), current_.size(), fp) != current_.size()) {
+		failed = true;
+	}
+	fclose(fp);
+
+	if (failed) {
+		ERROR_LOG(LOADER, "Could not save read trace for %s", origPath_.c_str());
+		File::Delete(filename);
+	}
+}
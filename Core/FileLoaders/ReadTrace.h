@@ -0,0 +1,87 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "base/mutex.h"
+#include "Common/Common.h"
+
+// Games read the same parts of the disc in the same order every boot and level load.
+// This records the reads made from an image, and on the next run follows along in the
+// previous trace to say what's likely to be read next, so it can be read ahead.
+class ReadTrace {
+public:
+	struct Entry {
+		s64 pos;
+		u32 size;
+		// Since the trace was opened.
+		u32 ms;
+	};
+
+	// Loads the trace from a previous run of this image, if any.
+	ReadTrace(const std::string &path, s64 filesize);
+	// Saves the trace for the next run.
+	~ReadTrace();
+
+	static void SetTraceDir(const std::string &path) {
+		traceDir_ = path;
+	}
+
+	void Record(s64 pos, size_t bytes);
+	// Adds upcoming reads from the previous run to upcoming, up to maxBytes total.
+	void Predict(std::vector<Entry> &upcoming, size_t maxBytes);
+
+private:
+	bool Load(const std::string &filename);
+	void Save(const std::string &filename);
+	std::string MakeTraceFilePath();
+	size_t FindInPrevious(s64 pos);
+
+	enum {
+		TRACE_VERSION = 1,
+		MAX_ENTRIES = 65536,
+		// How far ahead from the last match to look first.
+		SEARCH_WINDOW = 64,
+		// Don't predict reads that came much later last time.
+		LOOKAHEAD_MS = 2000,
+	};
+
+	struct FileHeader {
+		char magic[8];
+		u32_le version;
+		u32_le count;
+		s64_le filesize;
+	};
+
+	std::string origPath_;
+	s64 filesize_;
+	double startTime_;
+
+	std::vector<Entry> previous_;
+	// Indexes into previous_, sorted by position, to find reads off the expected path.
+	std::vector<u32> previousByPos_;
+	// Index of the next entry expected in previous_.
+	size_t cursor_;
+	bool matched_;
+
+	std::vector<Entry> current_;
+	recursive_mutex lock_;
+
+	static std::string traceDir_;
+};
@@ -99,7 +99,118 @@ static bool FixFilenameCase(const std::string &path, std::string &filename)
 	return retValue;
 }
 
-bool FixPathCase(std::string& basePath, std::string &path, FixPathCaseBehavior behavior)
+bool DirectoryCaseCache::FixFilenameCase(const std::string &dir, std::string &filename)
+{
+	std::string lower = filename;
+	for (size_t i = 0; i < lower.size(); i++)
+	{
+		lower[i] = tolower(lower[i]);
+	}
+
+	lock_guard guard(lock_);
+	auto listing = dirs_.find(dir);
+	bool scanned = false;
+	if (listing == dirs_.end())
+	{
+		if (dirs_.size() >= MAX_CACHED_DIRS)
+			dirs_.clear();
+		listing = dirs_.insert(std::make_pair(dir, Listing())).first;
+		if (!Scan(dir, listing->second))
+		{
+			dirs_.erase(listing);
+			return false;
+		}
+		scanned = true;
+	}
+
+	auto name = listing->second.names.find(lower);
+	if (name == listing->second.names.end())
+	{
+		// Something other than us may have created it since we looked.
+		if (scanned || IsCurrent(dir, listing->second))
+			return false;
+		if (!Scan(dir, listing->second))
+		{
+			dirs_.erase(listing);
+			return false;
+		}
+		name = listing->second.names.find(lower);
+		if (name == listing->second.names.end())
+			return false;
+	}
+
+	// When names only differ in case, keep an exact match if there is one.
+	if (listing->second.ambiguous.count(lower) != 0 && File::Exists(dir + filename))
+		return true;
+
+	filename = name->second;
+	return true;
+}
+
+void DirectoryCaseCache::Invalidate(const std::string &path)
+{
+	lock_guard guard(lock_);
+	for (auto it = dirs_.begin(); it != dirs_.end(); )
+	{
+		const std::string &dir = it->first;
+		// The directories containing path, and path itself and everything under it.
+		if (path.compare(0, dir.size(), dir) == 0 || dir.compare(0, path.size(), path) == 0)
+			it = dirs_.erase(it);
+		else
+			++it;
+	}
+}
+
+bool DirectoryCaseCache::Scan(const std::string &dir, Listing &listing)
+{
+	struct stat st;
+	if (stat(dir.c_str(), &st) != 0)
+		return false;
+
+	DIR *dirp = opendir(dir.c_str());
+	if (!dirp)
+		return false;
+
+	listing.names.clear();
+	listing.ambiguous.clear();
+	listing.mtime = st.st_mtime;
+	listing.scanned = time(nullptr);
+
+	struct dirent *result;
+	while ((result = readdir(dirp)) != NULL)
+	{
+		std::string name = result->d_name;
+		std::string lower = name;
+		for (size_t i = 0; i < lower.size(); i++)
+		{
+			lower[i] = tolower(lower[i]);
+		}
+
+		auto inserted = listing.names.insert(std::make_pair(lower, name));
+		if (!inserted.second)
+		{
+			// Like a scan, the last one wins if there's no exact match.
+			inserted.first->second = name;
+			listing.ambiguous.insert(lower);
+		}
+	}
+
+	closedir(dirp);
+	return true;
+}
+
+bool DirectoryCaseCache::IsCurrent(const std::string &dir, const Listing &listing)
+{
+	struct stat st;
+	if (stat(dir.c_str(), &st) != 0 || st.st_mtime != listing.mtime)
+		return false;
+
+	// Timestamps can be coarse (2 seconds on FAT), so a scan made right after a change may
+	// have missed another one within the same tick.  Only trust it once it's clearly older.
+	return listing.scanned - listing.mtime > 2;
+}
+
+bool FixPathCase(std::string& basePath, std::string &path, FixPathCaseBehavior behavior, DirectoryCaseCache *cache)
 {
 	size_t len = path.size();
 
@@ -130,7 +241,8 @@ bool FixPathCase(std::string& basePath, std::string &path, FixPathCaseBehavior b
 			std::string component = path.substr(start, i - start);
 
 			// Fix case and stop on nonexistant path component
-			if (FixFilenameCase(fullPath, component) == false) {
+			bool found = cache ? cache->FixFilenameCase(fullPath, component) : FixFilenameCase(fullPath, component);
+			if (!found) {
 				// Still counts as success if partial matches allowed or if this
 				// is the last component and only the ones before it are required
 				return (behavior == FPC_PARTIAL_ALLOWED || (behavior == FPC_PATH_MUST_EXIST && i >= len));
@@ -172,7 +284,7 @@ std::string DirectoryFileHandle::GetLocalPath(std::string& basePath, std::string
 	return basePath + localpath;
 }
 
-bool DirectoryFileHandle::Open(std::string &basePath, std::string &fileName, FileAccess access, u32 &error)
+bool DirectoryFileHandle::Open(std::string &basePath, std::string &fileName, FileAccess access, u32 &error, DirectoryCaseCache *caseCache)
 {
 	error = 0;
 
@@ -180,7 +292,7 @@ bool DirectoryFileHandle::Open(std::string &basePath, std::string &fileName, Fil
 	if (access & (FILEACCESS_APPEND|FILEACCESS_CREATE|FILEACCESS_WRITE))
 	{
 		DEBUG_LOG(FILESYS, "Checking case for path %s", fileName.c_str());
-		if ( ! FixPathCase(basePath, fileName, FPC_PATH_MUST_EXIST) )
+		if ( ! FixPathCase(basePath, fileName, FPC_PATH_MUST_EXIST, caseCache) )
 			return false;  // or go on and attempt (for a better error code than just 0?)
 	}
 	// else we try fopen first (in case we're lucky) before simulating case insensitivity
@@ -249,7 +361,7 @@ bool DirectoryFileHandle::Open(std::string &basePath, std::string &fileName, Fil
 
 #if HOST_IS_CASE_SENSITIVE
 	if (!success && !(access & FILEACCESS_CREATE)) {
-		if ( ! FixPathCase(basePath,fileName, FPC_PATH_MUST_EXIST) )
+		if ( ! FixPathCase(basePath,fileName, FPC_PATH_MUST_EXIST, caseCache) )
 			return 0;  // or go on and attempt (for a better error code than just 0?)
 		fullName = GetLocalPath(basePath,fileName); 
 		const char *fullNameC = fullName.c_str();
@@ -267,6 +379,12 @@ bool DirectoryFileHandle::Open(std::string &basePath, std::string &fileName, Fil
 	}
 #endif
 
+#if HOST_IS_CASE_SENSITIVE
+	if (success && caseCache && (access & FILEACCESS_CREATE)) {
+		caseCache->Invalidate(fullName);
+	}
+#endif
+
 #ifndef _WIN32
 	if (success) {
 		struct stat st;
@@ -434,10 +552,13 @@ bool DirectoryFileSystem::MkDir(const std::string &dirname) {
 	// duplicate (different case) directories
 
 	std::string fixedCase = dirname;
-	if ( ! FixPathCase(basePath,fixedCase, FPC_PARTIAL_ALLOWED) )
+	if ( ! FixPathCase(basePath,fixedCase, FPC_PARTIAL_ALLOWED, &caseCache) )
 		return false;
 
-	return File::CreateFullPath(GetLocalPath(fixedCase));
+	std::string fullName = GetLocalPath(fixedCase);
+	bool success = File::CreateFullPath(fullName);
+	caseCache.Invalidate(fullName);
+	return success;
 #else
 	return File::CreateFullPath(GetLocalPath(dirname));
 #endif
@@ -448,15 +569,18 @@ bool DirectoryFileSystem::RmDir(const std::string &dirname) {
 
 #if HOST_IS_CASE_SENSITIVE
 	// Maybe we're lucky?
-	if (File::DeleteDirRecursively(fullName))
+	if (File::DeleteDirRecursively(fullName)) {
+		caseCache.Invalidate(fullName);
 		return true;
+	}
 
 	// Nope, fix case and try again
 	fullName = dirname;
-	if ( ! FixPathCase(basePath,fullName, FPC_FILE_MUST_EXIST) )
+	if ( ! FixPathCase(basePath,fullName, FPC_FILE_MUST_EXIST, &caseCache) )
 		return false;  // or go on and attempt (for a better error code than just false?)
 
 	fullName = GetLocalPath(fullName);
+	caseCache.Invalidate(fullName);
 #endif
 
 /*#ifdef _WIN32
@@ -488,7 +612,7 @@ int DirectoryFileSystem::RenameFile(const std::string &from, const std::string &
 
 #if HOST_IS_CASE_SENSITIVE
 	// In case TO should overwrite a file with different case
-	if ( ! FixPathCase(basePath,fullTo, FPC_PATH_MUST_EXIST) )
+	if ( ! FixPathCase(basePath,fullTo, FPC_PATH_MUST_EXIST, &caseCache) )
 		return -1;  // or go on and attempt (for a better error code than just false?)
 #endif
 
@@ -506,7 +630,7 @@ int DirectoryFileSystem::RenameFile(const std::string &from, const std::string &
 	{
 		// May have failed due to case sensitivity on FROM, so try again
 		fullFrom = from;
-		if ( ! FixPathCase(basePath,fullFrom, FPC_FILE_MUST_EXIST) )
+		if ( ! FixPathCase(basePath,fullFrom, FPC_FILE_MUST_EXIST, &caseCache) )
 			return -1;  // or go on and attempt (for a better error code than just false?)
 		fullFrom = GetLocalPath(fullFrom);
 
@@ -516,6 +640,11 @@ int DirectoryFileSystem::RenameFile(const std::string &from, const std::string &
 		retValue = (0 == rename(fullFrom.c_str(), fullToC));
 #endif
 	}
+
+	if (retValue) {
+		caseCache.Invalidate(fullFrom);
+		caseCache.Invalidate(fullTo);
+	}
 #endif
 
 	// TODO: Better error codes.
@@ -535,7 +664,7 @@ bool DirectoryFileSystem::RemoveFile(const std::string &filename) {
 	{
 		// May have failed due to case sensitivity, so try again
 		fullName = filename;
-		if ( ! FixPathCase(basePath,fullName, FPC_FILE_MUST_EXIST) )
+		if ( ! FixPathCase(basePath,fullName, FPC_FILE_MUST_EXIST, &caseCache) )
 			return false;  // or go on and attempt (for a better error code than just false?)
 		fullName = GetLocalPath(fullName);
 
@@ -545,6 +674,10 @@ bool DirectoryFileSystem::RemoveFile(const std::string &filename) {
 		retValue = (0 == unlink(fullName.c_str()));
 #endif
 	}
+
+	if (retValue) {
+		caseCache.Invalidate(fullName);
+	}
 #endif
 
 	return retValue;
@@ -553,7 +686,7 @@ bool DirectoryFileSystem::RemoveFile(const std::string &filename) {
 u32 DirectoryFileSystem::OpenFile(std::string filename, FileAccess access, const char *devicename) {
 	OpenFileEntry entry;
 	u32 err = 0;
-	bool success = entry.hFile.Open(basePath, filename, access, err);
+	bool success = entry.hFile.Open(basePath, filename, access, err, &caseCache);
 
 	if (!success) {
 #ifdef _WIN32
@@ -663,7 +796,7 @@ PSPFileInfo DirectoryFileSystem::GetFileInfo(std::string filename) {
 	std::string fullName = GetLocalPath(filename);
 	if (!File::Exists(fullName)) {
 #if HOST_IS_CASE_SENSITIVE
-		if (! FixPathCase(basePath,filename, FPC_FILE_MUST_EXIST))
+		if (! FixPathCase(basePath,filename, FPC_FILE_MUST_EXIST, &caseCache))
 			return x;
 		fullName = GetLocalPath(filename);
 
@@ -764,7 +897,7 @@ std::vector<PSPFileInfo> DirectoryFileSystem::GetDirListing(std::string path) {
 	DIR *dp = opendir(localPath.c_str());
 
 #if HOST_IS_CASE_SENSITIVE
-	if (dp == NULL && FixPathCase(basePath,path, FPC_FILE_MUST_EXIST)) {
+	if (dp == NULL && FixPathCase(basePath,path, FPC_FILE_MUST_EXIST, &caseCache)) {
 		// May have failed due to case sensitivity, try again
 		localPath = GetLocalPath(path);
 		dp = opendir(localPath.c_str());
@@ -806,7 +939,7 @@ u64 DirectoryFileSystem::FreeSpace(const std::string &path) {
 
 #if HOST_IS_CASE_SENSITIVE
 	std::string fixedCase = path;
-	if (FixPathCase(basePath, fixedCase, FPC_FILE_MUST_EXIST)) {
+	if (FixPathCase(basePath, fixedCase, FPC_FILE_MUST_EXIST, &caseCache)) {
 		// May have failed due to case sensitivity, try again.
 		if (free_disk_space(GetLocalPath(fixedCase), result)) {
 			return result;
@@ -844,7 +977,7 @@ void DirectoryFileSystem::DoState(PointerWrap &p) {
 			p.Do(entry.guestFilename);
 			p.Do(entry.access);
 			u32 err;
-			if (!entry.hFile.Open(basePath,entry.guestFilename,entry.access, err)) {
+			if (!entry.hFile.Open(basePath,entry.guestFilename,entry.access, err, &caseCache)) {
 				ERROR_LOG(FILESYS, "Failed to reopen file while loading state: %s", entry.guestFilename.c_str());
 				continue;
 			}
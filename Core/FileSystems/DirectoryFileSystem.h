@@ -19,8 +19,12 @@
 
 // TODO: Remove the Windows-specific code, FILE is fine there too.
 
+#include <ctime>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 
+#include "base/mutex.h"
 #include "../Core/FileSystems/FileSystem.h"
 
 #ifdef _WIN32
@@ -47,6 +51,37 @@ typedef void * HANDLE;
 
 #endif
 
+// Remembers the names in host directories by their lowercase form, so that fixing the case
+// of a path is a lookup rather than a scan of each directory along the way.
+// Only used on case sensitive hosts.
+class DirectoryCaseCache {
+public:
+	// dir is a host path ending in a slash.  Returns false if nothing in it matches filename.
+	bool FixFilenameCase(const std::string &dir, std::string &filename);
+	// Call after creating, removing or renaming path on the host.
+	void Invalidate(const std::string &path);
+
+private:
+	enum {
+		MAX_CACHED_DIRS = 256,
+	};
+
+	struct Listing {
+		// Lowercase name -> name on the host.
+		std::unordered_map<std::string, std::string> names;
+		// Lowercase names with more than one match on the host.
+		std::unordered_set<std::string> ambiguous;
+		time_t mtime;
+		time_t scanned;
+	};
+
+	bool Scan(const std::string &dir, Listing &listing);
+	bool IsCurrent(const std::string &dir, const Listing &listing);
+
+	std::unordered_map<std::string, Listing> dirs_;
+	recursive_mutex lock_;
+};
+
 #if HOST_IS_CASE_SENSITIVE
 enum FixPathCaseBehavior {
 	FPC_FILE_MUST_EXIST,  // all path components must exist (rmdir, move from)
@@ -54,7 +89,7 @@ enum FixPathCaseBehavior {
 	FPC_PARTIAL_ALLOWED,  // don't care how many exist (mkdir recursive)
 };
 
-bool FixPathCase(std::string& basePath, std::string &path, FixPathCaseBehavior behavior);
+bool FixPathCase(std::string& basePath, std::string &path, FixPathCaseBehavior behavior, DirectoryCaseCache *cache = nullptr);
 #endif
 
 struct DirectoryFileHandle
@@ -77,7 +112,7 @@ struct DirectoryFileHandle
 	}
 
 	std::string GetLocalPath(std::string& basePath, std::string localpath);
-	bool Open(std::string& basePath, std::string& fileName, FileAccess access, u32 &err);
+	bool Open(std::string& basePath, std::string& fileName, FileAccess access, u32 &err, DirectoryCaseCache *caseCache = nullptr);
 	size_t Read(u8* pointer, s64 size);
 	size_t Write(const u8* pointer, s64 size);
 	size_t Seek(s32 position, FileMove type);
@@ -125,6 +160,7 @@ class DirectoryFileSystem : public IFileSystem {
 	std::string basePath;
 	IHandleAllocator *hAlloc;
 	int flags;
+	DirectoryCaseCache caseCache;
 	// In case of Windows: Translate slashes, etc.
 	std::string GetLocalPath(std::string localpath);
 };
@@ -121,6 +121,9 @@ class IFileSystem {
 	virtual int      DevType(u32 handle) = 0;
 	virtual int      Flags() = 0;
 	virtual u64      FreeSpace(const std::string &path) = 0;
+
+	// Systems that wrap another one return it, so all their mounts share one lock.
+	virtual IFileSystem *LockOwner() { return this; }
 };
 
 
@@ -195,33 +195,69 @@ ISOFileSystem::ISOFileSystem(IHandleAllocator *_hAlloc, BlockDevice *_blockDevic
 	entireISO.size = _blockDevice->GetNumBlocks();
 	entireISO.flags = 0;
 	entireISO.parent = NULL;
+	entireISO.valid = true;
 
-	treeroot = new TreeEntry();
+	treeArenaUsed_ = 0;
+	treeroot = NewTreeEntry();
 	treeroot->isDirectory = true;
 	treeroot->startingPosition = 0;
 	treeroot->size = 0;
 	treeroot->flags = 0;
 	treeroot->parent = NULL;
+	treeroot->valid = true;
+
+	rootDirSector_ = 0;
+	rootDirSize_ = 0;
 
 	if (memcmp(desc.cd001, "CD001", 5)) {
 		ERROR_LOG(FILESYS, "ISO looks bogus? Giving up...");
 		return;
 	}
 
-	u32 rootSector = desc.root.firstDataSector();
-	u32 rootSize = desc.root.dataLength();
-
-	ReadDirectory(rootSector, rootSize, treeroot, 0);
+	// The tree is read one directory at a time, as paths are looked up.
+	rootDirSector_ = desc.root.firstDataSector();
+	rootDirSize_ = desc.root.dataLength();
+	treeroot->valid = false;
 }
 
 ISOFileSystem::~ISOFileSystem()
 {
 	delete blockDevice;
-	delete treeroot;
+	for (size_t i = 0; i < treeArena_.size(); ++i)
+		delete [] treeArena_[i];
+	treeArena_.clear();
 }
 
-void ISOFileSystem::ReadDirectory(u32 startsector, u32 dirsize, TreeEntry *root, size_t level)
+ISOFileSystem::TreeEntry *ISOFileSystem::NewTreeEntry()
 {
+	if (treeArena_.empty() || treeArenaUsed_ == TREE_ARENA_BLOCK_SIZE) {
+		treeArena_.push_back(new TreeEntry[TREE_ARENA_BLOCK_SIZE]);
+		treeArenaUsed_ = 0;
+	}
+	return &treeArena_.back()[treeArenaUsed_++];
+}
+
+void ISOFileSystem::ReadDirectory(TreeEntry *root)
+{
+	root->valid = true;
+
+	u32 startsector = root->startingPosition / 2048;
+	u32 dirsize = (u32)root->size;
+	if (root == treeroot) {
+		// The root reports itself as sector 0, size 0, so its location is kept separately.
+		startsector = rootDirSector_;
+		dirsize = rootDirSize_;
+	}
+
+	size_t level = 0;
+	for (TreeEntry *cur = root; cur != treeroot && cur != NULL; cur = cur->parent)
+		++level;
+
+	// Children are indexed under their full path (no leading slash.)
+	std::string prefix = EntryFullPath(root);
+	if (!prefix.empty())
+		prefix = prefix.substr(1) + "/";
+
 	for (u32 secnum = startsector, endsector = dirsize/2048 + startsector; secnum < endsector; ++secnum)
 	{
 		u8 theSector[2048];
@@ -249,33 +285,25 @@ void ISOFileSystem::ReadDirectory(u32 startsector, u32 dirsize, TreeEntry *root,
 			bool isFile = (dir.flags & 2) ? false : true;
 			bool relative;
 
-			TreeEntry *e = new TreeEntry();
+			std::string name;
 			if (dir.identifierLength == 1 && (dir.firstIdChar == '\x00' || dir.firstIdChar == '.'))
 			{
-				e->name = ".";
+				name = ".";
 				relative = true;
 			}
 			else if (dir.identifierLength == 1 && dir.firstIdChar == '\x01')
 			{
-				e->name = "..";
+				name = "..";
 				relative = true;
 			}
 			else
 			{
-				e->name = std::string((const char *)&dir.firstIdChar, dir.identifierLength);
+				name = std::string((const char *)&dir.firstIdChar, dir.identifierLength);
 				relative = false;
 			}
 
-			e->size = dir.dataLength();
-			e->startingPosition = dir.firstDataSector() * 2048;
-			e->isDirectory = !isFile;
-			e->flags = dir.flags;
-			e->parent = root;
-
-			// Let's not excessively spam the log - I commented this line out.
-			//DEBUG_LOG(FILESYS, "%s: %s %08x %08x %i", e->isDirectory?"D":"F", e->name.c_str(), dir.firstDataSectorLE, e->startingPosition, e->startingPosition);
-
-			if (e->isDirectory && !relative)
+			bool loadLater = false;
+			if (!isFile && !relative)
 			{
 				if (dir.firstDataSector() == startsector)
 				{
@@ -283,20 +311,32 @@ void ISOFileSystem::ReadDirectory(u32 startsector, u32 dirsize, TreeEntry *root,
 				}
 				else
 				{
-					bool doRecurse = true;
+					loadLater = true;
 					if (!restrictTree.empty())
-						doRecurse = level < restrictTree.size() && restrictTree[level] == e->name;
+						loadLater = level < restrictTree.size() && restrictTree[level] == name;
 
-					if (doRecurse) {
-						ReadDirectory(dir.firstDataSector(), dir.dataLength(), e, level + 1);
-					} else {
-						// The entry is not kept, must free it.
-						delete e;
+					// The entry is not kept, don't bother allocating it.
+					if (!loadLater)
 						continue;
-					}
 				}
 			}
+
+			TreeEntry *e = NewTreeEntry();
+			e->name = name;
+			e->size = dir.dataLength();
+			e->startingPosition = dir.firstDataSector() * 2048;
+			e->isDirectory = !isFile;
+			e->flags = dir.flags;
+			e->parent = root;
+			e->valid = !loadLater;
+
+			// Let's not excessively spam the log - I commented this line out.
+			//DEBUG_LOG(FILESYS, "%s: %s %08x %08x %i", e->isDirectory?"D":"F", e->name.c_str(), dir.firstDataSectorLE, e->startingPosition, e->startingPosition);
+
 			root->children.push_back(e);
+
+			// On duplicate names, the first entry wins and the others can only be listed.
+			pathIndex_.insert(std::make_pair(prefix + name, e));
 		}
 	}
 }
@@ -323,50 +363,43 @@ ISOFileSystem::TreeEntry *ISOFileSystem::GetFromPath(const std::string &path, bo
 	if (pathLength <= pathIndex)
 		return treeroot;
 
+	lock_guard guard(treeLock_);
+
+	// A single trailing slash is allowed, as when walking the tree one component at a time.
+	size_t keyLength = pathLength - pathIndex;
+	if (path[pathLength - 1] == '/')
+		--keyLength;
+
+	const std::string key = path.substr(pathIndex, keyLength);
+	PathIndex::const_iterator it = pathIndex_.find(key);
+	if (it != pathIndex_.end())
+		return it->second;
+
+	// Not seen yet, read in each directory along the way that hasn't been.
 	TreeEntry *e = treeroot;
+	size_t componentStart = 0;
 	while (true)
 	{
-		TreeEntry *ne = nullptr;
-		std::string name = "";
-		if (pathLength > pathIndex)
-		{
-			size_t nextSlashIndex = path.find_first_of('/', pathIndex);
-			if (nextSlashIndex == std::string::npos)
-				nextSlashIndex = pathLength;
+		if (!e->valid)
+			ReadDirectory(e);
 
-			const std::string firstPathComponent = path.substr(pathIndex, nextSlashIndex - pathIndex);
-			for (size_t i = 0; i < e->children.size(); i++)
-			{
-				const std::string &n = e->children[i]->name;
-				
-				if (firstPathComponent == n)
-				{
-					//yay we got it
-					ne = e->children[i];
-					name = n;
-					break;
-				}
-			}
-		}
-		
-		if (ne)
-		{
-			e = ne;
-			pathIndex += name.length();
-			if (pathIndex < pathLength && path[pathIndex] == '/')
-				++pathIndex;
+		size_t componentEnd = key.find('/', componentStart);
+		if (componentEnd == key.npos)
+			componentEnd = key.length();
 
-			if (pathLength <= pathIndex)
-				return e;
-		}
-		else
-		{
-			if (catchError)
-				ERROR_LOG(FILESYS,"File %s not found", path.c_str());
+		it = pathIndex_.find(key.substr(0, componentEnd));
+		if (it == pathIndex_.end())
+			break;
 
-			return 0;
-		}
+		e = it->second;
+		if (componentEnd >= key.length())
+			return e;
+		componentStart = componentEnd + 1;
 	}
+
+	if (catchError)
+		ERROR_LOG(FILESYS, "File %s not found", path.c_str());
+	return 0;
 }
 
 u32 ISOFileSystem::OpenFile(std::string filename, FileAccess access, const char *devicename)
@@ -703,9 +736,12 @@ PSPFileInfo ISOFileSystem::GetFileInfo(std::string filename)
 std::vector<PSPFileInfo> ISOFileSystem::GetDirListing(std::string path)
 {
 	std::vector<PSPFileInfo> myVector;
+	lock_guard guard(treeLock_);
 	TreeEntry *entry = GetFromPath(path);
 	if (! entry)
 		return myVector;
+	if (!entry->valid)
+		ReadDirectory(entry);
 
 	const std::string dot(".");
 	const std::string dotdot("..");
@@ -759,12 +795,6 @@ std::string ISOFileSystem::EntryFullPath(TreeEntry *e)
 	return path;
 }
 
-ISOFileSystem::TreeEntry::~TreeEntry() {
-	for (size_t i = 0; i < children.size(); ++i)
-		delete children[i];
-	children.clear();
-}
-
 void ISOFileSystem::DoState(PointerWrap &p)
 {
 	auto s = p.Section("ISOFileSystem", 1, 2);
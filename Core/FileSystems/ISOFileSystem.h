@@ -19,7 +19,9 @@
 
 #include <map>
 #include <list>
+#include <unordered_map>
 
+#include "base/mutex.h"
 #include "FileSystem.h"
 
 #include "BlockDevices.h"
@@ -55,15 +57,17 @@ class ISOFileSystem : public IFileSystem {
 	bool RemoveFile(const std::string &filename) override { return false; }
 
 private:
+	// Owned by the arena below, never deleted individually.
 	struct TreeEntry {
 		TreeEntry(){}
-		~TreeEntry();
 
 		std::string name;
 		u32 flags;
 		u32 startingPosition;
 		s64 size;
 		bool isDirectory;
+		// For directories, whether children have been read from the disc yet.
+		bool valid;
 
 		TreeEntry *parent;
 		std::vector<TreeEntry *> children;
@@ -82,6 +86,8 @@ class ISOFileSystem : public IFileSystem {
 	EntryMap entries;
 	IHandleAllocator *hAlloc;
 	TreeEntry *treeroot;
+	u32 rootDirSector_;
+	u32 rootDirSize_;
 	BlockDevice *blockDevice;
 	u32 lastReadBlock_;
 
@@ -90,7 +96,20 @@ class ISOFileSystem : public IFileSystem {
 	// Don't use this in the emu, not savestated.
 	std::vector<std::string> restrictTree;
 
-	void ReadDirectory(u32 startsector, u32 dirsize, TreeEntry *root, size_t level);
+	// TreeEntries are allocated in blocks, since large discs have tens of thousands of them.
+	enum { TREE_ARENA_BLOCK_SIZE = 256 };
+	std::vector<TreeEntry *> treeArena_;
+	size_t treeArenaUsed_;
+
+	// Full paths relative to the root (no leading slash) to entries, filled in as directories are read.
+	typedef std::unordered_map<std::string, TreeEntry *> PathIndex;
+	PathIndex pathIndex_;
+	// Guards the tree and index above, since directories are read in on first use and paths
+	// may be looked up from more than one thread.
+	recursive_mutex treeLock_;
+
+	TreeEntry *NewTreeEntry();
+	void ReadDirectory(TreeEntry *root);
 	TreeEntry *GetFromPath(const std::string &path, bool catchError = true);
 	std::string EntryFullPath(TreeEntry *e);
 };
@@ -137,6 +156,7 @@ class ISOBlockSystem : public IFileSystem {
 	}
 	int      Flags() override { return isoFileSystem_->Flags(); }
 	u64      FreeSpace(const std::string &path) override { return isoFileSystem_->FreeSpace(path); }
+	IFileSystem *LockOwner() override { return isoFileSystem_; }
 
 	size_t WriteFile(u32 handle, const u8 *pointer, s64 size) override {
 		return isoFileSystem_->WriteFile(handle, pointer, size);
@@ -16,7 +16,7 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <algorithm>
-#include <set>
+#include <map>
 
 #include "Common/ChunkFile.h"
 #include "Common/StringUtils.h"
@@ -164,21 +164,92 @@ static bool RealPath(const std::string &currentDirectory, const std::string &inP
 	return true;
 }
 
-IFileSystem *MetaFileSystem::GetHandleOwner(u32 handle)
+MetaFileSystem::MountTablePtr MetaFileSystem::GetMountTable()
 {
-	lock_guard guard(lock);
-	for (size_t i = 0; i < fileSystems.size(); i++)
+	lock_guard guard(mountLock);
+	return fileSystems;
+}
+
+void MetaFileSystem::SetMountTable(MountTable *table)
+{
+	for (size_t i = 0; i < table->mounts.size(); i++)
+	{
+		std::string prefix = table->mounts[i].prefix;
+		std::transform(prefix.begin(), prefix.end(), prefix.begin(), tolower);
+		// The first one mounted wins.
+		table->prefixes.insert(std::make_pair(prefix, i));
+	}
+
+	lock_guard guard(mountLock);
+	fileSystems.reset(table);
+}
+
+bool MetaFileSystem::IsMounted(const MountPoint &mount)
+{
+	// Unmount and Remount swap the table while holding the lock, and nothing is deleted before
+	// that.  So if it's still here with the same lock, it can't go away until we unlock.
+	MountTablePtr table = GetMountTable();
+	for (size_t i = 0; i < table->mounts.size(); i++)
 	{
-		if (fileSystems[i].system->OwnsHandle(handle))
-			return fileSystems[i].system; //got it!
+		if (table->mounts[i].system == mount.system && table->mounts[i].lock == mount.lock)
+			return true;
+	}
+	return false;
+}
+
+MetaFileSystem::MountGuard::MountGuard(MetaFileSystem *meta, const MountPoint &mount) : lock_(mount.lock)
+{
+	lock_->lock();
+	mounted_ = meta->IsMounted(mount);
+}
+
+MetaFileSystem::MountGuard::~MountGuard()
+{
+	lock_->unlock();
+}
+
+bool MetaFileSystem::GetHandleOwner(u32 handle, MountPoint &mount)
+{
+	{
+		lock_guard guard(handleLock);
+		auto owner = handleOwners.find(handle);
+		if (owner != handleOwners.end())
+		{
+			mount = owner->second;
+			return true;
+		}
+	}
+
+	// Not opened through us, or since a state was loaded.  Ask around.
+	// Mustn't hold handleLock here, file systems take it (in GetNewHandle) under their own lock.
+	MountTablePtr table = GetMountTable();
+	for (size_t i = 0; i < table->mounts.size(); i++)
+	{
+		const MountPoint &candidate = table->mounts[i];
+		MountGuard systemGuard(this, candidate);
+		if (systemGuard.Mounted() && candidate.system->OwnsHandle(handle))
+		{
+			// Remembered while locked, so it can't be forgotten by an unmount first.
+			lock_guard guard(handleLock);
+			handleOwners[handle] = candidate;
+			mount = candidate;
+			return true;
+		}
 	}
 	//none found?
+	return false;
+}
+
+IFileSystem *MetaFileSystem::GetHandleOwner(u32 handle)
+{
+	MountPoint mount;
+	if (GetHandleOwner(handle, mount))
+		return mount.system; //got it!
 	return 0;
 }
 
-bool MetaFileSystem::MapFilePath(const std::string &_inpath, std::string &outpath, MountPoint **system)
+bool MetaFileSystem::MapFilePath(const std::string &_inpath, std::string &outpath, MountPoint &mount, int *error)
 {
-	lock_guard guard(lock);
 	std::string realpath;
 
 	std::string inpath = _inpath;
@@ -207,43 +278,47 @@ bool MetaFileSystem::MapFilePath(const std::string &_inpath, std::string &outpat
 		}
 	}
 
-	const std::string *currentDirectory = &startingDirectory;
-
-	int currentThread = __KernelGetCurThread();
-	currentDir_t::iterator it = currentDir.find(currentThread);
-	if (it == currentDir.end()) 
+	std::string currentDirectory;
 	{
-		//Attempt to emulate SCE_KERNEL_ERROR_NOCWD / 8002032C: may break things requiring fixes elsewhere
-		if (inpath.find(':') == std::string::npos /* means path is relative */) 
+		lock_guard guard(lock);
+		currentDirectory = startingDirectory;
+
+		int currentThread = __KernelGetCurThread();
+		currentDir_t::iterator it = currentDir.find(currentThread);
+		if (it == currentDir.end()) 
 		{
-			lastOpenError = SCE_KERNEL_ERROR_NOCWD;
-			WARN_LOG(FILESYS, "Path is relative, but current directory not set for thread %i. returning 8002032C(SCE_KERNEL_ERROR_NOCWD) instead.", currentThread);
+			//Attempt to emulate SCE_KERNEL_ERROR_NOCWD / 8002032C: may break things requiring fixes elsewhere
+			if (inpath.find(':') == std::string::npos /* means path is relative */) 
+			{
+				if (error)
+					*error = SCE_KERNEL_ERROR_NOCWD;
+				WARN_LOG(FILESYS, "Path is relative, but current directory not set for thread %i. returning 8002032C(SCE_KERNEL_ERROR_NOCWD) instead.", currentThread);
+			}
+		}
+		else
+		{
+			currentDirectory = it->second;
 		}
-	}
-	else
-	{
-		currentDirectory = &(it->second);
 	}
 
-	if ( RealPath(*currentDirectory, inpath, realpath) )
+	if ( RealPath(currentDirectory, inpath, realpath) )
 	{
 		std::string prefix = realpath;
 		size_t prefixPos = realpath.find(':');
 		if (prefixPos != realpath.npos)
 			prefix = NormalizePrefix(realpath.substr(0, prefixPos + 1));
+		std::transform(prefix.begin(), prefix.end(), prefix.begin(), tolower);
 
-		for (size_t i = 0; i < fileSystems.size(); i++)
+		MountTablePtr table = GetMountTable();
+		auto found = table->prefixes.find(prefix);
+		if (found != table->prefixes.end())
 		{
-			size_t prefLen = fileSystems[i].prefix.size();
-			if (strncasecmp(fileSystems[i].prefix.c_str(), prefix.c_str(), prefLen) == 0)
-			{
-				outpath = realpath.substr(prefixPos + 1);
-				*system = &(fileSystems[i]);
+			outpath = realpath.substr(prefixPos + 1);
+			mount = table->mounts[found->second];
 
-				VERBOSE_LOG(FILESYS, "MapFilePath: mapped \"%s\" to prefix: \"%s\", path: \"%s\"", inpath.c_str(), fileSystems[i].prefix.c_str(), outpath.c_str());
+			VERBOSE_LOG(FILESYS, "MapFilePath: mapped \"%s\" to prefix: \"%s\", path: \"%s\"", inpath.c_str(), mount.prefix.c_str(), outpath.c_str());
 
-				return true;
-			}
+			return true;
 		}
 	}
 
@@ -272,27 +347,96 @@ std::string MetaFileSystem::NormalizePrefix(std::string prefix) const {
 void MetaFileSystem::Mount(std::string prefix, IFileSystem *system)
 {
 	lock_guard guard(lock);
+	MountTablePtr old = GetMountTable();
+	MountTable *table = new MountTable();
+	table->mounts = old->mounts;
+
 	MountPoint x;
 	x.prefix = prefix;
 	x.system = system;
-	fileSystems.push_back(x);
+	// Share the lock if it (or what it wraps) is already mounted elsewhere.
+	for (size_t i = 0; i < table->mounts.size(); i++)
+	{
+		if (table->mounts[i].system->LockOwner() == system->LockOwner())
+			x.lock = table->mounts[i].lock;
+	}
+	if (!x.lock)
+		x.lock.reset(new recursive_mutex());
+	table->mounts.push_back(x);
+
+	SetMountTable(table);
 }
 
 void MetaFileSystem::Unmount(std::string prefix, IFileSystem *system)
 {
 	lock_guard guard(lock);
+	MountTablePtr old = GetMountTable();
+	MountTable *table = new MountTable();
+	table->mounts = old->mounts;
+
 	MountPoint x;
 	x.prefix = prefix;
 	x.system = system;
-	fileSystems.erase(std::remove(fileSystems.begin(), fileSystems.end(), x), fileSystems.end());
+	table->mounts.erase(std::remove(table->mounts.begin(), table->mounts.end(), x), table->mounts.end());
+
+	std::shared_ptr<recursive_mutex> systemLock;
+	bool stillMounted = false;
+	for (size_t i = 0; i < old->mounts.size(); i++)
+	{
+		if (old->mounts[i].system == system)
+			systemLock = old->mounts[i].lock;
+	}
+	for (size_t i = 0; i < table->mounts.size(); i++)
+	{
+		if (table->mounts[i].system == system)
+			stillMounted = true;
+	}
+	if (!systemLock)
+	{
+		delete table;
+		return;
+	}
+
+	// Let anything in progress on it finish first.
+	lock_guard systemGuard(*systemLock);
+	SetMountTable(table);
+	if (!stillMounted)
+		ForgetHandles(system);
 }
 
 void MetaFileSystem::Remount(IFileSystem *oldSystem, IFileSystem *newSystem) {
-	for (auto it = fileSystems.begin(); it != fileSystems.end(); ++it) {
+	lock_guard guard(lock);
+	MountTablePtr old = GetMountTable();
+	MountTable *table = new MountTable();
+	table->mounts = old->mounts;
+
+	std::shared_ptr<recursive_mutex> systemLock;
+	for (auto it = table->mounts.begin(); it != table->mounts.end(); ++it) {
 		if (it->system == oldSystem) {
+			// It takes over the old one's lock, it's the same device after all.
 			it->system = newSystem;
+			systemLock = it->lock;
 		}
 	}
+	if (!systemLock) {
+		delete table;
+		return;
+	}
+
+	// Let anything in progress on the old one finish first.
+	lock_guard systemGuard(*systemLock);
+	SetMountTable(table);
+	ForgetHandles(oldSystem);
+}
+
+void MetaFileSystem::ForgetHandles(IFileSystem *system) {
+	lock_guard guard(handleLock);
+	for (auto it = handleOwners.begin(); it != handleOwners.end(); ) {
+		if (it->second.system == system)
+			it = handleOwners.erase(it);
+		else
+			++it;
+	}
 }
 
 IFileSystem *MetaFileSystem::GetSystemFromFilename(const std::string &filename) {
@@ -303,7 +447,8 @@ IFileSystem *MetaFileSystem::GetSystemFromFilename(const std::string &filename)
 }
 
 IFileSystem *MetaFileSystem::GetSystem(const std::string &prefix) {
-	for (auto it = fileSystems.begin(); it != fileSystems.end(); ++it) {
+	MountTablePtr table = GetMountTable();
+	for (auto it = table->mounts.begin(); it != table->mounts.end(); ++it) {
 		if (it->prefix == NormalizePrefix(prefix))
 			return it->system;
 	}
@@ -313,97 +458,103 @@ IFileSystem *MetaFileSystem::GetSystem(const std::string &prefix) {
 void MetaFileSystem::Shutdown()
 {
 	lock_guard guard(lock);
-	current = 6;
+	MountTablePtr old = GetMountTable();
+	SetMountTable(new MountTable());
+	{
+		lock_guard handleGuard(handleLock);
+		current = 6;
+		handleOwners.clear();
+	}
 
 	// Ownership is a bit convoluted. Let's just delete everything once.
+	// Calls still in progress hold the lock, and won't start on a system once it's unmounted.
 
-	std::set<IFileSystem *> toDelete;
-	for (size_t i = 0; i < fileSystems.size(); i++) {
-		toDelete.insert(fileSystems[i].system);
+	std::map<IFileSystem *, std::shared_ptr<recursive_mutex>> toDelete;
+	for (size_t i = 0; i < old->mounts.size(); i++) {
+		toDelete[old->mounts[i].system] = old->mounts[i].lock;
 	}
 
 	for (auto iter = toDelete.begin(); iter != toDelete.end(); ++iter)
 	{
-		delete *iter;
+		lock_guard systemGuard(*iter->second);
+		delete iter->first;
 	}
 
-	fileSystems.clear();
 	currentDir.clear();
 	startingDirectory = "";
 }
 
 u32 MetaFileSystem::OpenWithError(int &error, std::string filename, FileAccess access, const char *devicename)
 {
-	lock_guard guard(lock);
-	u32 h = OpenFile(filename, access, devicename);
-	error = lastOpenError;
-	return h;
-}
-
-u32 MetaFileSystem::OpenFile(std::string filename, FileAccess access, const char *devicename)
-{
-	lock_guard guard(lock);
-	lastOpenError = 0;
+	error = 0;
 	std::string of;
-	MountPoint *mount;
-	if (MapFilePath(filename, of, &mount))
+	MountPoint mount;
+	while (MapFilePath(filename, of, mount, &error))
 	{
-		s32 res = mount->system->OpenFile(of, access, mount->prefix.c_str());
+		MountGuard systemGuard(this, mount);
+		if (!systemGuard.Mounted())
+			continue;
+		s32 res = mount.system->OpenFile(of, access, mount.prefix.c_str());
 		if (res < 0)
 		{
-			lastOpenError = res;
+			error = res;
 			return 0;
 		}
+		if (res != 0)
+		{
+			// Remembered while locked, so it can't be forgotten by an unmount first.
+			lock_guard guard(handleLock);
+			handleOwners[res] = mount;
+		}
 		return res;
 	}
-	else
-	{
-		return 0;
-	}
+	return 0;
+}
+
+u32 MetaFileSystem::OpenFile(std::string filename, FileAccess access, const char *devicename)
+{
+	int error;
+	return OpenWithError(error, filename, access, devicename);
 }
 
 PSPFileInfo MetaFileSystem::GetFileInfo(std::string filename)
 {
-	lock_guard guard(lock);
 	std::string of;
-	IFileSystem *system;
-	if (MapFilePath(filename, of, &system))
+	MountPoint mount;
+	while (MapFilePath(filename, of, mount))
 	{
-		return system->GetFileInfo(of);
-	}
-	else
-	{
-		PSPFileInfo bogus; // TODO
-		return bogus; 
+		MountGuard systemGuard(this, mount);
+		if (systemGuard.Mounted())
+			return mount.system->GetFileInfo(of);
 	}
+	PSPFileInfo bogus; // TODO
+	return bogus; 
 }
 
 bool MetaFileSystem::GetHostPath(const std::string &inpath, std::string &outpath)
 {
-	lock_guard guard(lock);
 	std::string of;
-	IFileSystem *system;
-	if (MapFilePath(inpath, of, &system)) {
-		return system->GetHostPath(of, outpath);
-	} else {
-		return false;
+	MountPoint mount;
+	while (MapFilePath(inpath, of, mount)) {
+		MountGuard systemGuard(this, mount);
+		if (systemGuard.Mounted())
+			return mount.system->GetHostPath(of, outpath);
 	}
+	return false;
 }
 
 std::vector<PSPFileInfo> MetaFileSystem::GetDirListing(std::string path)
 {
-	lock_guard guard(lock);
 	std::string of;
-	IFileSystem *system;
-	if (MapFilePath(path, of, &system))
-	{
-		return system->GetDirListing(of);
-	}
-	else
+	MountPoint mount;
+	while (MapFilePath(path, of, mount))
 	{
-		std::vector<PSPFileInfo> empty;
-		return empty;
+		MountGuard systemGuard(this, mount);
+		if (systemGuard.Mounted())
+			return mount.system->GetDirListing(of);
 	}
+	std::vector<PSPFileInfo> empty;
+	return empty;
 }
 
 void MetaFileSystem::ThreadEnded(int threadID)
@@ -414,7 +565,6 @@ void MetaFileSystem::ThreadEnded(int threadID)
 
 int MetaFileSystem::ChDir(const std::string &dir)
 {
-	lock_guard guard(lock);
 	// Retain the old path and fail if the arg is 1023 bytes or longer.
 	if (dir.size() >= 1023)
 		return SCE_KERNEL_ERROR_NAMETOOLONG;
@@ -422,21 +572,24 @@ int MetaFileSystem::ChDir(const std::string &dir)
 	int curThread = __KernelGetCurThread();
 	
 	std::string of;
-	MountPoint *mountPoint;
-	if (MapFilePath(dir, of, &mountPoint))
+	MountPoint mountPoint;
+	if (MapFilePath(dir, of, mountPoint))
 	{
-		currentDir[curThread] = mountPoint->prefix + of;
+		lock_guard guard(lock);
+		currentDir[curThread] = mountPoint.prefix + of;
 		return 0;
 	}
 	else
 	{
-		for (size_t i = 0; i < fileSystems.size(); i++)
+		MountTablePtr table = GetMountTable();
+		for (size_t i = 0; i < table->mounts.size(); i++)
 		{
-			const std::string &prefix = fileSystems[i].prefix;
+			const std::string &prefix = table->mounts[i].prefix;
 			if (strncasecmp(prefix.c_str(), dir.c_str(), prefix.size()) == 0)
 			{
 				// The PSP is completely happy with invalid current dirs as long as they have a valid device.
 				WARN_LOG(FILESYS, "ChDir failed to map path \"%s\", saving as current directory anyway", dir.c_str());
+				lock_guard guard(lock);
 				currentDir[curThread] = dir;
 				return 0;
 			}
@@ -449,155 +602,170 @@ int MetaFileSystem::ChDir(const std::string &dir)
 
 bool MetaFileSystem::MkDir(const std::string &dirname)
 {
-	lock_guard guard(lock);
 	std::string of;
-	IFileSystem *system;
-	if (MapFilePath(dirname, of, &system))
+	MountPoint mount;
+	while (MapFilePath(dirname, of, mount))
 	{
-		return system->MkDir(of);
-	}
-	else
-	{
-		return false;
+		MountGuard systemGuard(this, mount);
+		if (systemGuard.Mounted())
+			return mount.system->MkDir(of);
 	}
+	return false;
 }
 
 bool MetaFileSystem::RmDir(const std::string &dirname)
 {
-	lock_guard guard(lock);
 	std::string of;
-	IFileSystem *system;
-	if (MapFilePath(dirname, of, &system))
-	{
-		return system->RmDir(of);
-	}
-	else
+	MountPoint mount;
+	while (MapFilePath(dirname, of, mount))
 	{
-		return false;
+		MountGuard systemGuard(this, mount);
+		if (systemGuard.Mounted())
+			return mount.system->RmDir(of);
 	}
+	return false;
 }
 
 int MetaFileSystem::RenameFile(const std::string &from, const std::string &to)
 {
-	lock_guard guard(lock);
 	std::string of;
 	std::string rf;
-	IFileSystem *osystem;
-	IFileSystem *rsystem = NULL;
-	if (MapFilePath(from, of, &osystem))
+	MountPoint omount;
+	MountPoint rmount;
+	while (MapFilePath(from, of, omount))
 	{
 		// If it's a relative path, it seems to always use from's filesystem.
 		if (to.find(":/") != to.npos)
 		{
-			if (!MapFilePath(to, rf, &rsystem))
+			if (!MapFilePath(to, rf, rmount))
 				return -1;
 		}
 		else
 		{
 			rf = to;
-			rsystem = osystem;
+			rmount = omount;
 		}
 
-		if (osystem != rsystem)
+		if (omount.system != rmount.system)
 			return SCE_KERNEL_ERROR_XDEV;
 
-		return osystem->RenameFile(of, rf);
-	}
-	else
-	{
-		return -1;
+		MountGuard systemGuard(this, omount);
+		if (systemGuard.Mounted())
+			return omount.system->RenameFile(of, rf);
 	}
+	return -1;
 }
 
 bool MetaFileSystem::RemoveFile(const std::string &filename)
 {
-	lock_guard guard(lock);
 	std::string of;
-	IFileSystem *system;
-	if (MapFilePath(filename, of, &system))
-	{
-		return system->RemoveFile(of);
-	}
-	else
+	MountPoint mount;
+	while (MapFilePath(filename, of, mount))
 	{
-		return false;
+		MountGuard systemGuard(this, mount);
+		if (systemGuard.Mounted())
+			return mount.system->RemoveFile(of);
 	}
+	return false;
 }
 
 int MetaFileSystem::Ioctl(u32 handle, u32 cmd, u32 indataPtr, u32 inlen, u32 outdataPtr, u32 outlen, int &usec)
 {
-	lock_guard guard(lock);
-	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->Ioctl(handle, cmd, indataPtr, inlen, outdataPtr, outlen, usec);
+	MountPoint mount;
+	while (GetHandleOwner(handle, mount))
+	{
+		MountGuard systemGuard(this, mount);
+		if (systemGuard.Mounted())
+			return mount.system->Ioctl(handle, cmd, indataPtr, inlen, outdataPtr, outlen, usec);
+	}
 	return SCE_KERNEL_ERROR_ERROR;
 }
 
 int MetaFileSystem::DevType(u32 handle)
 {
-	lock_guard guard(lock);
-	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->DevType(handle);
+	MountPoint mount;
+	while (GetHandleOwner(handle, mount))
+	{
+		MountGuard systemGuard(this, mount);
+		if (systemGuard.Mounted())
+			return mount.system->DevType(handle);
+	}
 	return SCE_KERNEL_ERROR_ERROR;
 }
 
 void MetaFileSystem::CloseFile(u32 handle)
 {
-	lock_guard guard(lock);
-	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		sys->CloseFile(handle);
+	MountPoint mount;
+	while (GetHandleOwner(handle, mount))
+	{
+		MountGuard systemGuard(this, mount);
+		if (!systemGuard.Mounted())
+			continue;
+		mount.system->CloseFile(handle);
+		lock_guard guard(handleLock);
+		handleOwners.erase(handle);
+		break;
+	}
 }
 
 size_t MetaFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size)
 {
-	lock_guard guard(lock);
-	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->ReadFile(handle, pointer, size);
-	else
-		return 0;
+	MountPoint mount;
+	while (GetHandleOwner(handle, mount))
+	{
+		MountGuard systemGuard(this, mount);
+		if (systemGuard.Mounted())
+			return mount.system->ReadFile(handle, pointer, size);
+	}
+	return 0;
 }
 
 size_t MetaFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size)
 {
-	lock_guard guard(lock);
-	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->WriteFile(handle, pointer, size);
-	else
-		return 0;
+	MountPoint mount;
+	while (GetHandleOwner(handle, mount))
+	{
+		MountGuard systemGuard(this, mount);
+		if (systemGuard.Mounted())
+			return mount.system->WriteFile(handle, pointer, size);
+	}
+	return 0;
 }
 
 size_t MetaFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &usec)
 {
-	lock_guard guard(lock);
-	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->ReadFile(handle, pointer, size, usec);
-	else
-		return 0;
+	MountPoint mount;
+	while (GetHandleOwner(handle, mount))
+	{
+		MountGuard systemGuard(this, mount);
+		if (systemGuard.Mounted())
+			return mount.system->ReadFile(handle, pointer, size, usec);
+	}
+	return 0;
 }
 
 size_t MetaFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size, int &usec)
 {
-	lock_guard guard(lock);
-	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->WriteFile(handle, pointer, size, usec);
-	else
-		return 0;
+	MountPoint mount;
+	while (GetHandleOwner(handle, mount))
+	{
+		MountGuard systemGuard(this, mount);
+		if (systemGuard.Mounted())
+			return mount.system->WriteFile(handle, pointer, size, usec);
+	}
+	return 0;
 }
 
 size_t MetaFileSystem::SeekFile(u32 handle, s32 position, FileMove type)
 {
-	lock_guard guard(lock);
-	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->SeekFile(handle,position,type);
-	else
-		return 0;
+	MountPoint mount;
+	while (GetHandleOwner(handle, mount))
+	{
+		MountGuard systemGuard(this, mount);
+		if (systemGuard.Mounted())
+			return mount.system->SeekFile(handle,position,type);
+	}
+	return 0;
 }
 
 int MetaFileSystem::ReadEntireFile(const std::string &filename, std::vector<u8> &data) {
@@ -619,13 +787,15 @@ int MetaFileSystem::ReadEntireFile(const std::string &filename, std::vector<u8>
 
 u64 MetaFileSystem::FreeSpace(const std::string &path)
 {
-	lock_guard guard(lock);
 	std::string of;
-	IFileSystem *system;
-	if (MapFilePath(path, of, &system))
-		return system->FreeSpace(of);
-	else
-		return 0;
+	MountPoint mount;
+	while (MapFilePath(path, of, mount))
+	{
+		MountGuard systemGuard(this, mount);
+		if (systemGuard.Mounted())
+			return mount.system->FreeSpace(of);
+	}
+	return 0;
 }
 
 void MetaFileSystem::DoState(PointerWrap &p)
@@ -636,11 +806,19 @@ void MetaFileSystem::DoState(PointerWrap &p)
 	if (!s)
 		return;
 
-	p.Do(current);
+	{
+		lock_guard handleGuard(handleLock);
+		p.Do(current);
+		// Handles are recreated by each file system, we'll find their owners again as needed.
+		if (p.mode == p.MODE_READ)
+			handleOwners.clear();
+	}
 
 	// Save/load per-thread current directory map
 	p.Do(currentDir);
 
+	MountTablePtr table = GetMountTable();
+	const std::vector<MountPoint> &fileSystems = table->mounts;
 	u32 n = (u32) fileSystems.size();
 	p.Do(n);
 	bool skipPfat0 = false;
@@ -657,8 +835,13 @@ void MetaFileSystem::DoState(PointerWrap &p)
 
 	for (u32 i = 0; i < n; ++i) {
 		if (!skipPfat0 || fileSystems[i].prefix != "pfat0:") {
+			MountGuard systemGuard(this, fileSystems[i]);
+			if (!systemGuard.Mounted()) {
+				p.SetError(p.ERROR_FAILURE);
+				ERROR_LOG(FILESYS, "Savestate failure: filesystem was unmounted during save.");
+				return;
+			}
 			fileSystems[i].system->DoState(p);
 		}
 	}
 }
-
@@ -17,7 +17,9 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "base/mutex.h"
@@ -29,23 +31,62 @@ class MetaFileSystem : public IHandleAllocator, public IFileSystem {
 	struct MountPoint {
 		std::string prefix;
 		IFileSystem *system;
+		// Held while calling into system, shared by every prefix it's mounted on.
+		std::shared_ptr<recursive_mutex> lock;
 
 		bool operator == (const MountPoint &other) const {
 			return prefix == other.prefix && system == other.system;
 		}
 	};
 
-	std::vector<MountPoint> fileSystems;
+	// Holds a mount's lock while calling into its system.  A copied MountPoint can outlive
+	// the mount: if it was unmounted or replaced while we waited, the system may be deleted
+	// already, so check Mounted() and look it up again if not.
+	class MountGuard {
+	public:
+		MountGuard(MetaFileSystem *meta, const MountPoint &mount);
+		~MountGuard();
+
+		bool Mounted() const {
+			return mounted_;
+		}
+
+	private:
+		std::shared_ptr<recursive_mutex> lock_;
+		bool mounted_;
+	};
+
+	// Never changed once in use, so lookups don't need to lock.  Mounting swaps in a new one.
+	struct MountTable {
+		std::vector<MountPoint> mounts;
+		// Lowercase prefix -> first index in mounts.
+		std::unordered_map<std::string, size_t> prefixes;
+	};
+	typedef std::shared_ptr<const MountTable> MountTablePtr;
+
+	MountTablePtr fileSystems;
+	// Only held while getting or replacing fileSystems.
+	recursive_mutex mountLock;
+
+	std::unordered_map<u32, MountPoint> handleOwners;
+	recursive_mutex handleLock;
 
 	typedef std::map<int, std::string> currentDir_t;
 	currentDir_t currentDir;
 
 	std::string startingDirectory;
-	int lastOpenError;
+	// Protects currentDir and startingDirectory.
 	recursive_mutex lock;
 
+	MountTablePtr GetMountTable();
+	void SetMountTable(MountTable *table);
+	bool IsMounted(const MountPoint &mount);
+	void ForgetHandles(IFileSystem *system);
+	bool GetHandleOwner(u32 handle, MountPoint &mount);
+	bool MapFilePath(const std::string &inpath, std::string &outpath, MountPoint &mount, int *error = nullptr);
+
 public:
-	MetaFileSystem() {
+	MetaFileSystem() : fileSystems(new MountTable()) {
 		current = 6;  // what?
 	}
 
@@ -61,6 +102,7 @@ class MetaFileSystem : public IHandleAllocator, public IFileSystem {
 	void Shutdown();
 
 	u32 GetNewHandle() override {
+		lock_guard guard(handleLock);
 		u32 res = current++;
 		if (current < 0) {
 			current = 0;
@@ -72,12 +114,11 @@ class MetaFileSystem : public IHandleAllocator, public IFileSystem {
 	void DoState(PointerWrap &p) override;
 
 	IFileSystem *GetHandleOwner(u32 handle);
-	bool MapFilePath(const std::string &inpath, std::string &outpath, MountPoint **system);
 
 	inline bool MapFilePath(const std::string &_inpath, std::string &outpath, IFileSystem **system) {
-		MountPoint *mountPoint;
-		if (MapFilePath(_inpath, outpath, &mountPoint)) {
-			*system = mountPoint->system;
+		MountPoint mountPoint;
+		if (MapFilePath(_inpath, outpath, mountPoint)) {
+			*system = mountPoint.system;
 			return true;
 		}
 
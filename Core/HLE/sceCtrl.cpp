@@ -22,6 +22,7 @@
 #include "Core/HLE/FunctionWrappers.h"
 #include "Core/MIPS/MIPS.h"
 #include "Core/CoreTiming.h"
+#include "Core/Replay.h"
 #include "Core/MemMapHelpers.h"
 #include "Common/ChunkFile.h"
 #include "Common/StdMutex.h"
@@ -102,6 +103,8 @@ const u32 CTRL_EMU_RAPIDFIRE_MASK = CTRL_UP | CTRL_DOWN | CTRL_LEFT | CTRL_RIGHT
 static void __CtrlUpdateLatch()
 {
 	std::lock_guard<std::recursive_mutex> guard(ctrlMutex);
+	// When playing back a replay, this is where the recorded input comes in.
+	ReplayApplyCtrl(ctrlCurrent.buttons, ctrlCurrent.analog, CoreTiming::GetTicks());
 	
 	// Copy in the current data to the current buffer.
 	ctrlBufs[ctrlBuf] = ctrlCurrent;
@@ -142,19 +145,29 @@ static int __CtrlResetLatch()
 	return oldBufs;
 }
 
+// A replay only has what the latch saw, so while one is recording or playing, peeks see that too.
+// Otherwise host input that changed since would leak in, and playback would go differently.
+static const _ctrl_data &__CtrlPeekData()
+{
+	if (ReplayIsRecording() || ReplayIsPlaying())
+		return ctrlBufs[(ctrlBuf + NUM_CTRL_BUFFERS - 1) % NUM_CTRL_BUFFERS];
+	return ctrlCurrent;
+}
+
 u32 __CtrlPeekButtons()
 {
 	std::lock_guard<std::recursive_mutex> guard(ctrlMutex);
 
-	return ctrlCurrent.buttons;
+	return __CtrlPeekData().buttons;
 }
 
 void __CtrlPeekAnalog(int stick, float *x, float *y)
 {
 	std::lock_guard<std::recursive_mutex> guard(ctrlMutex);
 
-	*x = (ctrlCurrent.analog[stick][CTRL_ANALOG_X] - 127.5f) / 127.5f;
-	*y = -(ctrlCurrent.analog[stick][CTRL_ANALOG_Y] - 127.5f) / 127.5f;
+	const _ctrl_data &data = __CtrlPeekData();
+	*x = (data.analog[stick][CTRL_ANALOG_X] - 127.5f) / 127.5f;
+	*y = -(data.analog[stick][CTRL_ANALOG_Y] - 127.5f) / 127.5f;
 }
 
 
@@ -429,6 +429,9 @@ void __DisplayGetDebugStats(char stats[], size_t bufsize) {
 		"Draw calls: %i, flushes %i\n"
 		"Cached Draw calls: %i\n"
 		"Num Tracked Vertex Arrays: %i\n"
+		"Vertex cache: %i hits (%i shared), %i misses\n"
+		"Vertex cache: %i KB hashed, %i KB uploaded\n"
+		"Cached DL commands: %i (%i segments)\n"
 		"Cycles executed: %d (%f per vertex)\n"
 		"Commands per call level: %i %i %i %i\n"
 		"Vertices Submitted: %i\n"
@@ -451,6 +454,13 @@ void __DisplayGetDebugStats(char stats[], size_t bufsize) {
 		gpuStats.numFlushes,
 		gpuStats.numCachedDrawCalls,
 		gpuStats.numTrackedVertexArrays,
+		gpuStats.numCachedDrawCalls,
+		gpuStats.numVertexCacheShared,
+		gpuStats.numVertexCacheMisses,
+		gpuStats.vertexCacheBytesHashed / 1024,
+		gpuStats.vertexCacheBytesUploaded / 1024,
+		gpuStats.numCachedListCommands,
+		gpuStats.numTrackedListSegments,
 		gpuStats.vertexGPUCycles + gpuStats.otherGPUCycles,
 		vertexAverageCycles,
 		gpuStats.gpuCommandsAtCallLevel[0],gpuStats.gpuCommandsAtCallLevel[1],gpuStats.gpuCommandsAtCallLevel[2],gpuStats.gpuCommandsAtCallLevel[3],
@@ -38,6 +38,7 @@
 #include "Core/HW/MemoryStick.h"
 #include "Core/HW/AsyncIOManager.h"
 #include "Core/CoreTiming.h"
+#include "Core/Replay.h"
 #include "Core/Reporting.h"
 
 #include "Core/FileSystems/FileSystem.h"
@@ -330,7 +331,8 @@ static void __IoAsyncNotify(u64 userdata, int cyclesLate) {
 
 	if (g_Config.iIOTimingMethod == IOTIMING_HOST) {
 		// Not all async operations actually queue up.  Maybe should separate them?
-		if (!ioManager.HasResult(f->handle) && ioManager.HasOperation(f->handle)) {
+		bool ready = ioManager.HasResult(f->handle) || !ioManager.HasOperation(f->handle);
+		if (!ReplayApplyIoReady(ready, CoreTiming::GetTicks())) {
 			// Try again in another 0.5ms until the IO completes on the host.
 			CoreTiming::ScheduleEvent(usToCycles(500) - cyclesLate, asyncNotifyEvent, userdata);
 			return;
@@ -386,7 +388,7 @@ static void __IoSyncNotify(u64 userdata, int cyclesLate) {
 	}
 
 	if (g_Config.iIOTimingMethod == IOTIMING_HOST) {
-		if (!ioManager.HasResult(f->handle)) {
+		if (!ReplayApplyIoReady(ioManager.HasResult(f->handle), CoreTiming::GetTicks())) {
 			// Try again in another 0.5ms until the IO completes on the host.
 			CoreTiming::ScheduleEvent(usToCycles(500) - cyclesLate, syncNotifyEvent, userdata);
 			return;
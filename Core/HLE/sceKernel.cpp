@@ -164,6 +164,8 @@ void __KernelShutdown()
 	hleCurrentThreadName = NULL;
 	kernelObjects.Clear();
 
+	SaveState::Shutdown();
+
 	__AudioCodecShutdown();
 	__VideoPmpShutdown();
 	__AACShutdown();
@@ -0,0 +1,208 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstring>
+
+#include "base/functional.h"
+#include "Common/Common.h"
+#include "Common/Log.h"
+#include "Common/ThreadPools.h"
+#include "Core/Config.h"
+#include "Core/MemSnapshot.h"
+#ifdef SHARED_SNAPPY
+#include <snappy-c.h>
+#else
+#include "ext/snappy/snappy-c.h"
+#endif
+
+#ifdef _M_SSE
+#include <emmintrin.h>
+#endif
+
+static bool PagesEqual(const u8 *a, const u8 *b) {
+#ifdef _M_SSE
+	// We only care if they're equal, so no need to find where they differ like memcmp.
+	const __m128i *pa = (const __m128i *)a;
+	const __m128i *pb = (const __m128i *)b;
+	const __m128i zero = _mm_setzero_si128();
+	for (int i = 0; i < MemSnapshot::PAGE_BYTES / 16; i += 4) {
+		__m128i x0 = _mm_xor_si128(_mm_loadu_si128(pa + i + 0), _mm_loadu_si128(pb + i + 0));
+		__m128i x1 = _mm_xor_si128(_mm_loadu_si128(pa + i + 1), _mm_loadu_si128(pb + i + 1));
+		__m128i x2 = _mm_xor_si128(_mm_loadu_si128(pa + i + 2), _mm_loadu_si128(pb + i + 2));
+		__m128i x3 = _mm_xor_si128(_mm_loadu_si128(pa + i + 3), _mm_loadu_si128(pb + i + 3));
+		__m128i x = _mm_or_si128(_mm_or_si128(x0, x1), _mm_or_si128(x2, x3));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, zero)) != 0xFFFF) {
+			return false;
+		}
+	}
+	return true;
+#else
+	return memcmp(a, b, MemSnapshot::PAGE_BYTES) == 0;
+#endif
+}
+
+static void XorPage(u8 *dest, const u8 *a, const u8 *b) {
+	u64 *d = (u64 *)dest;
+	const u64 *pa = (const u64 *)a;
+	const u64 *pb = (const u64 *)b;
+	for (int i = 0; i < MemSnapshot::PAGE_BYTES / 8; ++i) {
+		d[i] = pa[i] ^ pb[i];
+	}
+}
+
+bool MemSnapshot::SetRegions(const std::vector<Region> &regions) {
+	if (regions == regions_) {
+		return true;
+	}
+
+	regionPages_.clear();
+	u32 pages = 0;
+	for (size_t i = 0; i < regions.size(); ++i) {
+		_dbg_assert_msg_(MEMMAP, (regions[i].size & (PAGE_BYTES - 1)) == 0, "Snapshot regions must be whole pages");
+		regionPages_.push_back(pages);
+		pages += regions[i].size >> PAGE_SHIFT;
+	}
+	regions_ = regions;
+	Clear();
+	return false;
+}
+
+void MemSnapshot::Clear() {
+	// Actually free it, this is a lot of memory.
+	std::vector<u8>().swap(copy_);
+	std::vector<u8>().swap(changed_);
+}
+
+u8 *MemSnapshot::PagePtr(u32 page) {
+	size_t i = regionPages_.size() - 1;
+	while (regionPages_[i] > page) {
+		--i;
+	}
+	return regions_[i].ptr + ((page - regionPages_[i]) << PAGE_SHIFT);
+}
+
+void MemSnapshot::ComparePages(int first, int last) {
+	for (int page = first; page < last; ++page) {
+		const u8 *src = PagePtr(page);
+		changed_[page] = PagesEqual(src, &copy_[(size_t)page << PAGE_SHIFT]) ? 0 : 1;
+	}
+}
+
+void MemSnapshot::SaveChangedPages(int first, int last, Undo &undo) {
+	for (int i = first; i < last; ++i) {
+		const u8 *src = PagePtr(undo.pages[i]);
+		u8 *copy = &copy_[(size_t)undo.pages[i] << PAGE_SHIFT];
+		XorPage(&undo.data[(size_t)i << PAGE_SHIFT], copy, src);
+		memcpy(copy, src, PAGE_BYTES);
+	}
+}
+
+u32 MemSnapshot::Capture(Undo &undo) {
+	undo.clear();
+
+	if (copy_.empty()) {
+		size_t total = 0;
+		for (size_t i = 0; i < regions_.size(); ++i) {
+			total += regions_[i].size;
+		}
+		copy_.resize(total);
+		changed_.resize(total >> PAGE_SHIFT);
+
+		u8 *dest = copy_.empty() ? nullptr : &copy_[0];
+		for (size_t i = 0; i < regions_.size(); ++i) {
+			memcpy(dest, regions_[i].ptr, regions_[i].size);
+			dest += regions_[i].size;
+		}
+		return (u32)(total >> PAGE_SHIFT);
+	}
+
+	// First find what changed, which means reading everything, spread over threads.
+	const int pages = (int)changed_.size();
+	const bool parallel = g_Config.iNumWorkerThreads > 1;
+	if (parallel) {
+		GlobalThreadPool::Loop(std::bind(&MemSnapshot::ComparePages, this, placeholder::_1, placeholder::_2), 0, pages);
+	} else {
+		ComparePages(0, pages);
+	}
+
+	for (int page = 0; page < pages; ++page) {
+		if (changed_[page]) {
+			undo.pages.push_back(page);
+		}
+	}
+
+	// Then save only those, which is usually a small part.
+	const int count = (int)undo.pages.size();
+	undo.data.resize((size_t)count << PAGE_SHIFT);
+	if (parallel) {
+		GlobalThreadPool::Loop(std::bind(&MemSnapshot::SaveChangedPages, this, placeholder::_1, placeholder::_2, std::ref(undo)), 0, count);
+	} else {
+		SaveChangedPages(0, count, undo);
+	}
+	return (u32)count;
+}
+
+void MemSnapshot::Compress(Undo &undo, std::vector<u8> &scratch) {
+	if (undo.compressed || undo.data.empty()) {
+		return;
+	}
+
+	size_t compressedSize = snappy_max_compressed_length(undo.data.size());
+	scratch.resize(compressedSize);
+	if (snappy_compress((const char *)&undo.data[0], undo.data.size(), (char *)&scratch[0], &compressedSize) != SNAPPY_OK) {
+		return;
+	}
+	scratch.resize(compressedSize);
+	undo.data.swap(scratch);
+	undo.compressed = true;
+}
+
+bool MemSnapshot::Restore() {
+	if (copy_.empty()) {
+		return false;
+	}
+
+	const u8 *src = &copy_[0];
+	for (size_t i = 0; i < regions_.size(); ++i) {
+		memcpy(regions_[i].ptr, src, regions_[i].size);
+		src += regions_[i].size;
+	}
+	return true;
+}
+
+void MemSnapshot::Revert(const Undo &undo) {
+	if (copy_.empty() || undo.pages.empty()) {
+		return;
+	}
+
+	const u8 *data = &undo.data[0];
+	if (undo.compressed) {
+		size_t size = undo.pages.size() << PAGE_SHIFT;
+		revertScratch_.resize(size);
+		if (snappy_uncompress((const char *)data, undo.data.size(), (char *)&revertScratch_[0], &size) != SNAPPY_OK || size != revertScratch_.size()) {
+			ERROR_LOG(MEMMAP, "Rewind snapshot corrupt, can't go back further");
+			Clear();
+			return;
+		}
+		data = &revertScratch_[0];
+	}
+
+	for (size_t i = 0; i < undo.pages.size(); ++i) {
+		u8 *copy = &copy_[(size_t)undo.pages[i] << PAGE_SHIFT];
+		XorPage(copy, copy, data + (i << PAGE_SHIFT));
+	}
+}
@@ -0,0 +1,93 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <vector>
+#include "Common/CommonTypes.h"
+
+// Keeps a copy of memory as of the last snapshot, and updates it page by page.
+// Only the pages that changed are copied, and their old contents are handed back
+// so the snapshot before can be reconstructed.  Used for rewind.
+class MemSnapshot {
+public:
+	enum {
+		PAGE_SHIFT = 12,
+		PAGE_BYTES = 1 << PAGE_SHIFT,
+	};
+
+	struct Region {
+		u8 *ptr;
+		u32 size;
+
+		bool operator == (const Region &other) const {
+			return ptr == other.ptr && size == other.size;
+		}
+	};
+
+	// What the pages that changed between two snapshots contained in the first one.
+	// Stored as the XOR of the two, which is mostly zeros and compresses well.
+	struct Undo {
+		Undo() : compressed(false) {}
+
+		std::vector<u32> pages;
+		std::vector<u8> data;
+		bool compressed;
+
+		void clear() {
+			pages.clear();
+			data.clear();
+			compressed = false;
+		}
+	};
+
+	// Region sizes must be multiples of PAGE_BYTES.  Returns false if they changed, in
+	// which case the copy is dropped and the next Capture() starts over.
+	bool SetRegions(const std::vector<Region> &regions);
+	// Drops the copy, to free memory.
+	void Clear();
+
+	// Brings the copy up to date with memory.  Returns the number of pages that changed.
+	// The first time, everything is copied and undo is left empty.
+	// Pages are compared on the global thread pool, if there are worker threads.
+	u32 Capture(Undo &undo);
+	// Shrinks an undo from Capture().  Safe to call on another thread, as long as the
+	// snapshot isn't reverted with it meanwhile.
+	static void Compress(Undo &undo, std::vector<u8> &scratch);
+	// Copies the snapshot back into memory.
+	bool Restore();
+	// Goes back to the snapshot before, using the undo from the Capture() that followed it.
+	void Revert(const Undo &undo);
+
+	bool Empty() const {
+		return copy_.empty();
+	}
+
+private:
+	u8 *PagePtr(u32 page);
+	void ComparePages(int first, int last);
+	void SaveChangedPages(int first, int last, Undo &undo);
+
+	std::vector<Region> regions_;
+	// First page of each region in copy_.
+	std::vector<u32> regionPages_;
+	std::vector<u8> copy_;
+
+	// Reused between captures, to avoid allocating.
+	std::vector<u8> changed_;
+	std::vector<u8> revertScratch_;
+};
@@ -0,0 +1,311 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#include "Common/FileUtil.h"
+#include "Common/Log.h"
+#include "Common/StdMutex.h"
+#include "Core/CoreTiming.h"
+#include "Core/Replay.h"
+
+enum class ReplayState {
+	IDLE,
+	RECORDING,
+	PLAYING,
+	FINISHED,
+};
+
+static const char REPLAY_MAGIC[8] = { 'P', 'P', 'R', 'E', 'P', 'L', 'A', 'Y' };
+static const u32 REPLAY_VERSION = 1;
+
+struct ReplayHeader {
+	char magic[8];
+	u32 version;
+	u32 ctrlCount;
+	u32 ioCount;
+	u32 eventCount;
+	u64 startTicks;
+	u64 endTicks;
+};
+
+struct ReplayCtrl {
+	u64 ticks;
+	u32 buttons;
+	u8 analog[2][2];
+};
+
+struct ReplayIo {
+	u64 ticks;
+	u32 ready;
+	u32 pad;
+};
+
+struct ReplayEvent {
+	u64 ticks;
+	s64 time;
+	u64 userdata;
+	char name[32];
+};
+
+// Written only while holding replayLock, from either the emu thread or the UI.  Hooks check
+// it first without locking, so stores release and loads acquire.
+static std::atomic<ReplayState> replayState(ReplayState::IDLE);
+// Protects the rest, so recording can be stopped from the UI.
+static std::recursive_mutex replayLock;
+static u64 replayStartTicks;
+static u64 replayEndTicks;
+
+static std::vector<ReplayCtrl> ctrlItems;
+static std::vector<ReplayIo> ioItems;
+static std::vector<ReplayEvent> eventItems;
+static size_t ctrlPos;
+static size_t ioPos;
+static size_t eventPos;
+
+static void ReplayClear() {
+	ctrlItems.clear();
+	ioItems.clear();
+	eventItems.clear();
+	ctrlPos = 0;
+	ioPos = 0;
+	eventPos = 0;
+}
+
+static void ReplayOutOfSync(const char *what, u64 t, u64 expected) {
+	ERROR_LOG(COMMON, "Replay out of sync: %s at tick %lld, recorded at %lld", what, (long long)t, (long long)expected);
+	replayState.store(ReplayState::IDLE, std::memory_order_release);
+	ReplayClear();
+}
+
+static void ReplayCheckEnd(u64 t) {
+	if (t >= replayEndTicks) {
+		INFO_LOG(COMMON, "Replay finished at tick %lld", (long long)t);
+		replayState.store(ReplayState::FINISHED, std::memory_order_release);
+		ReplayClear();
+	}
+}
+
+void ReplayBeginRecording() {
+	std::lock_guard<std::recursive_mutex> guard(replayLock);
+	ReplayClear();
+	replayStartTicks = CoreTiming::GetTicks();
+	replayState.store(ReplayState::RECORDING, std::memory_order_release);
+	INFO_LOG(COMMON, "Replay recording started at tick %lld", (long long)replayStartTicks);
+}
+
+bool ReplayFinishRecording(const std::string &filename) {
+	std::lock_guard<std::recursive_mutex> guard(replayLock);
+	if (replayState.load(std::memory_order_acquire) != ReplayState::RECORDING) {
+		return false;
+	}
+	replayState.store(ReplayState::IDLE, std::memory_order_release);
+
+	ReplayHeader header;
+	memcpy(header.magic, REPLAY_MAGIC, sizeof(header.magic));
+	header.version = REPLAY_VERSION;
+	header.ctrlCount = (u32)ctrlItems.size();
+	header.ioCount = (u32)ioItems.size();
+	header.eventCount = (u32)eventItems.size();
+	header.startTicks = replayStartTicks;
+	header.endTicks = CoreTiming::GetTicks();
+
+	File::IOFile file(filename, "wb");
+	bool success = file.WriteArray(&header, 1);
+	success = success && file.WriteArray(ctrlItems.data(), ctrlItems.size());
+	success = success && file.WriteArray(ioItems.data(), ioItems.size());
+	success = success && file.WriteArray(eventItems.data(), eventItems.size());
+	if (!success) {
+		ERROR_LOG(COMMON, "Unable to write replay to %s", filename.c_str());
+	} else {
+		INFO_LOG(COMMON, "Replay recorded to %s: %d inputs, %d IO, %d events", filename.c_str(), header.ctrlCount, header.ioCount, header.eventCount);
+	}
+	ReplayClear();
+	return success;
+}
+
+bool ReplayBeginPlayback(const std::string &filename) {
+	std::lock_guard<std::recursive_mutex> guard(replayLock);
+	ReplayClear();
+	replayState.store(ReplayState::IDLE, std::memory_order_release);
+
+	File::IOFile file(filename, "rb");
+	ReplayHeader header;
+	if (!file.ReadArray(&header, 1) || memcmp(header.magic, REPLAY_MAGIC, sizeof(header.magic)) != 0 || header.version != REPLAY_VERSION) {
+		ERROR_LOG(COMMON, "Not a replay: %s", filename.c_str());
+		return false;
+	}
+
+	ctrlItems.resize(header.ctrlCount);
+	ioItems.resize(header.ioCount);
+	eventItems.resize(header.eventCount);
+	bool success = file.ReadArray(ctrlItems.data(), ctrlItems.size());
+	success = success && file.ReadArray(ioItems.data(), ioItems.size());
+	success = success && file.ReadArray(eventItems.data(), eventItems.size());
+	if (!success) {
+		ERROR_LOG(COMMON, "Replay truncated: %s", filename.c_str());
+		ReplayClear();
+		return false;
+	}
+
+	if (header.startTicks != CoreTiming::GetTicks()) {
+		ERROR_LOG(COMMON, "Replay %s was recorded from a different state", filename.c_str());
+		ReplayClear();
+		return false;
+	}
+
+	replayStartTicks = header.startTicks;
+	replayEndTicks = header.endTicks;
+	replayState.store(ReplayState::PLAYING, std::memory_order_release);
+	INFO_LOG(COMMON, "Replay playback started at tick %lld", (long long)replayStartTicks);
+	return true;
+}
+
+void ReplayAbort() {
+	std::lock_guard<std::recursive_mutex> guard(replayLock);
+	replayState.store(ReplayState::IDLE, std::memory_order_release);
+	ReplayClear();
+}
+
+bool ReplayIsRecording() {
+	return replayState.load(std::memory_order_acquire) == ReplayState::RECORDING;
+}
+
+bool ReplayIsPlaying() {
+	return replayState.load(std::memory_order_acquire) == ReplayState::PLAYING;
+}
+
+bool ReplayIsFinished() {
+	return replayState.load(std::memory_order_acquire) == ReplayState::FINISHED;
+}
+
+void ReplayApplyCtrl(u32 &buttons, u8 analog[2][2], u64 t) {
+	ReplayState state = replayState.load(std::memory_order_acquire);
+	if (state != ReplayState::RECORDING && state != ReplayState::PLAYING) {
+		return;
+	}
+
+	std::lock_guard<std::recursive_mutex> guard(replayLock);
+	// It may have been stopped while waiting for the lock.
+	state = replayState.load(std::memory_order_acquire);
+	if (state == ReplayState::RECORDING) {
+		// Only changes are kept, most samples are the same as the last.
+		if (!ctrlItems.empty()) {
+			const ReplayCtrl &last = ctrlItems.back();
+			if (last.buttons == buttons && memcmp(last.analog, analog, sizeof(last.analog)) == 0) {
+				return;
+			}
+		}
+		ReplayCtrl item;
+		item.ticks = t;
+		item.buttons = buttons;
+		memcpy(item.analog, analog, sizeof(item.analog));
+		ctrlItems.push_back(item);
+	} else if (state == ReplayState::PLAYING) {
+		while (ctrlPos < ctrlItems.size() && ctrlItems[ctrlPos].ticks <= t) {
+			++ctrlPos;
+		}
+		if (ctrlPos == 0) {
+			// Nothing recorded yet, so nothing was pressed when recording began.
+			buttons = 0;
+			memset(analog, 128, 4);
+		} else {
+			const ReplayCtrl &current = ctrlItems[ctrlPos - 1];
+			buttons = current.buttons;
+			memcpy(analog, current.analog, sizeof(current.analog));
+		}
+	}
+}
+
+bool ReplayApplyIoReady(bool ready, u64 t) {
+	ReplayState state = replayState.load(std::memory_order_acquire);
+	if (state != ReplayState::RECORDING && state != ReplayState::PLAYING) {
+		return ready;
+	}
+
+	std::lock_guard<std::recursive_mutex> guard(replayLock);
+	// It may have been stopped while waiting for the lock.
+	state = replayState.load(std::memory_order_acquire);
+	if (state == ReplayState::RECORDING) {
+		ReplayIo item;
+		item.ticks = t;
+		item.ready = ready ? 1 : 0;
+		item.pad = 0;
+		ioItems.push_back(item);
+	} else if (state == ReplayState::PLAYING) {
+		if (ioPos >= ioItems.size()) {
+			return ready;
+		}
+		const ReplayIo &item = ioItems[ioPos++];
+		if (item.ticks != t) {
+			ReplayOutOfSync("IO check", t, item.ticks);
+			return ready;
+		}
+		// If it wasn't actually ready yet, the caller waits for it.
+		return item.ready != 0;
+	}
+	return ready;
+}
+
+void ReplayRecordEvent(u64 t, const char *name, u64 userdata, s64 time) {
+	std::lock_guard<std::recursive_mutex> guard(replayLock);
+	if (replayState.load(std::memory_order_acquire) != ReplayState::RECORDING) {
+		return;
+	}
+
+	ReplayEvent item;
+	item.ticks = t;
+	item.time = time;
+	item.userdata = userdata;
+	memset(item.name, 0, sizeof(item.name));
+	strncpy(item.name, name, sizeof(item.name) - 1);
+	eventItems.push_back(item);
+}
+
+bool ReplayPeekEvent(u64 t, std::string &name, u64 &userdata, s64 &time) {
+	std::lock_guard<std::recursive_mutex> guard(replayLock);
+	if (replayState.load(std::memory_order_acquire) != ReplayState::PLAYING) {
+		return false;
+	}
+	ReplayCheckEnd(t);
+	if (replayState.load(std::memory_order_acquire) != ReplayState::PLAYING || eventPos >= eventItems.size()) {
+		return false;
+	}
+
+	const ReplayEvent &item = eventItems[eventPos];
+	if (item.ticks > t) {
+		return false;
+	}
+	if (item.ticks < t) {
+		// Should've been queued at an earlier Advance(), so we're lost.
+		ReplayOutOfSync("event", t, item.ticks);
+		return false;
+	}
+	name = item.name;
+	userdata = item.userdata;
+	time = item.time;
+	return true;
+}
+
+void ReplayPopEvent() {
+	std::lock_guard<std::recursive_mutex> guard(replayLock);
+	if (replayState.load(std::memory_order_acquire) == ReplayState::PLAYING && eventPos < eventItems.size()) {
+		++eventPos;
+	}
+}
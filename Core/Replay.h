@@ -0,0 +1,52 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <string>
+#include "Common/CommonTypes.h"
+
+// Records everything that reaches the emulated PSP from outside, so a run can be
+// played back exactly from the save state it started at: controller samples, when
+// host IO finished, and when events from other threads got into CoreTiming.
+// Everything is keyed on emulated ticks, not wall time.
+
+// Starts recording from the current tick.  Call on the emu thread, ideally right as
+// a state is saved (see SaveState::SaveForReplay.)
+void ReplayBeginRecording();
+// Stops recording and writes what was recorded.
+bool ReplayFinishRecording(const std::string &filename);
+// Starts playing back a recording.  The matching state must already be loaded.
+bool ReplayBeginPlayback(const std::string &filename);
+// Stops either, and forgets what was recorded.
+void ReplayAbort();
+
+bool ReplayIsRecording();
+bool ReplayIsPlaying();
+// True once a playback reached the point the recording stopped at, without going out of sync.
+bool ReplayIsFinished();
+
+// Hooks, called on the emu thread.  When playing back, these replace the live values.
+void ReplayApplyCtrl(u32 &buttons, u8 analog[2][2], u64 t);
+bool ReplayApplyIoReady(bool ready, u64 t);
+
+// For CoreTiming's threadsafe events, which are matched by name so recordings don't
+// depend on registration order.
+void ReplayRecordEvent(u64 t, const char *name, u64 userdata, s64 time);
+// Returns the next event that must be queued at or before t, if any.
+bool ReplayPeekEvent(u64 t, std::string &name, u64 &userdata, s64 &time);
+void ReplayPopEvent();
@@ -15,10 +15,14 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <deque>
+#include <memory>
 #include <vector>
 
 #include "base/timeutil.h"
 #include "base/NativeApp.h"
+#include "thread/thread.h"
+#include "thread/threadutil.h"
 #include "i18n/i18n.h"
 
 #include "Common/StdMutex.h"
@@ -39,6 +43,8 @@
 #include "Core/HLE/ReplaceTables.h"
 #include "Core/HLE/sceKernel.h"
 #include "Core/MemMap.h"
+#include "Core/MemSnapshot.h"
+#include "Core/Replay.h"
 #include "Core/MIPS/MIPS.h"
 #include "HW/MemoryStick.h"
 #include "GPU/GPUState.h"
@@ -48,7 +54,19 @@ namespace SaveState
 {
 	struct SaveStart
 	{
+		SaveStart() : memory(nullptr), undo(nullptr)
+		{
+		}
+		// For rewind, memory is kept in a snapshot instead of the state.
+		SaveStart(MemSnapshot *m, MemSnapshot::Undo *u) : memory(m), undo(u)
+		{
+		}
+
 		void DoState(PointerWrap &p);
+		void DoMemory(PointerWrap &p);
+
+		MemSnapshot *memory;
+		MemSnapshot::Undo *undo;
 	};
 
 	enum OperationType
@@ -58,6 +76,7 @@ namespace SaveState
 		SAVESTATE_VERIFY,
 		SAVESTATE_REWIND,
 		SAVESTATE_SAVE_SCREENSHOT,
+		SAVESTATE_SAVE_FOR_REPLAY,
 	};
 
 	struct Operation
@@ -73,85 +92,155 @@ namespace SaveState
 		void *cbUserData;
 	};
 
-	CChunkFileReader::Error SaveToRam(std::vector<u8> &data) {
-		SaveStart state;
+	static CChunkFileReader::Error SaveToRam(std::vector<u8> &data, SaveStart &state) {
 		size_t sz = CChunkFileReader::MeasurePtr(state);
 		if (data.size() < sz)
 			data.resize(sz);
 		return CChunkFileReader::SavePtr(&data[0], state);
 	}
 
+	static CChunkFileReader::Error LoadFromRam(std::vector<u8> &data, SaveStart &state) {
+		return CChunkFileReader::LoadPtr(&data[0], state);
+	}
+
+	CChunkFileReader::Error SaveToRam(std::vector<u8> &data) {
+		SaveStart state;
+		return SaveToRam(data, state);
+	}
+
 	CChunkFileReader::Error LoadFromRam(std::vector<u8> &data) {
 		SaveStart state;
-		return CChunkFileReader::LoadPtr(&data[0], state);
+		return LoadFromRam(data, state);
+	}
+
+	static void GetMemoryRegions(std::vector<MemSnapshot::Region> &regions)
+	{
+		MemSnapshot::Region ram = { Memory::GetPointer(PSP_GetKernelMemoryBase()), Memory::g_MemorySize };
+		MemSnapshot::Region vram = { Memory::m_pVRAM, Memory::VRAM_SIZE };
+		MemSnapshot::Region scratchpad = { Memory::m_pScratchPad, Memory::SCRATCHPAD_SIZE };
+		regions.push_back(ram);
+		regions.push_back(vram);
+		regions.push_back(scratchpad);
 	}
 
 	struct StateRingbuffer
 	{
-		StateRingbuffer(int size) : first_(0), next_(0), size_(size), base_(-1)
+		StateRingbuffer(int size) : first_(0), count_(0), size_(size), base_(-1)
 		{
 			states_.resize(size);
+			undos_.resize(size);
 			baseMapping_.resize(size);
 		}
 
+		~StateRingbuffer()
+		{
+			WaitForCompress();
+		}
+
 		CChunkFileReader::Error Save()
 		{
-			int n = next_++ % size_;
-			if ((next_ % size_) == first_)
-				++first_;
+			// The last one might still be compressing, and might be using bases_.
+			WaitForCompress();
+
+			// If memory moved (e.g. after a reset), there's no going back to the old snapshots.
+			std::vector<MemSnapshot::Region> regions;
+			GetMemoryRegions(regions);
+			if (!memory_.SetRegions(regions))
+				Clear();
+
+			int n = (first_ + count_) % size_;
+			if (count_ == size_)
+				first_ = (first_ + 1) % size_;
+			else
+				++count_;
 
-			static std::vector<u8> buffer;
-			std::vector<u8> *compressBuffer = &buffer;
+			// Memory goes into memory_, only the pages that changed are copied.
+			// That leaves the rest of the state, which is small, to compress against a base.
+			SaveStart state(&memory_, &undos_[n]);
+			std::vector<u8> *compressBuffer = &buffer_;
 			CChunkFileReader::Error err;
 
 			if (base_ == -1 || ++baseUsage_ > BASE_USAGE_INTERVAL)
 			{
 				base_ = (base_ + 1) % ARRAY_SIZE(bases_);
 				baseUsage_ = 0;
-				err = SaveToRam(bases_[base_]);
+				err = SaveToRam(bases_[base_], state);
 				// Let's not bother savestating twice.
 				compressBuffer = &bases_[base_];
 			}
 			else
-				err = SaveToRam(buffer);
+				err = SaveToRam(buffer_, state);
 
+			baseMapping_[n] = base_;
 			if (err == CChunkFileReader::ERROR_NONE)
-				Compress(states_[n], *compressBuffer, bases_[base_]);
+			{
+				// The emu thread doesn't need to wait for this, it's done with the state.
+				const std::vector<u8> *base = &bases_[base_];
+				compressThread_ = std::thread([=] {
+					setCurrentThreadName("RewindCompress");
+					Compress(states_[n], *compressBuffer, *base);
+					MemSnapshot::Compress(undos_[n], compressScratch_);
+				});
+			}
 			else
 				states_[n].clear();
-			baseMapping_[n] = base_;
 			return err;
 		}
 
+		void WaitForCompress()
+		{
+			if (compressThread_.joinable())
+				compressThread_.join();
+		}
+
 		CChunkFileReader::Error Restore()
 		{
 			// No valid states left.
 			if (Empty())
 				return CChunkFileReader::ERROR_BAD_FILE;
 
-			int n = (--next_ + size_) % size_;
-			if (states_[n].empty())
+			WaitForCompress();
+			std::vector<MemSnapshot::Region> regions;
+			GetMemoryRegions(regions);
+			if (!memory_.SetRegions(regions) || memory_.Empty())
+			{
+				Clear();
 				return CChunkFileReader::ERROR_BAD_FILE;
+			}
+
+			int n = (first_ + --count_) % size_;
+			CChunkFileReader::Error err = CChunkFileReader::ERROR_BAD_FILE;
+			if (!states_[n].empty())
+			{
+				Decompress(buffer_, states_[n], bases_[baseMapping_[n]]);
+				SaveStart state(&memory_, nullptr);
+				err = LoadFromRam(buffer_, state);
+			}
 
-			static std::vector<u8> buffer;
-			Decompress(buffer, states_[n], bases_[baseMapping_[n]]);
-			return LoadFromRam(buffer);
+			// Whatever happened, the snapshot now needs to match the one before.
+			memory_.Revert(undos_[n]);
+			undos_[n].clear();
+			return err;
 		}
 
-		void Compress(std::vector<u8> &result, const std::vector<u8> &state, const std::vector<u8> &base)
+		static void Compress(std::vector<u8> &result, const std::vector<u8> &state, const std::vector<u8> &base)
 		{
-			result.clear();
+			// Enough for the worst case, every block changed.  Usually reuses the last allocation.
+			result.resize(state.size() + state.size() / BLOCK_SIZE + 1);
+			size_t pos = 0;
 			for (size_t i = 0; i < state.size(); i += BLOCK_SIZE)
 			{
 				int blockSize = std::min(BLOCK_SIZE, (int)(state.size() - i));
 				if (i + blockSize > base.size() || memcmp(&state[i], &base[i], blockSize) != 0)
 				{
-					result.push_back(1);
-					result.insert(result.end(), state.begin() + i, state.begin() +i + blockSize);
+					result[pos++] = 1;
+					memcpy(&result[pos], &state[i], blockSize);
+					pos += blockSize;
 				}
 				else
-					result.push_back(0);
+					result[pos++] = 0;
 			}
+			result.resize(pos);
 		}
 
 		void Decompress(std::vector<u8> &result, const std::vector<u8> &compressed, const std::vector<u8> &base)
@@ -181,13 +270,18 @@ namespace SaveState
 
 		void Clear()
 		{
+			WaitForCompress();
 			first_ = 0;
-			next_ = 0;
+			count_ = 0;
+			base_ = -1;
+			memory_.Clear();
+			for (size_t i = 0; i < undos_.size(); ++i)
+				undos_[i].clear();
 		}
 
 		bool Empty() const
 		{
-			return next_ == first_;
+			return count_ == 0;
 		}
 
 		static const int BLOCK_SIZE;
@@ -195,13 +289,21 @@ namespace SaveState
 		static const int BASE_USAGE_INTERVAL;
 		typedef std::vector<u8> StateBuffer;
 		int first_;
-		int next_;
+		int count_;
 		int size_;
 		std::vector<StateBuffer> states_;
 		StateBuffer bases_[2];
 		std::vector<int> baseMapping_;
 		int base_;
 		int baseUsage_;
+
+		// Memory as of the newest state, and how to step back from each state to the one before.
+		MemSnapshot memory_;
+		std::vector<MemSnapshot::Undo> undos_;
+
+		StateBuffer buffer_;
+		StateBuffer compressScratch_;
+		std::thread compressThread_;
 	};
 
 	static bool needsProcess = false;
@@ -218,6 +320,55 @@ namespace SaveState
 	const int StateRingbuffer::BLOCK_SIZE = 8192;
 	const int StateRingbuffer::BASE_USAGE_INTERVAL = 15;
 
+	// Compressing and writing a state (or encoding a screenshot) takes a while, so only the
+	// capture happens on the emu thread.  The rest is done here, in the order queued.
+	static std::deque<std::function<void()>> writeQueue;
+	static std::recursive_mutex writeMutex;
+	static std::thread writeThread;
+	static bool writeThreadRunning = false;
+
+	static void WriteThreadFunc()
+	{
+		setCurrentThreadName("SaveStateWrite");
+		while (true)
+		{
+			std::function<void()> job;
+			{
+				std::lock_guard<std::recursive_mutex> guard(writeMutex);
+				if (writeQueue.empty())
+				{
+					writeThreadRunning = false;
+					return;
+				}
+				job = writeQueue.front();
+				writeQueue.pop_front();
+			}
+			job();
+		}
+	}
+
+	static void QueueWrite(const std::function<void()> &job)
+	{
+		std::lock_guard<std::recursive_mutex> guard(writeMutex);
+		writeQueue.push_back(job);
+		if (!writeThreadRunning)
+		{
+			// It ran out of work, so it's exiting (or gone) - start a new one.
+			if (writeThread.joinable())
+				writeThread.join();
+			writeThreadRunning = true;
+			writeThread = std::thread(&WriteThreadFunc);
+		}
+	}
+
+	// Blocks until everything queued is on disk.
+	static void WaitForWrites()
+	{
+		// Only the emu thread queues, so nothing can be added meanwhile.
+		if (writeThread.joinable())
+			writeThread.join();
+	}
+
 	void SaveStart::DoState(PointerWrap &p)
 	{
 		auto s = p.Section("SaveStart", 1);
@@ -233,11 +384,11 @@ namespace SaveState
 		{
 			auto blockCache = MIPSComp::jit->GetBlockCache();
 			auto savedBlocks = blockCache->SaveAndClearEmuHackOps();
-			Memory::DoState(p);
+			DoMemory(p);
 			blockCache->RestoreSavedEmuHackOps(savedBlocks);
 		}
 		else
-			Memory::DoState(p);
+			DoMemory(p);
 		RestoreSavedReplacements(savedReplacements);
 
 		MemoryStick_DoState(p);
@@ -248,6 +399,29 @@ namespace SaveState
 		pspFileSystem.DoState(p);
 	}
 
+	void SaveStart::DoMemory(PointerWrap &p)
+	{
+		if (!memory)
+		{
+			Memory::DoState(p);
+			return;
+		}
+
+		// The regions were checked against the snapshot already, so sizes match.
+		switch (p.mode)
+		{
+		case PointerWrap::MODE_WRITE:
+			memory->Capture(*undo);
+			break;
+		case PointerWrap::MODE_READ:
+			if (!memory->Restore())
+				p.SetError(p.ERROR_FAILURE);
+			break;
+		default:
+			break;
+		}
+	}
+
 	void Enqueue(SaveState::Operation op)
 	{
 		std::lock_guard<std::recursive_mutex> guard(mutex);
@@ -269,6 +443,11 @@ namespace SaveState
 		Enqueue(Operation(SAVESTATE_SAVE, filename, callback, cbUserData));
 	}
 
+	void SaveForReplay(const std::string &filename, Callback callback, void *cbUserData)
+	{
+		Enqueue(Operation(SAVESTATE_SAVE_FOR_REPLAY, filename, callback, cbUserData));
+	}
+
 	void Verify(Callback callback, void *cbUserData)
 	{
 		Enqueue(Operation(SAVESTATE_VERIFY, std::string(""), callback, cbUserData));
@@ -583,6 +762,10 @@ namespace SaveState
 			{
 			case SAVESTATE_LOAD:
 				INFO_LOG(COMMON, "Loading state from %s", op.filename.c_str());
+				// It might be the one we're still writing.
+				WaitForWrites();
+				// Whatever was being recorded or played back doesn't lead here.
+				ReplayAbort();
 				result = CChunkFileReader::Load(op.filename, PPSSPP_GIT_VERSION, state, &reason);
 				if (result == CChunkFileReader::ERROR_NONE) {
 					osm.Show(sc->T("Loaded State"), 2.0);
@@ -600,13 +783,34 @@ namespace SaveState
 				break;
 
 			case SAVESTATE_SAVE:
+			case SAVESTATE_SAVE_FOR_REPLAY:
 				INFO_LOG(COMMON, "Saving state to %s", op.filename.c_str());
-				result = CChunkFileReader::Save(op.filename, g_paramSFO.GetValueString("TITLE"), PPSSPP_GIT_VERSION, state);
-				if (result == CChunkFileReader::ERROR_NONE) {
-
-					osm.Show(sc->T("Saved State"), 2.0);
-					callbackResult = true;
-				} else if (result == CChunkFileReader::ERROR_BROKEN_STATE) {
+				{
+					// Only the capture needs the emulator paused, compression and I/O happen on the write thread.
+					std::shared_ptr<PointerWrapBuffer> buffer(new PointerWrapBuffer());
+					result = CChunkFileReader::SaveBuffer(*buffer, state);
+					if (result == CChunkFileReader::ERROR_NONE) {
+						if (op.type == SAVESTATE_SAVE_FOR_REPLAY) {
+							// Right here, so the recording starts on exactly the tick the state has.
+							ReplayBeginRecording();
+						}
+						const std::string filename = op.filename;
+						const std::string title = g_paramSFO.GetValueString("TITLE");
+						const char *i18nSaved = sc->T("Saved State");
+						Callback callback = op.callback;
+						void *cbUserData = op.cbUserData;
+						QueueWrite([=] {
+							bool success = CChunkFileReader::SaveFile(filename, title, PPSSPP_GIT_VERSION, *buffer) == CChunkFileReader::ERROR_NONE;
+							osm.Show(success ? i18nSaved : i18nSaveFailure, 2.0);
+							if (callback)
+								callback(success, cbUserData);
+						});
+						// The write will call it once it's done.
+						op.callback = Callback();
+						break;
+					}
+				}
+				if (result == CChunkFileReader::ERROR_BROKEN_STATE) {
 					HandleFailure();
 					osm.Show(i18nSaveFailure, 2.0);
 					ERROR_LOG(COMMON, "Save state failure: %s", reason.c_str());
@@ -624,6 +828,7 @@ namespace SaveState
 
 			case SAVESTATE_REWIND:
 				INFO_LOG(COMMON, "Rewinding to recent savestate snapshot");
+				ReplayAbort();
 				result = rewindStates.Restore();
 				if (result == CChunkFileReader::ERROR_NONE) {
 					osm.Show(sc->T("Loaded State"), 2.0);
@@ -647,8 +852,21 @@ namespace SaveState
 				break;
 
 			case SAVESTATE_SAVE_SCREENSHOT:
-				if (!TakeGameScreenshot(op.filename.c_str(), SCREENSHOT_JPG, SCREENSHOT_RENDER)) {
-					ERROR_LOG(COMMON, "Failed to take a screenshot for the savestate! %s", op.filename.c_str());
+				{
+					// Grab it now, but leave the encoding to the write thread.
+					std::vector<u8> rgb;
+					u32 w, h;
+					callbackResult = CaptureGameScreenshot(rgb, w, h, SCREENSHOT_RENDER);
+					if (callbackResult) {
+						const std::string filename = op.filename;
+						QueueWrite([=] {
+							if (!WriteGameScreenshot(filename.c_str(), SCREENSHOT_JPG, rgb, w, h)) {
+								ERROR_LOG(COMMON, "Failed to take a screenshot for the savestate! %s", filename.c_str());
+							}
+						});
+					} else {
+						ERROR_LOG(COMMON, "Failed to take a screenshot for the savestate! %s", op.filename.c_str());
+					}
 				}
 				break;
 
@@ -677,4 +895,12 @@ namespace SaveState
 
 		hasLoadedState = false;
 	}
+
+	void Shutdown()
+	{
+		WaitForWrites();
+
+		std::lock_guard<std::recursive_mutex> guard(mutex);
+		rewindStates.Clear();
+	}
 }
@@ -28,6 +28,8 @@ namespace SaveState
 	const int SAVESTATESLOTS = 5;
 
 	void Init();
+	// Waits for any saves still being written.
+	void Shutdown();
 
 	// Cycle through the 5 savestate slots
 	void NextSlot();
@@ -54,6 +56,9 @@ namespace SaveState
 	// Save the current state to the specified file (async.)
 	// Warning: callback will be called on a different thread.
 	void Save(const std::string &filename, Callback callback = Callback(), void *cbUserData = 0);
+	// Same, and starts recording a replay from exactly that point (see Core/Replay.h.)
+	// Warning: callback will be called on a different thread.
+	void SaveForReplay(const std::string &filename, Callback callback = Callback(), void *cbUserData = 0);
 
 	CChunkFileReader::Error SaveToRam(std::vector<u8> &state);
 	CChunkFileReader::Error LoadFromRam(std::vector<u8> &state);
@@ -22,6 +22,8 @@
 #include "ext/jpge/jpge.h"
 #endif
 
+#include <vector>
+
 #include "Common/ColorConv.h"
 #include "Common/FileUtil.h"
 #include "Core/Config.h"
@@ -215,11 +217,11 @@ static const u8 *ConvertBufferTo888RGB(const GPUDebugBuffer &buf, u8 *&temp, u32
 	return buffer;
 }
 
-bool TakeGameScreenshot(const char *filename, ScreenshotFormat fmt, ScreenshotType type) {
+bool CaptureGameScreenshot(std::vector<u8> &rgb, u32 &w, u32 &h, ScreenshotType type) {
 	GPUDebugBuffer buf;
 	bool success = false;
-	u32 w = (u32)-1;
-	u32 h = (u32)-1;
+	w = (u32)-1;
+	h = (u32)-1;
 
 	if (type == SCREENSHOT_RENDER) {
 		if (gpuDebug) {
@@ -244,45 +246,45 @@ bool TakeGameScreenshot(const char *filename, ScreenshotFormat fmt, ScreenshotTy
 		return false;
 	}
 
+	u8 *flipbuffer = nullptr;
+	const u8 *buffer = ConvertBufferTo888RGB(buf, flipbuffer, w, h);
+	if (buffer != nullptr) {
+		rgb.assign(buffer, buffer + w * h * 3);
+	}
+	delete [] flipbuffer;
+	return buffer != nullptr;
+}
+
+bool WriteGameScreenshot(const char *filename, ScreenshotFormat fmt, const std::vector<u8> &rgb, u32 w, u32 h) {
+	bool success = !rgb.empty();
+
 #ifdef USING_QT_UI
 	if (success) {
-		u8 *flipbuffer = nullptr;
-		const u8 *buffer = ConvertBufferTo888RGB(buf, flipbuffer, w, h);
 		// TODO: Handle other formats (e.g. Direct3D, raw framebuffers.)
-		QImage image(buffer, w, h, QImage::Format_RGB888);
+		QImage image(&rgb[0], w, h, QImage::Format_RGB888);
 		success = image.save(filename, fmt == SCREENSHOT_PNG ? "PNG" : "JPG");
-		delete [] flipbuffer;
 	}
 #else
-	if (success) {
-		u8 *flipbuffer = nullptr;
-		const u8 *buffer = ConvertBufferTo888RGB(buf, flipbuffer, w, h);
-		if (buffer == nullptr) {
+	if (success && fmt == SCREENSHOT_PNG) {
+		png_image png;
+		memset(&png, 0, sizeof(png));
+		png.version = PNG_IMAGE_VERSION;
+		png.format = PNG_FORMAT_RGB;
+		png.width = w;
+		png.height = h;
+		success = WriteScreenshotToPNG(&png, filename, 0, &rgb[0], w * 3, nullptr);
+		png_image_free(&png);
+
+		if (png.warning_or_error >= 2) {
+			ERROR_LOG(COMMON, "Saving screenshot to PNG produced errors.");
 			success = false;
 		}
-
-		if (success && fmt == SCREENSHOT_PNG) {
-			png_image png;
-			memset(&png, 0, sizeof(png));
-			png.version = PNG_IMAGE_VERSION;
-			png.format = PNG_FORMAT_RGB;
-			png.width = w;
-			png.height = h;
-			success = WriteScreenshotToPNG(&png, filename, 0, buffer, w * 3, nullptr);
-			png_image_free(&png);
-
-			if (png.warning_or_error >= 2) {
-				ERROR_LOG(COMMON, "Saving screenshot to PNG produced errors.");
-				success = false;
-			}
-		} else if (success && fmt == SCREENSHOT_JPG) {
-			jpge::params params;
-			params.m_quality = 90;
-			success = WriteScreenshotToJPEG(filename, w, h, 3, buffer, params);
-		} else {
-			success = false;
-		}
-		delete [] flipbuffer;
+	} else if (success && fmt == SCREENSHOT_JPG) {
+		jpge::params params;
+		params.m_quality = 90;
+		success = WriteScreenshotToJPEG(filename, w, h, 3, &rgb[0], params);
+	} else {
+		success = false;
 	}
 #endif
 	if (!success) {
@@ -290,3 +292,12 @@ bool TakeGameScreenshot(const char *filename, ScreenshotFormat fmt, ScreenshotTy
 	}
 	return success;
 }
+
+bool TakeGameScreenshot(const char *filename, ScreenshotFormat fmt, ScreenshotType type) {
+	std::vector<u8> rgb;
+	u32 w, h;
+	if (!CaptureGameScreenshot(rgb, w, h, type)) {
+		return false;
+	}
+	return WriteGameScreenshot(filename, fmt, rgb, w, h);
+}
@@ -17,6 +17,9 @@
 
 #pragma once
 
+#include <vector>
+#include "Common/CommonTypes.h"
+
 enum ScreenshotFormat {
 	SCREENSHOT_PNG,
 	SCREENSHOT_JPG,
@@ -30,4 +33,9 @@ enum ScreenshotType {
 	SCREENSHOT_RENDER,
 };
 
+// Grabs the frame as 24-bit RGB, to be written later.  Must be called on the emu thread.
+bool CaptureGameScreenshot(std::vector<u8> &rgb, u32 &w, u32 &h, ScreenshotType type);
+// Encodes and writes a captured frame.  Doesn't touch the GPU, so it's fine on any thread.
+bool WriteGameScreenshot(const char *filename, ScreenshotFormat fmt, const std::vector<u8> &rgb, u32 w, u32 h);
+
 bool TakeGameScreenshot(const char *filename, ScreenshotFormat fmt, ScreenshotType type);
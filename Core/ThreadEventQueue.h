@@ -17,14 +17,22 @@
 
 #pragma once
 
+#include <atomic>
+#include <deque>
+
 #include "base/mutex.h"
 #include "Core/System.h"
 #include "Core/CoreTiming.h"
-#include <deque>
 
+// Events are handed over through a fixed size ring, so neither side takes a lock per event.
+// The lock is only taken to sleep, wake the other side, or if the ring fills up.
 template <typename B, typename Event, typename EventType, EventType EVENT_INVALID, EventType EVENT_SYNC, EventType EVENT_FINISH>
 struct ThreadEventQueue : public B {
-	ThreadEventQueue() : threadEnabled_(false), eventsRunning_(false), eventsHaveRun_(false) {
+	ThreadEventQueue() : threadEnabled_(false), eventsRunning_(false), eventsHaveRun_(false),
+		consumerWaiting_(false), syncWaiters_(0), syncTarget_(0), overflowing_(false), enqueuePos_(0), dequeuePos_(0), scheduled_(0), processed_(0) {
+		for (u32 i = 0; i < EVENT_RING_SIZE; ++i) {
+			ring_[i].sequence.store(i, std::memory_order_relaxed);
+		}
 	}
 
 	void SetThreadEnabled(bool threadEnabled) {
@@ -36,54 +44,54 @@ struct ThreadEventQueue : public B {
 	}
 
 	void ScheduleEvent(Event ev) {
-		if (threadEnabled_) {
-			lock_guard guard(eventsLock_);
-			events_.push_back(ev);
-			eventsWait_.notify_one();
-		} else {
-			events_.push_back(ev);
+		if (overflowing_ || !TryPushEvent(ev)) {
+			PushOverflowEvent(ev);
 		}
 
 		if (!threadEnabled_) {
 			RunEventsUntil(0);
+		} else {
+			WakeConsumer();
 		}
 	}
 
+	// Includes an event that's still being processed.
 	bool HasEvents() {
-		if (threadEnabled_) {
-			lock_guard guard(eventsLock_);
-			return !events_.empty();
-		} else {
-			return !events_.empty();
-		}
+		return (s32)(scheduled_ - processed_) > 0;
 	}
 
 	void NotifyDrain() {
 		if (threadEnabled_) {
 			lock_guard guard(eventsLock_);
-			eventsDrain_.notify_one();
+			eventsDrain_.notify_all();
 		}
 	}
 
 	Event GetNextEvent() {
-		if (threadEnabled_) {
+		Event ev(EVENT_INVALID);
+		// Overflowed events are newer than anything left in the ring when they were taken.
+		if (!overflowBatch_.empty()) {
+			ev = overflowBatch_.front();
+			overflowBatch_.pop_front();
+			return ev;
+		}
+		if (TryPopEvent(ev)) {
+			return ev;
+		}
+		if (overflowing_) {
 			lock_guard guard(eventsLock_);
-			if (events_.empty()) {
-				NotifyDrain();
-				return EVENT_INVALID;
+			// Something might've been pushed just before the overflow started.
+			if (TryPopEvent(ev)) {
+				return ev;
 			}
-
-			Event ev = events_.front();
-			events_.pop_front();
-			return ev;
-		} else {
-			if (events_.empty()) {
-				return EVENT_INVALID;
+			overflowBatch_.swap(overflow_);
+			overflowing_ = false;
+			if (!overflowBatch_.empty()) {
+				ev = overflowBatch_.front();
+				overflowBatch_.pop_front();
 			}
-			Event ev = events_.front();
-			events_.pop_front();
-			return ev;
 		}
+		return ev;
 	}
 
 	void RunEventsUntil(u64 globalticks) {
@@ -91,6 +99,7 @@ struct ThreadEventQueue : public B {
 			do {
 				for (Event ev = GetNextEvent(); EventType(ev) != EVENT_INVALID; ev = GetNextEvent()) {
 					ProcessEventIfApplicable(ev, globalticks);
+					++processed_;
 				}
 			} while (CoreTiming::GetTicks() < globalticks);
 			return;
@@ -101,22 +110,35 @@ struct ThreadEventQueue : public B {
 		eventsHaveRun_ = true;
 		do {
 			while (!HasEvents() && !ShouldExitEventLoop()) {
-				eventsWait_.wait(eventsLock_);
+				consumerWaiting_ = true;
+				// Check again, a producer only wakes us once it sees the flag.
+				if (!HasEvents()) {
+					eventsWait_.wait(eventsLock_);
+				}
 			}
+			consumerWaiting_ = false;
 			// Quit the loop if the queue is drained and coreState has tripped, or threading is disabled.
 			if (!HasEvents()) {
 				break;
 			}
 
+			eventsLock_.unlock();
 			for (Event ev = GetNextEvent(); EventType(ev) != EVENT_INVALID; ev = GetNextEvent()) {
-				eventsLock_.unlock();
 				ProcessEventIfApplicable(ev, globalticks);
-				eventsLock_.lock();
+				++processed_;
+				if (syncWaiters_ != 0 && processed_ == syncTarget_) {
+					NotifyDrain();
+				}
+			}
+			eventsLock_.lock();
+			if (syncWaiters_ != 0) {
+				// Each waiter has its own target, wake them all to check.
+				eventsDrain_.notify_all();
 			}
 		} while (CoreTiming::GetTicks() < globalticks);
 
 		// This will force the waiter to check coreState, even if we didn't actually drain.
-		NotifyDrain();
+		eventsDrain_.notify_all();
 		eventsRunning_ = false;
 	}
 
@@ -129,8 +151,8 @@ struct ThreadEventQueue : public B {
 		}
 	}
 
-	inline bool ShouldSyncThread(bool force) {
-		if (!HasEvents())
+	inline bool ShouldSyncThread(u32 target, bool force) {
+		if ((s32)(target - processed_) <= 0)
 			return false;
 		if (coreState != CORE_RUNNING && !force)
 			return false;
@@ -145,19 +167,26 @@ struct ThreadEventQueue : public B {
 		return true;
 	}
 
+	// Waits for everything scheduled so far to finish, but not for anything scheduled after.
 	// Force ignores coreState.
 	void SyncThread(bool force = false) {
 		if (!threadEnabled_) {
 			return;
 		}
 
+		const u32 target = scheduled_;
+		if ((s32)(target - processed_) <= 0) {
+			// Nothing in flight, no need to wake anyone.
+			return;
+		}
+
 		lock_guard guard(eventsLock_);
-		// While processing the last event, HasEvents() will be false even while not done.
-		// So we schedule a nothing event and wait for that to finish.
-		ScheduleEvent(EVENT_SYNC);
-		while (ShouldSyncThread(force)) {
+		syncTarget_ = target;
+		++syncWaiters_;
+		while (ShouldSyncThread(target, force)) {
 			eventsDrain_.wait(eventsLock_);
 		}
+		--syncWaiters_;
 	}
 
 	void FinishEventLoop() {
@@ -184,7 +213,7 @@ struct ThreadEventQueue : public B {
 			break;
 
 		case EVENT_SYNC:
-			// Nothing special to do, this event it just to wait on, see SyncThread.
+			// Nothing special to do, this event is just to wait on (see AsyncIOManager::WaitResult.)
 			break;
 
 		default:
@@ -193,10 +222,93 @@ struct ThreadEventQueue : public B {
 	}
 
 private:
+	enum {
+		// Must be a power of 2.
+		EVENT_RING_SIZE = 1024,
+	};
+
+	struct RingCell {
+		RingCell() : ev(EVENT_INVALID) {}
+
+		// Equal to the position when free, position + 1 once the event is written.
+		std::atomic<u32> sequence;
+		Event ev;
+	};
+
+	// Any thread may push (the GPU thread schedules invalidations too), only the consumer pops.
+	bool TryPushEvent(const Event &ev) {
+		// Counted before taking a position, so a SyncThread() target read after pushing covers
+		// every event ahead of ours, even ones still being written by other producers.
+		// This also keeps HasEvents() from missing an event the consumer can pop.
+		++scheduled_;
+		u32 pos = enqueuePos_.load(std::memory_order_relaxed);
+		for (;;) {
+			RingCell &cell = ring_[pos & (EVENT_RING_SIZE - 1)];
+			s32 diff = (s32)(cell.sequence.load(std::memory_order_acquire) - pos);
+			if (diff == 0) {
+				if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+					cell.ev = ev;
+					cell.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (diff < 0) {
+				// Full.  The caller counts it again when it overflows.
+				--scheduled_;
+				return false;
+			} else {
+				pos = enqueuePos_.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	void PushOverflowEvent(const Event &ev) {
+		lock_guard guard(eventsLock_);
+		if (overflowing_ || !TryPushEvent(ev)) {
+			// Full.  Everything after this stays in order behind it, until the consumer takes them.
+			overflowing_ = true;
+			++scheduled_;
+			overflow_.push_back(ev);
+		}
+	}
+
+	void WakeConsumer() {
+		// Only the first producer to see it asleep needs to wake it.
+		if (consumerWaiting_ && consumerWaiting_.exchange(false)) {
+			lock_guard guard(eventsLock_);
+			eventsWait_.notify_one();
+		}
+	}
+
+	bool TryPopEvent(Event &ev) {
+		u32 pos = dequeuePos_.load(std::memory_order_relaxed);
+		RingCell &cell = ring_[pos & (EVENT_RING_SIZE - 1)];
+		if (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+			return false;
+		}
+		ev = cell.ev;
+		dequeuePos_.store(pos + 1, std::memory_order_relaxed);
+		cell.sequence.store(pos + EVENT_RING_SIZE, std::memory_order_release);
+		return true;
+	}
+
 	bool threadEnabled_;
 	bool eventsRunning_;
 	bool eventsHaveRun_;
-	std::deque<Event> events_;
+	std::atomic<bool> consumerWaiting_;
+	std::atomic<int> syncWaiters_;
+	std::atomic<u32> syncTarget_;
+	std::atomic<bool> overflowing_;
+
+	RingCell ring_[EVENT_RING_SIZE];
+	std::atomic<u32> enqueuePos_;
+	std::atomic<u32> dequeuePos_;
+	// Counts rather than positions, since overflowed events never get a ring position.
+	std::atomic<u32> scheduled_;
+	std::atomic<u32> processed_;
+
+	std::deque<Event> overflow_;
+	// Only touched by the consumer.
+	std::deque<Event> overflowBatch_;
 	recursive_mutex eventsLock_;
 	condition_variable eventsWait_;
 	condition_variable eventsDrain_;
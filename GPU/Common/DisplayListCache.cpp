@@ -0,0 +1,214 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstring>
+
+#include "ext/xxhash.h"
+#include "Core/MemMap.h"
+#include "GPU/GPUCommon.h"
+#include "GPU/GPUState.h"
+#include "GPU/Common/DisplayListCache.h"
+
+enum {
+	// Shorter segments aren't worth the lookup and hash.
+	DLS_MIN_WORDS = 8,
+	// Must fit in DisplayListStep::offset.
+	DLS_MAX_WORDS = 0x8000,
+	DLS_MAX_HASH_FAILURES = 2,
+	DLS_KILL_AGE = 120,
+	DLS_UNRELIABLE_KILL_AGE = 240,
+	DLS_UNRELIABLE_KILL_MAX = 4,
+};
+
+// Commands with none of these only write cmdmem, so only the last write in a row matters.
+static const u8 FLAG_STORE_ONLY_MASK = FLAG_FLUSHBEFORE | FLAG_FLUSHBEFOREONCHANGE | FLAG_ANY_EXECUTE | FLAG_WRITES_PC;
+
+static u32 HashSegment(u32 pc, u32 words) {
+	return XXH32(Memory::GetPointerUnchecked(pc), words * 4, 0x4C15DC0A);
+}
+
+DisplayListCache::DisplayListCache() {
+	memset(cmdFlags_, 0, sizeof(cmdFlags_));
+}
+
+DisplayListCache::~DisplayListCache() {
+	Clear();
+}
+
+void DisplayListCache::SetCommandFlags(const u8 flags[256]) {
+	if (memcmp(cmdFlags_, flags, sizeof(cmdFlags_)) != 0) {
+		memcpy(cmdFlags_, flags, sizeof(cmdFlags_));
+		Clear();
+	}
+}
+
+u32 DisplayListCache::ScanSegment(u32 pc, int downcount) const {
+	u32 maxWords = std::min((u32)downcount, (u32)DLS_MAX_WORDS);
+	maxWords = Memory::ValidSize(pc, maxWords * 4) / 4;
+
+	const u32_le *ops = (const u32_le *)Memory::GetPointerUnchecked(pc);
+	u32 words = 0;
+	while (words < maxWords && !(cmdFlags_[ops[words] >> 24] & FLAG_WRITES_PC)) {
+		++words;
+	}
+	return words;
+}
+
+bool DisplayListCache::EndsSegment(u8 cmd) const {
+	return (cmdFlags_[cmd] & FLAG_WRITES_PC) != 0;
+}
+
+void DisplayListCache::Decode(DisplayListSegment *seg) const {
+	const u32_le *ops = (const u32_le *)Memory::GetPointerUnchecked(seg->pc);
+
+	// Where each cmd was last stored in the current run of store only commands, or -1.
+	int lastStore[256];
+	memset(lastStore, -1, sizeof(lastStore));
+	std::vector<u8> runCmds;
+	std::vector<bool> dropped(seg->words, false);
+
+	for (u32 i = 0; i < seg->words; ++i) {
+		const u32 op = ops[i];
+		const u8 cmd = op >> 24;
+		if (cmdFlags_[cmd] & FLAG_STORE_ONLY_MASK) {
+			// Something may read gstate here, so the run ends.
+			for (u8 runCmd : runCmds) {
+				lastStore[runCmd] = -1;
+			}
+			runCmds.clear();
+			continue;
+		}
+
+		if (lastStore[cmd] >= 0) {
+			dropped[lastStore[cmd]] = true;
+		} else {
+			runCmds.push_back(cmd);
+		}
+		lastStore[cmd] = (int)i;
+	}
+
+	seg->steps.clear();
+	for (u32 i = 0; i < seg->words; ++i) {
+		if (dropped[i]) {
+			continue;
+		}
+		DisplayListStep step;
+		step.op = ops[i];
+		step.offset = (u16)i;
+		step.cmd = step.op >> 24;
+		step.flags = cmdFlags_[step.cmd];
+		seg->steps.push_back(step);
+	}
+}
+
+const DisplayListSegment *DisplayListCache::Lookup(u32 pc, int downcount) {
+	DisplayListSegment *seg;
+	auto iter = segments_.find(pc);
+	if (iter == segments_.end()) {
+		seg = new DisplayListSegment();
+		seg->pc = pc;
+		seg->words = ScanSegment(pc, downcount);
+		seg->hash = HashSegment(pc, seg->words);
+		// Could be a one-off, only decode if we see it again.
+		seg->status = seg->words < DLS_MIN_WORDS ? DisplayListSegment::DLS_UNRELIABLE : DisplayListSegment::DLS_NEW;
+		seg->hashFailures = 0;
+		seg->lastFrame = gpuStats.numFlips;
+		segments_[pc] = seg;
+		return nullptr;
+	}
+
+	seg = iter->second;
+	seg->lastFrame = gpuStats.numFlips;
+	if (seg->status == DisplayListSegment::DLS_UNRELIABLE) {
+		return nullptr;
+	}
+	if ((int)seg->words > downcount) {
+		// Not all written yet, the stall address is still inside.
+		return nullptr;
+	}
+
+	u32 hash = HashSegment(pc, seg->words);
+	if (hash != seg->hash) {
+		if (++seg->hashFailures > DLS_MAX_HASH_FAILURES) {
+			// Rebuilt with different contents often, not worth hashing.
+			seg->status = DisplayListSegment::DLS_UNRELIABLE;
+			seg->steps.clear();
+			seg->steps.shrink_to_fit();
+		} else {
+			seg->words = ScanSegment(pc, downcount);
+			seg->hash = HashSegment(pc, seg->words);
+			seg->status = seg->words < DLS_MIN_WORDS ? DisplayListSegment::DLS_UNRELIABLE : DisplayListSegment::DLS_NEW;
+			seg->steps.clear();
+		}
+		return nullptr;
+	}
+
+	if (seg->status == DisplayListSegment::DLS_NEW) {
+		Decode(seg);
+		seg->status = DisplayListSegment::DLS_READY;
+	}
+	return seg;
+}
+
+void DisplayListCache::Invalidate(u32 addr, int size) {
+	if (size <= 0) {
+		Clear();
+		return;
+	}
+
+	// Display list PCs never have the cached/uncached bits.
+	addr &= 0x3FFFFFFF;
+	for (auto iter = segments_.begin(); iter != segments_.end(); ) {
+		const DisplayListSegment *seg = iter->second;
+		if (seg->pc < addr + size && addr < seg->pc + seg->words * 4) {
+			delete seg;
+			segments_.erase(iter++);
+		} else {
+			++iter;
+		}
+	}
+}
+
+void DisplayListCache::Decimate() {
+	const int threshold = gpuStats.numFlips - DLS_KILL_AGE;
+	const int unreliableThreshold = gpuStats.numFlips - DLS_UNRELIABLE_KILL_AGE;
+	int unreliableLeft = DLS_UNRELIABLE_KILL_MAX;
+	for (auto iter = segments_.begin(); iter != segments_.end(); ) {
+		bool kill;
+		if (iter->second->status == DisplayListSegment::DLS_UNRELIABLE) {
+			// We limit killing unreliable so we don't rescan too often.
+			kill = iter->second->lastFrame < unreliableThreshold && --unreliableLeft >= 0;
+		} else {
+			kill = iter->second->lastFrame < threshold;
+		}
+		if (kill) {
+			delete iter->second;
+			segments_.erase(iter++);
+		} else {
+			++iter;
+		}
+	}
+	gpuStats.numTrackedListSegments = (int)segments_.size();
+}
+
+void DisplayListCache::Clear() {
+	for (auto iter = segments_.begin(); iter != segments_.end(); ++iter) {
+		delete iter->second;
+	}
+	segments_.clear();
+}
@@ -0,0 +1,78 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+// A command that survived pre-decoding, with its flags looked up already.
+struct DisplayListStep {
+	u32 op;
+	// In words from the start of the segment, so the PC can be restored for handlers.
+	u16 offset;
+	u8 cmd;
+	u8 flags;
+};
+
+// A straight run of commands, up to (not including) anything that changes the PC.
+struct DisplayListSegment {
+	enum Status {
+		DLS_NEW,
+		DLS_READY,
+		DLS_UNRELIABLE,
+	};
+
+	u32 pc;
+	// Words of display list covered, including commands dropped while decoding.
+	u32 words;
+	u32 hash;
+	Status status;
+	int hashFailures;
+	int lastFrame;
+	std::vector<DisplayListStep> steps;
+};
+
+// Games tend to submit the same display lists (HUDs, static geometry) every frame.  This keeps
+// those decoded, so the run loop can skip reading and looking up each command again.  Like the
+// vertex cache, segments are verified by hash each time, and dropped if they keep changing.
+class DisplayListCache {
+public:
+	DisplayListCache();
+	~DisplayListCache();
+
+	// Flags use the FLAG_* values from GPUCommon.h.  Changing them clears the cache.
+	void SetCommandFlags(const u8 flags[256]);
+
+	// Returns a segment starting at pc that's unchanged and fits in downcount, or nullptr.
+	const DisplayListSegment *Lookup(u32 pc, int downcount);
+	// Segments start again after these.
+	bool EndsSegment(u8 cmd) const;
+
+	void Invalidate(u32 addr, int size);
+	void Decimate();
+	void Clear();
+
+private:
+	u32 ScanSegment(u32 pc, int downcount) const;
+	void Decode(DisplayListSegment *seg) const;
+
+	std::unordered_map<u32, DisplayListSegment *> segments_;
+	u8 cmdFlags_[256];
+};
@@ -19,6 +19,10 @@
 
 #include "Common/Common.h"
 
+#if defined(_M_SSE)
+#include <emmintrin.h>
+#endif
+
 // Points don't need indexing...
 static const u8 indexedPrimitiveType[7] = {
 	GE_PRIM_POINTS,
@@ -30,6 +34,164 @@ static const u8 indexedPrimitiveType[7] = {
 	GE_PRIM_RECTANGLES,
 };
 
+// The index lists are generated eight indices at a time where there's a repeating pattern.
+// Index arithmetic wraps at 16 bits in both paths, like the stores to u16 always did.
+
+// Writes start, start + 1, ... start + count - 1.
+static u16 *WriteSequential(u16 *outInds, int start, int count) {
+	int i = 0;
+#if defined(_M_SSE)
+	__m128i ind = _mm_add_epi16(_mm_set1_epi16((short)start), _mm_set_epi16(7, 6, 5, 4, 3, 2, 1, 0));
+	const __m128i step = _mm_set1_epi16(8);
+	for (; i + 8 <= count; i += 8) {
+		_mm_storeu_si128((__m128i *)(outInds + i), ind);
+		ind = _mm_add_epi16(ind, step);
+	}
+#endif
+	for (; i < count; i++)
+		outInds[i] = start + i;
+	return outInds + count;
+}
+
+// Writes the triangles of a strip of sequential vertices as a list.
+static u16 *WriteStripAsList(u16 *outInds, int start, int numTris) {
+	int i = 0;
+#if defined(_M_SSE)
+	// Eight triangles fill three vectors exactly:
+	// 0 1 2, 1 3 2, 2 3 4, 3 5 4, 4 5 6, 5 7 6, 6 7 8, 7 9 8.
+	const __m128i base = _mm_set1_epi16((short)start);
+	__m128i a = _mm_add_epi16(base, _mm_set_epi16(3, 2, 2, 3, 1, 2, 1, 0));
+	__m128i b = _mm_add_epi16(base, _mm_set_epi16(5, 6, 5, 4, 4, 5, 3, 4));
+	__m128i c = _mm_add_epi16(base, _mm_set_epi16(8, 9, 7, 8, 7, 6, 6, 7));
+	const __m128i step = _mm_set1_epi16(8);
+	for (; i + 8 <= numTris; i += 8) {
+		_mm_storeu_si128((__m128i *)(outInds + 0), a);
+		_mm_storeu_si128((__m128i *)(outInds + 8), b);
+		_mm_storeu_si128((__m128i *)(outInds + 16), c);
+		outInds += 24;
+		a = _mm_add_epi16(a, step);
+		b = _mm_add_epi16(b, step);
+		c = _mm_add_epi16(c, step);
+	}
+#endif
+	// i is even here, so the winding starts over.
+	int wind = 1;
+	int ibase = start + i;
+	for (; i < numTris; i++) {
+		*outInds++ = ibase;
+		*outInds++ = ibase + wind;
+		wind ^= 3;  // toggle between 1 and 2
+		*outInds++ = ibase + wind;
+		ibase++;
+	}
+	return outInds;
+}
+
+// Writes the triangles of a fan of sequential vertices as a list.
+static u16 *WriteFanAsList(u16 *outInds, int start, int numTris) {
+	int i = 0;
+#if defined(_M_SSE)
+	// Eight triangles fill three vectors exactly, the lanes holding the center stay put:
+	// c 1 2, c 2 3, c 3 4, c 4 5, c 5 6, c 6 7, c 7 8, c 8 9.
+	const __m128i base = _mm_set1_epi16((short)start);
+	__m128i a = _mm_add_epi16(base, _mm_set_epi16(3, 0, 3, 2, 0, 2, 1, 0));
+	__m128i b = _mm_add_epi16(base, _mm_set_epi16(0, 6, 5, 0, 5, 4, 0, 4));
+	__m128i c = _mm_add_epi16(base, _mm_set_epi16(9, 8, 0, 8, 7, 0, 7, 6));
+	const __m128i stepA = _mm_set_epi16(8, 0, 8, 8, 0, 8, 8, 0);
+	const __m128i stepB = _mm_set_epi16(0, 8, 8, 0, 8, 8, 0, 8);
+	const __m128i stepC = _mm_set_epi16(8, 8, 0, 8, 8, 0, 8, 8);
+	for (; i + 8 <= numTris; i += 8) {
+		_mm_storeu_si128((__m128i *)(outInds + 0), a);
+		_mm_storeu_si128((__m128i *)(outInds + 8), b);
+		_mm_storeu_si128((__m128i *)(outInds + 16), c);
+		outInds += 24;
+		a = _mm_add_epi16(a, stepA);
+		b = _mm_add_epi16(b, stepB);
+		c = _mm_add_epi16(c, stepC);
+	}
+#endif
+	for (; i < numTris; i++) {
+		*outInds++ = start;
+		*outInds++ = start + i + 1;
+		*outInds++ = start + i + 2;
+	}
+	return outInds;
+}
+
+// Writes the lines of a line strip of sequential vertices as a list.
+static u16 *WriteLineStripAsList(u16 *outInds, int start, int numLines) {
+	int i = 0;
+#if defined(_M_SSE)
+	__m128i ind = _mm_add_epi16(_mm_set1_epi16((short)start), _mm_set_epi16(4, 3, 3, 2, 2, 1, 1, 0));
+	const __m128i step = _mm_set1_epi16(4);
+	for (; i + 4 <= numLines; i += 4) {
+		_mm_storeu_si128((__m128i *)outInds, ind);
+		outInds += 8;
+		ind = _mm_add_epi16(ind, step);
+	}
+#endif
+	for (; i < numLines; i++) {
+		*outInds++ = start + i;
+		*outInds++ = start + i + 1;
+	}
+	return outInds;
+}
+
+// Writes indexOffset + inds[i] for count indices.
+static u16 *TranslateSequential(u16 *outInds, const u8 *inds, int count, int indexOffset) {
+	int i = 0;
+#if defined(_M_SSE)
+	const __m128i offset = _mm_set1_epi16((short)indexOffset);
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 8 <= count; i += 8) {
+		const __m128i ind = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(inds + i)), zero);
+		_mm_storeu_si128((__m128i *)(outInds + i), _mm_add_epi16(ind, offset));
+	}
+#endif
+	for (; i < count; i++)
+		outInds[i] = indexOffset + inds[i];
+	return outInds + count;
+}
+
+static u16 *TranslateSequential(u16 *outInds, const u16_le *inds, int count, int indexOffset) {
+	int i = 0;
+#if defined(_M_SSE)
+	const __m128i offset = _mm_set1_epi16((short)indexOffset);
+	for (; i + 8 <= count; i += 8) {
+		const __m128i ind = _mm_loadu_si128((const __m128i *)(inds + i));
+		_mm_storeu_si128((__m128i *)(outInds + i), _mm_add_epi16(ind, offset));
+	}
+#endif
+	for (; i < count; i++)
+		outInds[i] = indexOffset + inds[i];
+	return outInds + count;
+}
+
+// Two triangles per iteration, so there's no winding to toggle.
+template <typename T>
+static u16 *TranslateStripAsList(u16 *outInds, const T *inds, int numTris, int indexOffset) {
+	int i = 0;
+	for (; i + 2 <= numTris; i += 2) {
+		const u16 i0 = indexOffset + inds[i];
+		const u16 i1 = indexOffset + inds[i + 1];
+		const u16 i2 = indexOffset + inds[i + 2];
+		const u16 i3 = indexOffset + inds[i + 3];
+		outInds[0] = i0;
+		outInds[1] = i1;
+		outInds[2] = i2;
+		outInds[3] = i1;
+		outInds[4] = i3;
+		outInds[5] = i2;
+		outInds += 6;
+	}
+	if (i < numTris) {
+		*outInds++ = indexOffset + inds[i];
+		*outInds++ = indexOffset + inds[i + 1];
+		*outInds++ = indexOffset + inds[i + 2];
+	}
+	return outInds;
+}
+
 void IndexGenerator::Reset() {
 	prim_ = GE_PRIM_INVALID;
 	count_ = 0;
@@ -48,7 +210,8 @@ bool IndexGenerator::PrimCompatible(int prim1, int prim2) {
 bool IndexGenerator::PrimCompatible(int prim) const {
 	if (prim_ == GE_PRIM_INVALID || prim == GE_PRIM_KEEP_PREVIOUS)
 		return true;
-	return indexedPrimitiveType[prim] == prim_;
+	// prim_ may be a strip.
+	return indexedPrimitiveType[prim] == indexedPrimitiveType[prim_];
 }
 
 void IndexGenerator::Setup(u16 *inds) {
@@ -68,12 +231,54 @@ void IndexGenerator::AddPrim(int prim, int vertexCount) {
 	}
 }
 
-void IndexGenerator::AddPoints(int numVerts) {
+void IndexGenerator::ConvertToList() {
+	if (prim_ != GE_PRIM_TRIANGLE_STRIP)
+		return;
+
+	const int stripCount = count_;
+	stripScratch_.assign(indsBase_, indsBase_ + stripCount);
+	const u16 *strip = stripScratch_.data();
+	u16 *outInds = indsBase_;
+	for (int i = 0; i + 2 < stripCount; i++) {
+		const u16 i0 = strip[i];
+		const u16 i1 = strip[i + 1 + (i & 1)];
+		const u16 i2 = strip[i + 2 - (i & 1)];
+		// Drops the joins between strips, along with anything else that can't draw anything.
+		if (i0 == i1 || i1 == i2 || i0 == i2)
+			continue;
+		outInds[0] = i0;
+		outInds[1] = i1;
+		outInds[2] = i2;
+		outInds += 3;
+	}
+	inds_ = outInds;
+	count_ = (int)(outInds - indsBase_);
+	prim_ = GE_PRIM_TRIANGLES;
+	seenPrims_ |= 1 << GE_PRIM_TRIANGLES;
+	pureCount_ = 0;
+}
+
+// Repeats the last index and the next strip's first one, so that the next strip continues
+// this one through degenerate triangles, starting on an even triangle to keep its winding.
+void IndexGenerator::StitchStrip(u16 firstIndex) {
+	if (count_ == 0)
+		return;
 	u16 *outInds = inds_;
-	const int startIndex = index_;
-	for (int i = 0; i < numVerts; i++)
-		*outInds++ = startIndex + i;
+	const u16 lastIndex = outInds[-1];
+	*outInds++ = lastIndex;
+	*outInds++ = firstIndex;
+	count_ += 2;
+	if (count_ & 1) {
+		*outInds++ = firstIndex;
+		count_++;
+	}
 	inds_ = outInds;
+	seenPrims_ |= SEEN_STITCHED;
+	pureCount_ = 0;
+}
+
+void IndexGenerator::AddPoints(int numVerts) {
+	inds_ = WriteSequential(inds_, index_, numVerts);
 	// ignore overflow verts
 	index_ += numVerts;
 	count_ += numVerts;
@@ -82,14 +287,9 @@ void IndexGenerator::AddPoints(int numVerts) {
 }
 
 void IndexGenerator::AddList(int numVerts) {
-	u16 *outInds = inds_;
-	const int startIndex = index_;
-	for (int i = 0; i < numVerts; i += 3) {
-		*outInds++ = startIndex + i;
-		*outInds++ = startIndex + i + 1;
-		*outInds++ = startIndex + i + 2;
-	}
-	inds_ = outInds;
+	ConvertToList();
+	// Whole triangles are written, even for a partial one at the end.
+	inds_ = WriteSequential(inds_, index_, numVerts > 0 ? (numVerts + 2) / 3 * 3 : 0);
 	// ignore overflow verts
 	index_ += numVerts;
 	count_ += numVerts;
@@ -98,58 +298,48 @@ void IndexGenerator::AddList(int numVerts) {
 }
 
 void IndexGenerator::AddStrip(int numVerts) {
-	int wind = 1;
-	const int numTris = numVerts - 2;
-	u16 *outInds = inds_;
-	int ibase = index_;
-	for (int i = 0; i < numTris; i++) {
-		*outInds++ = ibase;
-		*outInds++ = ibase + wind;
-		wind ^= 3;  // toggle between 1 and 2
-		*outInds++ = ibase + wind;
-		ibase++;
-	}
-	inds_ = outInds;
-	index_ += numVerts;
-	if (numTris > 0)
-		count_ += numTris * 3;	
-	// This is so we can detect one single strip by just looking at seenPrims_.
-	if (!seenPrims_) {
+	if (seenPrims_ == 0) {
+		// This is so we can detect one single strip by just looking at seenPrims_.
+		// Such a strip is drawn without indices.
+		inds_ = WriteSequential(inds_, index_, numVerts);
+		count_ += numVerts;
 		seenPrims_ = 1 << GE_PRIM_TRIANGLE_STRIP;
 		prim_ = GE_PRIM_TRIANGLE_STRIP;
 		pureCount_ = numVerts;
+	} else if (prim_ == GE_PRIM_TRIANGLE_STRIP) {
+		// Only strips so far, so join this one on instead of turning them all into a list.
+		if (numVerts >= 3) {
+			StitchStrip(index_);
+			inds_ = WriteSequential(inds_, index_, numVerts);
+			count_ += numVerts;
+		}
 	} else {
+		const int numTris = numVerts - 2;
+		inds_ = WriteStripAsList(inds_, index_, numTris);
+		if (numTris > 0)
+			count_ += numTris * 3;
 		seenPrims_ |= (1 << GE_PRIM_TRIANGLE_STRIP) | (1 << GE_PRIM_TRIANGLES);
 		prim_ = GE_PRIM_TRIANGLES;
 		pureCount_ = 0;
 	}
+	index_ += numVerts;
 }
 
 void IndexGenerator::AddFan(int numVerts) {
+	ConvertToList();
 	const int numTris = numVerts - 2;
-	u16 *outInds = inds_;
-	const int startIndex = index_;
-	for (int i = 0; i < numTris; i++) {
-		*outInds++ = startIndex;
-		*outInds++ = startIndex + i + 1;
-		*outInds++ = startIndex + i + 2;
-	}
-	inds_ = outInds;
+	inds_ = WriteFanAsList(inds_, index_, numTris);
 	index_ += numVerts;
-	count_ += numTris * 3;
+	if (numTris > 0)
+		count_ += numTris * 3;
 	prim_ = GE_PRIM_TRIANGLES;
 	seenPrims_ |= 1 << GE_PRIM_TRIANGLE_FAN;
 }
 
 //Lines
 void IndexGenerator::AddLineList(int numVerts) {
-	u16 *outInds = inds_;
-	const int startIndex = index_;
-	for (int i = 0; i < numVerts; i += 2) {
-		*outInds++ = startIndex + i;
-		*outInds++ = startIndex + i + 1;
-	}
-	inds_ = outInds;
+	// Whole lines are written, even for a partial one at the end.
+	inds_ = WriteSequential(inds_, index_, numVerts > 0 ? (numVerts + 1) & ~1 : 0);
 	index_ += numVerts;
 	count_ += numVerts;
 	prim_ = GE_PRIM_LINES;
@@ -158,29 +348,18 @@ void IndexGenerator::AddLineList(int numVerts) {
 
 void IndexGenerator::AddLineStrip(int numVerts) {
 	const int numLines = numVerts - 1;
-	u16 *outInds = inds_;
-	const int startIndex = index_;
-	for (int i = 0; i < numLines; i++) {
-		*outInds++ = startIndex + i;
-		*outInds++ = startIndex + i + 1;
-	}
-	inds_ = outInds;
+	inds_ = WriteLineStripAsList(inds_, index_, numLines);
 	index_ += numVerts;
-	count_ += numLines * 2;
+	if (numLines > 0)
+		count_ += numLines * 2;
 	prim_ = GE_PRIM_LINES;
 	seenPrims_ |= 1 << GE_PRIM_LINE_STRIP;
 }
 
 void IndexGenerator::AddRectangles(int numVerts) {
-	u16 *outInds = inds_;
-	const int startIndex = index_;
 	//rectangles always need 2 vertices, disregard the last one if there's an odd number
 	numVerts = numVerts & ~1;
-	for (int i = 0; i < numVerts; i += 2) {
-		*outInds++ = startIndex + i;
-		*outInds++ = startIndex + i + 1;
-	}
-	inds_ = outInds;
+	inds_ = WriteSequential(inds_, index_, numVerts);
 	index_ += numVerts;
 	count_ += numVerts;
 	prim_ = GE_PRIM_RECTANGLES;
@@ -213,10 +392,7 @@ void IndexGenerator::TranslatePrim(int prim, int numInds, const u16 *inds, int i
 
 void IndexGenerator::TranslatePoints(int numInds, const u8 *inds, int indexOffset) {
 	indexOffset = index_ - indexOffset;
-	u16 *outInds = inds_;
-	for (int i = 0; i < numInds; i++)
-		*outInds++ = indexOffset + inds[i];
-	inds_ = outInds;
+	inds_ = TranslateSequential(inds_, inds, numInds, indexOffset);
 	count_ += numInds;
 	prim_ = GE_PRIM_POINTS;
 	seenPrims_ |= (1 << GE_PRIM_POINTS) | SEEN_INDEX8;
@@ -225,76 +401,70 @@ void IndexGenerator::TranslatePoints(int numInds, const u8 *inds, int indexOffse
 void IndexGenerator::TranslatePoints(int numInds, const u16 *_inds, int indexOffset) {
 	indexOffset = index_ - indexOffset;
 	const u16_le *inds = (u16_le*)_inds;
-	u16 *outInds = inds_;
-	for (int i = 0; i < numInds; i++)
-		*outInds++ = indexOffset + inds[i];
-	inds_ = outInds;
+	inds_ = TranslateSequential(inds_, inds, numInds, indexOffset);
 	count_ += numInds;
 	prim_ = GE_PRIM_POINTS;
 	seenPrims_ |= (1 << GE_PRIM_POINTS) | SEEN_INDEX16;
 }
 
 void IndexGenerator::TranslateList(int numInds, const u8 *inds, int indexOffset) {
+	ConvertToList();
 	indexOffset = index_ - indexOffset;
-	u16 *outInds = inds_;
 	int numTris = numInds / 3;  // Round to whole triangles
 	numInds = numTris * 3;
-	for (int i = 0; i < numInds; i += 3) {
-		*outInds++ = indexOffset + inds[i];
-		*outInds++ = indexOffset + inds[i + 1];
-		*outInds++ = indexOffset + inds[i + 2];
-	}
-	inds_ = outInds;
+	inds_ = TranslateSequential(inds_, inds, numInds, indexOffset);
 	count_ += numInds;
 	prim_ = GE_PRIM_TRIANGLES;
 	seenPrims_ |= (1 << GE_PRIM_TRIANGLES) | SEEN_INDEX8;
 }
 
 void IndexGenerator::TranslateStrip(int numInds, const u8 *inds, int indexOffset) {
-	int wind = 1;
 	indexOffset = index_ - indexOffset;
 	int numTris = numInds - 2;
-	u16 *outInds = inds_;
-	for (int i = 0; i < numTris; i++) {
-		*outInds++ = indexOffset + inds[i];
-		*outInds++ = indexOffset + inds[i + wind];
-		wind ^= 3;  // Toggle between 1 and 2
-		*outInds++ = indexOffset + inds[i + wind];
+	if (InStripMode()) {
+		// Keep it a strip, see AddStrip.
+		if (numTris > 0) {
+			StitchStrip(indexOffset + inds[0]);
+			inds_ = TranslateSequential(inds_, inds, numInds, indexOffset);
+			count_ += numInds;
+		}
+		prim_ = GE_PRIM_TRIANGLE_STRIP;
+		seenPrims_ |= (1 << GE_PRIM_TRIANGLE_STRIP) | SEEN_INDEX8;
+		return;
 	}
-	inds_ = outInds;
-	count_ += numTris * 3;
+	inds_ = TranslateStripAsList(inds_, inds, numTris, indexOffset);
+	if (numTris > 0)
+		count_ += numTris * 3;
 	prim_ = GE_PRIM_TRIANGLES;
 	seenPrims_ |= (1 << GE_PRIM_TRIANGLE_STRIP) | SEEN_INDEX8;
 }
 
 void IndexGenerator::TranslateFan(int numInds, const u8 *inds, int indexOffset) {
 	if (numInds <= 0) return;
+	ConvertToList();
 	indexOffset = index_ - indexOffset;
 	int numTris = numInds - 2;
 	u16 *outInds = inds_;
+	const u16 center = indexOffset + inds[0];
 	for (int i = 0; i < numTris; i++) {
-		*outInds++ = indexOffset + inds[0];
+		*outInds++ = center;
 		*outInds++ = indexOffset + inds[i + 1];
 		*outInds++ = indexOffset + inds[i + 2];
 	}
 	inds_ = outInds;
-	count_ += numTris * 3;
+	if (numTris > 0)
+		count_ += numTris * 3;
 	prim_ = GE_PRIM_TRIANGLES;
 	seenPrims_ |= (1 << GE_PRIM_TRIANGLE_FAN) | SEEN_INDEX8;
 }
 
 void IndexGenerator::TranslateList(int numInds, const u16 *_inds, int indexOffset) {
+	ConvertToList();
 	const u16_le *inds = (u16_le*)_inds;
 	indexOffset = index_ - indexOffset;
-	u16 *outInds = inds_;
 	int numTris = numInds / 3;  // Round to whole triangles
 	numInds = numTris * 3;
-	for (int i = 0; i < numInds; i += 3) {
-		*outInds++ = indexOffset + inds[i];
-		*outInds++ = indexOffset + inds[i + 1];
-		*outInds++ = indexOffset + inds[i + 2];
-	}
-	inds_ = outInds;
+	inds_ = TranslateSequential(inds_, inds, numInds, indexOffset);
 	count_ += numInds;
 	prim_ = GE_PRIM_TRIANGLES;
 	seenPrims_ |= (1 << GE_PRIM_TRIANGLES) | SEEN_INDEX16;
@@ -302,18 +472,22 @@ void IndexGenerator::TranslateList(int numInds, const u16 *_inds, int indexOffse
 
 void IndexGenerator::TranslateStrip(int numInds, const u16 *_inds, int indexOffset) {
 	const u16_le *inds = (u16_le*)_inds;
-	int wind = 1;
 	indexOffset = index_ - indexOffset;
 	int numTris = numInds - 2;
-	u16 *outInds = inds_;
-	for (int i = 0; i < numTris; i++) {
-		*outInds++ = indexOffset + inds[i];
-		*outInds++ = indexOffset + inds[i + wind];
-		wind ^= 3;  // Toggle between 1 and 2
-		*outInds++ = indexOffset + inds[i + wind];
+	if (InStripMode()) {
+		// Keep it a strip, see AddStrip.
+		if (numTris > 0) {
+			StitchStrip(indexOffset + inds[0]);
+			inds_ = TranslateSequential(inds_, inds, numInds, indexOffset);
+			count_ += numInds;
+		}
+		prim_ = GE_PRIM_TRIANGLE_STRIP;
+		seenPrims_ |= (1 << GE_PRIM_TRIANGLE_STRIP) | SEEN_INDEX16;
+		return;
 	}
-	inds_ = outInds;
-	count_ += numTris * 3;
+	inds_ = TranslateStripAsList(inds_, inds, numTris, indexOffset);
+	if (numTris > 0)
+		count_ += numTris * 3;
 	prim_ = GE_PRIM_TRIANGLES;
 	seenPrims_ |= (1 << GE_PRIM_TRIANGLE_STRIP) | SEEN_INDEX16;
 }
@@ -321,29 +495,27 @@ void IndexGenerator::TranslateStrip(int numInds, const u16 *_inds, int indexOffs
 void IndexGenerator::TranslateFan(int numInds, const u16 *_inds, int indexOffset) {
 	const u16_le *inds = (u16_le*)_inds;
 	if (numInds <= 0) return;
+	ConvertToList();
 	indexOffset = index_ - indexOffset;
 	int numTris = numInds - 2;
 	u16 *outInds = inds_;
+	const u16 center = indexOffset + inds[0];
 	for (int i = 0; i < numTris; i++) {
-		*outInds++ = indexOffset + inds[0];
+		*outInds++ = center;
 		*outInds++ = indexOffset + inds[i + 1];
 		*outInds++ = indexOffset + inds[i + 2];
 	}
 	inds_ = outInds;
-	count_ += numTris * 3;
+	if (numTris > 0)
+		count_ += numTris * 3;
 	prim_ = GE_PRIM_TRIANGLES;
 	seenPrims_ |= (1 << GE_PRIM_TRIANGLE_FAN) | SEEN_INDEX16;
 }
 
 void IndexGenerator::TranslateLineList(int numInds, const u8 *inds, int indexOffset) {
 	indexOffset = index_ - indexOffset;
-	u16 *outInds = inds_;
 	numInds = numInds & ~1;
-	for (int i = 0; i < numInds; i += 2) {
-		*outInds++ = indexOffset + inds[i];
-		*outInds++ = indexOffset + inds[i+1];
-	}
-	inds_ = outInds;
+	inds_ = TranslateSequential(inds_, inds, numInds, indexOffset);
 	count_ += numInds;
 	prim_ = GE_PRIM_LINES;
 	seenPrims_ |= (1 << GE_PRIM_LINES) | SEEN_INDEX8;
@@ -358,7 +530,8 @@ void IndexGenerator::TranslateLineStrip(int numInds, const u8 *inds, int indexOf
 		*outInds++ = indexOffset + inds[i + 1];
 	}
 	inds_ = outInds;
-	count_ += numLines * 2;
+	if (numLines > 0)
+		count_ += numLines * 2;
 	prim_ = GE_PRIM_LINES;
 	seenPrims_ |= (1 << GE_PRIM_LINE_STRIP) | SEEN_INDEX8;
 }
@@ -366,13 +539,8 @@ void IndexGenerator::TranslateLineStrip(int numInds, const u8 *inds, int indexOf
 void IndexGenerator::TranslateLineList(int numInds, const u16 *_inds, int indexOffset) {
 	indexOffset = index_ - indexOffset;
 	const u16_le *inds = (u16_le*)_inds;
-	u16 *outInds = inds_;
 	numInds = numInds & ~1;
-	for (int i = 0; i < numInds; i += 2) {
-		*outInds++ = indexOffset + inds[i];
-		*outInds++ = indexOffset + inds[i+1];
-	}
-	inds_ = outInds;
+	inds_ = TranslateSequential(inds_, inds, numInds, indexOffset);
 	count_ += numInds;
 	prim_ = GE_PRIM_LINES;
 	seenPrims_ |= (1 << GE_PRIM_LINES) | SEEN_INDEX16;
@@ -388,21 +556,17 @@ void IndexGenerator::TranslateLineStrip(int numInds, const u16 *_inds, int index
 		*outInds++ = indexOffset + inds[i + 1];
 	}
 	inds_ = outInds;
-	count_ += numLines * 2;
+	if (numLines > 0)
+		count_ += numLines * 2;
 	prim_ = GE_PRIM_LINES;
 	seenPrims_ |= (1 << GE_PRIM_LINE_STRIP) | SEEN_INDEX16;
 }
 
 void IndexGenerator::TranslateRectangles(int numInds, const u8 *inds, int indexOffset) {
 	indexOffset = index_ - indexOffset;
-	u16 *outInds = inds_;
 	//rectangles always need 2 vertices, disregard the last one if there's an odd number
 	numInds = numInds & ~1; 
-	for (int i = 0; i < numInds; i += 2) {
-		*outInds++ = indexOffset + inds[i];
-		*outInds++ = indexOffset + inds[i+1];
-	}
-	inds_ = outInds;
+	inds_ = TranslateSequential(inds_, inds, numInds, indexOffset);
 	count_ += numInds;
 	prim_ = GE_PRIM_RECTANGLES;
 	seenPrims_ |= (1 << GE_PRIM_RECTANGLES) | SEEN_INDEX8;
@@ -411,14 +575,9 @@ void IndexGenerator::TranslateRectangles(int numInds, const u8 *inds, int indexO
 void IndexGenerator::TranslateRectangles(int numInds, const u16 *_inds, int indexOffset) {	
 	indexOffset = index_ - indexOffset;
 	const u16_le *inds = (u16_le*)_inds;
-	u16 *outInds = inds_;
 	//rectangles always need 2 vertices, disregard the last one if there's an odd number
 	numInds = numInds & ~1;
-	for (int i = 0; i < numInds; i += 2) {
-		*outInds++ = indexOffset + inds[i];
-		*outInds++ = indexOffset + inds[i+1];
-	}
-	inds_ = outInds;
+	inds_ = TranslateSequential(inds_, inds, numInds, indexOffset);
 	count_ += numInds;
 	prim_ = GE_PRIM_RECTANGLES;
 	seenPrims_ |= (1 << GE_PRIM_RECTANGLES) | SEEN_INDEX16;
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <algorithm>
+#include <vector>
 #include "CommonTypes.h"
 #include "../ge_constants.h"
 
@@ -34,6 +35,10 @@ class IndexGenerator {
 	void TranslatePrim(int prim, int numInds, const u8 *inds, int indexOffset);
 	void TranslatePrim(int prim, int numInds, const u16 *inds, int indexOffset);
 
+	// Strips are kept as one long strip (joined by degenerate triangles) for as long as only strips
+	// are added. This turns such a batch into a triangle list, for code that can't draw strips.
+	void ConvertToList();
+
 	void Advance(int numVerts) {
 		index_ += numVerts;
 	}
@@ -82,9 +87,13 @@ class IndexGenerator {
 	void TranslateFan(int numVerts, const u8 *inds, int indexOffset);
 	void TranslateFan(int numVerts, const u16 *inds, int indexOffset);
 
+	bool InStripMode() const { return seenPrims_ == 0 || prim_ == GE_PRIM_TRIANGLE_STRIP; }
+	void StitchStrip(u16 firstIndex);
+
 	enum {
 		SEEN_INDEX8 = 1 << 16,
-		SEEN_INDEX16 = 1 << 17
+		SEEN_INDEX16 = 1 << 17,
+		SEEN_STITCHED = 1 << 18,
 	};
 
 	u16 *indsBase_;
@@ -94,5 +103,6 @@ class IndexGenerator {
 	int pureCount_;
 	GEPrimitiveType prim_;
 	int seenPrims_;
+	std::vector<u16> stripScratch_;
 };
 
@@ -1,6 +1,7 @@
 #include <string>
 #include <sstream>
 
+#include "Common/FileUtil.h"
 #include "Common/StringUtils.h"
 #include "Core/Config.h"
 
@@ -278,3 +279,144 @@ void ComputeFragmentShaderID(ShaderID *id_out) {
 
 	*id_out = id;
 }
+
+// Shader pseudo-cache.
+//
+// We simply store the IDs of the shaders used during gameplay. On next startup of
+// the same game, we simply compile all the shaders from the start, so we don't have to
+// compile them on the fly later. Where the driver can give us the linked programs, we
+// store those too, which saves most of the work if the same driver loads them again.
+//
+// If things like GPU supported features have changed since the last time, we discard the cache
+// as sometimes these features might have an effect on the ID bits.
+
+#define CACHE_HEADER_MAGIC 0x83277592
+#define CACHE_VERSION 2
+// Same as the current version, but without the program binaries.
+#define CACHE_VERSION_NO_BINARIES 1
+
+struct CacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t featureFlags;
+	uint32_t driverHash;
+	int numVertexShaders;
+	int numFragmentShaders;
+	int numLinkedPrograms;
+};
+
+template <typename T>
+static void WriteArray(std::vector<u8> &data, const T *src, size_t count) {
+	if (count == 0) {
+		return;
+	}
+	const u8 *p = (const u8 *)src;
+	data.insert(data.end(), p, p + sizeof(T) * count);
+}
+
+template <typename T>
+static bool ReadArray(const u8 *&data, const u8 *end, T *dest, size_t count) {
+	if (count > (size_t)(end - data) / sizeof(T)) {
+		return false;
+	}
+	if (count == 0) {
+		return true;
+	}
+	memcpy(dest, data, sizeof(T) * count);
+	data += sizeof(T) * count;
+	return true;
+}
+
+void ShaderCacheFile::Serialize(std::vector<u8> &data) const {
+	CacheHeader header;
+	header.magic = CACHE_HEADER_MAGIC;
+	header.version = CACHE_VERSION;
+	header.featureFlags = featureFlags;
+	header.driverHash = driverHash;
+	header.numVertexShaders = (int)vertexShaders.size();
+	header.numFragmentShaders = (int)fragmentShaders.size();
+	header.numLinkedPrograms = (int)programs.size();
+
+	data.clear();
+	WriteArray(data, &header, 1);
+	WriteArray(data, vertexShaders.data(), vertexShaders.size());
+	WriteArray(data, fragmentShaders.data(), fragmentShaders.size());
+	for (const ShaderCacheProgram &program : programs) {
+		const u32 binarySize = (u32)program.binary.size();
+		WriteArray(data, &program.vsid, 1);
+		WriteArray(data, &program.fsid, 1);
+		WriteArray(data, &program.binaryFormat, 1);
+		WriteArray(data, &binarySize, 1);
+		WriteArray(data, program.binary.data(), program.binary.size());
+	}
+}
+
+bool ShaderCacheFile::Deserialize(const u8 *data, size_t size) {
+	const u8 *end = data + size;
+	*this = ShaderCacheFile();
+
+	CacheHeader header;
+	if (!ReadArray(data, end, &header, 1) || header.magic != CACHE_HEADER_MAGIC) {
+		return false;
+	}
+	if (header.version != CACHE_VERSION && header.version != CACHE_VERSION_NO_BINARIES) {
+		return false;
+	}
+	if (header.numVertexShaders < 0 || header.numFragmentShaders < 0 || header.numLinkedPrograms < 0) {
+		return false;
+	}
+	const bool hasBinaries = header.version != CACHE_VERSION_NO_BINARIES;
+
+	vertexShaders.resize(header.numVertexShaders);
+	fragmentShaders.resize(header.numFragmentShaders);
+	bool valid = ReadArray(data, end, vertexShaders.data(), vertexShaders.size());
+	valid = valid && ReadArray(data, end, fragmentShaders.data(), fragmentShaders.size());
+	// Each program is at least its two IDs, don't trust the count to allocate.
+	valid = valid && (size_t)header.numLinkedPrograms <= (size_t)(end - data) / (2 * sizeof(ShaderID));
+	if (valid) {
+		programs.resize(header.numLinkedPrograms);
+	}
+	for (size_t i = 0; valid && i < programs.size(); i++) {
+		ShaderCacheProgram &program = programs[i];
+		u32 binarySize = 0;
+		program.binaryFormat = 0;
+		valid = ReadArray(data, end, &program.vsid, 1) && ReadArray(data, end, &program.fsid, 1);
+		if (valid && hasBinaries) {
+			valid = ReadArray(data, end, &program.binaryFormat, 1) && ReadArray(data, end, &binarySize, 1);
+			valid = valid && binarySize <= (size_t)(end - data);
+			if (valid) {
+				program.binary.assign(data, data + binarySize);
+				data += binarySize;
+			}
+		}
+	}
+
+	if (!valid) {
+		ERROR_LOG(G3D, "Truncated shader cache file, ignoring it.");
+		*this = ShaderCacheFile();
+		return false;
+	}
+	featureFlags = header.featureFlags;
+	driverHash = hasBinaries ? header.driverHash : 0;
+	return true;
+}
+
+bool ShaderCacheFile::Save(const std::string &filename) const {
+	std::vector<u8> data;
+	Serialize(data);
+
+	File::IOFile f(filename, "wb");
+	return f.IsOpen() && f.WriteBytes(data.data(), data.size());
+}
+
+bool ShaderCacheFile::Load(const std::string &filename) {
+	File::IOFile f(filename, "rb");
+	if (!f.IsOpen()) {
+		return false;
+	}
+	std::vector<u8> data((size_t)f.GetSize());
+	if (!f.ReadBytes(data.data(), data.size())) {
+		return false;
+	}
+	return Deserialize(data.data(), data.size());
+}
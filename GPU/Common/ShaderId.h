@@ -1,5 +1,8 @@
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include "base/basictypes.h"
 
 // TODO: There will be additional bits, indicating that groups of these will be
@@ -144,3 +147,33 @@ std::string VertexShaderDesc(const ShaderID &id);
 
 void ComputeFragmentShaderID(ShaderID *id);
 std::string FragmentShaderDesc(const ShaderID &id);
+
+struct ShaderCacheProgram {
+	ShaderID vsid;
+	ShaderID fsid;
+	// A driver specific program binary, if the backend could get one. Empty otherwise.
+	u32 binaryFormat;
+	std::vector<u8> binary;
+};
+
+// The shaders and programs a game has used, saved so that they can all be compiled at startup the
+// next time instead of stuttering on first use. Doesn't know about any graphics API, the backends
+// fill it in and compile from it.
+struct ShaderCacheFile {
+	ShaderCacheFile() : featureFlags(0), driverHash(0) {}
+
+	// The IDs depend on these, so the cache is useless if they change.
+	u32 featureFlags;
+	// Identifies the driver that produced the program binaries, they can't be used with any other.
+	u32 driverHash;
+	std::vector<ShaderID> vertexShaders;
+	std::vector<ShaderID> fragmentShaders;
+	std::vector<ShaderCacheProgram> programs;
+
+	void Serialize(std::vector<u8> &data) const;
+	// Returns false, leaving the cache empty, if the data is truncated or not a shader cache.
+	bool Deserialize(const u8 *data, size_t size);
+
+	bool Save(const std::string &filename) const;
+	bool Load(const std::string &filename);
+};
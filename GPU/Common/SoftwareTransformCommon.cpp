@@ -18,6 +18,7 @@
 #include "math/math_util.h"
 #include "gfx_es2/gpu_features.h"
 
+#include "Common/ThreadPools.h"
 #include "Core/Config.h"
 #include "GPU/GPUState.h"
 #include "GPU/Math3D.h"
@@ -128,60 +129,38 @@ static bool IsReallyAClear(const TransformedVertex *transformed, int numVerts) {
 	return true;
 }
 
-void SoftwareTransform(
-	int prim, u8 *decoded, int vertexCount, u32 vertType, u16 *&inds, int indexType,
-	const DecVtxFormat &decVtxFormat, int &maxIndex, FramebufferManagerCommon *fbman, TextureCacheCommon *texCache, TransformedVertex *transformed, TransformedVertex *transformedExpanded, TransformedVertex *&drawBuffer, int &numTrans, bool &drawIndexed, SoftwareTransformResult *result, float ySign) {
-	bool throughmode = (vertType & GE_VTYPE_THROUGH_MASK) != 0;
-	bool lmode = gstate.isUsingSecondaryColor() && gstate.isLightingEnabled();
-
-	// TODO: Split up into multiple draw calls for GLES 2.0 where you can't guarantee support for more than 0x10000 verts.
-
-#if defined(MOBILE_DEVICE)
-	if (vertexCount > 0x10000/3)
-		vertexCount = 0x10000/3;
-#endif
-
-	float uscale = 1.0f;
-	float vscale = 1.0f;
-	bool scaleUV = false;
-	if (throughmode) {
-		uscale /= gstate_c.curTextureWidth;
-		vscale /= gstate_c.curTextureHeight;
-	} else {
-		scaleUV = !g_Config.bPrescaleUV;
-	}
-
-	bool skinningEnabled = vertTypeIsSkinningEnabled(vertType);
-
-	const int w = gstate.getTextureWidth(0);
-	const int h = gstate.getTextureHeight(0);
-	float widthFactor = (float) w / (float) gstate_c.curTextureWidth;
-	float heightFactor = (float) h / (float) gstate_c.curTextureHeight;
-
-	Lighter lighter(vertType);
-	float fog_end = getFloat24(gstate.fog1);
-	float fog_slope = getFloat24(gstate.fog2);
-	// Same fixup as in ShaderManager.cpp
-	if (my_isinf(fog_slope)) {
-		// not really sure what a sensible value might be.
-		fog_slope = fog_slope < 0.0f ? -10000.0f : 10000.0f;
-	}
-	if (my_isnan(fog_slope)) {
-		// Workaround for https://github.com/hrydgard/ppsspp/issues/5384#issuecomment-38365988
-		// Just put the fog far away at a large finite distance.
-		// Infinities and NaNs are rather unpredictable in shaders on many GPUs
-		// so it's best to just make it a sane calculation.
-		fog_end = 100000.0f;
-		fog_slope = 1.0f;
-	}
-
-	VertexReader reader(decoded, decVtxFormat, vertType);
-	if (throughmode) {
-		for (int index = 0; index < maxIndex; index++) {
+// Everything SoftwareTransformRange needs, computed once per draw.
+struct SoftwareTransformContext {
+	u8 *decoded;
+	const DecVtxFormat &decVtxFormat;
+	u32 vertType;
+	bool throughmode;
+	bool lmode;
+	bool skinningEnabled;
+	bool scaleUV;
+	float uscale;
+	float vscale;
+	float widthFactor;
+	float heightFactor;
+	float fog_end;
+	float fog_slope;
+	Lighter *lighter;
+	TransformedVertex *transformed;
+};
+
+// Below this, handing the work to the thread pool costs more than it saves.
+static const int SOFTWARE_TRANSFORM_PARALLEL_MIN_VERTS = 1024;
+
+// Transforms vertices [lower, upper).  Each vertex only depends on the draw state, so ranges can
+// run on different threads and still give exactly the same result.
+static void SoftwareTransformRange(const SoftwareTransformContext &ctx, int lower, int upper) {
+	VertexReader reader(ctx.decoded, ctx.decVtxFormat, ctx.vertType);
+	if (ctx.throughmode) {
+		for (int index = lower; index < upper; index++) {
 			// Do not touch the coordinates or the colors. No lighting.
 			reader.Goto(index);
 			// TODO: Write to a flexible buffer, we don't always need all four components.
-			TransformedVertex &vert = transformed[index];
+			TransformedVertex &vert = ctx.transformed[index];
 			reader.ReadPos(vert.pos);
 
 			if (reader.hasColor0()) {
@@ -193,8 +172,8 @@ void SoftwareTransform(
 			if (reader.hasUV()) {
 				reader.ReadUV(vert.uv);
 
-				vert.u *= uscale;
-				vert.v *= vscale;
+				vert.u *= ctx.uscale;
+				vert.v *= ctx.vscale;
 			} else {
 				vert.u = 0.0f;
 				vert.v = 0.0f;
@@ -205,7 +184,7 @@ void SoftwareTransform(
 		}
 	} else {
 		// Okay, need to actually perform the full transform.
-		for (int index = 0; index < maxIndex; index++) {
+		for (int index = lower; index < upper; index++) {
 			reader.Goto(index);
 
 			float v[3] = {0, 0, 0};
@@ -221,7 +200,7 @@ void SoftwareTransform(
 			Vec3f worldnormal(0, 0, 1);
 			reader.ReadPos(pos);
 
-			if (!skinningEnabled) {
+			if (!ctx.skinningEnabled) {
 				Vec3ByMatrix43(out, pos, gstate.worldMatrix);
 				if (reader.hasNormal()) {
 					reader.ReadNrm(normal.AsArray());
@@ -240,7 +219,7 @@ void SoftwareTransform(
 				// Skinning
 				Vec3f psum(0, 0, 0);
 				Vec3f nsum(0, 0, 0);
-				for (int i = 0; i < vertTypeGetNumBoneWeights(vertType); i++) {
+				for (int i = 0; i < vertTypeGetNumBoneWeights(ctx.vertType); i++) {
 					if (weights[i] != 0.0f) {
 						Vec3ByMatrix43(out, pos, gstate.boneMatrix+i*12);
 						Vec3f tpos(out);
@@ -276,13 +255,13 @@ void SoftwareTransform(
 			if (gstate.isLightingEnabled()) {
 				float litColor0[4];
 				float litColor1[4];
-				lighter.Light(litColor0, litColor1, unlitColor.AsArray(), out, worldnormal);
+				ctx.lighter->Light(litColor0, litColor1, unlitColor.AsArray(), out, worldnormal);
 
 				// Don't ignore gstate.lmode - we should send two colors in that case
 				for (int j = 0; j < 4; j++) {
 					c0[j] = litColor0[j];
 				}
-				if (lmode) {
+				if (ctx.lmode) {
 					// Separate colors
 					for (int j = 0; j < 4; j++) {
 						c1[j] = litColor1[j];
@@ -301,7 +280,7 @@ void SoftwareTransform(
 				} else {
 					c0 = Vec4f::FromRGBA(gstate.getMaterialAmbientRGBA());
 				}
-				if (lmode) {
+				if (ctx.lmode) {
 					// c1 is already 0.
 				}
 			}
@@ -315,7 +294,7 @@ void SoftwareTransform(
 			case GE_TEXMAP_TEXTURE_COORDS:	// UV mapping
 			case GE_TEXMAP_UNKNOWN: // Seen in Riviera.  Unsure of meaning, but this works.
 				// Texture scale/offset is only performed in this mode.
-				if (scaleUV) {
+				if (ctx.scaleUV) {
 					uv[0] = ruv[0]*gstate_c.uv.uScale + gstate_c.uv.uOff;
 					uv[1] = ruv[1]*gstate_c.uv.vScale + gstate_c.uv.vOff;
 				} else {
@@ -364,8 +343,8 @@ void SoftwareTransform(
 			case GE_TEXMAP_ENVIRONMENT_MAP:
 				// Shade mapping - use two light sources to generate U and V.
 				{
-					Vec3f lightpos0 = Vec3f(&lighter.lpos[gstate.getUVLS0() * 3]).Normalized();
-					Vec3f lightpos1 = Vec3f(&lighter.lpos[gstate.getUVLS1() * 3]).Normalized();
+					Vec3f lightpos0 = Vec3f(&ctx.lighter->lpos[gstate.getUVLS0() * 3]).Normalized();
+					Vec3f lightpos1 = Vec3f(&ctx.lighter->lpos[gstate.getUVLS1() * 3]).Normalized();
 
 					uv[0] = (1.0f + Dot(lightpos0, worldnormal))/2.0f;
 					uv[1] = (1.0f + Dot(lightpos1, worldnormal))/2.0f;
@@ -379,25 +358,85 @@ void SoftwareTransform(
 				break;
 			}
 
-			uv[0] = uv[0] * widthFactor;
-			uv[1] = uv[1] * heightFactor;
+			uv[0] = uv[0] * ctx.widthFactor;
+			uv[1] = uv[1] * ctx.heightFactor;
 
 			// Transform the coord by the view matrix.
 			Vec3ByMatrix43(v, out, gstate.viewMatrix);
-			fogCoef = (v[2] + fog_end) * fog_slope;
+			fogCoef = (v[2] + ctx.fog_end) * ctx.fog_slope;
 
 			// TODO: Write to a flexible buffer, we don't always need all four components.
-			memcpy(&transformed[index].x, v, 3 * sizeof(float));
-			transformed[index].fog = fogCoef;
-			memcpy(&transformed[index].u, uv, 3 * sizeof(float));
-			transformed[index].color0_32 = c0.ToRGBA();
-			transformed[index].color1_32 = c1.ToRGBA();
+			memcpy(&ctx.transformed[index].x, v, 3 * sizeof(float));
+			ctx.transformed[index].fog = fogCoef;
+			memcpy(&ctx.transformed[index].u, uv, 3 * sizeof(float));
+			ctx.transformed[index].color0_32 = c0.ToRGBA();
+			ctx.transformed[index].color1_32 = c1.ToRGBA();
 
 			// The multiplication by the projection matrix is still performed in the vertex shader.
 			// So is vertex depth rounding, to simulate the 16-bit depth buffer.
 		}
 	}
 
+}
+
+void SoftwareTransform(
+	int prim, u8 *decoded, int vertexCount, u32 vertType, u16 *&inds, int indexType,
+	const DecVtxFormat &decVtxFormat, int &maxIndex, FramebufferManagerCommon *fbman, TextureCacheCommon *texCache, TransformedVertex *transformed, TransformedVertex *transformedExpanded, TransformedVertex *&drawBuffer, int &numTrans, bool &drawIndexed, SoftwareTransformResult *result, float ySign) {
+	bool throughmode = (vertType & GE_VTYPE_THROUGH_MASK) != 0;
+	bool lmode = gstate.isUsingSecondaryColor() && gstate.isLightingEnabled();
+
+	// TODO: Split up into multiple draw calls for GLES 2.0 where you can't guarantee support for more than 0x10000 verts.
+
+#if defined(MOBILE_DEVICE)
+	if (vertexCount > 0x10000/3)
+		vertexCount = 0x10000/3;
+#endif
+
+	float uscale = 1.0f;
+	float vscale = 1.0f;
+	bool scaleUV = false;
+	if (throughmode) {
+		uscale /= gstate_c.curTextureWidth;
+		vscale /= gstate_c.curTextureHeight;
+	} else {
+		scaleUV = !g_Config.bPrescaleUV;
+	}
+
+	bool skinningEnabled = vertTypeIsSkinningEnabled(vertType);
+
+	const int w = gstate.getTextureWidth(0);
+	const int h = gstate.getTextureHeight(0);
+	float widthFactor = (float) w / (float) gstate_c.curTextureWidth;
+	float heightFactor = (float) h / (float) gstate_c.curTextureHeight;
+
+	Lighter lighter(vertType);
+	float fog_end = getFloat24(gstate.fog1);
+	float fog_slope = getFloat24(gstate.fog2);
+	// Same fixup as in ShaderManager.cpp
+	if (my_isinf(fog_slope)) {
+		// not really sure what a sensible value might be.
+		fog_slope = fog_slope < 0.0f ? -10000.0f : 10000.0f;
+	}
+	if (my_isnan(fog_slope)) {
+		// Workaround for https://github.com/hrydgard/ppsspp/issues/5384#issuecomment-38365988
+		// Just put the fog far away at a large finite distance.
+		// Infinities and NaNs are rather unpredictable in shaders on many GPUs
+		// so it's best to just make it a sane calculation.
+		fog_end = 100000.0f;
+		fog_slope = 1.0f;
+	}
+
+	SoftwareTransformContext ctx = { decoded, decVtxFormat, vertType, throughmode, lmode, skinningEnabled, scaleUV, uscale, vscale, widthFactor, heightFactor, fog_end, fog_slope, &lighter, transformed };
+	// Big batches, mostly skinned and lit characters, are worth splitting across the worker threads.
+	if (maxIndex >= SOFTWARE_TRANSFORM_PARALLEL_MIN_VERTS && g_Config.iNumWorkerThreads > 1) {
+		auto bound = [&](int a, int b) -> void {
+			SoftwareTransformRange(ctx, a, b);
+		};
+		GlobalThreadPool::Loop(bound, 0, maxIndex);
+	} else {
+		SoftwareTransformRange(ctx, 0, maxIndex);
+	}
+
 	// Here's the best opportunity to try to detect rectangles used to clear the screen, and
 	// replace them with real clears. This can provide a speedup on certain mobile chips.
 	//
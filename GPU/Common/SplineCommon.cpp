@@ -21,6 +21,7 @@
 #include "profiler/profiler.h"
 
 #include "Common/CPUDetect.h"
+#include "Common/ThreadPools.h"
 #include "Core/Config.h"
 
 #include "GPU/Common/SplineCommon.h"
@@ -54,7 +55,8 @@ inline __m128 SSENormalizeMultiplierSSE2(__m128 v)
 
 inline __m128 SSENormalizeMultiplierSSE4(__m128 v)
 {
-	return _mm_rsqrt_ps(_mm_dp_ps(v, v, 0xFF));
+	// Only x, y and z: w is whatever followed the vector in memory.
+	return _mm_rsqrt_ps(_mm_dp_ps(v, v, 0x7F));
 }
 
 inline __m128 SSENormalizeMultiplier(bool useSSE4, __m128 v)
@@ -123,15 +125,59 @@ inline float bern1deriv(float x) { return 9 * x * x - 12 * x + 3; }
 inline float bern2deriv(float x) { return 3 * (2 - 3 * x) * x; }
 inline float bern3deriv(float x) { return 3 * x * x; }
 
+// Bernstein basis weights and their derivatives at one tesselation step.
+struct BezierWeights {
+	float t;
+	float basis[4];
+	float deriv[4];
+};
+
+// The weights only depend on the tesselation level, so all the patches of a surface share one table per direction.
+static BezierWeights *BuildBezierWeights(int tess) {
+	BezierWeights *table = new BezierWeights[tess + 1];
+	for (int i = 0; i < tess + 1; i++) {
+		float t = ((float)i / (float)tess);
+		table[i].t = t;
+		table[i].basis[0] = bern0(t);
+		table[i].basis[1] = bern1(t);
+		table[i].basis[2] = bern2(t);
+		table[i].basis[3] = bern3(t);
+		table[i].deriv[0] = bern0deriv(t);
+		table[i].deriv[1] = bern1deriv(t);
+		table[i].deriv[2] = bern2deriv(t);
+		table[i].deriv[3] = bern3deriv(t);
+	}
+	return table;
+}
+
+// Points are padded to four floats so all the components are evaluated at once.
+static inline void BernsteinSum(float out[4], const float *p0, const float *p1, const float *p2, const float *p3, const float weights[4]) {
+#ifdef _M_SSE
+	__m128 sum = _mm_mul_ps(_mm_loadu_ps(p0), _mm_set_ps1(weights[0]));
+	sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(p1), _mm_set_ps1(weights[1])));
+	sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(p2), _mm_set_ps1(weights[2])));
+	sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(p3), _mm_set_ps1(weights[3])));
+	_mm_storeu_ps(out, sum);
+#else
+	for (int i = 0; i < 4; i++) {
+		out[i] = p0[i] * weights[0] + p1[i] * weights[1] + p2[i] * weights[2] + p3[i] * weights[3];
+	}
+#endif
+}
+
 // http://en.wikipedia.org/wiki/Bernstein_polynomial
-static Vec3Packedf Bernstein3D(const Vec3Packedf& p0, const Vec3Packedf& p1, const Vec3Packedf& p2, const Vec3Packedf& p3, float x) {
-	if (x == 0) return p0;
-	else if (x == 1) return p3;
-	return p0 * bern0(x) + p1 * bern1(x) + p2 * bern2(x) + p3 * bern3(x);
+static inline void Bernstein3D(float out[4], const float *p0, const float *p1, const float *p2, const float *p3, const BezierWeights &w) {
+	if (w.t == 0) {
+		memcpy(out, p0, 4 * sizeof(float));
+	} else if (w.t == 1) {
+		memcpy(out, p3, 4 * sizeof(float));
+	} else {
+		BernsteinSum(out, p0, p1, p2, p3, w.basis);
+	}
 }
 
-static Vec3Packedf Bernstein3DDerivative(const Vec3Packedf& p0, const Vec3Packedf& p1, const Vec3Packedf& p2, const Vec3Packedf& p3, float x) {
-	return p0 * bern0deriv(x) + p1 * bern1deriv(x) + p2 * bern2deriv(x) + p3 * bern3deriv(x);
+static inline void Bernstein3DDerivative(float out[4], const float *p0, const float *p1, const float *p2, const float *p3, const BezierWeights &w) {
+	BernsteinSum(out, p0, p1, p2, p3, w.deriv);
 }
 
 static void spline_n_4(int i, float t, float *knot, float *splineVal) {
@@ -293,10 +339,38 @@ static inline void AccumulateWeighted(Vec4f &out, const Vec4f &in, const Vec4f &
 #endif
 }
 
+// Spline basis weights for one column or row of the tesselated patch.
+struct SplineWeights {
+	int start;  // First of the four control points they apply to.
+	float weights[4];
+};
+
+// The weights only depend on the column (or row), so they're computed once per column instead of per vertex.
+static SplineWeights *BuildSplineWeights(int patch_div, int count, float *knot) {
+	SplineWeights *table = new SplineWeights[patch_div + 1];
+	float one_over_patch_div = 1.0f / (float)(patch_div);
+	for (int tile = 0; tile < patch_div + 1; tile++) {
+		float t = (float)tile * (float)(count - 3) * one_over_patch_div;
+		if (t < 0.0f)
+			t = 0.0f;
+		int start = (int)t;
+
+		// TODO: Would really like to fix the surrounding logic somehow to get rid of these but I can't quite get it right..
+		// Without the previous epsilons and with large count_u, we will end up doing an out of bounds access later without these.
+		if (start >= count - 3) start = count - 4;
+
+		table[tile].start = start;
+		spline_n_4(start, t, knot, table[tile].weights);
+	}
+	return table;
+}
+
+// Below this many vertices, handing the work to the thread pool costs more than it saves.
+static const int TESSELATE_PARALLEL_MIN_VERTS = 1024;
+
 template <bool origNrm, bool origCol, bool origTc, bool useSSE4>
 static void SplinePatchFullQuality(u8 *&dest, u16 *indices, int &count, const SplinePatchLocal &spatch, u32 origVertType, int quality, int maxVertices) {
 	// Full (mostly) correct tessellation of spline patches.
-	// Not very fast.
 
 	float *knot_u = new float[spatch.count_u + 4];
 	float *knot_v = new float[spatch.count_v + 4];
@@ -333,110 +407,112 @@ static void SplinePatchFullQuality(u8 *&dest, u16 *indices, int &count, const Sp
 	float one_over_patch_div_s = 1.0f / (float)(patch_div_s);
 	float one_over_patch_div_t = 1.0f / (float)(patch_div_t);
 
-	for (int tile_v = 0; tile_v < patch_div_t + 1; tile_v++) {
-		float v = (float)tile_v * (float)(spatch.count_v - 3) * one_over_patch_div_t;
-		if (v < 0.0f)
-			v = 0.0f;
-		for (int tile_u = 0; tile_u < patch_div_s + 1; tile_u++) {
-			float u = (float)tile_u * (float)(spatch.count_u - 3) * one_over_patch_div_s;
-			if (u < 0.0f)
-				u = 0.0f;
-			SimpleVertex *vert = &vertices[tile_v * (patch_div_s + 1) + tile_u];
-			Vec4f vert_color(0, 0, 0, 0);
-			Vec3f vert_pos;
-			vert_pos.SetZero();
-			Vec3f vert_nrm;
-			if (origNrm) {
-				vert_nrm.SetZero();
-			}
-			if (origCol) {
-				vert_color.SetZero();
-			} else {
-				memcpy(vert->color, spatch.points[0]->color, 4);
-			}
-			if (origTc) {
-				vert->uv[0] = 0.0f;
-				vert->uv[1] = 0.0f;
-			} else {
-				vert->uv[0] = tu_width * ((float)tile_u * one_over_patch_div_s);
-				vert->uv[1] = tv_height * ((float)tile_v * one_over_patch_div_t);
-			}
-
-
-			// Collect influences from surrounding control points.
-			float u_weights[4];
-			float v_weights[4];
-
-			int iu = (int)u;
-			int iv = (int)v;
+	const SplineWeights *weights_u = BuildSplineWeights(patch_div_s, spatch.count_u, knot_u);
+	const SplineWeights *weights_v = BuildSplineWeights(patch_div_t, spatch.count_v, knot_v);
+
+	// Every vertex only depends on the control points, so rows can be computed on any thread.
+	auto computeRows = [&](int lower, int upper) {
+		for (int tile_v = lower; tile_v < upper; tile_v++) {
+			const SplineWeights &wv = weights_v[tile_v];
+			for (int tile_u = 0; tile_u < patch_div_s + 1; tile_u++) {
+				const SplineWeights &wu = weights_u[tile_u];
+				SimpleVertex *vert = &vertices[tile_v * (patch_div_s + 1) + tile_u];
+				Vec4f vert_color(0, 0, 0, 0);
+				Vec3f vert_pos;
+				vert_pos.SetZero();
+				Vec3f vert_nrm;
+				if (origNrm) {
+					vert_nrm.SetZero();
+				}
+				if (origCol) {
+					vert_color.SetZero();
+				} else {
+					memcpy(vert->color, spatch.points[0]->color, 4);
+				}
+				if (origTc) {
+					vert->uv[0] = 0.0f;
+					vert->uv[1] = 0.0f;
+				} else {
+					vert->uv[0] = tu_width * ((float)tile_u * one_over_patch_div_s);
+					vert->uv[1] = tv_height * ((float)tile_v * one_over_patch_div_t);
+				}
 
-			// TODO: Would really like to fix the surrounding logic somehow to get rid of these but I can't quite get it right..
-			// Without the previous epsilons and with large count_u, we will end up doing an out of bounds access later without these.
-			if (iu >= spatch.count_u - 3) iu = spatch.count_u - 4;
-			if (iv >= spatch.count_v - 3) iv = spatch.count_v - 4;
 
-			spline_n_4(iu, u, knot_u, u_weights);
-			spline_n_4(iv, v, knot_v, v_weights);
+				// Collect influences from surrounding control points.
+				const float *u_weights = wu.weights;
+				const float *v_weights = wv.weights;
+				const int iu = wu.start;
+				const int iv = wv.start;
 
-			// Handle degenerate patches. without this, spatch.points[] may read outside the number of initialized points.
-			int patch_w = std::min(spatch.count_u - iu, 4);
-			int patch_h = std::min(spatch.count_v - iv, 4);
+				// Handle degenerate patches. without this, spatch.points[] may read outside the number of initialized points.
+				int patch_w = std::min(spatch.count_u - iu, 4);
+				int patch_h = std::min(spatch.count_v - iv, 4);
 
-			for (int ii = 0; ii < patch_w; ++ii) {
-				for (int jj = 0; jj < patch_h; ++jj) {
-					float u_spline = u_weights[ii];
-					float v_spline = v_weights[jj];
-					float f = u_spline * v_spline;
+				for (int ii = 0; ii < patch_w; ++ii) {
+					for (int jj = 0; jj < patch_h; ++jj) {
+						float u_spline = u_weights[ii];
+						float v_spline = v_weights[jj];
+						float f = u_spline * v_spline;
 
-					if (f > 0.0f) {
+						if (f > 0.0f) {
 #ifdef _M_SSE
-						Vec4f fv(_mm_set_ps1(f));
+							Vec4f fv(_mm_set_ps1(f));
 #else
-						Vec4f fv = Vec4f::AssignToAll(f);
+							Vec4f fv = Vec4f::AssignToAll(f);
 #endif
-						int idx = spatch.count_u * (iv + jj) + (iu + ii);
-						/*
-						if (idx >= max_idx) {
-							char temp[512];
-							snprintf(temp, sizeof(temp), "count_u: %d count_v: %d patch_w: %d patch_h: %d  ii: %d  jj: %d  iu: %d  iv: %d  patch_div_s: %d  patch_div_t: %d\n", spatch.count_u, spatch.count_v, patch_w, patch_h, ii, jj, iu, iv, patch_div_s, patch_div_t);
-							OutputDebugStringA(temp);
-							DebugBreak();
-						}*/
-						SimpleVertex *a = spatch.points[idx];
-						AccumulateWeighted(vert_pos, a->pos, fv);
-						if (origTc) {
-							vert->uv[0] += a->uv[0] * f;
-							vert->uv[1] += a->uv[1] * f;
-						}
-						if (origCol) {
-							Vec4f a_color = Vec4f::FromRGBA(a->color_32);
-							AccumulateWeighted(vert_color, a_color, fv);
-						}
-						if (origNrm) {
-							AccumulateWeighted(vert_nrm, a->nrm, fv);
+							int idx = spatch.count_u * (iv + jj) + (iu + ii);
+							/*
+							if (idx >= max_idx) {
+								char temp[512];
+								snprintf(temp, sizeof(temp), "count_u: %d count_v: %d patch_w: %d patch_h: %d  ii: %d  jj: %d  iu: %d  iv: %d  patch_div_s: %d  patch_div_t: %d\n", spatch.count_u, spatch.count_v, patch_w, patch_h, ii, jj, iu, iv, patch_div_s, patch_div_t);
+								OutputDebugStringA(temp);
+								DebugBreak();
+							}*/
+							SimpleVertex *a = spatch.points[idx];
+							AccumulateWeighted(vert_pos, a->pos, fv);
+							if (origTc) {
+								vert->uv[0] += a->uv[0] * f;
+								vert->uv[1] += a->uv[1] * f;
+							}
+							if (origCol) {
+								Vec4f a_color = Vec4f::FromRGBA(a->color_32);
+								AccumulateWeighted(vert_color, a_color, fv);
+							}
+							if (origNrm) {
+								AccumulateWeighted(vert_nrm, a->nrm, fv);
+							}
 						}
 					}
 				}
-			}
-			vert->pos = vert_pos;
-			if (origNrm) {
+				vert->pos = vert_pos;
+				if (origNrm) {
 #ifdef _M_SSE
-				const __m128 normalize = SSENormalizeMultiplier(useSSE4, vert_nrm.vec);
-				vert_nrm.vec = _mm_mul_ps(vert_nrm.vec, normalize);
+					const __m128 normalize = SSENormalizeMultiplier(useSSE4, vert_nrm.vec);
+					vert_nrm.vec = _mm_mul_ps(vert_nrm.vec, normalize);
 #else
-				vert_nrm.Normalize();
+					vert_nrm.Normalize();
 #endif
-				vert->nrm = vert_nrm;
-			} else {
-				vert->nrm.SetZero();
-				vert->nrm.z = 1.0f;
-			}
-			if (origCol) {
-				vert->color_32 = vert_color.ToRGBA();
+					vert->nrm = vert_nrm;
+				} else {
+					vert->nrm.SetZero();
+					vert->nrm.z = 1.0f;
+				}
+				if (origCol) {
+					vert->color_32 = vert_color.ToRGBA();
+				}
 			}
 		}
+	};
+
+	const bool parallel = (patch_div_s + 1) * (patch_div_t + 1) >= TESSELATE_PARALLEL_MIN_VERTS && g_Config.iNumWorkerThreads > 1;
+	if (parallel) {
+		GlobalThreadPool::Loop(computeRows, 0, patch_div_t + 1);
+	} else {
+		computeRows(0, patch_div_t + 1);
 	}
 
+	delete[] weights_u;
+	delete[] weights_v;
 	delete[] knot_u;
 	delete[] knot_v;
 
@@ -446,43 +522,52 @@ static void SplinePatchFullQuality(u8 *&dest, u16 *indices, int &count, const Sp
 		const __m128 facing = spatch.patchFacing ? _mm_set_ps1(-1.0f) : _mm_set_ps1(1.0f);
 #endif
 
-		for (int v = 0; v < patch_div_t + 1; v++) {
-			Vec3f vl_pos = vertices[v * (patch_div_s + 1)].pos;
-			Vec3f vc_pos = vertices[v * (patch_div_s + 1)].pos;
+		// Only reads positions, which are all done by now, so this splits by rows too.
+		auto computeNormalRows = [&](int lower, int upper) {
+			for (int v = lower; v < upper; v++) {
+				Vec3f vl_pos = vertices[v * (patch_div_s + 1)].pos;
+				Vec3f vc_pos = vertices[v * (patch_div_s + 1)].pos;
 
-			for (int u = 0; u < patch_div_s + 1; u++) {
-				const int t = std::max(0, v - 1);
-				const int r = std::min(patch_div_s, u + 1);
-				const int b = std::min(patch_div_t, v + 1);
+				for (int u = 0; u < patch_div_s + 1; u++) {
+					const int t = std::max(0, v - 1);
+					const int r = std::min(patch_div_s, u + 1);
+					const int b = std::min(patch_div_t, v + 1);
 
-				const Vec3f vr_pos = vertices[v * (patch_div_s + 1) + r].pos;
+					const Vec3f vr_pos = vertices[v * (patch_div_s + 1) + r].pos;
 
 #ifdef _M_SSE
-				const __m128 right = _mm_sub_ps(vr_pos.vec, vl_pos.vec);
+					const __m128 right = _mm_sub_ps(vr_pos.vec, vl_pos.vec);
 
-				const Vec3f vb_pos = vertices[b * (patch_div_s + 1) + u].pos;
-				const Vec3f vt_pos = vertices[t * (patch_div_s + 1) + u].pos;
-				const __m128 down = _mm_sub_ps(vb_pos.vec, vt_pos.vec);
+					const Vec3f vb_pos = vertices[b * (patch_div_s + 1) + u].pos;
+					const Vec3f vt_pos = vertices[t * (patch_div_s + 1) + u].pos;
+					const __m128 down = _mm_sub_ps(vb_pos.vec, vt_pos.vec);
 
-				const __m128 crossed = SSECrossProduct(right, down);
-				const __m128 normalize = SSENormalizeMultiplier(useSSE4, crossed);
+					const __m128 crossed = SSECrossProduct(right, down);
+					const __m128 normalize = SSENormalizeMultiplier(useSSE4, crossed);
 
-				Vec3f finalNrm = _mm_mul_ps(normalize, _mm_mul_ps(crossed, facing));
-				vertices[v * (patch_div_s + 1) + u].nrm = finalNrm;
+					Vec3f finalNrm = _mm_mul_ps(normalize, _mm_mul_ps(crossed, facing));
+					vertices[v * (patch_div_s + 1) + u].nrm = finalNrm;
 #else
-				const Vec3Packedf &right = vr_pos - vl_pos;
-				const Vec3Packedf &down = vertices[b * (patch_div_s + 1) + u].pos - vertices[t * (patch_div_s + 1) + u].pos;
+					const Vec3Packedf &right = vr_pos - vl_pos;
+					const Vec3Packedf &down = vertices[b * (patch_div_s + 1) + u].pos - vertices[t * (patch_div_s + 1) + u].pos;
 
-				vertices[v * (patch_div_s + 1) + u].nrm = Cross(right, down).Normalized();
-				if (spatch.patchFacing) {
-					vertices[v * (patch_div_s + 1) + u].nrm *= -1.0f;
-				}
+					vertices[v * (patch_div_s + 1) + u].nrm = Cross(right, down).Normalized();
+					if (spatch.patchFacing) {
+						vertices[v * (patch_div_s + 1) + u].nrm *= -1.0f;
+					}
 #endif
 
-				// Rotate for the next one to the right.
-				vl_pos = vc_pos;
-				vc_pos = vr_pos;
+					// Rotate for the next one to the right.
+					vl_pos = vc_pos;
+					vc_pos = vr_pos;
+				}
 			}
+		};
+
+		if (parallel) {
+			GlobalThreadPool::Loop(computeNormalRows, 0, patch_div_t + 1);
+		} else {
+			computeNormalRows(0, patch_div_t + 1);
 		}
 	}
 
@@ -612,71 +697,56 @@ static void _BezierPatchLowQuality(u8 *&dest, u16 *&indices, int &count, int tes
 	}
 }
 
-static void _BezierPatchHighQuality(u8 *&dest, u16 *&indices, int &count, int tess_u, int tess_v, const BezierPatch &patch, u32 origVertType, int maxVertices) {
+static void _BezierPatchHighQuality(u8 *&dest, u16 *&indices, int &count, int tess_u, int tess_v, const BezierPatch &patch, u32 origVertType, const BezierWeights *weights_u, const BezierWeights *weights_v) {
 	const float third = 1.0f / 3.0f;
 
-	// Downsample until it fits, in case crazy tesselation factors are sent.
-	while ((tess_u + 1) * (tess_v + 1) > maxVertices) {
-		tess_u /= 2;
-		tess_v /= 2;
-	}
-
 	// First compute all the vertices and put them in an array
 	SimpleVertex *&vertices = (SimpleVertex*&)dest;
 
-	Vec3Packedf *horiz = new Vec3Packedf[(tess_u + 1) * 4];
-	Vec3Packedf *horiz2 = horiz + (tess_u + 1) * 1;
-	Vec3Packedf *horiz3 = horiz + (tess_u + 1) * 2;
-	Vec3Packedf *horiz4 = horiz + (tess_u + 1) * 3;
+	float points[16][4];
+	for (int i = 0; i < 16; i++) {
+		memcpy(points[i], patch.points[i]->pos.AsArray(), 3 * sizeof(float));
+		points[i][3] = 0.0f;
+	}
 
-	Vec3Packedf *derivU1 = new Vec3Packedf[(tess_u + 1) * 4];
-	Vec3Packedf *derivU2 = derivU1 + (tess_u + 1) * 1;
-	Vec3Packedf *derivU3 = derivU1 + (tess_u + 1) * 2;
-	Vec3Packedf *derivU4 = derivU1 + (tess_u + 1) * 3;
+	float (*horiz)[4][4] = new float[tess_u + 1][4][4];
+	float (*derivU)[4][4] = new float[tess_u + 1][4][4];
 
 	bool computeNormals = patch.computeNormals;
 
 	// Precompute the horizontal curves to we only have to evaluate the vertical ones.
 	for (int i = 0; i < tess_u + 1; i++) {
-		float u = ((float)i / (float)tess_u);
-		horiz[i] = Bernstein3D(patch.points[0]->pos, patch.points[1]->pos, patch.points[2]->pos, patch.points[3]->pos, u);
-		horiz2[i] = Bernstein3D(patch.points[4]->pos, patch.points[5]->pos, patch.points[6]->pos, patch.points[7]->pos, u);
-		horiz3[i] = Bernstein3D(patch.points[8]->pos, patch.points[9]->pos, patch.points[10]->pos, patch.points[11]->pos, u);
-		horiz4[i] = Bernstein3D(patch.points[12]->pos, patch.points[13]->pos, patch.points[14]->pos, patch.points[15]->pos, u);
-
-		if (computeNormals) {
-			derivU1[i] = Bernstein3DDerivative(patch.points[0]->pos, patch.points[1]->pos, patch.points[2]->pos, patch.points[3]->pos, u);
-			derivU2[i] = Bernstein3DDerivative(patch.points[4]->pos, patch.points[5]->pos, patch.points[6]->pos, patch.points[7]->pos, u);
-			derivU3[i] = Bernstein3DDerivative(patch.points[8]->pos, patch.points[9]->pos, patch.points[10]->pos, patch.points[11]->pos, u);
-			derivU4[i] = Bernstein3DDerivative(patch.points[12]->pos, patch.points[13]->pos, patch.points[14]->pos, patch.points[15]->pos, u);
+		for (int row = 0; row < 4; row++) {
+			const float (*p)[4] = &points[row * 4];
+			Bernstein3D(horiz[i][row], p[0], p[1], p[2], p[3], weights_u[i]);
+			if (computeNormals) {
+				Bernstein3DDerivative(derivU[i][row], p[0], p[1], p[2], p[3], weights_u[i]);
+			}
 		}
 	}
 
+	const bool origTc = (origVertType & GE_VTYPE_TC_MASK) != 0;
+	const bool origCol = (origVertType & GE_VTYPE_COL_MASK) != 0;
 
 	for (int tile_v = 0; tile_v < tess_v + 1; ++tile_v) {
+		const BezierWeights &wv = weights_v[tile_v];
 		for (int tile_u = 0; tile_u < tess_u + 1; ++tile_u) {
-			float u = ((float)tile_u / (float)tess_u);
-			float v = ((float)tile_v / (float)tess_v);
-			float bv = v;
+			float u = weights_u[tile_u].t;
+			float v = wv.t;
 
-			// TODO: Should be able to precompute the four curves per U, then just Bernstein per V. Will benefit large tesselation factors.
-			const Vec3Packedf &pos1 = horiz[tile_u];
-			const Vec3Packedf &pos2 = horiz2[tile_u];
-			const Vec3Packedf &pos3 = horiz3[tile_u];
-			const Vec3Packedf &pos4 = horiz4[tile_u];
+			const float (*pos)[4] = horiz[tile_u];
 
 			SimpleVertex &vert = vertices[tile_v * (tess_u + 1) + tile_u];
 
 			if (computeNormals) {
-				const Vec3Packedf &derivU1_ = derivU1[tile_u];
-				const Vec3Packedf &derivU2_ = derivU2[tile_u];
-				const Vec3Packedf &derivU3_ = derivU3[tile_u];
-				const Vec3Packedf &derivU4_ = derivU4[tile_u];
+				const float (*deriv)[4] = derivU[tile_u];
 
-				Vec3Packedf derivU = Bernstein3D(derivU1_, derivU2_, derivU3_, derivU4_, bv);
-				Vec3Packedf derivV = Bernstein3DDerivative(pos1, pos2, pos3, pos4, bv);
+				float vertDerivU[4];
+				float vertDerivV[4];
+				Bernstein3D(vertDerivU, deriv[0], deriv[1], deriv[2], deriv[3], wv);
+				Bernstein3DDerivative(vertDerivV, pos[0], pos[1], pos[2], pos[3], wv);
 
-				vert.nrm = Cross(derivU, derivV).Normalized();
+				vert.nrm = Cross(Vec3Packedf(vertDerivU), Vec3Packedf(vertDerivV)).Normalized();
 				if (patch.patchFacing)
 					vert.nrm *= -1.0f;
 			}
@@ -684,25 +754,32 @@ static void _BezierPatchHighQuality(u8 *&dest, u16 *&indices, int &count, int te
 				vert.nrm.SetZero();
 			}
 
-			vert.pos = Bernstein3D(pos1, pos2, pos3, pos4, bv);
+			float vertPos[4];
+			Bernstein3D(vertPos, pos[0], pos[1], pos[2], pos[3], wv);
+			vert.pos = Vec3Packedf(vertPos);
 
-			if ((origVertType & GE_VTYPE_TC_MASK) == 0) {
+			if (!origTc) {
 				// Generate texcoord
 				vert.uv[0] = u + patch.u_index * third;
 				vert.uv[1] = v + patch.v_index * third;
-			} else {
-				// Sample UV from control points
-				patch.sampleTexUV(u, v, vert.uv[0], vert.uv[1]);
-			} 
-
-			if (origVertType & GE_VTYPE_COL_MASK) {
-				patch.sampleColor(u, v, vert.color);
-			} else {
+			}
+
+			if (origTc || origCol) {
+				const BezierPatch::SamplingParams params(u, v);
+				if (origTc) {
+					// Sample UV from control points
+					patch.sampleTexUV(params, vert.uv[0], vert.uv[1]);
+				}
+				if (origCol) {
+					patch.sampleColor(params, vert.color);
+				}
+			}
+			if (!origCol) {
 				memcpy(vert.color, patch.points[0]->color, 4);
 			}
 		}
 	}
-	delete[] derivU1;
+	delete[] derivU;
 	delete[] horiz;
 
 	GEPatchPrimType prim_type = patch.primType;
@@ -723,17 +800,60 @@ static void _BezierPatchHighQuality(u8 *&dest, u16 *&indices, int &count, int te
 }
 
 void TesselateBezierPatch(u8 *&dest, u16 *&indices, int &count, int tess_u, int tess_v, const BezierPatch &patch, u32 origVertType, int maxVertices) {
+	TesselateBezierPatches(dest, indices, count, tess_u, tess_v, &patch, 1, origVertType, maxVertices);
+}
+
+void TesselateBezierPatches(u8 *&dest, u16 *&indices, int &count, int tess_u, int tess_v, const BezierPatch *patches, int num_patches, u32 origVertType, int maxVertices) {
 	switch (g_Config.iSplineBezierQuality) {
 	case LOW_QUALITY:
-		_BezierPatchLowQuality(dest, indices, count, tess_u, tess_v, patch, origVertType);
-		break;
+		for (int patch_idx = 0; patch_idx < num_patches; ++patch_idx) {
+			_BezierPatchLowQuality(dest, indices, count, tess_u, tess_v, patches[patch_idx], origVertType);
+		}
+		return;
 	case MEDIUM_QUALITY:
-		_BezierPatchHighQuality(dest, indices, count, tess_u / 2, tess_v / 2, patch, origVertType, maxVertices);
+		tess_u /= 2;
+		tess_v /= 2;
 		break;
 	case HIGH_QUALITY:
-		_BezierPatchHighQuality(dest, indices, count, tess_u, tess_v, patch, origVertType, maxVertices);
 		break;
+	default:
+		return;
+	}
+
+	// Downsample until it fits, in case crazy tesselation factors are sent.
+	while ((tess_u + 1) * (tess_v + 1) > maxVertices) {
+		tess_u /= 2;
+		tess_v /= 2;
 	}
+
+	const BezierWeights *weights_u = BuildBezierWeights(tess_u);
+	const BezierWeights *weights_v = BuildBezierWeights(tess_v);
+
+	// Every patch produces the same number of vertices and indices, so each knows where its output goes
+	// and they can be tesselated on any thread.
+	const int vertsPerPatch = (tess_u + 1) * (tess_v + 1);
+	const int indsPerPatch = tess_u * tess_v * 6;
+	auto tesselatePatches = [&](int lower, int upper) {
+		for (int patch_idx = lower; patch_idx < upper; ++patch_idx) {
+			u8 *patchDest = dest + patch_idx * vertsPerPatch * sizeof(SimpleVertex);
+			u16 *patchIndices = indices + patch_idx * indsPerPatch;
+			int patchCount = 0;
+			_BezierPatchHighQuality(patchDest, patchIndices, patchCount, tess_u, tess_v, patches[patch_idx], origVertType, weights_u, weights_v);
+		}
+	};
+
+	if (num_patches * vertsPerPatch >= TESSELATE_PARALLEL_MIN_VERTS && g_Config.iNumWorkerThreads > 1) {
+		GlobalThreadPool::Loop(tesselatePatches, 0, num_patches);
+	} else {
+		tesselatePatches(0, num_patches);
+	}
+
+	delete[] weights_u;
+	delete[] weights_v;
+
+	dest += num_patches * vertsPerPatch * sizeof(SimpleVertex);
+	indices += num_patches * indsPerPatch;
+	count += num_patches * indsPerPatch;
 }
 
 
@@ -891,10 +1011,7 @@ void DrawEngineCommon::SubmitBezier(const void *control_points, const void *indi
 
 	u16 *inds = quadIndices_;
 	int maxVertices = SPLINE_BUFFER_SIZE / vertexSize;
-	for (int patch_idx = 0; patch_idx < num_patches_u*num_patches_v; ++patch_idx) {
-		BezierPatch& patch = patches[patch_idx];
-		TesselateBezierPatch(dest, inds, count, tess_u, tess_v, patch, origVertType, maxVertices);
-	}
+	TesselateBezierPatches(dest, inds, count, tess_u, tess_v, patches, num_patches_u * num_patches_v, origVertType, maxVertices);
 	delete[] patches;
 
 	u32 vertTypeWithIndex16 = (vertType & ~GE_VTYPE_IDX_MASK) | GE_VTYPE_IDX_16BIT;
@@ -36,11 +36,14 @@ inline float lerp(float a, float b, float x) {
 	return a + x * (b - a);
 }
 
-// SLOW!
 inline void lerpColor(const Vec4f &a, const Vec4f &b, float x, Vec4f &out) {
+#if defined(_M_SSE)
+	out.vec = _mm_add_ps(a.vec, _mm_mul_ps(_mm_set_ps1(x), _mm_sub_ps(b.vec, a.vec)));
+#else
 	for (int i = 0; i < 4; i++) {
 		out[i] = a[i] + x * (b[i] - a[i]);
 	}
+#endif
 }
 
 inline void lerpColor(const u8 *a, const u8 *b, float x, Vec4f &out) {
@@ -92,7 +95,10 @@ struct BezierPatch {
 
 	// Interpolate colors between control points (bilinear, should be good enough).
 	void sampleColor(float u, float v, u8 color[4]) const {
-		const SamplingParams params(u, v);
+		sampleColor(SamplingParams(u, v), color);
+	}
+
+	void sampleColor(const SamplingParams &params, u8 color[4]) const {
 		Vec4f upperColor, lowerColor, resultColor;
 		lerpColor(points[params.tl]->color, points[params.tr]->color, params.fracU, upperColor);
 		lerpColor(points[params.bl]->color, points[params.br]->color, params.fracU, lowerColor);
@@ -101,13 +107,27 @@ struct BezierPatch {
 	}
 
 	void sampleTexUV(float u, float v, float &tu, float &tv) const {
-		const SamplingParams params(u, v);
+		sampleTexUV(SamplingParams(u, v), tu, tv);
+	}
+
+	void sampleTexUV(const SamplingParams &params, float &tu, float &tv) const {
+#if defined(_M_SSE)
+		// Both coordinates of the upper and lower edges at once: (upperTU, upperTV, lowerTU, lowerTV).
+		const __m128 left = _mm_set_ps(points[params.bl]->uv[1], points[params.bl]->uv[0], points[params.tl]->uv[1], points[params.tl]->uv[0]);
+		const __m128 right = _mm_set_ps(points[params.br]->uv[1], points[params.br]->uv[0], points[params.tr]->uv[1], points[params.tr]->uv[0]);
+		const __m128 edges = _mm_add_ps(left, _mm_mul_ps(_mm_set_ps1(params.fracU), _mm_sub_ps(right, left)));
+		const __m128 lower = _mm_movehl_ps(edges, edges);
+		const __m128 result = _mm_add_ps(edges, _mm_mul_ps(_mm_set_ps1(params.fracV), _mm_sub_ps(lower, edges)));
+		tu = _mm_cvtss_f32(result);
+		tv = _mm_cvtss_f32(_mm_shuffle_ps(result, result, _MM_SHUFFLE(1, 1, 1, 1)));
+#else
 		float upperTU = lerp(points[params.tl]->uv[0], points[params.tr]->uv[0], params.fracU);
 		float upperTV = lerp(points[params.tl]->uv[1], points[params.tr]->uv[1], params.fracU);
 		float lowerTU = lerp(points[params.bl]->uv[0], points[params.br]->uv[0], params.fracU);
 		float lowerTV = lerp(points[params.bl]->uv[1], points[params.br]->uv[1], params.fracU);
 		tu = lerp(upperTU, lowerTU, params.fracV);
 		tv = lerp(upperTV, lowerTV, params.fracV);
+#endif
 	}
 };
 
@@ -132,3 +152,5 @@ enum quality {
 
 void TesselateSplinePatch(u8 *&dest, u16 *indices, int &count, const SplinePatchLocal &spatch, u32 origVertType, int maxVertices);
 void TesselateBezierPatch(u8 *&dest, u16 *&indices, int &count, int tess_u, int tess_v, const BezierPatch &patch, u32 origVertType, int maxVertices);
+// Tesselates all the patches of a bezier surface, splitting big surfaces across the worker threads.
+void TesselateBezierPatches(u8 *&dest, u16 *&indices, int &count, int tess_u, int tess_v, const BezierPatch *patches, int num_patches, u32 origVertType, int maxVertices);
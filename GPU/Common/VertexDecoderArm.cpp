@@ -103,6 +103,8 @@ static const ARMReg accNEON = Q3;
 static const JitLookup jitLookup[] = {
 	{&VertexDecoder::Step_WeightsU8, &VertexDecoderJitCache::Jit_WeightsU8},
 	{&VertexDecoder::Step_WeightsU16, &VertexDecoderJitCache::Jit_WeightsU16},
+	{&VertexDecoder::Step_WeightsU8ToFloat, &VertexDecoderJitCache::Jit_WeightsU8ToFloat},
+	{&VertexDecoder::Step_WeightsU16ToFloat, &VertexDecoderJitCache::Jit_WeightsU16ToFloat},
 	{&VertexDecoder::Step_WeightsFloat, &VertexDecoderJitCache::Jit_WeightsFloat},
 
 	{&VertexDecoder::Step_WeightsU8Skin, &VertexDecoderJitCache::Jit_WeightsU8Skin},
@@ -111,18 +113,24 @@ static const JitLookup jitLookup[] = {
 
 	{&VertexDecoder::Step_TcU8, &VertexDecoderJitCache::Jit_TcU8},
 	{&VertexDecoder::Step_TcU16, &VertexDecoderJitCache::Jit_TcU16},
+	{&VertexDecoder::Step_TcU8ToFloat, &VertexDecoderJitCache::Jit_TcU8ToFloat},
+	{&VertexDecoder::Step_TcU16ToFloat, &VertexDecoderJitCache::Jit_TcU16ToFloat},
 	{&VertexDecoder::Step_TcFloat, &VertexDecoderJitCache::Jit_TcFloat},
 	{&VertexDecoder::Step_TcU16Double, &VertexDecoderJitCache::Jit_TcU16Double},
+	{&VertexDecoder::Step_TcU16DoubleToFloat, &VertexDecoderJitCache::Jit_TcU16DoubleToFloat},
 
 	{&VertexDecoder::Step_TcU8Prescale, &VertexDecoderJitCache::Jit_TcU8Prescale},
 	{&VertexDecoder::Step_TcU16Prescale, &VertexDecoderJitCache::Jit_TcU16Prescale},
 	{&VertexDecoder::Step_TcFloatPrescale, &VertexDecoderJitCache::Jit_TcFloatPrescale},
 
 	{&VertexDecoder::Step_TcU16Through, &VertexDecoderJitCache::Jit_TcU16Through},
+	{&VertexDecoder::Step_TcU16ThroughToFloat, &VertexDecoderJitCache::Jit_TcU16ThroughToFloat},
 	{&VertexDecoder::Step_TcFloatThrough, &VertexDecoderJitCache::Jit_TcFloatThrough},
 	{&VertexDecoder::Step_TcU16ThroughDouble, &VertexDecoderJitCache::Jit_TcU16ThroughDouble},
+	{&VertexDecoder::Step_TcU16ThroughDoubleToFloat, &VertexDecoderJitCache::Jit_TcU16ThroughDoubleToFloat},
 
 	{&VertexDecoder::Step_NormalS8, &VertexDecoderJitCache::Jit_NormalS8},
+	{&VertexDecoder::Step_NormalS8ToFloat, &VertexDecoderJitCache::Jit_NormalS8ToFloat},
 	{&VertexDecoder::Step_NormalS16, &VertexDecoderJitCache::Jit_NormalS16},
 	{&VertexDecoder::Step_NormalFloat, &VertexDecoderJitCache::Jit_NormalFloat},
 
@@ -130,6 +138,7 @@ static const JitLookup jitLookup[] = {
 	{&VertexDecoder::Step_NormalS16Skin, &VertexDecoderJitCache::Jit_NormalS16Skin},
 	{&VertexDecoder::Step_NormalFloatSkin, &VertexDecoderJitCache::Jit_NormalFloatSkin},
 
+	{&VertexDecoder::Step_ColorInvalid, &VertexDecoderJitCache::Jit_ColorInvalid},
 	{&VertexDecoder::Step_Color8888, &VertexDecoderJitCache::Jit_Color8888},
 	{&VertexDecoder::Step_Color4444, &VertexDecoderJitCache::Jit_Color4444},
 	{&VertexDecoder::Step_Color565, &VertexDecoderJitCache::Jit_Color565},
@@ -366,6 +375,45 @@ static const ARMReg weightRegs[8] = { S8, S9, S10, S11, S12, S13, S14, S15 };
 static const ARMReg neonWeightRegsD[4] = { D4, D5, D6, D7 };
 static const ARMReg neonWeightRegsQ[2] = { Q2, Q3 };
 
+void VertexDecoderJitCache::Jit_WeightsU8ToFloat() {
+	// TODO: NEON.  These are only used when not skinning.
+	MOVI2F(S15, by128, scratchReg);
+	int j;
+	for (j = 0; j < dec_->nweights; j++) {
+		LDRB(tempReg1, srcReg, dec_->weightoff + j);
+		VMOV(fpScratchReg, tempReg1);
+		VCVT(fpScratchReg, fpScratchReg, TO_FLOAT);
+		VMUL(fpScratchReg, fpScratchReg, S15);
+		VSTR(fpScratchReg, dstReg, dec_->decFmt.w0off + j * 4);
+	}
+	if (j & 3) {
+		EOR(scratchReg, scratchReg, scratchReg);
+	}
+	while (j & 3) {
+		STR(scratchReg, dstReg, dec_->decFmt.w0off + j * 4);
+		j++;
+	}
+}
+
+void VertexDecoderJitCache::Jit_WeightsU16ToFloat() {
+	MOVI2F(S15, by32768, scratchReg);
+	int j;
+	for (j = 0; j < dec_->nweights; j++) {
+		LDRH(tempReg1, srcReg, dec_->weightoff + j * 2);
+		VMOV(fpScratchReg, tempReg1);
+		VCVT(fpScratchReg, fpScratchReg, TO_FLOAT);
+		VMUL(fpScratchReg, fpScratchReg, S15);
+		VSTR(fpScratchReg, dstReg, dec_->decFmt.w0off + j * 4);
+	}
+	if (j & 3) {
+		EOR(scratchReg, scratchReg, scratchReg);
+	}
+	while (j & 3) {
+		STR(scratchReg, dstReg, dec_->decFmt.w0off + j * 4);
+		j++;
+	}
+}
+
 void VertexDecoderJitCache::Jit_ApplyWeights() {
 	if (NEONSkinning) {
 		// We construct a matrix in Q4-Q7
@@ -573,7 +621,27 @@ void VertexDecoderJitCache::Jit_TcFloat() {
 void VertexDecoderJitCache::Jit_TcU16Through() {
 	LDRH(tempReg1, srcReg, dec_->tcoff);
 	LDRH(tempReg2, srcReg, dec_->tcoff + 2);
+	Jit_UpdateThroughBounds();
+
+	ORR(tempReg1, tempReg1, Operand2(tempReg2, ST_LSL, 16));
+	STR(tempReg1, dstReg, dec_->decFmt.uvoff);
+}
+
+void VertexDecoderJitCache::Jit_TcU16ThroughToFloat() {
+	LDRH(tempReg1, srcReg, dec_->tcoff);
+	LDRH(tempReg2, srcReg, dec_->tcoff + 2);
+	Jit_UpdateThroughBounds();
+
+	VMOV(fpScratchReg, tempReg1);
+	VMOV(fpScratchReg2, tempReg2);
+	VCVT(fpScratchReg, fpScratchReg, TO_FLOAT);
+	VCVT(fpScratchReg2, fpScratchReg2, TO_FLOAT);
+	VSTR(fpScratchReg, dstReg, dec_->decFmt.uvoff);
+	VSTR(fpScratchReg2, dstReg, dec_->decFmt.uvoff + 4);
+}
 
+// Expects U in tempReg1 and V in tempReg2, both zero extended.
+void VertexDecoderJitCache::Jit_UpdateThroughBounds() {
 	// TODO: Cleanup.
 	MOVP2R(scratchReg, &gstate_c.vertBounds.minU);
 
@@ -590,9 +658,6 @@ void VertexDecoderJitCache::Jit_TcU16Through() {
 	updateSide(tempReg1, CC_GT, offsetof(KnownVertexBounds, maxU));
 	updateSide(tempReg2, CC_LT, offsetof(KnownVertexBounds, minV));
 	updateSide(tempReg2, CC_GT, offsetof(KnownVertexBounds, maxV));
-
-	ORR(tempReg1, tempReg1, Operand2(tempReg2, ST_LSL, 16));
-	STR(tempReg1, dstReg, dec_->decFmt.uvoff);
 }
 
 void VertexDecoderJitCache::Jit_TcFloatThrough() {
@@ -618,6 +683,50 @@ void VertexDecoderJitCache::Jit_TcU16ThroughDouble() {
 	STR(tempReg1, dstReg, dec_->decFmt.uvoff);
 }
 
+void VertexDecoderJitCache::Jit_TcU16ThroughDoubleToFloat() {
+	LDRH(tempReg1, srcReg, dec_->tcoff);
+	LDRH(tempReg2, srcReg, dec_->tcoff + 2);
+	LSL(tempReg1, tempReg1, 1);
+	LSL(tempReg2, tempReg2, 1);
+	VMOV(fpScratchReg, tempReg1);
+	VMOV(fpScratchReg2, tempReg2);
+	VCVT(fpScratchReg, fpScratchReg, TO_FLOAT);
+	VCVT(fpScratchReg2, fpScratchReg2, TO_FLOAT);
+	VSTR(fpScratchReg, dstReg, dec_->decFmt.uvoff);
+	VSTR(fpScratchReg2, dstReg, dec_->decFmt.uvoff + 4);
+}
+
+void VertexDecoderJitCache::Jit_TcU8ToFloat() {
+	LDRB(tempReg1, srcReg, dec_->tcoff);
+	LDRB(tempReg2, srcReg, dec_->tcoff + 1);
+	Jit_WriteUVToFloat(by128);
+}
+
+void VertexDecoderJitCache::Jit_TcU16ToFloat() {
+	LDRH(tempReg1, srcReg, dec_->tcoff);
+	LDRH(tempReg2, srcReg, dec_->tcoff + 2);
+	Jit_WriteUVToFloat(by32768);
+}
+
+void VertexDecoderJitCache::Jit_TcU16DoubleToFloat() {
+	LDRH(tempReg1, srcReg, dec_->tcoff);
+	LDRH(tempReg2, srcReg, dec_->tcoff + 2);
+	Jit_WriteUVToFloat(by16384);
+}
+
+// Expects U in tempReg1 and V in tempReg2.
+void VertexDecoderJitCache::Jit_WriteUVToFloat(float scale) {
+	MOVI2F(S15, scale, scratchReg);
+	VMOV(fpScratchReg, tempReg1);
+	VMOV(fpScratchReg2, tempReg2);
+	VCVT(fpScratchReg, fpScratchReg, TO_FLOAT);
+	VCVT(fpScratchReg2, fpScratchReg2, TO_FLOAT);
+	VMUL(fpScratchReg, fpScratchReg, S15);
+	VMUL(fpScratchReg2, fpScratchReg2, S15);
+	VSTR(fpScratchReg, dstReg, dec_->decFmt.uvoff);
+	VSTR(fpScratchReg2, dstReg, dec_->decFmt.uvoff + 4);
+}
+
 void VertexDecoderJitCache::Jit_TcU8Prescale() {
 	if (cpu_info.bNEON) {
 		// TODO: Needs testing
@@ -694,6 +803,10 @@ void VertexDecoderJitCache::Jit_TcFloatPrescale() {
 	}
 }
 
+void VertexDecoderJitCache::Jit_ColorInvalid() {
+	// Do nothing.
+}
+
 void VertexDecoderJitCache::Jit_Color8888() {
 	LDR(tempReg1, srcReg, dec_->coloff);
 	// Set flags to determine if alpha != 0xFF.
@@ -1143,6 +1256,17 @@ void VertexDecoderJitCache::Jit_NormalS8() {
 	// STR(tempReg1, dstReg, dec_->decFmt.nrmoff);
 }
 
+void VertexDecoderJitCache::Jit_NormalS8ToFloat() {
+	Jit_AnyS8ToFloat(dec_->nrmoff);
+
+	ADD(scratchReg, dstReg, dec_->decFmt.nrmoff);
+	if (NEONSkinning) {
+		VST1(F_32, srcNEON, scratchReg, 2);
+	} else {
+		VSTMIA(scratchReg, false, src[0], 3);
+	}
+}
+
 // Copy 6 bytes and then 2 zeroes.
 void VertexDecoderJitCache::Jit_NormalS16() {
 	LDRH(tempReg1, srcReg, dec_->nrmoff);
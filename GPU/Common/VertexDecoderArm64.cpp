@@ -20,6 +20,8 @@
 #define ARM64
 #endif
 
+#include <algorithm>
+
 #include "base/logging.h"
 #include "Common/CPUDetect.h"
 #include "Core/Config.h"
@@ -35,6 +37,10 @@ static float MEMORY_ALIGNED16(boneMask[4]) = {1.0f, 1.0f, 1.0f, 0.0f};
 static const float by128 = 1.0f / 128.0f;
 static const float by32768 = 1.0f / 32768.0f;
 
+// In RGBA order.  565 has no alpha, it's forced to full when written.
+static const float MEMORY_ALIGNED16(byColor565[4]) = { 255.0f / 31.0f, 255.0f / 63.0f, 255.0f / 31.0f, 0.0f, };
+static const float MEMORY_ALIGNED16(byColor5551[4]) = { 255.0f / 31.0f, 255.0f / 31.0f, 255.0f / 31.0f, 255.0f / 1.0f, };
+
 using namespace Arm64Gen;
 
 // Pointers, X regs (X0 - X17 safe to use.)
@@ -55,6 +61,7 @@ static const ARM64Reg boundsMinUReg = W13;
 static const ARM64Reg boundsMinVReg = W14;
 static const ARM64Reg boundsMaxUReg = W15;
 static const ARM64Reg boundsMaxVReg = W16;
+static const ARM64Reg morphBaseReg = X9;
 
 static const ARM64Reg fpScratchReg = S4;
 static const ARM64Reg fpScratchReg2 = S5;
@@ -76,6 +83,10 @@ static const ARM64Reg accNEON = Q9;
 
 static const ARM64Reg neonWeightRegsQ[2] = { Q3, Q2 };  // reverse order to prevent clash with neonScratchReg in Jit_WeightsU*Skin.
 
+// We never skin when morphing, so the morph weights can stay in Q5-Q6 for the whole loop.
+static const ARM64Reg neonMorphWeightsQ[2] = { Q5, Q6 };
+static const ARM64Reg neonColorScaleQ = Q7;
+
 // Q4-Q7 is the generated matrix that we multiply things by.
 // Q8,Q9 are accumulators/scratch for matrix mul.
 // Q10, Q11 are more scratch for matrix mul.
@@ -84,6 +95,8 @@ static const ARM64Reg neonWeightRegsQ[2] = { Q3, Q2 };  // reverse order to prev
 static const JitLookup jitLookup[] = {
 	{&VertexDecoder::Step_WeightsU8, &VertexDecoderJitCache::Jit_WeightsU8},
 	{&VertexDecoder::Step_WeightsU16, &VertexDecoderJitCache::Jit_WeightsU16},
+	{&VertexDecoder::Step_WeightsU8ToFloat, &VertexDecoderJitCache::Jit_WeightsU8ToFloat},
+	{&VertexDecoder::Step_WeightsU16ToFloat, &VertexDecoderJitCache::Jit_WeightsU16ToFloat},
 	{&VertexDecoder::Step_WeightsFloat, &VertexDecoderJitCache::Jit_WeightsFloat},
 	{&VertexDecoder::Step_WeightsU8Skin, &VertexDecoderJitCache::Jit_WeightsU8Skin},
 	{&VertexDecoder::Step_WeightsU16Skin, &VertexDecoderJitCache::Jit_WeightsU16Skin},
@@ -91,16 +104,22 @@ static const JitLookup jitLookup[] = {
 
 	{&VertexDecoder::Step_TcU8, &VertexDecoderJitCache::Jit_TcU8},
 	{&VertexDecoder::Step_TcU16, &VertexDecoderJitCache::Jit_TcU16},
+	{&VertexDecoder::Step_TcU8ToFloat, &VertexDecoderJitCache::Jit_TcU8ToFloat},
+	{&VertexDecoder::Step_TcU16ToFloat, &VertexDecoderJitCache::Jit_TcU16ToFloat},
 	{&VertexDecoder::Step_TcFloat, &VertexDecoderJitCache::Jit_TcFloat},
 	{&VertexDecoder::Step_TcU16Double, &VertexDecoderJitCache::Jit_TcU16Double},
+	{&VertexDecoder::Step_TcU16DoubleToFloat, &VertexDecoderJitCache::Jit_TcU16DoubleToFloat},
 	{&VertexDecoder::Step_TcU8Prescale, &VertexDecoderJitCache::Jit_TcU8Prescale},
 	{&VertexDecoder::Step_TcU16Prescale, &VertexDecoderJitCache::Jit_TcU16Prescale},
 	{&VertexDecoder::Step_TcFloatPrescale, &VertexDecoderJitCache::Jit_TcFloatPrescale},
 	{&VertexDecoder::Step_TcU16Through, &VertexDecoderJitCache::Jit_TcU16Through},
+	{&VertexDecoder::Step_TcU16ThroughToFloat, &VertexDecoderJitCache::Jit_TcU16ThroughToFloat},
 	{&VertexDecoder::Step_TcFloatThrough, &VertexDecoderJitCache::Jit_TcFloatThrough},
 	{&VertexDecoder::Step_TcU16ThroughDouble, &VertexDecoderJitCache::Jit_TcU16ThroughDouble},
+	{&VertexDecoder::Step_TcU16ThroughDoubleToFloat, &VertexDecoderJitCache::Jit_TcU16ThroughDoubleToFloat},
 
 	{&VertexDecoder::Step_NormalS8, &VertexDecoderJitCache::Jit_NormalS8},
+	{&VertexDecoder::Step_NormalS8ToFloat, &VertexDecoderJitCache::Jit_NormalS8ToFloat},
 	{&VertexDecoder::Step_NormalS16, &VertexDecoderJitCache::Jit_NormalS16},
 	{&VertexDecoder::Step_NormalFloat, &VertexDecoderJitCache::Jit_NormalFloat},
 
@@ -108,6 +127,7 @@ static const JitLookup jitLookup[] = {
 	{&VertexDecoder::Step_NormalS16Skin, &VertexDecoderJitCache::Jit_NormalS16Skin},
 	{&VertexDecoder::Step_NormalFloatSkin, &VertexDecoderJitCache::Jit_NormalFloatSkin},
 
+	{&VertexDecoder::Step_ColorInvalid, &VertexDecoderJitCache::Jit_ColorInvalid},
 	{&VertexDecoder::Step_Color8888, &VertexDecoderJitCache::Jit_Color8888},
 	{&VertexDecoder::Step_Color4444, &VertexDecoderJitCache::Jit_Color4444},
 	{&VertexDecoder::Step_Color565, &VertexDecoderJitCache::Jit_Color565},
@@ -123,7 +143,6 @@ static const JitLookup jitLookup[] = {
 	{&VertexDecoder::Step_PosS16Skin, &VertexDecoderJitCache::Jit_PosS16Skin},
 	{&VertexDecoder::Step_PosFloatSkin, &VertexDecoderJitCache::Jit_PosFloatSkin},
 
-	/*
 	{&VertexDecoder::Step_NormalS8Morph, &VertexDecoderJitCache::Jit_NormalS8Morph},
 	{&VertexDecoder::Step_NormalS16Morph, &VertexDecoderJitCache::Jit_NormalS16Morph},
 	{&VertexDecoder::Step_NormalFloatMorph, &VertexDecoderJitCache::Jit_NormalFloatMorph},
@@ -136,7 +155,6 @@ static const JitLookup jitLookup[] = {
 	{&VertexDecoder::Step_Color4444Morph, &VertexDecoderJitCache::Jit_Color4444Morph},
 	{&VertexDecoder::Step_Color565Morph, &VertexDecoderJitCache::Jit_Color565Morph},
 	{&VertexDecoder::Step_Color5551Morph, &VertexDecoderJitCache::Jit_Color5551Morph},
-	*/
 };
 
 
@@ -222,6 +240,11 @@ JittedVertexDecoder VertexDecoderJitCache::Compile(const VertexDecoder &dec, int
 		}
 	}
 
+	if (dec.morphcount > 1) {
+		MOVP2R(tempRegPtr, &gstate_c.morphWeights[0]);
+		fp.LDP(128, INDEX_SIGNED, neonMorphWeightsQ[0], neonMorphWeightsQ[1], tempRegPtr, 0);
+	}
+
 	if (dec.col) {
 		// Or LDB and skip the conditional?  This is probably cheaper.
 		MOVI2R(fullAlphaReg, 0xFF);
@@ -387,6 +410,44 @@ void VertexDecoderJitCache::Jit_WeightsFloat() {
 	}
 }
 
+void VertexDecoderJitCache::Jit_WeightsU8ToFloat() {
+	auto loadBits = [](int n) -> u32 {
+		// For 3, we over read, the extra lane is zeroed below.
+		return n == 1 ? 8 : (n == 2 ? 16 : 32);
+	};
+
+	Jit_AnyU8ToFloat(dec_->weightoff, loadBits(std::min((int)dec_->nweights, 4)));
+	fp.STUR(128, neonScratchRegQ, dstReg, dec_->decFmt.w0off);
+	if (dec_->nweights > 4) {
+		Jit_AnyU8ToFloat(dec_->weightoff + 4, loadBits(dec_->nweights - 4));
+		fp.STUR(128, neonScratchRegQ, dstReg, dec_->decFmt.w0off + 16);
+	}
+
+	// Zero additional weights rounding up to 4.
+	for (int j = dec_->nweights; j & 3; j++) {
+		STR(INDEX_UNSIGNED, WZR, dstReg, dec_->decFmt.w0off + j * 4);
+	}
+}
+
+void VertexDecoderJitCache::Jit_WeightsU16ToFloat() {
+	auto loadBits = [](int n) -> u32 {
+		// For 3, we over read, the extra lane is zeroed below.
+		return n == 1 ? 16 : (n == 2 ? 32 : 64);
+	};
+
+	Jit_AnyU16ToFloat(dec_->weightoff, loadBits(std::min((int)dec_->nweights, 4)));
+	fp.STUR(128, neonScratchRegQ, dstReg, dec_->decFmt.w0off);
+	if (dec_->nweights > 4) {
+		Jit_AnyU16ToFloat(dec_->weightoff + 8, loadBits(dec_->nweights - 4));
+		fp.STUR(128, neonScratchRegQ, dstReg, dec_->decFmt.w0off + 16);
+	}
+
+	// Zero additional weights rounding up to 4.
+	for (int j = dec_->nweights; j & 3; j++) {
+		STR(INDEX_UNSIGNED, WZR, dstReg, dec_->decFmt.w0off + j * 4);
+	}
+}
+
 void VertexDecoderJitCache::Jit_WeightsU8Skin() {
 	// Weight is first so srcReg is correct.
 	switch (dec_->nweights) {
@@ -474,6 +535,10 @@ void VertexDecoderJitCache::Jit_WeightsFloatSkin() {
 	Jit_ApplyWeights();
 }
 
+void VertexDecoderJitCache::Jit_ColorInvalid() {
+	// Do nothing.
+}
+
 void VertexDecoderJitCache::Jit_Color8888() {
 	LDR(INDEX_UNSIGNED, tempReg1, srcReg, dec_->coloff);
 
@@ -585,7 +650,25 @@ void VertexDecoderJitCache::Jit_TcU16() {
 void VertexDecoderJitCache::Jit_TcU16Through() {
 	LDRH(INDEX_UNSIGNED, tempReg1, srcReg, dec_->tcoff);
 	LDRH(INDEX_UNSIGNED, tempReg2, srcReg, dec_->tcoff + 2);
+	Jit_UpdateThroughBounds();
+
+	ORR(tempReg1, tempReg1, tempReg2, ArithOption(tempReg2, ST_LSL, 16));
+	STR(INDEX_UNSIGNED, tempReg1, dstReg, dec_->decFmt.uvoff);
+}
+
+void VertexDecoderJitCache::Jit_TcU16ThroughToFloat() {
+	LDRH(INDEX_UNSIGNED, tempReg1, srcReg, dec_->tcoff);
+	LDRH(INDEX_UNSIGNED, tempReg2, srcReg, dec_->tcoff + 2);
+	Jit_UpdateThroughBounds();
 
+	fp.LDUR(32, neonScratchRegD, srcReg, dec_->tcoff);
+	fp.UXTL(16, neonScratchRegQ, neonScratchRegD); // Widen to 32-bit
+	fp.UCVTF(32, neonScratchRegD, neonScratchRegD);
+	fp.STUR(64, neonScratchRegD, dstReg, dec_->decFmt.uvoff);
+}
+
+// Expects U in tempReg1 and V in tempReg2, both zero extended.
+void VertexDecoderJitCache::Jit_UpdateThroughBounds() {
 	auto updateSide = [&](ARM64Reg src, CCFlags cc, ARM64Reg dst) {
 		CMP(src, dst);
 		CSEL(dst, src, dst, cc);
@@ -595,9 +678,6 @@ void VertexDecoderJitCache::Jit_TcU16Through() {
 	updateSide(tempReg1, CC_GT, boundsMaxUReg);
 	updateSide(tempReg2, CC_LT, boundsMinVReg);
 	updateSide(tempReg2, CC_GT, boundsMaxVReg);
-
-	ORR(tempReg1, tempReg1, tempReg2, ArithOption(tempReg2, ST_LSL, 16));
-	STR(INDEX_UNSIGNED, tempReg1, dstReg, dec_->decFmt.uvoff);
 }
 
 void VertexDecoderJitCache::Jit_TcFloatThrough() {
@@ -621,6 +701,32 @@ void VertexDecoderJitCache::Jit_TcU16ThroughDouble() {
 	STR(INDEX_UNSIGNED, tempReg1, dstReg, dec_->decFmt.uvoff);
 }
 
+void VertexDecoderJitCache::Jit_TcU16ThroughDoubleToFloat() {
+	fp.LDUR(32, neonScratchRegD, srcReg, dec_->tcoff);
+	fp.UXTL(16, neonScratchRegQ, neonScratchRegD); // Widen to 32-bit
+	fp.UCVTF(32, neonScratchRegD, neonScratchRegD);
+	fp.FADD(32, neonScratchRegD, neonScratchRegD, neonScratchRegD);
+	fp.STUR(64, neonScratchRegD, dstReg, dec_->decFmt.uvoff);
+}
+
+void VertexDecoderJitCache::Jit_TcU8ToFloat() {
+	Jit_AnyU8ToFloat(dec_->tcoff, 16);
+	fp.STUR(64, neonScratchRegD, dstReg, dec_->decFmt.uvoff);
+}
+
+void VertexDecoderJitCache::Jit_TcU16ToFloat() {
+	Jit_AnyU16ToFloat(dec_->tcoff, 32);
+	fp.STUR(64, neonScratchRegD, dstReg, dec_->decFmt.uvoff);
+}
+
+void VertexDecoderJitCache::Jit_TcU16DoubleToFloat() {
+	fp.LDUR(32, neonScratchRegD, srcReg, dec_->tcoff);
+	fp.UXTL(16, neonScratchRegQ, neonScratchRegD); // Widen to 32-bit
+	// Doubling is just one less fractional bit.
+	fp.UCVTF(32, neonScratchRegD, neonScratchRegD, 14);
+	fp.STUR(64, neonScratchRegD, dstReg, dec_->decFmt.uvoff);
+}
+
 void VertexDecoderJitCache::Jit_TcFloat() {
 	LDP(INDEX_SIGNED, tempReg1, tempReg2, srcReg, dec_->tcoff);
 	STP(INDEX_SIGNED, tempReg1, tempReg2, dstReg, dec_->decFmt.uvoff);
@@ -706,6 +812,11 @@ void VertexDecoderJitCache::Jit_NormalS8() {
 	STR(INDEX_UNSIGNED, tempReg1, dstReg, dec_->decFmt.nrmoff);
 }
 
+void VertexDecoderJitCache::Jit_NormalS8ToFloat() {
+	Jit_AnyS8ToFloat(dec_->nrmoff);
+	fp.STUR(128, srcQ[0], dstReg, dec_->decFmt.nrmoff);
+}
+
 // Copy 6 bytes and then 2 zeroes.
 void VertexDecoderJitCache::Jit_NormalS16() {
 	// NOTE: Not LDRH, we just copy the raw bytes here.
@@ -780,3 +891,220 @@ void VertexDecoderJitCache::Jit_WriteMatrixMul(int outOff, bool pos) {
 	}
 	fp.STUR(128, accNEON, dstReg, outOff);
 }
+
+void VertexDecoderJitCache::Jit_AnyU8ToFloat(int srcoff, u32 bits) {
+	_dbg_assert_msg_(JIT, bits == 8 || bits == 16 || bits == 32, "Bits must be 8, 16, or 32.");
+
+	fp.LDUR(bits, neonScratchRegD, srcReg, srcoff);
+	fp.UXTL(8, neonScratchRegQ, neonScratchRegD);
+	fp.UXTL(16, neonScratchRegQ, neonScratchRegD);
+	fp.UCVTF(32, neonScratchRegQ, neonScratchRegQ, 7);
+}
+
+void VertexDecoderJitCache::Jit_AnyU16ToFloat(int srcoff, u32 bits) {
+	_dbg_assert_msg_(JIT, bits == 16 || bits == 32 || bits == 64, "Bits must be 16, 32, or 64.");
+
+	fp.LDUR(bits, neonScratchRegD, srcReg, srcoff);
+	fp.UXTL(16, neonScratchRegQ, neonScratchRegD);
+	fp.UCVTF(32, neonScratchRegQ, neonScratchRegQ, 15);
+}
+
+// Each morph frame is onesize_ apart, so we walk morphBaseReg through them.
+void VertexDecoderJitCache::Jit_AnyS8Morph(int srcoff, int dstoff) {
+	ADDI2R(morphBaseReg, srcReg, srcoff, scratchReg);
+	for (int n = 0; n < dec_->morphcount; n++) {
+		fp.LDR(32, INDEX_POST, neonScratchRegD, morphBaseReg, dec_->onesize_);
+		fp.SXTL(8, neonScratchRegQ, neonScratchRegD);
+		fp.SXTL(16, neonScratchRegQ, neonScratchRegD);
+		fp.SCVTF(32, neonScratchRegQ, neonScratchRegQ, 7);
+		if (n == 0) {
+			fp.FMUL(32, accNEON, neonScratchRegQ, neonMorphWeightsQ[0], 0);
+		} else {
+			fp.FMLA(32, accNEON, neonScratchRegQ, neonMorphWeightsQ[n >> 2], n & 3);
+		}
+	}
+
+	// Like x86, we overwrite by 4 bytes, which the next step will fill in.
+	fp.STUR(128, accNEON, dstReg, dstoff);
+}
+
+void VertexDecoderJitCache::Jit_AnyS16Morph(int srcoff, int dstoff) {
+	ADDI2R(morphBaseReg, srcReg, srcoff, scratchReg);
+	for (int n = 0; n < dec_->morphcount; n++) {
+		fp.LDR(64, INDEX_POST, neonScratchRegD, morphBaseReg, dec_->onesize_);
+		fp.SXTL(16, neonScratchRegQ, neonScratchRegD);
+		fp.SCVTF(32, neonScratchRegQ, neonScratchRegQ, 15);
+		if (n == 0) {
+			fp.FMUL(32, accNEON, neonScratchRegQ, neonMorphWeightsQ[0], 0);
+		} else {
+			fp.FMLA(32, accNEON, neonScratchRegQ, neonMorphWeightsQ[n >> 2], n & 3);
+		}
+	}
+
+	fp.STUR(128, accNEON, dstReg, dstoff);
+}
+
+void VertexDecoderJitCache::Jit_AnyFloatMorph(int srcoff, int dstoff) {
+	ADDI2R(morphBaseReg, srcReg, srcoff, scratchReg);
+	for (int n = 0; n < dec_->morphcount; n++) {
+		fp.LDR(128, INDEX_POST, neonScratchRegQ, morphBaseReg, dec_->onesize_);
+		if (n == 0) {
+			fp.FMUL(32, accNEON, neonScratchRegQ, neonMorphWeightsQ[0], 0);
+		} else {
+			fp.FMLA(32, accNEON, neonScratchRegQ, neonMorphWeightsQ[n >> 2], n & 3);
+		}
+	}
+
+	fp.STUR(128, accNEON, dstReg, dstoff);
+}
+
+void VertexDecoderJitCache::Jit_PosS8Morph() {
+	Jit_AnyS8Morph(dec_->posoff, dec_->decFmt.posoff);
+}
+
+void VertexDecoderJitCache::Jit_PosS16Morph() {
+	Jit_AnyS16Morph(dec_->posoff, dec_->decFmt.posoff);
+}
+
+void VertexDecoderJitCache::Jit_PosFloatMorph() {
+	Jit_AnyFloatMorph(dec_->posoff, dec_->decFmt.posoff);
+}
+
+void VertexDecoderJitCache::Jit_NormalS8Morph() {
+	Jit_AnyS8Morph(dec_->nrmoff, dec_->decFmt.nrmoff);
+}
+
+void VertexDecoderJitCache::Jit_NormalS16Morph() {
+	Jit_AnyS16Morph(dec_->nrmoff, dec_->decFmt.nrmoff);
+}
+
+void VertexDecoderJitCache::Jit_NormalFloatMorph() {
+	Jit_AnyFloatMorph(dec_->nrmoff, dec_->decFmt.nrmoff);
+}
+
+void VertexDecoderJitCache::Jit_Color8888Morph() {
+	ADDI2R(morphBaseReg, srcReg, dec_->coloff, scratchReg);
+	for (int n = 0; n < dec_->morphcount; n++) {
+		fp.LDR(32, INDEX_POST, neonScratchRegD, morphBaseReg, dec_->onesize_);
+		fp.UXTL(8, neonScratchRegQ, neonScratchRegD);
+		fp.UXTL(16, neonScratchRegQ, neonScratchRegD);
+		fp.UCVTF(32, neonScratchRegQ, neonScratchRegQ);
+		if (n == 0) {
+			fp.FMUL(32, accNEON, neonScratchRegQ, neonMorphWeightsQ[0], 0);
+		} else {
+			fp.FMLA(32, accNEON, neonScratchRegQ, neonMorphWeightsQ[n >> 2], n & 3);
+		}
+	}
+
+	Jit_WriteMorphColor(dec_->decFmt.c0off);
+}
+
+void VertexDecoderJitCache::Jit_Color4444Morph() {
+	ADDI2R(morphBaseReg, srcReg, dec_->coloff, scratchReg);
+	for (int n = 0; n < dec_->morphcount; n++) {
+		LDRH(INDEX_POST, tempReg1, morphBaseReg, dec_->onesize_);
+
+		// Spread out the components, same as Jit_Color4444.  x * 17 is exactly x * 255 / 15.
+		ANDI2R(tempReg2, tempReg1, 0x000F, scratchReg);
+		ANDI2R(tempReg3, tempReg1, 0x00F0, scratchReg);
+		ORR(tempReg2, tempReg2, tempReg3, ArithOption(tempReg3, ST_LSL, 4));
+		ANDI2R(tempReg3, tempReg1, 0x0F00, scratchReg);
+		ORR(tempReg2, tempReg2, tempReg3, ArithOption(tempReg3, ST_LSL, 8));
+		ANDI2R(tempReg3, tempReg1, 0xF000, scratchReg);
+		ORR(tempReg2, tempReg2, tempReg3, ArithOption(tempReg3, ST_LSL, 12));
+		ORR(tempReg1, tempReg2, tempReg2, ArithOption(tempReg2, ST_LSL, 4));
+
+		fp.INS(32, neonScratchRegQ, 0, tempReg1);
+		fp.UXTL(8, neonScratchRegQ, neonScratchRegD);
+		fp.UXTL(16, neonScratchRegQ, neonScratchRegD);
+		fp.UCVTF(32, neonScratchRegQ, neonScratchRegQ);
+		if (n == 0) {
+			fp.FMUL(32, accNEON, neonScratchRegQ, neonMorphWeightsQ[0], 0);
+		} else {
+			fp.FMLA(32, accNEON, neonScratchRegQ, neonMorphWeightsQ[n >> 2], n & 3);
+		}
+	}
+
+	Jit_WriteMorphColor(dec_->decFmt.c0off);
+}
+
+void VertexDecoderJitCache::Jit_Color565Morph() {
+	MOVP2R(tempRegPtr, byColor565);
+	fp.LDR(128, INDEX_UNSIGNED, neonColorScaleQ, tempRegPtr, 0);
+
+	ADDI2R(morphBaseReg, srcReg, dec_->coloff, scratchReg);
+	for (int n = 0; n < dec_->morphcount; n++) {
+		LDRH(INDEX_POST, tempReg1, morphBaseReg, dec_->onesize_);
+
+		// One component per lane, alpha stays zero.
+		fp.EOR(neonScratchRegQ, neonScratchRegQ, neonScratchRegQ);
+		UBFX(tempReg2, tempReg1, 0, 5);
+		fp.INS(32, neonScratchRegQ, 0, tempReg2);
+		UBFX(tempReg2, tempReg1, 5, 6);
+		fp.INS(32, neonScratchRegQ, 1, tempReg2);
+		UBFX(tempReg2, tempReg1, 11, 5);
+		fp.INS(32, neonScratchRegQ, 2, tempReg2);
+
+		fp.UCVTF(32, neonScratchRegQ, neonScratchRegQ);
+		fp.FMUL(32, neonScratchRegQ, neonScratchRegQ, neonColorScaleQ);
+		if (n == 0) {
+			fp.FMUL(32, accNEON, neonScratchRegQ, neonMorphWeightsQ[0], 0);
+		} else {
+			fp.FMLA(32, accNEON, neonScratchRegQ, neonMorphWeightsQ[n >> 2], n & 3);
+		}
+	}
+
+	Jit_WriteMorphColor(dec_->decFmt.c0off, false);
+}
+
+void VertexDecoderJitCache::Jit_Color5551Morph() {
+	MOVP2R(tempRegPtr, byColor5551);
+	fp.LDR(128, INDEX_UNSIGNED, neonColorScaleQ, tempRegPtr, 0);
+
+	ADDI2R(morphBaseReg, srcReg, dec_->coloff, scratchReg);
+	for (int n = 0; n < dec_->morphcount; n++) {
+		LDRH(INDEX_POST, tempReg1, morphBaseReg, dec_->onesize_);
+
+		// One component per lane.
+		UBFX(tempReg2, tempReg1, 0, 5);
+		fp.INS(32, neonScratchRegQ, 0, tempReg2);
+		UBFX(tempReg2, tempReg1, 5, 5);
+		fp.INS(32, neonScratchRegQ, 1, tempReg2);
+		UBFX(tempReg2, tempReg1, 10, 5);
+		fp.INS(32, neonScratchRegQ, 2, tempReg2);
+		UBFX(tempReg2, tempReg1, 15, 1);
+		fp.INS(32, neonScratchRegQ, 3, tempReg2);
+
+		fp.UCVTF(32, neonScratchRegQ, neonScratchRegQ);
+		fp.FMUL(32, neonScratchRegQ, neonScratchRegQ, neonColorScaleQ);
+		if (n == 0) {
+			fp.FMUL(32, accNEON, neonScratchRegQ, neonMorphWeightsQ[0], 0);
+		} else {
+			fp.FMLA(32, accNEON, neonScratchRegQ, neonMorphWeightsQ[n >> 2], n & 3);
+		}
+	}
+
+	Jit_WriteMorphColor(dec_->decFmt.c0off);
+}
+
+void VertexDecoderJitCache::Jit_WriteMorphColor(int outOff, bool checkAlpha) {
+	// Truncate and clamp to 0-255, like clamp_u8((int)col).  Negatives convert to 0.
+	fp.FCVTZU(32, accNEON, accNEON);
+	fp.UQXTN(16, neonScratchRegD, accNEON);
+	fp.UQXTN(8, neonScratchRegD, neonScratchRegQ);
+	fp.UMOV(32, tempReg1, neonScratchRegQ, 0);
+
+	if (checkAlpha) {
+		// Set flags to determine if alpha != 0xFF.
+		ORN(tempReg2, WZR, tempReg1, ArithOption(tempReg1, ST_ASR, 24));
+		CMP(tempReg2, 0);
+
+		// Clear fullAlphaReg when the inverse was not 0.
+		CSEL(fullAlphaReg, fullAlphaReg, WZR, CC_EQ);
+	} else {
+		// Force alpha to full if we're not checking it.
+		ORRI2R(tempReg1, tempReg1, 0xFF000000, scratchReg);
+	}
+
+	STR(INDEX_UNSIGNED, tempReg1, dstReg, outOff);
+}
@@ -18,6 +18,10 @@
 #include <algorithm>
 #include <stdio.h>
 
+#if defined(ARM64)
+#include <arm_neon.h>
+#endif
+
 #include "base/basictypes.h"
 #include "base/logging.h"
 
@@ -41,8 +45,98 @@ static const u8 possize[4] = { 3, 3, 6, 12 }, posalign[4] = { 1, 1, 2, 4 };
 static const u8 wtsize[4] = { 0, 1, 2, 4 }, wtalign[4] = { 0, 1, 2, 4 };
 
 // When software skinning. This array is only used when non-jitted - when jitted, the matrix
-// is kept in registers.
-static float MEMORY_ALIGNED16(skinMatrix[12]);
+// is kept in registers.  Each column is padded to four floats so it loads as one vector.
+static float MEMORY_ALIGNED16(skinMatrix[16]);
+// The bone matrices, padded the same way.  Done once per DecodeVerts rather than per vertex.
+static float MEMORY_ALIGNED16(paddedBones[16 * 8]);
+
+// Just enough of a vector type for the skinning and morph steps, so they share one body.
+#if defined(_M_SSE)
+typedef __m128 StepVec;
+
+static inline StepVec StepVecZero() { return _mm_setzero_ps(); }
+static inline StepVec StepVecLoad(const float *p) { return _mm_load_ps(p); }
+static inline StepVec StepVecLoad3(const float *p) {
+	return _mm_movelh_ps(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)p), _mm_load_ss(p + 2));
+}
+static inline StepVec StepVecSet3(float x, float y, float z) { return _mm_set_ps(0.0f, z, y, x); }
+static inline StepVec StepVecMulAdd(StepVec acc, StepVec v, float f) { return _mm_add_ps(acc, _mm_mul_ps(v, _mm_set1_ps(f))); }
+static inline void StepVecStore(float *p, StepVec v) { _mm_store_ps(p, v); }
+static inline void StepVecStore3(float *p, StepVec v) {
+	_mm_storel_pi((__m64 *)p, v);
+	_mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+}
+#elif defined(ARM64)
+typedef float32x4_t StepVec;
+
+static inline StepVec StepVecZero() { return vdupq_n_f32(0.0f); }
+static inline StepVec StepVecLoad(const float *p) { return vld1q_f32(p); }
+static inline StepVec StepVecLoad3(const float *p) { return vcombine_f32(vld1_f32(p), vld1_lane_f32(p + 2, vdup_n_f32(0.0f), 0)); }
+static inline StepVec StepVecSet3(float x, float y, float z) {
+	const float v[4] = { x, y, z, 0.0f };
+	return vld1q_f32(v);
+}
+static inline StepVec StepVecMulAdd(StepVec acc, StepVec v, float f) { return vmlaq_n_f32(acc, v, f); }
+static inline void StepVecStore(float *p, StepVec v) { vst1q_f32(p, v); }
+static inline void StepVecStore3(float *p, StepVec v) {
+	vst1_f32(p, vget_low_f32(v));
+	vst1q_lane_f32(p + 2, v, 2);
+}
+#else
+struct StepVec {
+	float v[4];
+};
+
+static inline StepVec StepVecZero() {
+	StepVec r = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+	return r;
+}
+static inline StepVec StepVecLoad(const float *p) {
+	StepVec r = { { p[0], p[1], p[2], p[3] } };
+	return r;
+}
+static inline StepVec StepVecLoad3(const float *p) {
+	StepVec r = { { p[0], p[1], p[2], 0.0f } };
+	return r;
+}
+static inline StepVec StepVecSet3(float x, float y, float z) {
+	StepVec r = { { x, y, z, 0.0f } };
+	return r;
+}
+static inline StepVec StepVecMulAdd(StepVec acc, StepVec v, float f) {
+	for (int i = 0; i < 4; i++)
+		acc.v[i] += v.v[i] * f;
+	return acc;
+}
+static inline void StepVecStore(float *p, StepVec v) {
+	memcpy(p, v.v, sizeof(float) * 4);
+}
+static inline void StepVecStore3(float *p, StepVec v) {
+	memcpy(p, v.v, sizeof(float) * 3);
+}
+#endif
+
+static void PadBoneMatrices(int count) {
+	for (int i = 0; i < count; i++) {
+		ConvertMatrix4x3To4x4(&paddedBones[i * 16], &gstate.boneMatrix[i * 12]);
+	}
+}
+
+static inline void SkinPosition(float out[3], float x, float y, float z) {
+	StepVec r = StepVecLoad(skinMatrix + 12);
+	r = StepVecMulAdd(r, StepVecLoad(skinMatrix + 0), x);
+	r = StepVecMulAdd(r, StepVecLoad(skinMatrix + 4), y);
+	r = StepVecMulAdd(r, StepVecLoad(skinMatrix + 8), z);
+	StepVecStore3(out, r);
+}
+
+static inline void SkinNormal(float out[3], float x, float y, float z) {
+	StepVec r = StepVecZero();
+	r = StepVecMulAdd(r, StepVecLoad(skinMatrix + 0), x);
+	r = StepVecMulAdd(r, StepVecLoad(skinMatrix + 4), y);
+	r = StepVecMulAdd(r, StepVecLoad(skinMatrix + 8), z);
+	StepVecStore3(out, r);
+}
 
 inline int align(int n, int align) {
 	return (n + (align - 1)) & ~(align - 1);
@@ -138,7 +232,7 @@ void PrintDecodedVertex(VertexReader &vtx) {
 	printf("P: %f %f %f\n", pos[0], pos[1], pos[2]);
 }
 
-VertexDecoder::VertexDecoder() : jitted_(0), jittedSize_(0), decoded_(nullptr), ptr_(nullptr) {
+VertexDecoder::VertexDecoder() : jitted_(0), jittedSize_(0), decoded_(nullptr), ptr_(nullptr), skinInDecode(false) {
 }
 
 void VertexDecoder::Step_WeightsU8() const
@@ -202,34 +296,44 @@ void VertexDecoder::Step_WeightsFloat() const
 		wt[j++] = 0.0f;
 }
 
-void VertexDecoder::Step_WeightsU8Skin() const
+void VertexDecoder::ComputeSkinMatrix(const float weights[8]) const
 {
-	memset(skinMatrix, 0, sizeof(skinMatrix));
-	const u8 *wdata = (const u8*)(ptr_);
+	StepVec m0 = StepVecZero();
+	StepVec m1 = StepVecZero();
+	StepVec m2 = StepVecZero();
+	StepVec m3 = StepVecZero();
 	for (int j = 0; j < nweights; j++) {
-		const float *bone = &gstate.boneMatrix[j * 12];
-		if (wdata[j] != 0) {
-			float weight = wdata[j] * (1.0f / 128.0f);
-			for (int i = 0; i < 12; i++) {
-				skinMatrix[i] += weight * bone[i];
-			}
+		const float *bone = &paddedBones[j * 16];
+		const float weight = weights[j];
+		if (weight > 0.0f) {
+			m0 = StepVecMulAdd(m0, StepVecLoad(bone + 0), weight);
+			m1 = StepVecMulAdd(m1, StepVecLoad(bone + 4), weight);
+			m2 = StepVecMulAdd(m2, StepVecLoad(bone + 8), weight);
+			m3 = StepVecMulAdd(m3, StepVecLoad(bone + 12), weight);
 		}
 	}
+	StepVecStore(skinMatrix + 0, m0);
+	StepVecStore(skinMatrix + 4, m1);
+	StepVecStore(skinMatrix + 8, m2);
+	StepVecStore(skinMatrix + 12, m3);
+}
+
+void VertexDecoder::Step_WeightsU8Skin() const
+{
+	const u8 *wdata = (const u8*)(ptr_);
+	float weights[8];
+	for (int j = 0; j < nweights; j++)
+		weights[j] = wdata[j] * (1.0f / 128.0f);
+	ComputeSkinMatrix(weights);
 }
 
 void VertexDecoder::Step_WeightsU16Skin() const
 {
-	memset(skinMatrix, 0, sizeof(skinMatrix));
 	const u16 *wdata = (const u16*)(ptr_);
-	for (int j = 0; j < nweights; j++) {
-		const float *bone = &gstate.boneMatrix[j * 12];
-		if (wdata[j] != 0) {
-			float weight = wdata[j] * (1.0f / 32768.0f);
-			for (int i = 0; i < 12; i++) {
-				skinMatrix[i] += weight * bone[i];
-			}
-		}
-	}
+	float weights[8];
+	for (int j = 0; j < nweights; j++)
+		weights[j] = wdata[j] * (1.0f / 32768.0f);
+	ComputeSkinMatrix(weights);
 }
 
 // Float weights should be uncommon, we can live with having to multiply these by 2.0
@@ -237,17 +341,8 @@ void VertexDecoder::Step_WeightsU16Skin() const
 // (PSP uses 0.0-2.0 fixed point numbers for weights)
 void VertexDecoder::Step_WeightsFloatSkin() const
 {
-	memset(skinMatrix, 0, sizeof(skinMatrix));
 	const float *wdata = (const float*)(ptr_);
-	for (int j = 0; j < nweights; j++) {
-		const float *bone = &gstate.boneMatrix[j * 12];
-		float weight = wdata[j];
-		if (weight > 0.0) {
-			for (int i = 0; i < 12; i++) {
-				skinMatrix[i] += weight * bone[i];
-			}
-		}
-	}
+	ComputeSkinMatrix(wdata);
 }
 
 void VertexDecoder::Step_TcU8() const
@@ -534,59 +629,56 @@ void VertexDecoder::Step_NormalS8Skin() const
 {
 	float *normal = (float *)(decoded_ + decFmt.nrmoff);
 	const s8 *sv = (const s8*)(ptr_ + nrmoff);
-	const float fn[3] = { sv[0] * (1.0f / 128.0f), sv[1] * (1.0f / 128.0f), sv[2] * (1.0f / 128.0f) };
-	Norm3ByMatrix43(normal, fn, skinMatrix);
+	SkinNormal(normal, sv[0] * (1.0f / 128.0f), sv[1] * (1.0f / 128.0f), sv[2] * (1.0f / 128.0f));
 }
 
 void VertexDecoder::Step_NormalS16Skin() const
 {
 	float *normal = (float *)(decoded_ + decFmt.nrmoff);
 	const s16 *sv = (const s16_le*)(ptr_ + nrmoff);
-	const float fn[3] = { sv[0] * (1.0f / 32768.0f), sv[1] * (1.0f / 32768.0f), sv[2] * (1.0f / 32768.0f) };
-	Norm3ByMatrix43(normal, fn, skinMatrix);
+	SkinNormal(normal, sv[0] * (1.0f / 32768.0f), sv[1] * (1.0f / 32768.0f), sv[2] * (1.0f / 32768.0f));
 }
 
 void VertexDecoder::Step_NormalFloatSkin() const
 {
 	float *normal = (float *)(decoded_ + decFmt.nrmoff);
 	const float *fn = (const float *)(ptr_ + nrmoff);
-	Norm3ByMatrix43(normal, fn, skinMatrix);
+	SkinNormal(normal, fn[0], fn[1], fn[2]);
 }
 
 void VertexDecoder::Step_NormalS8Morph() const
 {
 	float *normal = (float *)(decoded_ + decFmt.nrmoff);
-	memset(normal, 0, sizeof(float) * 3);
+	StepVec acc = StepVecZero();
 	for (int n = 0; n < morphcount; n++) {
 		const s8 *bv = (const s8*)(ptr_ + onesize_*n + nrmoff);
 		const float multiplier = gstate_c.morphWeights[n] * (1.0f / 128.0f);
-		for (int j = 0; j < 3; j++)
-			normal[j] += bv[j] * multiplier;
+		acc = StepVecMulAdd(acc, StepVecSet3(bv[0], bv[1], bv[2]), multiplier);
 	}
+	StepVecStore3(normal, acc);
 }
 
 void VertexDecoder::Step_NormalS16Morph() const
 {
 	float *normal = (float *)(decoded_ + decFmt.nrmoff);
-	memset(normal, 0, sizeof(float) * 3);
+	StepVec acc = StepVecZero();
 	for (int n = 0; n < morphcount; n++) {
 		const s16 *sv = (const s16_le *)(ptr_ + onesize_*n + nrmoff);
 		const float multiplier = gstate_c.morphWeights[n] * (1.0f / 32768.0f);
-		for (int j = 0; j < 3; j++)
-			normal[j] += sv[j] * multiplier;
+		acc = StepVecMulAdd(acc, StepVecSet3(sv[0], sv[1], sv[2]), multiplier);
 	}
+	StepVecStore3(normal, acc);
 }
 
 void VertexDecoder::Step_NormalFloatMorph() const
 {
 	float *normal = (float *)(decoded_ + decFmt.nrmoff);
-	memset(normal, 0, sizeof(float) * 3);
+	StepVec acc = StepVecZero();
 	for (int n = 0; n < morphcount; n++) {
-		float multiplier = gstate_c.morphWeights[n];
 		const float *fv = (const float*)(ptr_ + onesize_*n + nrmoff);
-		for (int j = 0; j < 3; j++)
-			normal[j] += fv[j] * multiplier;
+		acc = StepVecMulAdd(acc, StepVecLoad3(fv), gstate_c.morphWeights[n]);
 	}
+	StepVecStore3(normal, acc);
 }
 
 void VertexDecoder::Step_PosS8() const
@@ -616,23 +708,21 @@ void VertexDecoder::Step_PosS8Skin() const
 {
 	float *pos = (float *)(decoded_ + decFmt.posoff);
 	const s8 *sv = (const s8*)(ptr_ + posoff);
-	const float fn[3] = { sv[0] * (1.0f / 128.0f), sv[1] * (1.0f / 128.0f), sv[2] * (1.0f / 128.0f) };
-	Vec3ByMatrix43(pos, fn, skinMatrix);
+	SkinPosition(pos, sv[0] * (1.0f / 128.0f), sv[1] * (1.0f / 128.0f), sv[2] * (1.0f / 128.0f));
 }
 
 void VertexDecoder::Step_PosS16Skin() const
 {
 	float *pos = (float *)(decoded_ + decFmt.posoff);
 	const s16_le *sv = (const s16_le *)(ptr_ + posoff);
-	const float fn[3] = { sv[0] * (1.0f / 32768.0f), sv[1] * (1.0f / 32768.0f), sv[2] * (1.0f / 32768.0f) };
-	Vec3ByMatrix43(pos, fn, skinMatrix);
+	SkinPosition(pos, sv[0] * (1.0f / 32768.0f), sv[1] * (1.0f / 32768.0f), sv[2] * (1.0f / 32768.0f));
 }
 
 void VertexDecoder::Step_PosFloatSkin() const
 {
 	float *pos = (float *)(decoded_ + decFmt.posoff);
 	const float *fn = (const float *)(ptr_ + posoff);
-	Vec3ByMatrix43(pos, fn, skinMatrix);
+	SkinPosition(pos, fn[0], fn[1], fn[2]);
 }
 
 void VertexDecoder::Step_PosS8Through() const
@@ -664,36 +754,34 @@ void VertexDecoder::Step_PosFloatThrough() const
 void VertexDecoder::Step_PosS8Morph() const
 {
 	float *v = (float *)(decoded_ + decFmt.posoff);
-	memset(v, 0, sizeof(float) * 3);
+	StepVec acc = StepVecZero();
 	for (int n = 0; n < morphcount; n++) {
-		const float multiplier = 1.0f / 128.0f;
 		const s8 *sv = (const s8*)(ptr_ + onesize_*n + posoff);
-		for (int j = 0; j < 3; j++)
-			v[j] += (float)sv[j] * (multiplier * gstate_c.morphWeights[n]);
+		acc = StepVecMulAdd(acc, StepVecSet3(sv[0], sv[1], sv[2]), gstate_c.morphWeights[n] * (1.0f / 128.0f));
 	}
+	StepVecStore3(v, acc);
 }
 
 void VertexDecoder::Step_PosS16Morph() const
 {
 	float *v = (float *)(decoded_ + decFmt.posoff);
-	memset(v, 0, sizeof(float) * 3);
+	StepVec acc = StepVecZero();
 	for (int n = 0; n < morphcount; n++) {
-		const float multiplier = 1.0f / 32768.0f;
-		const s16 *sv = (const s16*)(ptr_ + onesize_*n + posoff);
-		for (int j = 0; j < 3; j++)
-			v[j] += (float)sv[j] * (multiplier * gstate_c.morphWeights[n]);
+		const s16 *sv = (const s16_le *)(ptr_ + onesize_*n + posoff);
+		acc = StepVecMulAdd(acc, StepVecSet3(sv[0], sv[1], sv[2]), gstate_c.morphWeights[n] * (1.0f / 32768.0f));
 	}
+	StepVecStore3(v, acc);
 }
 
 void VertexDecoder::Step_PosFloatMorph() const
 {
 	float *v = (float *)(decoded_ + decFmt.posoff);
-	memset(v, 0, sizeof(float) * 3);
+	StepVec acc = StepVecZero();
 	for (int n = 0; n < morphcount; n++) {
 		const float *fv = (const float*)(ptr_ + onesize_*n + posoff);
-		for (int j = 0; j < 3; j++)
-			v[j] += fv[j] * gstate_c.morphWeights[n];
+		acc = StepVecMulAdd(acc, StepVecLoad3(fv), gstate_c.morphWeights[n]);
 	}
+	StepVecStore3(v, acc);
 }
 
 static const StepFunction wtstep[4] = {
@@ -888,7 +976,7 @@ void VertexDecoder::SetVertexType(u32 fmt, const VertexDecoderOptions &options,
 		DEBUG_LOG(G3D, "VTYPE: THRU=%i TC=%i COL=%i POS=%i NRM=%i WT=%i NW=%i IDX=%i MC=%i", (int)throughmode, tc, col, pos, nrm, weighttype, nweights, idx, morphcount);
 	}
 
-	bool skinInDecode = weighttype != 0 && g_Config.bSoftwareSkinning && morphcount == 1;
+	skinInDecode = weighttype != 0 && g_Config.bSoftwareSkinning && morphcount == 1;
 
 	if (weighttype) { // && nweights?
 		weightoff = size;
@@ -1090,6 +1178,9 @@ void VertexDecoder::DecodeVerts(u8 *decodedptr, const void *verts, int indexLowe
 		// We've compiled the steps into optimized machine code, so just jump!
 		jitted_(ptr_, decoded_, count);
 	} else {
+		if (skinInDecode) {
+			PadBoneMatrices(nweights);
+		}
 		// Interpret the decode steps
 		for (; count; count--) {
 			for (int i = 0; i < numSteps_; i++) {
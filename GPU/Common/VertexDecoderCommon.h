@@ -474,6 +474,8 @@ class VertexDecoder {
 	void Step_WeightsU16ToFloat() const;
 	void Step_WeightsFloat() const;
 
+	void ComputeSkinMatrix(const float weights[8]) const;
+
 	void Step_WeightsU8Skin() const;
 	void Step_WeightsU16Skin() const;
 	void Step_WeightsFloatSkin() const;
@@ -558,6 +560,7 @@ class VertexDecoder {
 	DecVtxFormat decFmt;
 
 	bool throughmode;
+	bool skinInDecode;
 	u8 size;
 	u8 onesize_;
 
@@ -631,11 +634,14 @@ class VertexDecoderJitCache : public FakeGen::FakeXCodeBlock {
 
 	void Jit_TcU16Double();
 	void Jit_TcU16ThroughDouble();
+	void Jit_TcU16DoubleToFloat();
+	void Jit_TcU16ThroughDoubleToFloat();
 
 	void Jit_TcU16Through();
 	void Jit_TcU16ThroughToFloat();
 	void Jit_TcFloatThrough();
 
+	void Jit_ColorInvalid();
 	void Jit_Color8888();
 	void Jit_Color4444();
 	void Jit_Color565();
@@ -679,6 +685,8 @@ class VertexDecoderJitCache : public FakeGen::FakeXCodeBlock {
 	void Jit_ApplyWeights();
 	void Jit_WriteMatrixMul(int outOff, bool pos);
 	void Jit_WriteMorphColor(int outOff, bool checkAlpha = true);
+	void Jit_UpdateThroughBounds();
+	void Jit_WriteUVToFloat(float scale);
 	void Jit_AnyS8ToFloat(int srcoff);
 	void Jit_AnyS16ToFloat(int srcoff);
 	void Jit_AnyU8ToFloat(int srcoff, u32 bits = 32);
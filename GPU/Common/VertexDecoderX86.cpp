@@ -100,6 +100,7 @@ static const JitLookup jitLookup[] = {
 	{&VertexDecoder::Step_TcU16ToFloat, &VertexDecoderJitCache::Jit_TcU16ToFloat},
 	{&VertexDecoder::Step_TcFloat, &VertexDecoderJitCache::Jit_TcFloat},
 	{&VertexDecoder::Step_TcU16Double, &VertexDecoderJitCache::Jit_TcU16Double},
+	{&VertexDecoder::Step_TcU16DoubleToFloat, &VertexDecoderJitCache::Jit_TcU16DoubleToFloat},
 
 	{&VertexDecoder::Step_TcU8Prescale, &VertexDecoderJitCache::Jit_TcU8Prescale},
 	{&VertexDecoder::Step_TcU16Prescale, &VertexDecoderJitCache::Jit_TcU16Prescale},
@@ -109,6 +110,7 @@ static const JitLookup jitLookup[] = {
 	{&VertexDecoder::Step_TcU16ThroughToFloat, &VertexDecoderJitCache::Jit_TcU16ThroughToFloat},
 	{&VertexDecoder::Step_TcFloatThrough, &VertexDecoderJitCache::Jit_TcFloatThrough},
 	{&VertexDecoder::Step_TcU16ThroughDouble, &VertexDecoderJitCache::Jit_TcU16ThroughDouble},
+	{&VertexDecoder::Step_TcU16ThroughDoubleToFloat, &VertexDecoderJitCache::Jit_TcU16ThroughDoubleToFloat},
 
 	{&VertexDecoder::Step_NormalS8, &VertexDecoderJitCache::Jit_NormalS8},
 	{&VertexDecoder::Step_NormalS8ToFloat, &VertexDecoderJitCache::Jit_NormalS8ToFloat},
@@ -119,6 +121,7 @@ static const JitLookup jitLookup[] = {
 	{&VertexDecoder::Step_NormalS16Skin, &VertexDecoderJitCache::Jit_NormalS16Skin},
 	{&VertexDecoder::Step_NormalFloatSkin, &VertexDecoderJitCache::Jit_NormalFloatSkin},
 
+	{&VertexDecoder::Step_ColorInvalid, &VertexDecoderJitCache::Jit_ColorInvalid},
 	{&VertexDecoder::Step_Color8888, &VertexDecoderJitCache::Jit_Color8888},
 	{&VertexDecoder::Step_Color4444, &VertexDecoderJitCache::Jit_Color4444},
 	{&VertexDecoder::Step_Color565, &VertexDecoderJitCache::Jit_Color565},
@@ -650,6 +653,12 @@ void VertexDecoderJitCache::Jit_TcU16ToFloat() {
 	MOVQ_xmm(MDisp(dstReg, dec_->decFmt.uvoff), XMM3);
 }
 
+void VertexDecoderJitCache::Jit_TcU16DoubleToFloat() {
+	Jit_AnyU16ToFloat(dec_->tcoff, 32);
+	ADDPS(XMM3, R(XMM3));
+	MOVQ_xmm(MDisp(dstReg, dec_->decFmt.uvoff), XMM3);
+}
+
 void VertexDecoderJitCache::Jit_TcU16Double() {
 	MOVZX(32, 16, tempReg1, MDisp(srcReg, dec_->tcoff));
 	MOVZX(32, 16, tempReg2, MDisp(srcReg, dec_->tcoff + 2));
@@ -710,6 +719,22 @@ void VertexDecoderJitCache::Jit_TcU16Through() {
 	MOV(32, R(tempReg1), MDisp(srcReg, dec_->tcoff));
 	MOV(32, MDisp(dstReg, dec_->decFmt.uvoff), R(tempReg1));
 
+	Jit_UpdateThroughBounds();
+}
+
+void VertexDecoderJitCache::Jit_TcU16ThroughToFloat() {
+	PXOR(fpScratchReg2, R(fpScratchReg2));
+	MOVD_xmm(fpScratchReg, MDisp(srcReg, dec_->tcoff));
+	PUNPCKLWD(fpScratchReg, R(fpScratchReg2));
+	CVTDQ2PS(fpScratchReg, R(fpScratchReg));
+	MOVQ_xmm(MDisp(dstReg, dec_->decFmt.uvoff), fpScratchReg);
+
+	MOV(32, R(tempReg1), MDisp(srcReg, dec_->tcoff));
+	Jit_UpdateThroughBounds();
+}
+
+// Expects U in the low 16 bits of tempReg1, V in the high.
+void VertexDecoderJitCache::Jit_UpdateThroughBounds() {
 	MOV(32, R(tempReg2), R(tempReg1));
 	SHR(32, R(tempReg2), Imm8(16));
 
@@ -720,19 +745,12 @@ void VertexDecoderJitCache::Jit_TcU16Through() {
 		SetJumpTarget(skip);
 	};
 
+	// The bounds are unsigned, so these have to be too.
 	// TODO: Can this actually be fast?  Hmm, floats aren't better.
-	updateSide(tempReg1, CC_GE, &gstate_c.vertBounds.minU);
-	updateSide(tempReg1, CC_LE, &gstate_c.vertBounds.maxU);
-	updateSide(tempReg2, CC_GE, &gstate_c.vertBounds.minV);
-	updateSide(tempReg2, CC_LE, &gstate_c.vertBounds.maxV);
-}
-
-void VertexDecoderJitCache::Jit_TcU16ThroughToFloat() {
-	PXOR(fpScratchReg2, R(fpScratchReg2));
-	MOVD_xmm(fpScratchReg, MDisp(srcReg, dec_->tcoff));
-	PUNPCKLWD(fpScratchReg, R(fpScratchReg2));
-	CVTDQ2PS(fpScratchReg, R(fpScratchReg));
-	MOVQ_xmm(MDisp(dstReg, dec_->decFmt.uvoff), fpScratchReg);
+	updateSide(tempReg1, CC_AE, &gstate_c.vertBounds.minU);
+	updateSide(tempReg1, CC_BE, &gstate_c.vertBounds.maxU);
+	updateSide(tempReg2, CC_AE, &gstate_c.vertBounds.minV);
+	updateSide(tempReg2, CC_BE, &gstate_c.vertBounds.maxV);
 }
 
 void VertexDecoderJitCache::Jit_TcU16ThroughDouble() {
@@ -744,6 +762,15 @@ void VertexDecoderJitCache::Jit_TcU16ThroughDouble() {
 	MOV(32, MDisp(dstReg, dec_->decFmt.uvoff), R(tempReg1));
 }
 
+void VertexDecoderJitCache::Jit_TcU16ThroughDoubleToFloat() {
+	PXOR(fpScratchReg2, R(fpScratchReg2));
+	MOVD_xmm(fpScratchReg, MDisp(srcReg, dec_->tcoff));
+	PUNPCKLWD(fpScratchReg, R(fpScratchReg2));
+	CVTDQ2PS(fpScratchReg, R(fpScratchReg));
+	ADDPS(fpScratchReg, R(fpScratchReg));
+	MOVQ_xmm(MDisp(dstReg, dec_->decFmt.uvoff), fpScratchReg);
+}
+
 void VertexDecoderJitCache::Jit_TcFloatThrough() {
 #ifdef _M_X64
 	MOV(64, R(tempReg1), MDisp(srcReg, dec_->tcoff));
@@ -754,6 +781,17 @@ void VertexDecoderJitCache::Jit_TcFloatThrough() {
 	MOV(32, MDisp(dstReg, dec_->decFmt.uvoff), R(tempReg1));
 	MOV(32, MDisp(dstReg, dec_->decFmt.uvoff + 4), R(tempReg2));
 #endif
+
+	// The steps truncate to u16 for the bounds, so we do too.
+	MOVQ_xmm(fpScratchReg, MDisp(srcReg, dec_->tcoff));
+	CVTTPS2DQ(fpScratchReg, R(fpScratchReg));
+	PSHUFLW(fpScratchReg, R(fpScratchReg), _MM_SHUFFLE(3, 3, 2, 0));
+	MOVD_xmm(R(tempReg1), fpScratchReg);
+	Jit_UpdateThroughBounds();
+}
+
+void VertexDecoderJitCache::Jit_ColorInvalid() {
+	// Do nothing.
 }
 
 void VertexDecoderJitCache::Jit_Color8888() {
@@ -1104,8 +1142,8 @@ void VertexDecoderJitCache::Jit_Color5551Morph() {
 }
 
 void VertexDecoderJitCache::Jit_WriteMorphColor(int outOff, bool checkAlpha) {
-	// Pack back into a u32, with saturation.
-	CVTPS2DQ(fpScratchReg, R(fpScratchReg));
+	// Pack back into a u32, with saturation.  Truncates, like the steps do.
+	CVTTPS2DQ(fpScratchReg, R(fpScratchReg));
 	PACKSSDW(fpScratchReg, R(fpScratchReg));
 	PACKUSWB(fpScratchReg, R(fpScratchReg));
 	MOVD_xmm(R(tempReg1), fpScratchReg);
@@ -77,6 +77,11 @@ enum {
 #define VERTEXCACHE_DECIMATION_INTERVAL 17
 
 enum { VAI_KILL_AGE = 120, VAI_UNRELIABLE_KILL_AGE = 240, VAI_UNRELIABLE_KILL_MAX = 4 };
+// Unreliable arrays are retried after 8 frames, doubling up to 512 each time they change again.
+enum { VAI_UNRELIABLE_RETRY_AGE = 4, VAI_UNRELIABLE_RETRY_MAX = 7 };
+
+// Sharing buffers trusts the hash alone to tell the data apart, and 32 bits collide too easily for that.
+static const bool VAI_SHARE_CONTENT = sizeof(ReliableHashType) >= 8;
 
 TransformDrawEngineDX9::TransformDrawEngineDX9()
 	:	decodedVerts_(0),
@@ -447,9 +452,11 @@ inline u32 ComputeMiniHashRange(const void *ptr, size_t sz) {
 		u32 hash = 0;
 		for (size_t i = 0; i < sz; i += step) {
 			hash += DoReliableHash32(p + i, 100, 0x3A44B9C4);
+			gpuStats.vertexCacheBytesHashed += 100;
 		}
 		return hash;
 	} else {
+		gpuStats.vertexCacheBytesHashed += 8;
 		return p[0] + p[sz - 1];
 	}
 }
@@ -473,7 +480,7 @@ u32 TransformDrawEngineDX9::ComputeMiniHash() {
 			fullhash += ComputeMiniHashRange(dc.verts, vertexSize * dc.vertexCount);
 		} else {
 			int indexLowerBound = dc.indexLowerBound, indexUpperBound = dc.indexUpperBound;
-			fullhash += ComputeMiniHashRange((const u8 *)dc.verts + vertexSize * indexLowerBound, vertexSize * (indexUpperBound - indexLowerBound));
+			fullhash += ComputeMiniHashRange((const u8 *)dc.verts + vertexSize * indexLowerBound, vertexSize * (indexUpperBound - indexLowerBound + 1));
 			fullhash += ComputeMiniHashRange(dc.inds, indexSize * dc.vertexCount);
 		}
 	}
@@ -483,6 +490,11 @@ u32 TransformDrawEngineDX9::ComputeMiniHash() {
 
 void TransformDrawEngineDX9::MarkUnreliable(VertexArrayInfoDX9 *vai) {
 	vai->status = VertexArrayInfoDX9::VAI_UNRELIABLE;
+	// Data that changed may settle down again (think loading screens), so don't give up on it for good.
+	if (vai->numUnreliable < VAI_UNRELIABLE_RETRY_MAX) {
+		vai->numUnreliable++;
+	}
+	vai->retryFrame = gpuStats.numFlips + (VAI_UNRELIABLE_RETRY_AGE << vai->numUnreliable);
 	if (vai->vbo) {
 		vai->vbo->Release();
 		vai->vbo = nullptr;
@@ -511,17 +523,21 @@ ReliableHashType TransformDrawEngineDX9::ComputeHash() {
 			while (j < numDrawCalls) {
 				if (drawCalls[j].verts != dc.verts)
 					break;
-				indexLowerBound = std::min(indexLowerBound, (int)dc.indexLowerBound);
-				indexUpperBound = std::max(indexUpperBound, (int)dc.indexUpperBound);
+				indexLowerBound = std::min(indexLowerBound, (int)drawCalls[j].indexLowerBound);
+				indexUpperBound = std::max(indexUpperBound, (int)drawCalls[j].indexUpperBound);
 				lastMatch = j;
 				j++;
 			}
 			// This could get seriously expensive with sparse indices. Need to combine hashing ranges the same way
 			// we do when drawing.
 			fullhash += DoReliableHash((const char *)dc.verts + vertexSize * indexLowerBound,
-				vertexSize * (indexUpperBound - indexLowerBound), 0x029F3EE1);
-			// Hm, we will miss some indices when combining above, but meh, it should be fine.
-			fullhash += DoReliableHash((const char *)dc.inds, indexSize * dc.vertexCount, 0x955FD1CA);
+				vertexSize * (indexUpperBound - indexLowerBound + 1), 0x029F3EE1);
+			gpuStats.vertexCacheBytesHashed += vertexSize * (indexUpperBound - indexLowerBound + 1);
+			// The buffers may be shared with other data that has the same content, so all the indices count.
+			for (j = i; j <= lastMatch; j++) {
+				fullhash += DoReliableHash((const char *)drawCalls[j].inds, indexSize * drawCalls[j].vertexCount, 0x955FD1CA);
+				gpuStats.vertexCacheBytesHashed += indexSize * drawCalls[j].vertexCount;
+			}
 			i = lastMatch;
 		}
 	}
@@ -532,11 +548,77 @@ ReliableHashType TransformDrawEngineDX9::ComputeHash() {
 	return fullhash;
 }
 
+ReliableHashType TransformDrawEngineDX9::ComputeContentKey(ReliableHashType dataHash) {
+	// The data hash doesn't know how the data was drawn, which the decoded buffers also depend on.
+	u32 shape = lastVType_;
+	for (int i = 0; i < numDrawCalls; i++) {
+		const DeferredDrawCall &dc = drawCalls[i];
+		shape = __rotl(shape, 13) ^ dc.vertType;
+		shape = __rotl(shape, 13) ^ dc.vertexCount;
+		shape = __rotl(shape, 13) ^ (u32)dc.prim;
+		shape = __rotl(shape, 13) ^ (dc.indexLowerBound | (dc.indexUpperBound << 16));
+	}
+	return dataHash ^ ((ReliableHashType)shape * (ReliableHashType)0x9E3779B97F4A7C15ULL);
+}
+
+bool TransformDrawEngineDX9::ShareVertexArray(VertexArrayInfoDX9 *vai) {
+	if (!VAI_SHARE_CONTENT) {
+		return false;
+	}
+	auto iter = vaiContent_.find(ComputeContentKey(vai->hash));
+	if (iter == vaiContent_.end()) {
+		return false;
+	}
+
+	VertexArrayContentDX9 &content = iter->second;
+	content.lastFrame = gpuStats.numFlips;
+	content.vbo->AddRef();
+	if (content.ebo) {
+		content.ebo->AddRef();
+	}
+	vai->vbo = content.vbo;
+	vai->ebo = content.ebo;
+	vai->numVerts = content.numVerts;
+	vai->maxIndex = content.maxIndex;
+	vai->prim = content.prim;
+	vai->flags = content.flags;
+	return true;
+}
+
+void TransformDrawEngineDX9::AddVertexArrayContent(VertexArrayInfoDX9 *vai) {
+	if (!VAI_SHARE_CONTENT) {
+		return;
+	}
+	VertexArrayContentDX9 &content = vaiContent_[ComputeContentKey(vai->hash)];
+	content.vbo = vai->vbo;
+	content.ebo = vai->ebo;
+	content.numVerts = vai->numVerts;
+	content.maxIndex = vai->maxIndex;
+	content.prim = vai->prim;
+	content.flags = vai->flags;
+	content.lastFrame = gpuStats.numFlips;
+	content.vbo->AddRef();
+	if (content.ebo) {
+		content.ebo->AddRef();
+	}
+}
+
+void TransformDrawEngineDX9::FreeVertexArrayContent(VertexArrayContentDX9 &content) {
+	content.vbo->Release();
+	if (content.ebo) {
+		content.ebo->Release();
+	}
+}
+
 void TransformDrawEngineDX9::ClearTrackedVertexArrays() {
 	for (auto vai = vai_.begin(); vai != vai_.end(); vai++) {
 		delete vai->second;
 	}
 	vai_.clear();
+	for (auto content = vaiContent_.begin(); content != vaiContent_.end(); content++) {
+		FreeVertexArrayContent(content->second);
+	}
+	vaiContent_.clear();
 }
 
 void TransformDrawEngineDX9::DecimateTrackedVertexArrays() {
@@ -565,6 +647,16 @@ void TransformDrawEngineDX9::DecimateTrackedVertexArrays() {
 		}
 	}
 
+	// The arrays using the buffers hold on to them, this only stops new arrays from finding them.
+	for (auto iter = vaiContent_.begin(); iter != vaiContent_.end(); ) {
+		if (iter->second.lastFrame < threshold) {
+			FreeVertexArrayContent(iter->second);
+			vaiContent_.erase(iter++);
+		} else {
+			++iter;
+		}
+	}
+
 	// Enable if you want to see vertex decoders in the log output. Need a better way.
 #if 0
 	char buffer[16384];
@@ -634,6 +726,20 @@ void TransformDrawEngineDX9::DoFlush() {
 					vai->minihash = ComputeMiniHash();
 					vai->status = VertexArrayInfoDX9::VAI_HASHING;
 					vai->drawsUntilNextFullHash = 0;
+					// The same data may already be decoded, from another address or from before it moved.
+					if (ShareVertexArray(vai)) {
+						gpuStats.numCachedDrawCalls++;
+						gpuStats.numVertexCacheShared++;
+						gpuStats.numCachedVertsDrawn += vai->numVerts;
+						gstate_c.vertexFullAlpha = vai->flags & VAI_FLAG_VERTEXFULLALPHA;
+						useElements = vai->ebo ? true : false;
+						vb_ = vai->vbo;
+						ib_ = vai->ebo;
+						vertexCount = vai->numVerts;
+						maxIndex = vai->maxIndex;
+						prim = static_cast<GEPrimitiveType>(vai->prim);
+						break;
+					}
 					DecodeVerts(); // writes to indexGen
 					vai->numVerts = indexGen.VertexCount();
 					vai->prim = indexGen.Prim();
@@ -663,6 +769,10 @@ void TransformDrawEngineDX9::DoFlush() {
 							DecodeVerts();
 							goto rotateVBO;
 						}
+						// Each time it holds up, forgive one of the times it changed.
+						if (vai->numUnreliable > 0) {
+							vai->numUnreliable--;
+						}
 						if (vai->numVerts > 64) {
 							// exponential backoff up to 16 draws, then every 24
 							vai->drawsUntilNextFullHash = std::min(24, vai->numFrames);
@@ -684,7 +794,14 @@ void TransformDrawEngineDX9::DoFlush() {
 						}
 					}
 
-					if (vai->vbo == 0) {
+					if (vai->vbo == 0 && ShareVertexArray(vai)) {
+						gpuStats.numCachedDrawCalls++;
+						gpuStats.numVertexCacheShared++;
+						gpuStats.numCachedVertsDrawn += vai->numVerts;
+						useElements = vai->ebo ? true : false;
+						gstate_c.vertexFullAlpha = vai->flags & VAI_FLAG_VERTEXFULLALPHA;
+					} else if (vai->vbo == 0) {
+						gpuStats.numVertexCacheMisses++;
 						DecodeVerts();
 						vai->numVerts = indexGen.VertexCount();
 						vai->prim = indexGen.Prim();
@@ -703,6 +820,7 @@ void TransformDrawEngineDX9::DoFlush() {
 						vai->vbo->Lock(0, size, &pVb, 0);
 						memcpy(pVb, decoded, size);
 						vai->vbo->Unlock();
+						gpuStats.vertexCacheBytesUploaded += size;
 						if (useElements) {
 							void * pIb;
 							u32 size = sizeof(short) * indexGen.VertexCount();
@@ -710,9 +828,11 @@ void TransformDrawEngineDX9::DoFlush() {
 							vai->ebo->Lock(0, size, &pIb, 0);
 							memcpy(pIb, decIndex, size);
 							vai->ebo->Unlock();
+							gpuStats.vertexCacheBytesUploaded += size;
 						} else {
 							vai->ebo = 0;
 						}
+						AddVertexArrayContent(vai);
 					} else {
 						gpuStats.numCachedDrawCalls++;
 						useElements = vai->ebo ? true : false;
@@ -754,6 +874,10 @@ void TransformDrawEngineDX9::DoFlush() {
 					if (vai->lastFrame != gpuStats.numFlips) {
 						vai->numFrames++;
 					}
+					if (gpuStats.numFlips >= vai->retryFrame) {
+						// Start over, hashing from the next draw on.
+						vai->status = VertexArrayInfoDX9::VAI_NEW;
+					}
 					DecodeVerts();
 					goto rotateVBO;
 				}
@@ -763,6 +887,9 @@ void TransformDrawEngineDX9::DoFlush() {
 		} else {
 			DecodeVerts();
 rotateVBO:
+			if (useCache) {
+				gpuStats.numVertexCacheMisses++;
+			}
 			gpuStats.numUncachedVertsDrawn += indexGen.VertexCount();
 			useElements = !indexGen.SeenOnlyPurePrims();
 			vertexCount = indexGen.VertexCount();
@@ -788,6 +915,8 @@ void TransformDrawEngineDX9::DoFlush() {
 		if (pHardwareVertexDecl) {
 			pD3Ddevice->SetVertexDeclaration(pHardwareVertexDecl);
 			if (vb_ == NULL) {
+				// The driver copies the data for these.
+				gpuStats.vertexCacheBytesUploaded += (int)((maxIndex + 1) * dec_->GetDecVtxFmt().stride + (useElements ? vertexCount * sizeof(short) : 0));
 				if (useElements) {
 					pD3Ddevice->DrawIndexedPrimitiveUP(glprim[prim], 0, maxIndex + 1, D3DPrimCount(glprim[prim], vertexCount), decIndex, D3DFMT_INDEX16, decoded, dec_->GetDecVtxFmt().stride);
 				} else {
@@ -814,11 +943,10 @@ void TransformDrawEngineDX9::DoFlush() {
 			gstate_c.vertexFullAlpha = gstate_c.vertexFullAlpha && ((hasColor && (gstate.materialupdate & 1)) || gstate.getMaterialAmbientA() == 255) && (!gstate.isLightingEnabled() || gstate.getAmbientA() == 255);
 		}
 
+		// The SW code can't draw the stitched strips.
+		indexGen.ConvertToList();
 		gpuStats.numUncachedVertsDrawn += indexGen.VertexCount();
 		prim = indexGen.Prim();
-		// Undo the strip optimization, not supported by the SW code yet.
-		if (prim == GE_PRIM_TRIANGLE_STRIP)
-			prim = GE_PRIM_TRIANGLES;
 		VERBOSE_LOG(G3D, "Flush prim %i SW! %i verts in one go", prim, indexGen.VertexCount());
 
 		int numTrans = 0;
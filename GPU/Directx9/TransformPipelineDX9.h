@@ -75,6 +75,8 @@ class VertexArrayInfoDX9 {
 		numVerts = 0;
 		drawsUntilNextFullHash = 0;
 		flags = 0;
+		retryFrame = 0;
+		numUnreliable = 0;
 	}
 	~VertexArrayInfoDX9();
 
@@ -104,6 +106,22 @@ class VertexArrayInfoDX9 {
 	int lastFrame;  // So that we can forget.
 	u16 drawsUntilNextFullHash;
 	u8 flags;
+
+	// Unreliable arrays get another chance at this frame, later each time they change.
+	int retryFrame;
+	u8 numUnreliable;
+};
+
+// Decoded vertex data by content rather than by address. Draws of data that's already in a buffer,
+// like data streamed to a new address each frame, share that buffer instead of decoding again.
+struct VertexArrayContentDX9 {
+	LPDIRECT3DVERTEXBUFFER9 vbo;
+	LPDIRECT3DINDEXBUFFER9 ebo;
+	u16 numVerts;
+	u16 maxIndex;
+	s8 prim;
+	u8 flags;
+	int lastFrame;
 };
 
 // Handles transform, lighting and drawing.
@@ -199,7 +217,11 @@ class TransformDrawEngineDX9 : public DrawEngineCommon {
 
 	u32 ComputeMiniHash();
 	ReliableHashType ComputeHash();  // Reads deferred vertex data.
+	ReliableHashType ComputeContentKey(ReliableHashType dataHash);
 	void MarkUnreliable(VertexArrayInfoDX9 *vai);
+	bool ShareVertexArray(VertexArrayInfoDX9 *vai);
+	void AddVertexArrayContent(VertexArrayInfoDX9 *vai);
+	void FreeVertexArrayContent(VertexArrayContentDX9 &content);
 
 	VertexDecoder *GetVertexDecoder(u32 vtype);
 
@@ -227,6 +249,7 @@ class TransformDrawEngineDX9 : public DrawEngineCommon {
 	TransformedVertex *transformedExpanded;
 
 	std::unordered_map<u32, VertexArrayInfoDX9 *> vai_;
+	std::unordered_map<ReliableHashType, VertexArrayContentDX9> vaiContent_;
 	std::unordered_map<u32, IDirect3DVertexDeclaration9 *> vertexDeclMap_;
 	
 	// Other
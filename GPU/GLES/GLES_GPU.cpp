@@ -51,17 +51,6 @@
 #include "Windows/GPU/WindowsGLContext.h"
 #endif
 
-enum {
-	FLAG_FLUSHBEFORE = 1,
-	FLAG_FLUSHBEFOREONCHANGE = 2,
-	FLAG_EXECUTE = 4,  // needs to actually be executed. unused for now.
-	FLAG_EXECUTEONCHANGE = 8,
-	FLAG_ANY_EXECUTE = 4 | 8,
-	FLAG_READS_PC = 16,
-	FLAG_WRITES_PC = 32,
-	FLAG_DIRTYONCHANGE = 64,
-};
-
 struct CommandTableEntry {
 	u8 cmd;
 	u8 flags;
@@ -394,6 +383,79 @@ static const CommandTableEntry commandTable[] = {
 	{GE_CMD_UNKNOWN_FF, 0},
 };
 
+struct StateDirtyTableEntry {
+	u8 cmd;
+	u32 dirty;
+};
+
+// The registers that the state groups derived at flush time read, so that a flush can skip the
+// groups where none of them changed. Also crunched into cmdInfo_ by init.
+static const StateDirtyTableEntry stateDirtyTable[] = {
+	// Through mode.
+	{GE_CMD_VERTEXTYPE, DIRTY_VIEWPORTSCISSOR_STATE | DIRTY_VERTEXSHADER_STATE | DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_CLEARMODE, DIRTY_BLEND_STATE | DIRTY_VERTEXSHADER_STATE | DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_FRAMEBUFPIXFORMAT, DIRTY_BLEND_STATE | DIRTY_DEPTHSTENCIL_STATE | DIRTY_FRAGMENTSHADER_STATE},
+
+	{GE_CMD_ALPHABLENDENABLE, DIRTY_BLEND_STATE | DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_BLENDMODE, DIRTY_BLEND_STATE | DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_BLENDFIXEDA, DIRTY_BLEND_STATE | DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_BLENDFIXEDB, DIRTY_BLEND_STATE | DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_LOGICOPENABLE, DIRTY_BLEND_STATE | DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_LOGICOP, DIRTY_BLEND_STATE | DIRTY_FRAGMENTSHADER_STATE},
+
+	// Stencil also decides whether alpha gets replaced in the shader.
+	{GE_CMD_STENCILTESTENABLE, DIRTY_BLEND_STATE | DIRTY_DEPTHSTENCIL_STATE | DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_STENCILTEST, DIRTY_BLEND_STATE | DIRTY_DEPTHSTENCIL_STATE | DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_STENCILOP, DIRTY_BLEND_STATE | DIRTY_DEPTHSTENCIL_STATE | DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_MASKALPHA, DIRTY_DEPTHSTENCIL_STATE},
+
+	// Only for detecting trivially true alpha tests.
+	{GE_CMD_ZTESTENABLE, DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_ZTEST, DIRTY_FRAGMENTSHADER_STATE},
+
+	{GE_CMD_ALPHATESTENABLE, DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_ALPHATEST, DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_COLORTESTENABLE, DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_COLORTEST, DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_COLORREF, DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_COLORTESTMASK, DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_TEXFUNC, DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_TEXWRAP, DIRTY_FRAGMENTSHADER_STATE},
+
+	{GE_CMD_TEXTUREMAPENABLE, DIRTY_VERTEXSHADER_STATE | DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_TEXMAPMODE, DIRTY_VERTEXSHADER_STATE | DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_FOGENABLE, DIRTY_VERTEXSHADER_STATE | DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_SHADEMODE, DIRTY_VERTEXSHADER_STATE | DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_LIGHTINGENABLE, DIRTY_VERTEXSHADER_STATE | DIRTY_FRAGMENTSHADER_STATE},
+	{GE_CMD_LIGHTMODE, DIRTY_VERTEXSHADER_STATE | DIRTY_FRAGMENTSHADER_STATE},
+
+	{GE_CMD_TEXSHADELS, DIRTY_VERTEXSHADER_STATE},
+	{GE_CMD_REVERSENORMAL, DIRTY_VERTEXSHADER_STATE},
+	{GE_CMD_MATERIALUPDATE, DIRTY_VERTEXSHADER_STATE},
+	{GE_CMD_LIGHTENABLE0, DIRTY_VERTEXSHADER_STATE},
+	{GE_CMD_LIGHTENABLE1, DIRTY_VERTEXSHADER_STATE},
+	{GE_CMD_LIGHTENABLE2, DIRTY_VERTEXSHADER_STATE},
+	{GE_CMD_LIGHTENABLE3, DIRTY_VERTEXSHADER_STATE},
+	{GE_CMD_LIGHTTYPE0, DIRTY_VERTEXSHADER_STATE},
+	{GE_CMD_LIGHTTYPE1, DIRTY_VERTEXSHADER_STATE},
+	{GE_CMD_LIGHTTYPE2, DIRTY_VERTEXSHADER_STATE},
+	{GE_CMD_LIGHTTYPE3, DIRTY_VERTEXSHADER_STATE},
+
+	{GE_CMD_VIEWPORTXSCALE, DIRTY_VIEWPORTSCISSOR_STATE},
+	{GE_CMD_VIEWPORTYSCALE, DIRTY_VIEWPORTSCISSOR_STATE},
+	{GE_CMD_VIEWPORTZSCALE, DIRTY_VIEWPORTSCISSOR_STATE},
+	{GE_CMD_VIEWPORTXCENTER, DIRTY_VIEWPORTSCISSOR_STATE},
+	{GE_CMD_VIEWPORTYCENTER, DIRTY_VIEWPORTSCISSOR_STATE},
+	{GE_CMD_VIEWPORTZCENTER, DIRTY_VIEWPORTSCISSOR_STATE},
+	{GE_CMD_OFFSETX, DIRTY_VIEWPORTSCISSOR_STATE},
+	{GE_CMD_OFFSETY, DIRTY_VIEWPORTSCISSOR_STATE},
+	{GE_CMD_SCISSOR1, DIRTY_VIEWPORTSCISSOR_STATE},
+	{GE_CMD_SCISSOR2, DIRTY_VIEWPORTSCISSOR_STATE},
+	{GE_CMD_MINZ, DIRTY_VIEWPORTSCISSOR_STATE},
+	{GE_CMD_MAXZ, DIRTY_VIEWPORTSCISSOR_STATE},
+	{GE_CMD_CLIPENABLE, DIRTY_VIEWPORTSCISSOR_STATE},
+};
+
 GLES_GPU::CommandInfo GLES_GPU::cmdInfo_[256];
 
 GLES_GPU::GLES_GPU(GraphicsContext *ctx)
@@ -437,6 +499,9 @@ GLES_GPU::GLES_GPU(GraphicsContext *ctx)
 			cmdInfo_[cmd].func = &GLES_GPU::Execute_Generic;
 		}
 	}
+	for (size_t i = 0; i < ARRAY_SIZE(stateDirtyTable); i++) {
+		cmdInfo_[stateDirtyTable[i].cmd].dirty |= stateDirtyTable[i].dirty;
+	}
 	// Find commands missing from the table.
 	for (int i = 0; i < 0xEF; i++) {
 		if (dupeCheck.find((u8)i) == dupeCheck.end()) {
@@ -727,11 +792,18 @@ void GLES_GPU::UpdateCmdInfo() {
 		cmdInfo_[GE_CMD_VERTEXTYPE].flags |= FLAG_FLUSHBEFOREONCHANGE;
 		cmdInfo_[GE_CMD_VERTEXTYPE].func = &GLES_GPU::Execute_VertexType;
 	}
+
+	u8 flags[256];
+	for (int i = 0; i < 256; ++i) {
+		flags[i] = cmdInfo_[i].flags;
+	}
+	dlCache_.SetCommandFlags(flags);
 }
 
 void GLES_GPU::ReapplyGfxStateInternal() {
 	transformDraw_.RestoreVAO();
 	glstate.Restore();
+	gstate_c.Dirty(DIRTY_ALL_STATE);
 	GPUCommon::ReapplyGfxStateInternal();
 }
 
@@ -739,6 +811,7 @@ void GLES_GPU::BeginFrameInternal() {
 	if (resized_) {
 		CheckGPUFeatures();
 		UpdateCmdInfo();
+		gstate_c.Dirty(DIRTY_ALL_STATE);
 		transformDraw_.Resized();
 		textureCache_.NotifyConfigChanged();
 	}
@@ -748,6 +821,7 @@ void GLES_GPU::BeginFrameInternal() {
 	textureCache_.StartFrame();
 	transformDraw_.DecimateTrackedVertexArrays();
 	transformDraw_.DecimateBuffers();
+	dlCache_.Decimate();
 	depalShaderCache_.Decimate();
 	fragmentTestCache_.Decimate();
 
@@ -841,8 +915,19 @@ void GLES_GPU::CopyDisplayToOutputInternal() {
 void GLES_GPU::FastRunLoop(DisplayList &list) {
 	PROFILE_THIS_SCOPE("gpuloop");
 	const CommandInfo *cmdInfo = cmdInfo_;
+	const bool useCache = g_Config.bDisplayListCache;
+	bool lookup = useCache;
 	int dc = downcount;
-	for (; dc > 0; --dc) {
+	while (dc > 0) {
+		if (lookup) {
+			lookup = false;
+			const DisplayListSegment *seg = dlCache_.Lookup(list.pc, dc);
+			if (seg) {
+				dc = ReplayCachedSegment(list, *seg, dc);
+				continue;
+			}
+		}
+
 		// We know that display list PCs have the upper nibble == 0 - no need to mask the pointer
 		const u32 op = *(const u32 *)(Memory::base + list.pc);
 		const u32 cmd = op >> 24;
@@ -854,16 +939,53 @@ void GLES_GPU::FastRunLoop(DisplayList &list) {
 			transformDraw_.Flush();
 		}
 		gstate.cmdmem[cmd] = op;  // TODO: no need to write if diff==0...
+		if (diff) {
+			gstate_c.Dirty(info.dirty);
+		}
 		if ((cmdFlags & FLAG_EXECUTE) || (diff && (cmdFlags & FLAG_EXECUTEONCHANGE))) {
 			downcount = dc;
 			(this->*info.func)(op, diff);
 			dc = downcount;
 		}
 		list.pc += 4;
+		--dc;
+		// A new segment may start wherever we jumped to.
+		lookup = useCache && (cmdFlags & FLAG_WRITES_PC) != 0;
 	}
 	downcount = 0;
 }
 
+// Same as FastRunLoop, but the commands are already read and looked up.
+int GLES_GPU::ReplayCachedSegment(DisplayList &list, const DisplayListSegment &seg, int dc) {
+	const CommandInfo *cmdInfo = cmdInfo_;
+	for (const DisplayListStep &step : seg.steps) {
+		const u32 diff = step.op ^ gstate.cmdmem[step.cmd];
+		if ((step.flags & FLAG_FLUSHBEFORE) || (diff && (step.flags & FLAG_FLUSHBEFOREONCHANGE))) {
+			transformDraw_.Flush();
+		}
+		gstate.cmdmem[step.cmd] = step.op;
+		if (diff) {
+			gstate_c.Dirty(cmdInfo[step.cmd].dirty);
+		}
+		if ((step.flags & FLAG_EXECUTE) || (diff && (step.flags & FLAG_EXECUTEONCHANGE))) {
+			// Handlers expect the PC and downcount of their own command.
+			const int expected = dc - step.offset;
+			list.pc = seg.pc + step.offset * 4;
+			downcount = expected;
+			(this->*cmdInfo[step.cmd].func)(step.op, diff);
+			if (downcount != expected) {
+				// Recalculated, so carry on from here like FastRunLoop would.
+				list.pc += 4;
+				return downcount - 1;
+			}
+		}
+	}
+
+	list.pc = seg.pc + seg.words * 4;
+	gpuStats.numCachedListCommands += seg.words;
+	return dc - seg.words;
+}
+
 void GLES_GPU::FinishDeferred() {
 	// This finishes reading any vertex data that is pending.
 	transformDraw_.FinishDeferred();
@@ -926,6 +1048,9 @@ void GLES_GPU::ExecuteOp(u32 op, u32 diff) {
 	const u8 cmd = op >> 24;
 	const CommandInfo info = cmdInfo_[cmd];
 	const u8 cmdFlags = info.flags;
+	if (diff) {
+		gstate_c.Dirty(info.dirty);
+	}
 	if ((cmdFlags & FLAG_EXECUTE) || (diff && (cmdFlags & FLAG_EXECUTEONCHANGE))) {
 		(this->*info.func)(op, diff);
 	}
@@ -2224,6 +2349,7 @@ void GLES_GPU::InvalidateCacheInternal(u32 addr, int size, GPUInvalidationType t
 		textureCache_.Invalidate(addr, size, type);
 	else
 		textureCache_.InvalidateAll(type);
+	dlCache_.Invalidate(addr, size);
 
 	if (type != GPU_INVALIDATE_ALL && framebufferManager_.MayIntersectFramebuffer(addr)) {
 		// If we're doing block transfers, we shouldn't need this, and it'll only confuse us.
@@ -93,6 +93,8 @@ class GLES_GPU : public GPUCommon {
 	typedef void (GLES_GPU::*CmdFunc)(u32 op, u32 diff);
 	struct CommandInfo {
 		u8 flags;
+		// DIRTY_*_STATE groups to dirty when the register changes.
+		u32 dirty;
 		GLES_GPU::CmdFunc func;
 	};
 
@@ -180,6 +182,7 @@ class GLES_GPU : public GPUCommon {
 	void ReinitializeInternal();
 	inline void UpdateVsyncInterval(bool force);
 	void UpdateCmdInfo();
+	int ReplayCachedSegment(DisplayList &list, const DisplayListSegment &seg, int dc);
 
 	static CommandInfo cmdInfo_[256];
 
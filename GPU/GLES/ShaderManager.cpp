@@ -42,6 +42,28 @@
 #include "UI/OnScreenDisplay.h"
 #include "Framebuffer.h"
 #include "i18n/i18n.h"
+#include "ext/xxhash.h"
+
+static bool SupportsProgramBinaries() {
+#ifdef USING_GLES2
+	return gl_extensions.GLES3;
+#else
+	return gl_extensions.ARB_get_program_binary || gl_extensions.VersionGEThan(4, 1);
+#endif
+}
+
+// Program binaries are only good for the exact driver that made them.
+static u32 ComputeDriverHash() {
+	static const GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	std::string driver;
+	for (GLenum name : names) {
+		const char *str = (const char *)glGetString(name);
+		if (str)
+			driver += str;
+		driver += '\n';
+	}
+	return XXH32(driver.data(), driver.size(), 0);
+}
 
 Shader::Shader(const char *code, uint32_t glShaderType, bool useHWTransform)
 	  : failed_(false), useHWTransform_(useHWTransform) {
@@ -89,71 +111,17 @@ Shader::~Shader() {
 		glDeleteShader(shader);
 }
 
-LinkedShader::LinkedShader(ShaderID VSID, Shader *vs, ShaderID FSID, Shader *fs, bool useHWTransform)
-		: useHWTransform_(useHWTransform), program(0), dirtyUniforms(0) {
+LinkedShader::LinkedShader(ShaderID VSID, Shader *vs, ShaderID FSID, Shader *fs, bool useHWTransform, const ShaderCacheProgram *cached)
+		: useHWTransform_(useHWTransform), program(0), dirtyUniforms(0), loadedFromBinary_(false) {
 	PROFILE_THIS_SCOPE("shaderlink");
 
 	program = glCreateProgram();
 	vs_ = vs;
-	glAttachShader(program, vs->shader);
-	glAttachShader(program, fs->shader);
-
-	// Bind attribute locations to fixed locations so that they're
-	// the same in all shaders. We use this later to minimize the calls to
-	// glEnableVertexAttribArray and glDisableVertexAttribArray.
-	glBindAttribLocation(program, ATTR_POSITION, "position");
-	glBindAttribLocation(program, ATTR_TEXCOORD, "texcoord");
-	glBindAttribLocation(program, ATTR_NORMAL, "normal");
-	glBindAttribLocation(program, ATTR_W1, "w1");
-	glBindAttribLocation(program, ATTR_W2, "w2");
-	glBindAttribLocation(program, ATTR_COLOR0, "color0");
-	glBindAttribLocation(program, ATTR_COLOR1, "color1");
 
-#if !defined(USING_GLES2)
-	if (gstate_c.featureFlags & GPU_SUPPORTS_DUALSOURCE_BLEND) {
-		// Dual source alpha
-		glBindFragDataLocationIndexed(program, 0, 0, "fragColor0");
-		glBindFragDataLocationIndexed(program, 0, 1, "fragColor1");
-	} else if (gl_extensions.VersionGEThan(3, 3, 0)) {
-		glBindFragDataLocation(program, 0, "fragColor0");
-	}
-#elif !defined(IOS)
-	if (gl_extensions.GLES3) {
-		if (gstate_c.featureFlags & GPU_SUPPORTS_DUALSOURCE_BLEND) {
-			glBindFragDataLocationIndexedEXT(program, 0, 0, "fragColor0");
-			glBindFragDataLocationIndexedEXT(program, 0, 1, "fragColor1");
-		}
+	if (cached) {
+		loadedFromBinary_ = LoadBinary(*cached);
 	}
-#endif
-
-	glLinkProgram(program);
-
-	GLint linkStatus = GL_FALSE;
-	glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
-	if (linkStatus != GL_TRUE) {
-		GLint bufLength = 0;
-		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &bufLength);
-		if (bufLength) {
-			char* buf = new char[bufLength];
-			glGetProgramInfoLog(program, bufLength, NULL, buf);
-#ifdef ANDROID
-			ELOG("Could not link program:\n %s", buf);
-#endif
-			ERROR_LOG(G3D, "Could not link program:\n %s", buf);
-			ERROR_LOG(G3D, "VS desc:\n%s\n", vs->GetShaderString(SHADER_STRING_SHORT_DESC, VSID).c_str());
-			ERROR_LOG(G3D, "FS desc:\n%s\n", fs->GetShaderString(SHADER_STRING_SHORT_DESC, FSID).c_str());
-			std::string vs_source = vs->GetShaderString(SHADER_STRING_SOURCE_CODE, VSID);
-			std::string fs_source = fs->GetShaderString(SHADER_STRING_SOURCE_CODE, FSID);
-			ERROR_LOG(G3D, "VS:\n%s\n", vs_source.c_str());
-			ERROR_LOG(G3D, "FS:\n%s\n", fs_source.c_str());
-			Reporting::ReportMessage("Error in shader program link: info: %s / fs: %s / vs: %s", buf, fs_source.c_str(), vs_source.c_str());
-#ifdef SHADERLOG
-			OutputDebugStringUTF8(buf);
-			OutputDebugStringUTF8(vs_source.c_str());
-			OutputDebugStringUTF8(fs_source.c_str());
-#endif
-			delete [] buf;	// we're dead!
-		}
+	if (!loadedFromBinary_ && !Link(VSID, vs, FSID, fs)) {
 		// Prevent a buffer overflow.
 		numBones = 0;
 		return;
@@ -295,6 +263,110 @@ LinkedShader::~LinkedShader() {
 	glDeleteProgram(program);
 }
 
+bool LinkedShader::Link(ShaderID VSID, Shader *vs, ShaderID FSID, Shader *fs) {
+	glAttachShader(program, vs->shader);
+	glAttachShader(program, fs->shader);
+
+	// Bind attribute locations to fixed locations so that they're
+	// the same in all shaders. We use this later to minimize the calls to
+	// glEnableVertexAttribArray and glDisableVertexAttribArray.
+	glBindAttribLocation(program, ATTR_POSITION, "position");
+	glBindAttribLocation(program, ATTR_TEXCOORD, "texcoord");
+	glBindAttribLocation(program, ATTR_NORMAL, "normal");
+	glBindAttribLocation(program, ATTR_W1, "w1");
+	glBindAttribLocation(program, ATTR_W2, "w2");
+	glBindAttribLocation(program, ATTR_COLOR0, "color0");
+	glBindAttribLocation(program, ATTR_COLOR1, "color1");
+
+#if !defined(USING_GLES2)
+	if (gstate_c.featureFlags & GPU_SUPPORTS_DUALSOURCE_BLEND) {
+		// Dual source alpha
+		glBindFragDataLocationIndexed(program, 0, 0, "fragColor0");
+		glBindFragDataLocationIndexed(program, 0, 1, "fragColor1");
+	} else if (gl_extensions.VersionGEThan(3, 3, 0)) {
+		glBindFragDataLocation(program, 0, "fragColor0");
+	}
+#elif !defined(IOS)
+	if (gl_extensions.GLES3) {
+		if (gstate_c.featureFlags & GPU_SUPPORTS_DUALSOURCE_BLEND) {
+			glBindFragDataLocationIndexedEXT(program, 0, 0, "fragColor0");
+			glBindFragDataLocationIndexedEXT(program, 0, 1, "fragColor1");
+		}
+	}
+#endif
+
+	if (SupportsProgramBinaries()) {
+		// So that the linked program can be saved in the shader cache.
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(program);
+
+	GLint linkStatus = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+	if (linkStatus != GL_TRUE) {
+		GLint bufLength = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &bufLength);
+		if (bufLength) {
+			char* buf = new char[bufLength];
+			glGetProgramInfoLog(program, bufLength, NULL, buf);
+#ifdef ANDROID
+			ELOG("Could not link program:\n %s", buf);
+#endif
+			ERROR_LOG(G3D, "Could not link program:\n %s", buf);
+			ERROR_LOG(G3D, "VS desc:\n%s\n", vs->GetShaderString(SHADER_STRING_SHORT_DESC, VSID).c_str());
+			ERROR_LOG(G3D, "FS desc:\n%s\n", fs->GetShaderString(SHADER_STRING_SHORT_DESC, FSID).c_str());
+			std::string vs_source = vs->GetShaderString(SHADER_STRING_SOURCE_CODE, VSID);
+			std::string fs_source = fs->GetShaderString(SHADER_STRING_SOURCE_CODE, FSID);
+			ERROR_LOG(G3D, "VS:\n%s\n", vs_source.c_str());
+			ERROR_LOG(G3D, "FS:\n%s\n", fs_source.c_str());
+			Reporting::ReportMessage("Error in shader program link: info: %s / fs: %s / vs: %s", buf, fs_source.c_str(), vs_source.c_str());
+#ifdef SHADERLOG
+			OutputDebugStringUTF8(buf);
+			OutputDebugStringUTF8(vs_source.c_str());
+			OutputDebugStringUTF8(fs_source.c_str());
+#endif
+			delete [] buf;	// we're dead!
+		}
+		return false;
+	}
+	return true;
+}
+
+bool LinkedShader::LoadBinary(const ShaderCacheProgram &cached) {
+	if (cached.binary.empty()) {
+		return false;
+	}
+	glProgramBinary(program, cached.binaryFormat, cached.binary.data(), (GLsizei)cached.binary.size());
+	GLint linkStatus = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+	if (linkStatus != GL_TRUE) {
+		// Usually a driver update. Start over with a clean program and link it the normal way.
+		glDeleteProgram(program);
+		program = glCreateProgram();
+		return false;
+	}
+	return true;
+}
+
+bool LinkedShader::GetBinary(ShaderCacheProgram *cached) const {
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return false;
+	}
+	GLsizei written = 0;
+	GLenum format = 0;
+	cached->binary.resize(length);
+	glGetProgramBinary(program, length, &written, &format, cached->binary.data());
+	if (written <= 0) {
+		cached->binary.clear();
+		return false;
+	}
+	cached->binary.resize(written);
+	cached->binaryFormat = format;
+	return true;
+}
+
 // Utility
 static void SetColorUniform3(int uniform, u32 color) {
 	const float col[3] = {
@@ -748,10 +820,21 @@ void LinkedShader::UpdateUniforms(u32 vertType, const ShaderID &vsid) {
 }
 
 ShaderManager::ShaderManager()
-		: lastShader_(nullptr), globalDirty_(0xFFFFFFFF), shaderSwitchDirty_(0), diskCacheDirty_(false) {
+		: curVSIDVertType_(0), curVSIDUseHWTransform_(false), curFSIDInputs_(0),
+		lastShader_(nullptr), globalDirty_(0xFFFFFFFF), shaderSwitchDirty_(0), diskCacheDirty_(false) {
 	codeBuffer_ = new char[16384];
 	lastFSID_.set_invalid();
 	lastVSID_.set_invalid();
+	gstate_c.Dirty(DIRTY_VERTEXSHADER_STATE | DIRTY_FRAGMENTSHADER_STATE);
+
+	useProgramBinaries_ = SupportsProgramBinaries();
+	if (useProgramBinaries_) {
+		// Some drivers have the functions, but no formats to save in.
+		GLint numFormats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+		useProgramBinaries_ = numFormats > 0;
+	}
+	driverHash_ = useProgramBinaries_ ? ComputeDriverHash() : 0;
 }
 
 ShaderManager::~ShaderManager() {
@@ -822,7 +905,13 @@ Shader *ShaderManager::ApplyVertexShader(int prim, u32 vertType, ShaderID *VSID)
 
 	bool useHWTransform = CanUseHardwareTransform(prim);
 
-	ComputeVertexShaderID(VSID, vertType, useHWTransform);
+	if (gstate_c.IsDirty(DIRTY_VERTEXSHADER_STATE) || vertType != curVSIDVertType_ || useHWTransform != curVSIDUseHWTransform_) {
+		ComputeVertexShaderID(&curVSID_, vertType, useHWTransform);
+		curVSIDVertType_ = vertType;
+		curVSIDUseHWTransform_ = useHWTransform;
+		gstate_c.Clean(DIRTY_VERTEXSHADER_STATE);
+	}
+	*VSID = curVSID_;
 
 	// Just update uniforms if this is the same shader as last time.
 	if (lastShader_ != 0 && *VSID == lastVSID_) {
@@ -864,9 +953,34 @@ Shader *ShaderManager::ApplyVertexShader(int prim, u32 vertType, ShaderID *VSID)
 	return vs;
 }
 
+// What ComputeFragmentShaderID reads besides the registers.
+static u32 FragmentShaderIDInputs() {
+	u32 inputs = 0;
+	if (gstate_c.textureFullAlpha)
+		inputs |= 1 << 0;
+	if (gstate_c.vertexFullAlpha)
+		inputs |= 1 << 1;
+	if (gstate_c.needShaderTexClamp)
+		inputs |= 1 << 2;
+	if (gstate_c.curTextureXOffset != 0 || gstate_c.curTextureYOffset != 0)
+		inputs |= 1 << 3;
+	if (gstate_c.bgraTexture)
+		inputs |= 1 << 4;
+	if (gstate_c.allowShaderBlend)
+		inputs |= 1 << 5;
+	if (g_Config.bDisableAlphaTest)
+		inputs |= 1 << 6;
+	return inputs;
+}
+
 LinkedShader *ShaderManager::ApplyFragmentShader(ShaderID VSID, Shader *vs, u32 vertType, int prim) {
-	ShaderID FSID;
-	ComputeFragmentShaderID(&FSID);
+	const u32 inputs = FragmentShaderIDInputs();
+	if (gstate_c.IsDirty(DIRTY_FRAGMENTSHADER_STATE) || inputs != curFSIDInputs_) {
+		ComputeFragmentShaderID(&curFSID_);
+		curFSIDInputs_ = inputs;
+		gstate_c.Clean(DIRTY_FRAGMENTSHADER_STATE);
+	}
+	const ShaderID FSID = curFSID_;
 	if (lastVShaderSame_ && FSID == lastFSID_) {
 		lastShader_->UpdateUniforms(vertType, VSID);
 		return lastShader_;
@@ -978,50 +1092,18 @@ std::string ShaderManager::DebugGetShaderString(std::string id, DebugShaderType
 	}
 }
 
-// Shader pseudo-cache.
-//
-// We simply store the IDs of the shaders used during gameplay. On next startup of
-// the same game, we simply compile all the shaders from the start, so we don't have to
-// compile them on the fly later. Ideally we would store the actual compiled shaders
-// rather than just their IDs, but OpenGL does not support this, except for a few obscure
-// vendor-specific extensions.
-//
-// If things like GPU supported features have changed since the last time, we discard the cache
-// as sometimes these features might have an effect on the ID bits.
-
-#define CACHE_HEADER_MAGIC 0x83277592
-#define CACHE_VERSION 1
-struct CacheHeader {
-	uint32_t magic;
-	uint32_t version;
-	uint32_t featureFlags;
-	uint32_t reserved;
-	int numVertexShaders;
-	int numFragmentShaders;
-	int numLinkedPrograms;
-};
-
+// See ShaderCacheFile for the format. Program binaries are used when they were saved by the
+// same driver, otherwise we compile and link everything from the IDs.
 void ShaderManager::LoadAndPrecompile(const std::string &filename) {
-	File::IOFile f(filename, "rb");
-	if (!f.IsOpen()) {
-		return;
-	}
-	CacheHeader header;
-	if (!f.ReadArray(&header, 1)) {
-		return;
-	}
-	if (header.magic != CACHE_HEADER_MAGIC || header.version != CACHE_VERSION || header.featureFlags != gstate_c.featureFlags) {
+	ShaderCacheFile cache;
+	if (!cache.Load(filename) || cache.featureFlags != gstate_c.featureFlags) {
 		return;
 	}
+	const bool useBinaries = useProgramBinaries_ && cache.driverHash == driverHash_;
 	time_update();
 	double start = time_now_d();
 
-	for (int i = 0; i < header.numVertexShaders; i++) {
-		ShaderID id;
-		if (!f.ReadArray(&id, 1)) {
-			ERROR_LOG(G3D, "Truncated shader cache file, aborting.");
-			return;
-		}
+	for (const ShaderID &id : cache.vertexShaders) {
 		Shader *vs = CompileVertexShader(id);
 		if (vs->Failed()) {
 			// Give up on using the cache, just bail. We can't safely create the fallback shaders here
@@ -1032,28 +1114,17 @@ void ShaderManager::LoadAndPrecompile(const std::string &filename) {
 		}
 		vsCache_[id] = vs;
 	}
-	for (int i = 0; i < header.numFragmentShaders; i++) {
-		ShaderID id;
-		if (!f.ReadArray(&id, 1)) {
-			ERROR_LOG(G3D, "Truncated shader cache file, aborting.");
-			return;
-		}
+	for (const ShaderID &id : cache.fragmentShaders) {
 		fsCache_[id] = CompileFragmentShader(id);
 	}
-	for (int i = 0; i < header.numLinkedPrograms; i++) {
-		ShaderID vsid, fsid;
-		if (!f.ReadArray(&vsid, 1)) {
-			ERROR_LOG(G3D, "Truncated shader cache file, aborting.");
-			return;
-		}
-		if (!f.ReadArray(&fsid, 1)) {
-			ERROR_LOG(G3D, "Truncated shader cache file, aborting.");
-			return;
-		}
-		VSCache::iterator vs = vsCache_.find(vsid);
-		FSCache::iterator fs = fsCache_.find(fsid);
+	int numFromBinary = 0;
+	for (const ShaderCacheProgram &program : cache.programs) {
+		VSCache::iterator vs = vsCache_.find(program.vsid);
+		FSCache::iterator fs = fsCache_.find(program.fsid);
 		if (vs != vsCache_.end() && fs != fsCache_.end()) {
-			LinkedShader *ls = new LinkedShader(vsid, vs->second, fsid, fs->second, vs->second->UseHWTransform());
+			LinkedShader *ls = new LinkedShader(program.vsid, vs->second, program.fsid, fs->second, vs->second->UseHWTransform(), useBinaries ? &program : nullptr);
+			if (ls->LoadedFromBinary())
+				numFromBinary++;
 			LinkedShaderCacheEntry entry(vs->second, fs->second, ls);
 			linkedShaderCache_.push_back(entry);
 		}
@@ -1061,7 +1132,7 @@ void ShaderManager::LoadAndPrecompile(const std::string &filename) {
 	time_update();
 	double end = time_now_d();
 
-	NOTICE_LOG(G3D, "Compiled and linked %d programs (%d vertex, %d fragment) in %0.1f milliseconds", header.numLinkedPrograms, header.numVertexShaders, header.numFragmentShaders, 1000 * (end - start));
+	NOTICE_LOG(G3D, "Compiled and linked %d programs (%d vertex, %d fragment, %d from binaries) in %0.1f milliseconds", (int)cache.programs.size(), (int)cache.vertexShaders.size(), (int)cache.fragmentShaders.size(), numFromBinary, 1000 * (end - start));
 	NOTICE_LOG(G3D, "Loaded the shader cache from '%s'", filename.c_str());
 	diskCacheDirty_ = false;
 }
@@ -1074,42 +1145,34 @@ void ShaderManager::Save(const std::string &filename) {
 		return;
 	}
 	INFO_LOG(G3D, "Saving the shader cache to '%s'", filename.c_str());
-	FILE *f = File::OpenCFile(filename, "wb");
-	if (!f) {
-		// Can't save, give up for now.
-		diskCacheDirty_ = false;
-		return;
-	}
-	CacheHeader header;
-	header.magic = CACHE_HEADER_MAGIC;
-	header.version = CACHE_VERSION;
-	header.reserved = 0;
-	header.featureFlags = gstate_c.featureFlags;
-	header.numVertexShaders = NumVertexShaders();
-	header.numFragmentShaders = NumFragmentShaders();
-	header.numLinkedPrograms = NumPrograms();
-	fwrite(&header, 1, sizeof(header), f);
+
+	ShaderCacheFile cache;
+	cache.featureFlags = gstate_c.featureFlags;
+	cache.driverHash = driverHash_;
 	for (auto iter : vsCache_) {
-		ShaderID id = iter.first;
-		fwrite(&id, 1, sizeof(id), f);
+		cache.vertexShaders.push_back(iter.first);
 	}
 	for (auto iter : fsCache_) {
-		ShaderID id = iter.first;
-		fwrite(&id, 1, sizeof(id), f);
+		cache.fragmentShaders.push_back(iter.first);
 	}
-	for (auto iter : linkedShaderCache_) {
-		ShaderID vsid, fsid;
+	cache.programs.resize(linkedShaderCache_.size());
+	for (size_t i = 0; i < linkedShaderCache_.size(); i++) {
+		const LinkedShaderCacheEntry &entry = linkedShaderCache_[i];
+		ShaderCacheProgram &program = cache.programs[i];
 		for (auto iter2 : vsCache_) {
-			if (iter.vs == iter2.second)
-				vsid = iter2.first;
+			if (entry.vs == iter2.second)
+				program.vsid = iter2.first;
 		}
 		for (auto iter2 : fsCache_) {
-			if (iter.fs == iter2.second)
-				fsid = iter2.first;
+			if (entry.fs == iter2.second)
+				program.fsid = iter2.first;
+		}
+		program.binaryFormat = 0;
+		if (useProgramBinaries_) {
+			entry.ls->GetBinary(&program);
 		}
-		fwrite(&vsid, 1, sizeof(vsid), f);
-		fwrite(&fsid, 1, sizeof(fsid), f);
 	}
-	fclose(f);
+	// If we can't save, give up for now.
+	cache.Save(filename);
 	diskCacheDirty_ = false;
 }
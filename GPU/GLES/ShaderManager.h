@@ -43,9 +43,13 @@ enum {
 
 class LinkedShader {
 public:
-	LinkedShader(ShaderID VSID, Shader *vs, ShaderID FSID, Shader *fs, bool useHWTransform);
+	LinkedShader(ShaderID VSID, Shader *vs, ShaderID FSID, Shader *fs, bool useHWTransform, const ShaderCacheProgram *cached = nullptr);
 	~LinkedShader();
 
+	// Gets the linked program from the driver for the shader cache.
+	bool GetBinary(ShaderCacheProgram *cached) const;
+	bool LoadedFromBinary() const { return loadedFromBinary_; }
+
 	void use(const ShaderID &VSID, LinkedShader *previous);
 	void stop();
 	void UpdateUniforms(u32 vertType, const ShaderID &VSID);
@@ -110,6 +114,12 @@ class LinkedShader {
 	int u_lightdiffuse[4];  // each light consist of vec4[3]
 	int u_lightspecular[4];  // attenuation
 	int u_lightambient[4];  // attenuation
+
+private:
+	bool Link(ShaderID VSID, Shader *vs, ShaderID FSID, Shader *fs);
+	bool LoadBinary(const ShaderCacheProgram &cached);
+
+	bool loadedFromBinary_;
 };
 
 enum {
@@ -228,6 +238,13 @@ class ShaderManager {
 	ShaderID lastFSID_;
 	ShaderID lastVSID_;
 
+	// The IDs computed by the last Apply*Shader, reused while DIRTY_*SHADER_STATE and their other inputs are clean.
+	ShaderID curVSID_;
+	u32 curVSIDVertType_;
+	bool curVSIDUseHWTransform_;
+	ShaderID curFSID_;
+	u32 curFSIDInputs_;
+
 	LinkedShader *lastShader_;
 	u32 globalDirty_;
 	u32 shaderSwitchDirty_;
@@ -240,4 +257,7 @@ class ShaderManager {
 	VSCache vsCache_;
 
 	bool diskCacheDirty_;
+	// Whether the driver can give us linked programs to store in the disk cache.
+	bool useProgramBinaries_;
+	u32 driverHash_;
 };
@@ -152,8 +152,6 @@ inline void TransformDrawEngine::ResetShaderBlending() {
 }
 
 void TransformDrawEngine::ApplyDrawState(int prim) {
-	// TODO: All this setup is soon so expensive that we'll need dirty flags, or simply do it in the command writes where we detect dirty by xoring. Silly to do all this work on every drawcall.
-
 	if (gstate_c.textureChanged != TEXCHANGE_UNCHANGED && !gstate.isModeClear() && gstate.isTextureMapEnabled()) {
 		textureCache_->SetTexture();
 		gstate_c.textureChanged = TEXCHANGE_UNCHANGED;
@@ -171,15 +169,41 @@ void TransformDrawEngine::ApplyDrawState(int prim) {
 
 	gstate_c.allowShaderBlend = !g_Config.bDisableSlowFramebufEffects;
 
-	// Do the large chunks of state conversion. We might be able to hide these two behind a dirty-flag each,
-	// to avoid recomputing heavy stuff unnecessarily every draw call.
-	GenericBlendState blendState;
-	ConvertBlendState(blendState, gstate_c.allowShaderBlend);
-	ViewportAndScissor vpAndScissor;
-	ConvertViewportAndScissor(useBufferedRendering,
-		framebufferManager_->GetRenderWidth(), framebufferManager_->GetRenderHeight(),
-		framebufferManager_->GetTargetBufferWidth(), framebufferManager_->GetTargetBufferHeight(),
-		vpAndScissor);
+	// Do the large chunks of state conversion, but only when the registers (see the dirty flags
+	// set by the command table) or anything else they're derived from changed.
+	if (gstate_c.IsDirty(DIRTY_BLEND_STATE) || blendAllowShaderBlend_ != gstate_c.allowShaderBlend || blendRenderingMode_ != g_Config.iRenderingMode) {
+		ConvertBlendState(blendState_, gstate_c.allowShaderBlend);
+		blendAllowShaderBlend_ = gstate_c.allowShaderBlend;
+		blendRenderingMode_ = g_Config.iRenderingMode;
+		gstate_c.Clean(DIRTY_BLEND_STATE);
+	}
+	// Copied, since shader blending may still change it below.
+	GenericBlendState blendState = blendState_;
+
+	ViewportScissorInputs vpInputs;
+	vpInputs.useBufferedRendering = useBufferedRendering;
+	vpInputs.renderWidth = framebufferManager_->GetRenderWidth();
+	vpInputs.renderHeight = framebufferManager_->GetRenderHeight();
+	vpInputs.bufferWidth = framebufferManager_->GetTargetBufferWidth();
+	vpInputs.bufferHeight = framebufferManager_->GetTargetBufferHeight();
+	vpInputs.rtOffsetX = gstate_c.curRTOffsetX;
+	vpInputs.rtWidth = gstate_c.curRTWidth;
+	vpInputs.rtHeight = gstate_c.curRTHeight;
+	vpInputs.pixelWidth = PSP_CoreParameter().pixelWidth;
+	vpInputs.pixelHeight = PSP_CoreParameter().pixelHeight;
+	if (gstate_c.IsDirty(DIRTY_VIEWPORTSCISSOR_STATE) || !(vpInputs == vpInputs_)) {
+		ConvertViewportAndScissor(useBufferedRendering, vpInputs.renderWidth, vpInputs.renderHeight, vpInputs.bufferWidth, vpInputs.bufferHeight, vpAndScissor_);
+		vpInputs_ = vpInputs;
+		gstate_c.Clean(DIRTY_VIEWPORTSCISSOR_STATE);
+
+		if (vpAndScissor_.dirtyProj) {
+			shaderManager_->DirtyUniform(DIRTY_PROJMATRIX);
+		}
+		if (vpAndScissor_.dirtyDepth) {
+			shaderManager_->DirtyUniform(DIRTY_DEPTHRANGE);
+		}
+	}
+	ViewportAndScissor vpAndScissor = vpAndScissor_;
 
 	if (blendState.applyShaderBlending) {
 		if (ApplyShaderBlending()) {
@@ -331,15 +355,18 @@ void TransformDrawEngine::ApplyDrawState(int prim) {
 
 		glstate.colorMask.set(rmask, gmask, bmask, amask);
 
-		GenericStencilFuncState stencilState;
-		ConvertStencilFuncState(stencilState);
+		if (gstate_c.IsDirty(DIRTY_DEPTHSTENCIL_STATE) || stencilDisabled_ != g_Config.bDisableStencilTest) {
+			ConvertStencilFuncState(stencilState_);
+			stencilDisabled_ = g_Config.bDisableStencilTest;
+			gstate_c.Clean(DIRTY_DEPTHSTENCIL_STATE);
+		}
 
 		// Stencil Test
-		if (stencilState.enabled) {
+		if (stencilState_.enabled) {
 			glstate.stencilTest.enable();
-			glstate.stencilFunc.set(ztests[stencilState.testFunc], stencilState.testRef, stencilState.testMask);
-			glstate.stencilOp.set(stencilOps[stencilState.sFail], stencilOps[stencilState.zFail], stencilOps[stencilState.zPass]);
-			glstate.stencilMask.set(stencilState.writeMask);
+			glstate.stencilFunc.set(ztests[stencilState_.testFunc], stencilState_.testRef, stencilState_.testMask);
+			glstate.stencilOp.set(stencilOps[stencilState_.sFail], stencilOps[stencilState_.zFail], stencilOps[stencilState_.zPass]);
+			glstate.stencilMask.set(stencilState_.writeMask);
 		} else {
 			glstate.stencilTest.disable();
 		}
@@ -360,13 +387,6 @@ void TransformDrawEngine::ApplyDrawState(int prim) {
 	}
 	glstate.viewport.set(vpAndScissor.viewportX, vpAndScissor.viewportY, vpAndScissor.viewportW, vpAndScissor.viewportH);
 	glstate.depthRange.set(vpAndScissor.depthRangeMin, vpAndScissor.depthRangeMax);
-
-	if (vpAndScissor.dirtyProj) {
-		shaderManager_->DirtyUniform(DIRTY_PROJMATRIX);
-	}
-	if (vpAndScissor.dirtyDepth) {
-		shaderManager_->DirtyUniform(DIRTY_DEPTHRANGE);
-	}
 }
 
 void TransformDrawEngine::ApplyDrawStateLate() {
@@ -115,6 +115,11 @@ enum {
 #define VERTEXCACHE_NAME_CACHE_MAX_AGE 120
 
 enum { VAI_KILL_AGE = 120, VAI_UNRELIABLE_KILL_AGE = 240, VAI_UNRELIABLE_KILL_MAX = 4 };
+// Unreliable arrays are retried after 8 frames, doubling up to 512 each time they change again.
+enum { VAI_UNRELIABLE_RETRY_AGE = 4, VAI_UNRELIABLE_RETRY_MAX = 7 };
+
+// Sharing buffers trusts the hash alone to tell the data apart, and 32 bits collide too easily for that.
+static const bool VAI_SHARE_CONTENT = sizeof(ReliableHashType) >= 8;
 
 
 TransformDrawEngine::TransformDrawEngine()
@@ -135,6 +140,13 @@ TransformDrawEngine::TransformDrawEngine()
 	bufferDecimationCounter_ = VERTEXCACHE_NAME_DECIMATION_INTERVAL;
 	memset(&decOptions_, 0, sizeof(decOptions_));
 	decOptions_.expandAllUVtoFloat = false;
+	memset(&blendState_, 0, sizeof(blendState_));
+	memset(&stencilState_, 0, sizeof(stencilState_));
+	memset(&vpAndScissor_, 0, sizeof(vpAndScissor_));
+	memset(&vpInputs_, 0, sizeof(vpInputs_));
+	blendAllowShaderBlend_ = false;
+	blendRenderingMode_ = -1;
+	stencilDisabled_ = false;
 	// Allocate nicely aligned memory. Maybe graphics drivers will
 	// appreciate it.
 	// All this is a LOT of memory, need to see if we can cut down somehow.
@@ -456,9 +468,11 @@ inline u32 ComputeMiniHashRange(const void *ptr, size_t sz) {
 		u32 hash = 0;
 		for (size_t i = 0; i < sz; i += step) {
 			hash += DoReliableHash32(p + i, 100, 0x3A44B9C4);
+			gpuStats.vertexCacheBytesHashed += 100;
 		}
 		return hash;
 	} else {
+		gpuStats.vertexCacheBytesHashed += 8;
 		return p[0] + p[sz - 1];
 	}
 }
@@ -482,7 +496,7 @@ u32 TransformDrawEngine::ComputeMiniHash() {
 			fullhash += ComputeMiniHashRange(dc.verts, vertexSize * dc.vertexCount);
 		} else {
 			int indexLowerBound = dc.indexLowerBound, indexUpperBound = dc.indexUpperBound;
-			fullhash += ComputeMiniHashRange((const u8 *)dc.verts + vertexSize * indexLowerBound, vertexSize * (indexUpperBound - indexLowerBound));
+			fullhash += ComputeMiniHashRange((const u8 *)dc.verts + vertexSize * indexLowerBound, vertexSize * (indexUpperBound - indexLowerBound + 1));
 			fullhash += ComputeMiniHashRange(dc.inds, indexSize * dc.vertexCount);
 		}
 	}
@@ -492,14 +506,12 @@ u32 TransformDrawEngine::ComputeMiniHash() {
 
 void TransformDrawEngine::MarkUnreliable(VertexArrayInfo *vai) {
 	vai->status = VertexArrayInfo::VAI_UNRELIABLE;
-	if (vai->vbo) {
-		FreeBuffer(vai->vbo);
-		vai->vbo = 0;
-	}
-	if (vai->ebo) {
-		FreeBuffer(vai->ebo);
-		vai->ebo = 0;
+	// Data that changed may settle down again (think loading screens), so don't give up on it for good.
+	if (vai->numUnreliable < VAI_UNRELIABLE_RETRY_MAX) {
+		vai->numUnreliable++;
 	}
+	vai->retryFrame = gpuStats.numFlips + (VAI_UNRELIABLE_RETRY_AGE << vai->numUnreliable);
+	FreeVertexArray(vai);
 }
 
 ReliableHashType TransformDrawEngine::ComputeHash() {
@@ -520,17 +532,21 @@ ReliableHashType TransformDrawEngine::ComputeHash() {
 			while (j < numDrawCalls) {
 				if (drawCalls[j].verts != dc.verts)
 					break;
-				indexLowerBound = std::min(indexLowerBound, (int)dc.indexLowerBound);
-				indexUpperBound = std::max(indexUpperBound, (int)dc.indexUpperBound);
+				indexLowerBound = std::min(indexLowerBound, (int)drawCalls[j].indexLowerBound);
+				indexUpperBound = std::max(indexUpperBound, (int)drawCalls[j].indexUpperBound);
 				lastMatch = j;
 				j++;
 			}
 			// This could get seriously expensive with sparse indices. Need to combine hashing ranges the same way
 			// we do when drawing.
 			fullhash += DoReliableHash((const char *)dc.verts + vertexSize * indexLowerBound,
-				vertexSize * (indexUpperBound - indexLowerBound), 0x029F3EE1);
-			// Hm, we will miss some indices when combining above, but meh, it should be fine.
-			fullhash += DoReliableHash((const char *)dc.inds, indexSize * dc.vertexCount, 0x955FD1CA);
+				vertexSize * (indexUpperBound - indexLowerBound + 1), 0x029F3EE1);
+			gpuStats.vertexCacheBytesHashed += vertexSize * (indexUpperBound - indexLowerBound + 1);
+			// The buffers may be shared with other data that has the same content, so all the indices count.
+			for (j = i; j <= lastMatch; j++) {
+				fullhash += DoReliableHash((const char *)drawCalls[j].inds, indexSize * drawCalls[j].vertexCount, 0x955FD1CA);
+				gpuStats.vertexCacheBytesHashed += indexSize * drawCalls[j].vertexCount;
+			}
 			i = lastMatch;
 		}
 	}
@@ -541,12 +557,78 @@ ReliableHashType TransformDrawEngine::ComputeHash() {
 	return fullhash;
 }
 
+ReliableHashType TransformDrawEngine::ComputeContentKey(ReliableHashType dataHash) {
+	// The data hash doesn't know how the data was drawn, which the decoded buffers also depend on.
+	u32 shape = lastVType_;
+	for (int i = 0; i < numDrawCalls; i++) {
+		const DeferredDrawCall &dc = drawCalls[i];
+		shape = __rotl(shape, 13) ^ dc.vertType;
+		shape = __rotl(shape, 13) ^ dc.vertexCount;
+		shape = __rotl(shape, 13) ^ (u32)dc.prim;
+		shape = __rotl(shape, 13) ^ (dc.indexLowerBound | (dc.indexUpperBound << 16));
+	}
+	return dataHash ^ ((ReliableHashType)shape * (ReliableHashType)0x9E3779B97F4A7C15ULL);
+}
+
+bool TransformDrawEngine::ShareVertexArray(VertexArrayInfo *vai) {
+	if (!VAI_SHARE_CONTENT) {
+		return false;
+	}
+	auto iter = vaiContent_.find(ComputeContentKey(vai->hash));
+	if (iter == vaiContent_.end()) {
+		return false;
+	}
+
+	VertexArrayContent &content = iter->second;
+	content.lastFrame = gpuStats.numFlips;
+	RetainBuffer(content.vbo);
+	if (content.ebo) {
+		RetainBuffer(content.ebo);
+	}
+	vai->vbo = content.vbo;
+	vai->ebo = content.ebo;
+	vai->numVerts = content.numVerts;
+	vai->maxIndex = content.maxIndex;
+	vai->prim = content.prim;
+	vai->flags = content.flags;
+	return true;
+}
+
+void TransformDrawEngine::AddVertexArrayContent(VertexArrayInfo *vai) {
+	if (!VAI_SHARE_CONTENT) {
+		return;
+	}
+	VertexArrayContent &content = vaiContent_[ComputeContentKey(vai->hash)];
+	content.vbo = vai->vbo;
+	content.ebo = vai->ebo;
+	content.numVerts = vai->numVerts;
+	content.maxIndex = vai->maxIndex;
+	content.prim = vai->prim;
+	content.flags = vai->flags;
+	content.lastFrame = gpuStats.numFlips;
+	RetainBuffer(content.vbo);
+	if (content.ebo) {
+		RetainBuffer(content.ebo);
+	}
+}
+
+void TransformDrawEngine::FreeVertexArrayContent(VertexArrayContent &content) {
+	FreeBuffer(content.vbo);
+	if (content.ebo) {
+		FreeBuffer(content.ebo);
+	}
+}
+
 void TransformDrawEngine::ClearTrackedVertexArrays() {
 	for (auto vai = vai_.begin(); vai != vai_.end(); vai++) {
 		FreeVertexArray(vai->second);
 		delete vai->second;
 	}
 	vai_.clear();
+	for (auto content = vaiContent_.begin(); content != vaiContent_.end(); content++) {
+		FreeVertexArrayContent(content->second);
+	}
+	vaiContent_.clear();
 }
 
 void TransformDrawEngine::DecimateTrackedVertexArrays() {
@@ -575,6 +657,16 @@ void TransformDrawEngine::DecimateTrackedVertexArrays() {
 			++iter;
 		}
 	}
+
+	// The arrays using the buffers hold on to them, this only stops new arrays from finding them.
+	for (auto iter = vaiContent_.begin(); iter != vaiContent_.end(); ) {
+		if (iter->second.lastFrame < threshold) {
+			FreeVertexArrayContent(iter->second);
+			vaiContent_.erase(iter++);
+		} else {
+			++iter;
+		}
+	}
 }
 
 GLuint TransformDrawEngine::AllocateBuffer(size_t sz) {
@@ -605,13 +697,26 @@ GLuint TransformDrawEngine::AllocateBuffer(size_t sz) {
 	bufferNameCacheSize_ += sz - info.sz;
 	info.sz = sz;
 	info.used = true;
+	info.refCount = 1;
 	return unused;
 }
 
+void TransformDrawEngine::RetainBuffer(GLuint buf) {
+	auto it = bufferNameInfo_.find(buf);
+	if (it != bufferNameInfo_.end()) {
+		it->second.refCount++;
+	} else {
+		ERROR_LOG(G3D, "Unexpected buffer retained (%d) but not tracked", buf);
+	}
+}
+
 void TransformDrawEngine::FreeBuffer(GLuint buf) {
 	// We can reuse buffers by setting new data on them, so let's actually keep it.
 	auto it = bufferNameInfo_.find(buf);
 	if (it != bufferNameInfo_.end()) {
+		if (--it->second.refCount > 0) {
+			return;
+		}
 		it->second.used = false;
 		it->second.lastFrame = gpuStats.numFlips;
 	} else {
@@ -676,6 +781,21 @@ void TransformDrawEngine::DoFlush() {
 					vai->minihash = ComputeMiniHash();
 					vai->status = VertexArrayInfo::VAI_HASHING;
 					vai->drawsUntilNextFullHash = 0;
+					// The same data may already be decoded, from another address or from before it moved.
+					if (ShareVertexArray(vai)) {
+						gpuStats.numCachedDrawCalls++;
+						gpuStats.numVertexCacheShared++;
+						gpuStats.numCachedVertsDrawn += vai->numVerts;
+						gstate_c.vertexFullAlpha = vai->flags & VAI_FLAG_VERTEXFULLALPHA;
+						useElements = vai->ebo ? true : false;
+						vbo = vai->vbo;
+						ebo = vai->ebo;
+						glstate.arrayBuffer.bind(vbo);
+						glstate.elementArrayBuffer.bind(ebo);
+						vertexCount = vai->numVerts;
+						prim = static_cast<GEPrimitiveType>(vai->prim);
+						break;
+					}
 					DecodeVerts(); // writes to indexGen
 					vai->numVerts = indexGen.VertexCount();
 					vai->prim = indexGen.Prim();
@@ -705,6 +825,10 @@ void TransformDrawEngine::DoFlush() {
 							DecodeVerts();
 							goto rotateVBO;
 						}
+						// Each time it holds up, forgive one of the times it changed.
+						if (vai->numUnreliable > 0) {
+							vai->numUnreliable--;
+						}
 						if (vai->numVerts > 64) {
 							// exponential backoff up to 16 draws, then every 32
 							vai->drawsUntilNextFullHash = std::min(32, vai->numFrames);
@@ -726,7 +850,16 @@ void TransformDrawEngine::DoFlush() {
 						}
 					}
 
-					if (vai->vbo == 0) {
+					if (vai->vbo == 0 && ShareVertexArray(vai)) {
+						gpuStats.numCachedDrawCalls++;
+						gpuStats.numVertexCacheShared++;
+						gpuStats.numCachedVertsDrawn += vai->numVerts;
+						glstate.arrayBuffer.bind(vai->vbo);
+						glstate.elementArrayBuffer.bind(vai->ebo);
+						useElements = vai->ebo ? true : false;
+						gstate_c.vertexFullAlpha = vai->flags & VAI_FLAG_VERTEXFULLALPHA;
+					} else if (vai->vbo == 0) {
+						gpuStats.numVertexCacheMisses++;
 						DecodeVerts();
 						vai->numVerts = indexGen.VertexCount();
 						vai->prim = indexGen.Prim();
@@ -743,6 +876,7 @@ void TransformDrawEngine::DoFlush() {
 						vai->vbo = AllocateBuffer(vsz);
 						glstate.arrayBuffer.bind(vai->vbo);
 						glBufferData(GL_ARRAY_BUFFER, vsz, decoded, GL_STATIC_DRAW);
+						gpuStats.vertexCacheBytesUploaded += (int)vsz;
 						// If there's only been one primitive type, and it's either TRIANGLES, LINES or POINTS,
 						// there is no need for the index buffer we built. We can then use glDrawArrays instead
 						// for a very minor speed boost.
@@ -751,10 +885,12 @@ void TransformDrawEngine::DoFlush() {
 							vai->ebo = AllocateBuffer(esz);
 							glstate.elementArrayBuffer.bind(vai->ebo);
 							glBufferData(GL_ELEMENT_ARRAY_BUFFER, esz, (GLvoid *)decIndex, GL_STATIC_DRAW);
+							gpuStats.vertexCacheBytesUploaded += (int)esz;
 						} else {
 							vai->ebo = 0;
 							glstate.elementArrayBuffer.bind(vai->ebo);
 						}
+						AddVertexArrayContent(vai);
 					} else {
 						gpuStats.numCachedDrawCalls++;
 						glstate.arrayBuffer.bind(vai->vbo);
@@ -796,6 +932,10 @@ void TransformDrawEngine::DoFlush() {
 					if (vai->lastFrame != gpuStats.numFlips) {
 						vai->numFrames++;
 					}
+					if (gpuStats.numFlips >= vai->retryFrame) {
+						// Start over, hashing from the next draw on.
+						vai->status = VertexArrayInfo::VAI_NEW;
+					}
 					DecodeVerts();
 					goto rotateVBO;
 				}
@@ -806,6 +946,9 @@ void TransformDrawEngine::DoFlush() {
 			DecodeVerts();
 
 rotateVBO:
+			if (useCache) {
+				gpuStats.numVertexCacheMisses++;
+			}
 			gpuStats.numUncachedVertsDrawn += indexGen.VertexCount();
 			useElements = !indexGen.SeenOnlyPurePrims();
 			vertexCount = indexGen.VertexCount();
@@ -851,11 +994,10 @@ void TransformDrawEngine::DoFlush() {
 			gstate_c.vertexFullAlpha = gstate_c.vertexFullAlpha && ((hasColor && (gstate.materialupdate & 1)) || gstate.getMaterialAmbientA() == 255) && (!gstate.isLightingEnabled() || gstate.getAmbientA() == 255);
 		}
 
+		// The SW code can't draw the stitched strips.
+		indexGen.ConvertToList();
 		gpuStats.numUncachedVertsDrawn += indexGen.VertexCount();
 		prim = indexGen.Prim();
-		// Undo the strip optimization, not supported by the SW code yet.
-		if (prim == GE_PRIM_TRIANGLE_STRIP)
-			prim = GE_PRIM_TRIANGLES;
 
 		TransformedVertex *drawBuffer = NULL;
 		int numTrans;
@@ -993,6 +1135,7 @@ GLuint TransformDrawEngine::BindBuffer(const void *p, size_t sz) {
 
 	// These aren't used more than once per frame, so let's use GL_STREAM_DRAW.
 	glBufferData(GL_ARRAY_BUFFER, sz, p, GL_STREAM_DRAW);
+	gpuStats.vertexCacheBytesUploaded += (int)sz;
 	buffersThisFrame_.push_back(buf);
 
 	return buf;
@@ -1005,6 +1148,7 @@ GLuint TransformDrawEngine::BindBuffer(const void *p1, size_t sz1, const void *p
 	glBufferData(GL_ARRAY_BUFFER, sz1 + sz2, nullptr, GL_STREAM_DRAW);
 	glBufferSubData(GL_ARRAY_BUFFER, 0, sz1, p1);
 	glBufferSubData(GL_ARRAY_BUFFER, sz1, sz2, p2);
+	gpuStats.vertexCacheBytesUploaded += (int)(sz1 + sz2);
 	buffersThisFrame_.push_back(buf);
 
 	return buf;
@@ -1014,6 +1158,7 @@ GLuint TransformDrawEngine::BindElementBuffer(const void *p, size_t sz) {
 	GLuint buf = AllocateBuffer(sz);
 	glstate.elementArrayBuffer.bind(buf);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sz, p, GL_STREAM_DRAW);
+	gpuStats.vertexCacheBytesUploaded += (int)sz;
 	buffersThisFrame_.push_back(buf);
 
 	return buf;
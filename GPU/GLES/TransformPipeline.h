@@ -76,6 +76,8 @@ class VertexArrayInfo {
 		numVerts = 0;
 		drawsUntilNextFullHash = 0;
 		flags = 0;
+		retryFrame = 0;
+		numUnreliable = 0;
 	}
 
 	enum Status {
@@ -104,6 +106,22 @@ class VertexArrayInfo {
 	int lastFrame;  // So that we can forget.
 	u16 drawsUntilNextFullHash;
 	u8 flags;
+
+	// Unreliable arrays get another chance at this frame, later each time they change.
+	int retryFrame;
+	u8 numUnreliable;
+};
+
+// Decoded vertex data by content rather than by address. Draws of data that's already in a buffer,
+// like data streamed to a new address each frame, share that buffer instead of decoding again.
+struct VertexArrayContent {
+	u32 vbo;
+	u32 ebo;
+	u16 numVerts;
+	u16 maxIndex;
+	s8 prim;
+	u8 flags;
+	int lastFrame;
 };
 
 // Handles transform, lighting and drawing.
@@ -203,12 +221,17 @@ class TransformDrawEngine : public DrawEngineCommon, public GfxResourceHolder {
 	void ResetShaderBlending();
 
 	GLuint AllocateBuffer(size_t sz);
+	void RetainBuffer(GLuint buf);
 	void FreeBuffer(GLuint buf);
 	void FreeVertexArray(VertexArrayInfo *vai);
 
 	u32 ComputeMiniHash();
 	ReliableHashType ComputeHash();  // Reads deferred vertex data.
+	ReliableHashType ComputeContentKey(ReliableHashType dataHash);
 	void MarkUnreliable(VertexArrayInfo *vai);
+	bool ShareVertexArray(VertexArrayInfo *vai);
+	void AddVertexArrayContent(VertexArrayInfo *vai);
+	void FreeVertexArrayContent(VertexArrayContent &content);
 
 	// Defer all vertex decoding to a Flush, so that we can hash and cache the
 	// generated buffers without having to redecode them every time.
@@ -234,14 +257,16 @@ class TransformDrawEngine : public DrawEngineCommon, public GfxResourceHolder {
 	TransformedVertex *transformedExpanded;
 
 	std::unordered_map<u32, VertexArrayInfo *> vai_;
+	std::unordered_map<ReliableHashType, VertexArrayContent> vaiContent_;
 
 	// Vertex buffer objects
 	// Element buffer objects
 	struct BufferNameInfo {
-		BufferNameInfo() : sz(0), used(false), lastFrame(0) {}
+		BufferNameInfo() : sz(0), used(false), refCount(0), lastFrame(0) {}
 
 		size_t sz;
 		bool used;
+		int refCount;  // Vertex arrays with the same content share buffers.
 		int lastFrame;
 	};
 	std::vector<GLuint> bufferNameCache_;
@@ -270,4 +295,33 @@ class TransformDrawEngine : public DrawEngineCommon, public GfxResourceHolder {
 
 	bool fboTexNeedBind_;
 	bool fboTexBound_;
+
+	// What the viewport and scissor are derived from, besides gstate.
+	struct ViewportScissorInputs {
+		bool useBufferedRendering;
+		int renderWidth;
+		int renderHeight;
+		int bufferWidth;
+		int bufferHeight;
+		u32 rtOffsetX;
+		u32 rtWidth;
+		u32 rtHeight;
+		int pixelWidth;
+		int pixelHeight;
+
+		bool operator ==(const ViewportScissorInputs &other) const {
+			return useBufferedRendering == other.useBufferedRendering && renderWidth == other.renderWidth && renderHeight == other.renderHeight &&
+				bufferWidth == other.bufferWidth && bufferHeight == other.bufferHeight && rtOffsetX == other.rtOffsetX &&
+				rtWidth == other.rtWidth && rtHeight == other.rtHeight && pixelWidth == other.pixelWidth && pixelHeight == other.pixelHeight;
+		}
+	};
+
+	// The state converted by the last ApplyDrawState, kept until its DIRTY_*_STATE flag or inputs change.
+	GenericBlendState blendState_;
+	bool blendAllowShaderBlend_;
+	int blendRenderingMode_;
+	GenericStencilFuncState stencilState_;
+	bool stencilDisabled_;
+	ViewportAndScissor vpAndScissor_;
+	ViewportScissorInputs vpInputs_;
 };
@@ -62,6 +62,10 @@ struct GPUStatistics {
 		numCachedVertsDrawn = 0;
 		numUncachedVertsDrawn = 0;
 		numTrackedVertexArrays = 0;
+		numVertexCacheShared = 0;
+		numVertexCacheMisses = 0;
+		vertexCacheBytesHashed = 0;
+		vertexCacheBytesUploaded = 0;
 		numTextureInvalidations = 0;
 		numTextureSwitches = 0;
 		numShaderSwitches = 0;
@@ -70,6 +74,7 @@ struct GPUStatistics {
 		msProcessingDisplayLists = 0;
 		vertexGPUCycles = 0;
 		otherGPUCycles = 0;
+		numCachedListCommands = 0;
 		memset(gpuCommandsAtCallLevel, 0, sizeof(gpuCommandsAtCallLevel));
 	}
 
@@ -81,6 +86,10 @@ struct GPUStatistics {
 	int numCachedVertsDrawn;
 	int numUncachedVertsDrawn;
 	int numTrackedVertexArrays;
+	int numVertexCacheShared;  // Cached draws found by content, a subset of numCachedDrawCalls
+	int numVertexCacheMisses;
+	int vertexCacheBytesHashed;
+	int vertexCacheBytesUploaded;
 	int numTextureInvalidations;
 	int numTextureSwitches;
 	int numShaderSwitches;
@@ -89,6 +98,7 @@ struct GPUStatistics {
 	int vertexGPUCycles;
 	int otherGPUCycles;
 	int gpuCommandsAtCallLevel[4];
+	int numCachedListCommands;
 
 	// Total statistics, updated by the GPU core in UpdateStats
 	int numVBlanks;
@@ -98,6 +108,7 @@ struct GPUStatistics {
 	int numFragmentShaders;
 	int numShaders;
 	int numFBOs;
+	int numTrackedListSegments;
 };
 
 extern GPUStatistics gpuStats;
@@ -607,6 +607,45 @@ void GPUCommon::SlowRunLoop(DisplayList &list)
 	}
 }
 
+void GPUCommon::ReplaySegment(DisplayList &list, const DisplayListSegment &seg) {
+	const int start = downcount;
+	for (const DisplayListStep &step : seg.steps) {
+		const u32 diff = step.op ^ gstate.cmdmem[step.cmd];
+		gstate.cmdmem[step.cmd] = step.op;
+		if (step.flags & FLAG_ANY_EXECUTE) {
+			// Handlers expect the PC and downcount of their own command.
+			const int expected = start - step.offset;
+			list.pc = seg.pc + step.offset * 4;
+			downcount = expected;
+			ExecuteOp(step.op, diff);
+			if (downcount != expected) {
+				// Recalculated, so carry on from here like the run loop would.
+				list.pc += 4;
+				--downcount;
+				return;
+			}
+		}
+	}
+
+	list.pc = seg.pc + seg.words * 4;
+	downcount = start - seg.words;
+	gpuStats.numCachedListCommands += seg.words;
+}
+
+void GPUCommon::SetExecuteOpFlags(const u8 *storeOnlyCmds, size_t count) {
+	u8 flags[256];
+	memset(flags, FLAG_EXECUTE, sizeof(flags));
+	flags[GE_CMD_JUMP] |= FLAG_WRITES_PC;
+	flags[GE_CMD_BJUMP] |= FLAG_WRITES_PC;
+	flags[GE_CMD_CALL] |= FLAG_WRITES_PC;
+	flags[GE_CMD_RET] |= FLAG_WRITES_PC;
+	flags[GE_CMD_END] |= FLAG_WRITES_PC;
+	for (size_t i = 0; i < count; ++i) {
+		flags[storeOnlyCmds[i]] = 0;
+	}
+	dlCache_.SetCommandFlags(flags);
+}
+
 // The newPC parameter is used for jumps, we don't count cycles between.
 void GPUCommon::UpdatePC(u32 currentPC, u32 newPC) {
 	// Rough estimate, 2 CPU ticks (it's double the clock rate) per GPU instruction.
@@ -1152,6 +1191,11 @@ void GPUCommon::DoState(PointerWrap &p) {
 	p.Do(isbreak);
 	p.Do(drawCompleteTicks);
 	p.Do(busyTicks);
+
+	if (p.mode == p.MODE_READ) {
+		// Would be rehashed anyway, but little of it is likely to match.
+		dlCache_.Clear();
+	}
 }
 
 void GPUCommon::InterruptStart(int listid) {
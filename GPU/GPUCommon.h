@@ -4,6 +4,7 @@
 #include "Common/MemoryUtil.h"
 #include "Core/ThreadEventQueue.h"
 #include "GPU/GPUInterface.h"
+#include "GPU/Common/DisplayListCache.h"
 #include "GPU/Common/GPUDebugInterface.h"
 
 #if defined(ANDROID)
@@ -12,6 +13,18 @@
 #include <xmmintrin.h>
 #endif
 
+// Command flags, for the backends' command tables and the display list cache.
+enum {
+	FLAG_FLUSHBEFORE = 1,
+	FLAG_FLUSHBEFOREONCHANGE = 2,
+	FLAG_EXECUTE = 4,  // needs to actually be executed. unused for now.
+	FLAG_EXECUTEONCHANGE = 8,
+	FLAG_ANY_EXECUTE = 4 | 8,
+	FLAG_READS_PC = 16,
+	FLAG_WRITES_PC = 32,
+	FLAG_DIRTYONCHANGE = 64,
+};
+
 typedef ThreadEventQueue<GPUInterface, GPUEvent, GPUEventType, GPU_EVENT_INVALID, GPU_EVENT_SYNC_THREAD, GPU_EVENT_FINISH_EVENT_LOOP> GPUThreadEventQueue;
 
 class GPUCommon : public GPUThreadEventQueue, public GPUDebugInterface {
@@ -138,6 +151,9 @@ class GPUCommon : public GPUThreadEventQueue, public GPUDebugInterface {
 	// To avoid virtual calls to PreExecuteOp().
 	virtual void FastRunLoop(DisplayList &list) = 0;
 	void SlowRunLoop(DisplayList &list);
+	// For backends that run every command through ExecuteOp().
+	void ReplaySegment(DisplayList &list, const DisplayListSegment &seg);
+	void SetExecuteOpFlags(const u8 *storeOnlyCmds, size_t count);
 	void UpdatePC(u32 currentPC, u32 newPC);
 	void UpdatePC(u32 currentPC) {
 		UpdatePC(currentPC, currentPC);
@@ -191,6 +207,8 @@ class GPUCommon : public GPUThreadEventQueue, public GPUDebugInterface {
 	bool dumpThisFrame_;
 	bool interruptsEnabled_;
 
+	DisplayListCache dlCache_;
+
 private:
 	// For CPU/GPU sync.
 #ifdef ANDROID
@@ -205,6 +205,7 @@ struct GPUStateCache_v0
 
 void GPUStateCache::Reset() {
 	memset(&gstate_c, 0, sizeof(gstate_c));
+	dirty = DIRTY_ALL_STATE;
 }
 
 void GPUStateCache::DoState(PointerWrap &p) {
@@ -473,6 +473,18 @@ enum {
 	GPU_PREFER_REVERSE_COLOR_ORDER = FLAG_BIT(31),
 };
 
+// The state that the backends derive from gstate when flushing, in groups. The command handlers
+// set these when a register that feeds a group changes, so a flush only redoes the groups that did.
+enum {
+	DIRTY_BLEND_STATE = FLAG_BIT(0),
+	DIRTY_DEPTHSTENCIL_STATE = FLAG_BIT(1),
+	DIRTY_VIEWPORTSCISSOR_STATE = FLAG_BIT(2),
+	DIRTY_VERTEXSHADER_STATE = FLAG_BIT(3),
+	DIRTY_FRAGMENTSHADER_STATE = FLAG_BIT(4),
+
+	DIRTY_ALL_STATE = FLAG_BIT(5) - 1,
+};
+
 struct KnownVertexBounds {
 	u16 minU;
 	u16 minV;
@@ -482,8 +494,13 @@ struct KnownVertexBounds {
 
 struct GPUStateCache {
 	bool Supports(int flag) { return (featureFlags & flag) != 0; }
+	void Dirty(u32 what) { dirty |= what; }
+	void Clean(u32 what) { dirty &= ~what; }
+	bool IsDirty(u32 what) const { return (dirty & what) != 0; }
 
 	u32 featureFlags;
+	// DIRTY_*_STATE flags. Not saved, everything is dirtied when the state is reapplied.
+	u32 dirty;
 
 	u32 vertexAddr;
 	u32 indexAddr;
@@ -19,17 +19,104 @@
 #include "GPU/Null/NullGpu.h"
 #include "GPU/GPUState.h"
 #include "GPU/ge_constants.h"
+#include "Core/Config.h"
 #include "Core/Debugger/Breakpoints.h"
 #include "Core/MemMap.h"
 #include "Core/MIPS/MIPS.h"
 #include "Core/HLE/sceKernelInterrupt.h"
 #include "Core/HLE/sceGe.h"
 
-NullGPU::NullGPU() { }
+// ExecuteOp() does nothing for these, they only need to be in cmdmem.
+static const u8 storeOnlyCommands[] = {
+	GE_CMD_NOP,
+	GE_CMD_BASE,
+	GE_CMD_VERTEXTYPE,
+	GE_CMD_REGION1,
+	GE_CMD_REGION2,
+	GE_CMD_CLIPENABLE,
+	GE_CMD_CULLFACEENABLE,
+	GE_CMD_CULL,
+	GE_CMD_TEXTUREMAPENABLE,
+	GE_CMD_FOGENABLE,
+	GE_CMD_DITHERENABLE,
+	GE_CMD_OFFSETX,
+	GE_CMD_OFFSETY,
+	GE_CMD_SCISSOR1,
+	GE_CMD_SCISSOR2,
+	GE_CMD_MINZ,
+	GE_CMD_MAXZ,
+	GE_CMD_FRAMEBUFPTR,
+	GE_CMD_FRAMEBUFWIDTH,
+	GE_CMD_FRAMEBUFPIXFORMAT,
+	GE_CMD_ZBUFPTR,
+	GE_CMD_ZBUFWIDTH,
+	GE_CMD_CLUTADDR,
+	GE_CMD_CLUTADDRUPPER,
+	GE_CMD_AMBIENTCOLOR,
+	GE_CMD_AMBIENTALPHA,
+	GE_CMD_MATERIALAMBIENT,
+	GE_CMD_MATERIALDIFFUSE,
+	GE_CMD_MATERIALEMISSIVE,
+	GE_CMD_MATERIALSPECULAR,
+	GE_CMD_MATERIALALPHA,
+	GE_CMD_MATERIALSPECULARCOEF,
+	GE_CMD_LIGHTTYPE0,
+	GE_CMD_LIGHTTYPE1,
+	GE_CMD_LIGHTTYPE2,
+	GE_CMD_LIGHTTYPE3,
+	GE_CMD_LIGHTENABLE0,
+	GE_CMD_LIGHTENABLE1,
+	GE_CMD_LIGHTENABLE2,
+	GE_CMD_LIGHTENABLE3,
+	GE_CMD_VIEWPORTXSCALE,
+	GE_CMD_VIEWPORTYSCALE,
+	GE_CMD_VIEWPORTZSCALE,
+	GE_CMD_VIEWPORTXCENTER,
+	GE_CMD_VIEWPORTYCENTER,
+	GE_CMD_VIEWPORTZCENTER,
+	GE_CMD_LIGHTMODE,
+	GE_CMD_PATCHDIVISION,
+	GE_CMD_MATERIALUPDATE,
+	GE_CMD_CLEARMODE,
+	GE_CMD_ALPHABLENDENABLE,
+	GE_CMD_BLENDMODE,
+	GE_CMD_BLENDFIXEDA,
+	GE_CMD_BLENDFIXEDB,
+	GE_CMD_ALPHATESTENABLE,
+	GE_CMD_ALPHATEST,
+	GE_CMD_TEXFILTER,
+	GE_CMD_ZTESTENABLE,
+	GE_CMD_STENCILTESTENABLE,
+	GE_CMD_ZTEST,
+	GE_CMD_DITH0,
+	GE_CMD_DITH1,
+	GE_CMD_DITH2,
+	GE_CMD_DITH3,
+};
+
+NullGPU::NullGPU() {
+	SetExecuteOpFlags(storeOnlyCommands, ARRAY_SIZE(storeOnlyCommands));
+}
+
 NullGPU::~NullGPU() { }
 
+void NullGPU::BeginFrame() {
+	dlCache_.Decimate();
+}
+
 void NullGPU::FastRunLoop(DisplayList &list) {
-	for (; downcount > 0; --downcount) {
+	const bool useCache = g_Config.bDisplayListCache;
+	bool lookup = useCache;
+	while (downcount > 0) {
+		if (lookup) {
+			lookup = false;
+			const DisplayListSegment *seg = dlCache_.Lookup(list.pc, downcount);
+			if (seg) {
+				ReplaySegment(list, *seg);
+				continue;
+			}
+		}
+
 		u32 op = Memory::ReadUnchecked_U32(list.pc);
 		u32 cmd = op >> 24;
 
@@ -38,6 +125,8 @@ void NullGPU::FastRunLoop(DisplayList &list) {
 		ExecuteOp(op, diff);
 
 		list.pc += 4;
+		--downcount;
+		lookup = useCache && dlCache_.EndsSegment(cmd);
 	}
 }
 
@@ -684,7 +773,7 @@ void NullGPU::UpdateStats() {
 }
 
 void NullGPU::InvalidateCache(u32 addr, int size, GPUInvalidationType type) {
-	// Nothing to invalidate.
+	dlCache_.Invalidate(addr, size);
 }
 
 void NullGPU::NotifyVideoUpload(u32 addr, int size, int width, int format) {
@@ -29,7 +29,7 @@ class NullGPU : public GPUCommon {
 	void InitClear() override {}
 	void ExecuteOp(u32 op, u32 diff) override;
 
-	void BeginFrame() override {}
+	void BeginFrame() override;
 	void SetDisplayFramebuffer(u32 framebuf, u32 stride, GEBufferFormat format) override {}
 	void CopyDisplayToOutput() override {}
 	void UpdateStats() override;
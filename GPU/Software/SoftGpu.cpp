@@ -50,6 +50,105 @@ FormatBuffer fb;
 FormatBuffer depthbuf;
 u32 clut[4096];
 
+// ExecuteOp() does nothing for these, they only need to be in cmdmem.
+static const u8 storeOnlyCommands[] = {
+	GE_CMD_NOP,
+	GE_CMD_BASE,
+	GE_CMD_VERTEXTYPE,
+	GE_CMD_REGION1,
+	GE_CMD_REGION2,
+	GE_CMD_CLIPENABLE,
+	GE_CMD_CULLFACEENABLE,
+	GE_CMD_CULL,
+	GE_CMD_TEXTUREMAPENABLE,
+	GE_CMD_LIGHTINGENABLE,
+	GE_CMD_FOGCOLOR,
+	GE_CMD_FOG1,
+	GE_CMD_FOG2,
+	GE_CMD_FOGENABLE,
+	GE_CMD_DITHERENABLE,
+	GE_CMD_OFFSETX,
+	GE_CMD_OFFSETY,
+	GE_CMD_SCISSOR1,
+	GE_CMD_SCISSOR2,
+	GE_CMD_MINZ,
+	GE_CMD_FRAMEBUFPIXFORMAT,
+	GE_CMD_TEXADDR0,
+	GE_CMD_TEXADDR1,
+	GE_CMD_TEXADDR2,
+	GE_CMD_TEXADDR3,
+	GE_CMD_TEXADDR4,
+	GE_CMD_TEXADDR5,
+	GE_CMD_TEXADDR6,
+	GE_CMD_TEXADDR7,
+	GE_CMD_TEXBUFWIDTH0,
+	GE_CMD_TEXBUFWIDTH1,
+	GE_CMD_TEXBUFWIDTH2,
+	GE_CMD_TEXBUFWIDTH3,
+	GE_CMD_TEXBUFWIDTH4,
+	GE_CMD_TEXBUFWIDTH5,
+	GE_CMD_TEXBUFWIDTH6,
+	GE_CMD_TEXBUFWIDTH7,
+	GE_CMD_CLUTADDR,
+	GE_CMD_CLUTADDRUPPER,
+	GE_CMD_TRANSFERSRC,
+	GE_CMD_TRANSFERSRCW,
+	GE_CMD_TRANSFERDST,
+	GE_CMD_TRANSFERDSTW,
+	GE_CMD_TRANSFERSRCPOS,
+	GE_CMD_TRANSFERDSTPOS,
+	GE_CMD_TRANSFERSIZE,
+	GE_CMD_TEXSIZE0,
+	GE_CMD_TEXSIZE1,
+	GE_CMD_TEXSIZE2,
+	GE_CMD_TEXSIZE3,
+	GE_CMD_TEXSIZE4,
+	GE_CMD_TEXSIZE5,
+	GE_CMD_TEXSIZE6,
+	GE_CMD_TEXSIZE7,
+	GE_CMD_AMBIENTCOLOR,
+	GE_CMD_AMBIENTALPHA,
+	GE_CMD_MATERIALAMBIENT,
+	GE_CMD_MATERIALDIFFUSE,
+	GE_CMD_MATERIALEMISSIVE,
+	GE_CMD_MATERIALSPECULAR,
+	GE_CMD_MATERIALALPHA,
+	GE_CMD_MATERIALSPECULARCOEF,
+	GE_CMD_LIGHTTYPE0,
+	GE_CMD_LIGHTTYPE1,
+	GE_CMD_LIGHTTYPE2,
+	GE_CMD_LIGHTTYPE3,
+	GE_CMD_VIEWPORTXSCALE,
+	GE_CMD_VIEWPORTYSCALE,
+	GE_CMD_VIEWPORTZSCALE,
+	GE_CMD_VIEWPORTXCENTER,
+	GE_CMD_VIEWPORTYCENTER,
+	GE_CMD_VIEWPORTZCENTER,
+	GE_CMD_LIGHTENABLE0,
+	GE_CMD_LIGHTENABLE1,
+	GE_CMD_LIGHTENABLE2,
+	GE_CMD_LIGHTENABLE3,
+	GE_CMD_LIGHTMODE,
+	GE_CMD_PATCHDIVISION,
+	GE_CMD_MATERIALUPDATE,
+	GE_CMD_CLEARMODE,
+	GE_CMD_ALPHABLENDENABLE,
+	GE_CMD_BLENDMODE,
+	GE_CMD_BLENDFIXEDA,
+	GE_CMD_BLENDFIXEDB,
+	GE_CMD_ALPHATESTENABLE,
+	GE_CMD_ALPHATEST,
+	GE_CMD_TEXFUNC,
+	GE_CMD_TEXFILTER,
+	GE_CMD_ZTESTENABLE,
+	GE_CMD_STENCILTESTENABLE,
+	GE_CMD_ZTEST,
+	GE_CMD_DITH0,
+	GE_CMD_DITH1,
+	GE_CMD_DITH2,
+	GE_CMD_DITH3,
+};
+
 SoftGPU::SoftGPU()
 {
 	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
@@ -99,6 +198,13 @@ SoftGPU::SoftGPU()
 	displayFramebuf_ = 0;
 	displayStride_ = 512;
 	displayFormat_ = GE_FORMAT_8888;
+
+	SetExecuteOpFlags(storeOnlyCommands, ARRAY_SIZE(storeOnlyCommands));
+}
+
+void SoftGPU::BeginFrame()
+{
+	dlCache_.Decimate();
 }
 
 void SoftGPU::DeviceLost() {
@@ -284,7 +390,18 @@ void SoftGPU::ProcessEvent(GPUEvent ev) {
 
 void SoftGPU::FastRunLoop(DisplayList &list) {
 	PROFILE_THIS_SCOPE("soft_runloop");
-	for (; downcount > 0; --downcount) {
+	const bool useCache = g_Config.bDisplayListCache;
+	bool lookup = useCache;
+	while (downcount > 0) {
+		if (lookup) {
+			lookup = false;
+			const DisplayListSegment *seg = dlCache_.Lookup(list.pc, downcount);
+			if (seg) {
+				ReplaySegment(list, *seg);
+				continue;
+			}
+		}
+
 		u32 op = Memory::ReadUnchecked_U32(list.pc);
 		u32 cmd = op >> 24;
 
@@ -293,6 +410,8 @@ void SoftGPU::FastRunLoop(DisplayList &list) {
 		ExecuteOp(op, diff);
 
 		list.pc += 4;
+		--downcount;
+		lookup = useCache && dlCache_.EndsSegment(cmd);
 	}
 }
 
@@ -810,7 +929,7 @@ void SoftGPU::UpdateStats()
 
 void SoftGPU::InvalidateCache(u32 addr, int size, GPUInvalidationType type)
 {
-	// Nothing to invalidate.
+	dlCache_.Invalidate(addr, size);
 }
 
 void SoftGPU::NotifyVideoUpload(u32 addr, int size, int width, int format)
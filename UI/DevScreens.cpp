@@ -33,6 +33,9 @@
 #include "Core/Config.h"
 #include "Core/System.h"
 #include "Core/CoreParameter.h"
+#include "Core/Replay.h"
+#include "Core/SaveState.h"
+#include "Core/ELF/ParamSFO.h"
 #include "Core/MIPS/MIPSTables.h"
 #include "Core/MIPS/JitCommon/NativeJit.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
@@ -74,6 +77,7 @@ void DevMenu::CreatePopupContents(UI::ViewGroup *parent) {
 	items->Add(new Choice(dev->T("Toggle Freeze")))->OnClick.Handle(this, &DevMenu::OnFreezeFrame);
 	items->Add(new Choice(dev->T("Dump Frame GPU Commands")))->OnClick.Handle(this, &DevMenu::OnDumpFrame);
 	items->Add(new Choice(dev->T("Toggle Audio Debug")))->OnClick.Handle(this, &DevMenu::OnToggleAudioDebug);
+	items->Add(new Choice(dev->T(ReplayIsRecording() ? "Stop Recording Replay" : "Record Replay")))->OnClick.Handle(this, &DevMenu::OnRecordReplay);
 #ifdef USE_PROFILER
 	items->Add(new CheckBox(&g_Config.bShowFrameProfiler, dev->T("Frame Profiler"), ""));
 #endif
@@ -139,6 +143,18 @@ UI::EventReturn DevMenu::OnDumpFrame(UI::EventParams &e) {
 	return UI::EVENT_DONE;
 }
 
+UI::EventReturn DevMenu::OnRecordReplay(UI::EventParams &e) {
+	// Play it back with: PPSSPPHeadless game.iso --state=ID_replay.ppst --replay=ID.replay
+	const std::string prefix = GetSysDirectory(DIRECTORY_SAVESTATE) + g_paramSFO.GetValueString("DISC_ID");
+	if (ReplayIsRecording()) {
+		ReplayFinishRecording(prefix + ".replay");
+	} else {
+		SaveState::SaveForReplay(prefix + "_replay.ppst");
+	}
+	screenManager()->finishDialog(this, DR_OK);
+	return UI::EVENT_DONE;
+}
+
 void DevMenu::dialogFinished(const Screen *dialog, DialogResult result) {
 	UpdateUIState(UISTATE_INGAME);
 	// Close when a subscreen got closed.
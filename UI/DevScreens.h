@@ -44,6 +44,7 @@ class DevMenu : public PopupScreen {
 	UI::EventReturn OnDumpFrame(UI::EventParams &e);
 	UI::EventReturn OnDeveloperTools(UI::EventParams &e);
 	UI::EventReturn OnToggleAudioDebug(UI::EventParams &e);
+	UI::EventReturn OnRecordReplay(UI::EventParams &e);
 };
 
 class LogConfigScreen : public UIDialogScreenWithBackground {
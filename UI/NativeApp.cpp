@@ -71,6 +71,7 @@
 #include "Core/Config.h"
 #include "Core/Core.h"
 #include "Core/FileLoaders/DiskCachingFileLoader.h"
+#include "Core/FileLoaders/ReadTrace.h"
 #include "Core/Host.h"
 #include "Core/SaveState.h"
 #include "Core/Screenshot.h"
@@ -507,6 +508,7 @@ void NativeInit(int argc, const char *argv[], const char *savegame_dir, const ch
 
 	if (cache_dir && strlen(cache_dir)) {
 		DiskCachingFileLoaderCache::SetCacheDir(cache_dir);
+		ReadTrace::SetTraceDir(cache_dir);
 		g_Config.appCacheDirectory = cache_dir;
 	}
 }
@@ -189,6 +189,7 @@ EXEC_AND_LIB_FILES := \
   $(SRC)/GPU/Common/TextureCacheCommon.cpp.arm \
   $(SRC)/GPU/Common/TextureScalerCommon.cpp.arm \
   $(SRC)/GPU/Common/SplineCommon.cpp.arm \
+  $(SRC)/GPU/Common/DisplayListCache.cpp \
   $(SRC)/GPU/Common/DrawEngineCommon.cpp.arm \
   $(SRC)/GPU/Common/TransformCommon.cpp.arm \
   $(SRC)/GPU/Common/TextureDecoder.cpp \
@@ -241,9 +242,12 @@ EXEC_AND_LIB_FILES := \
   $(SRC)/Core/FileLoaders/HTTPFileLoader.cpp \
   $(SRC)/Core/FileLoaders/LocalFileLoader.cpp \
   $(SRC)/Core/FileLoaders/RamCachingFileLoader.cpp \
+  $(SRC)/Core/FileLoaders/ReadTrace.cpp \
   $(SRC)/Core/FileLoaders/RetryingFileLoader.cpp \
   $(SRC)/Core/MemMap.cpp \
+  $(SRC)/Core/MemSnapshot.cpp \
   $(SRC)/Core/MemMapFunctions.cpp \
+  $(SRC)/Core/Replay.cpp \
   $(SRC)/Core/Reporting.cpp \
   $(SRC)/Core/SaveState.cpp \
   $(SRC)/Core/Screenshot.cpp \
@@ -402,7 +406,9 @@ ifeq ($(HEADLESS),1)
   LOCAL_MODULE := ppsspp_headless
   LOCAL_SRC_FILES := \
     $(SRC)/headless/Headless.cpp \
-    $(SRC)/headless/Compare.cpp
+    $(SRC)/headless/Bench.cpp \
+    $(SRC)/headless/Compare.cpp \
+    $(SRC)/headless/TestQueue.cpp
 
   include $(BUILD_EXECUTABLE)
 endif
@@ -484,6 +490,22 @@ ifeq ($(UNITTEST),1)
     $(SRC)/Core/MIPS/MIPSAsm.cpp \
     $(SRC)/unittest/JitHarness.cpp \
     $(SRC)/unittest/TestVertexJit.cpp \
+    $(SRC)/unittest/TestSoftwareTransform.cpp \
+    $(SRC)/unittest/TestSplineCommon.cpp \
+    $(SRC)/unittest/TestIndexGenerator.cpp \
+    $(SRC)/unittest/TestShaderCache.cpp \
+    $(SRC)/unittest/TestThreadPool.cpp \
+    $(SRC)/unittest/TestDiskCachingFileLoader.cpp \
+    $(SRC)/unittest/TestReadTrace.cpp \
+    $(SRC)/unittest/TestThreadEventQueue.cpp \
+    $(SRC)/unittest/TestReplay.cpp \
+    $(SRC)/unittest/TestDirectoryCaseCache.cpp \
+    $(SRC)/unittest/TestDisplayListCache.cpp \
+    $(SRC)/unittest/TestISOFileSystem.cpp \
+    $(SRC)/unittest/TestHTTPFileLoader.cpp \
+    $(SRC)/unittest/TestMetaFileSystem.cpp \
+    $(SRC)/unittest/TestMemSnapshot.cpp \
+    $(SRC)/unittest/TestChunkFile.cpp \
     $(TESTARMEMITTER_FILE) \
     $(SRC)/unittest/UnitTest.cpp
 
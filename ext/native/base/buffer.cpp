@@ -228,6 +228,13 @@ int Buffer::Read(int fd, size_t sz) {
 	return (int)received;
 }
 
+int Buffer::ReadSome(int fd, size_t sz) {
+	size_t old_size = data_.size();
+	int retval = recv(fd, Append(sz), (int)sz, 0);
+	data_.resize(old_size + std::max(retval, 0));
+	return retval;
+}
+
 void Buffer::PeekAll(std::string *dest) {
 	dest->resize(data_.size());
 	memcpy(&(*dest)[0], &data_[0], data_.size());
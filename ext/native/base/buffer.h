@@ -72,6 +72,11 @@ class Buffer {
 	// < 0: error
 	// >= 0: number of bytes read
   int Read(int fd, size_t sz);
+	// Reads whatever has arrived, up to sz bytes, waiting only if nothing has.
+	// < 0: error
+	// 0: connection closed
+	// > 0: number of bytes read
+	int ReadSome(int fd, size_t sz);
 
   // Utilities. Try to avoid checking for size.
   size_t size() const { return data_.size(); }
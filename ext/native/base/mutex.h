@@ -268,8 +268,20 @@ class condition_variable {
 #endif
 	}
 
-	// notify_all is not really possible to implement with win32 events?
-	// Can be done just fine using WakeAllConditionVariable though.
+	void notify_all() {
+#ifdef _WIN32
+#ifdef _M_X64
+		WakeAllConditionVariable(&cond_);
+#else
+		// Should be locked at this time.  Might wake more than needed, like wait() says.
+		if (waiting_ != 0) {
+			ReleaseSemaphore(sema_, waiting_, NULL);
+		}
+#endif
+#else
+		pthread_cond_broadcast(&event_);
+#endif
+	}
 
 	void wait(recursive_mutex &mtx) {
 		// broken http://msdn.microsoft.com/en-us/library/windows/desktop/ms686301(v=vs.85).aspx
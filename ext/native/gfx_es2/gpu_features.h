@@ -56,6 +56,7 @@ struct GLExtensions {
 	bool ARB_conservative_depth;
 	bool ARB_copy_image;
 	bool ARB_vertex_array_object;
+	bool ARB_get_program_binary;
 
 	// EXT
 	bool EXT_swap_control_tear;
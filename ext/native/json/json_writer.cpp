@@ -17,7 +17,7 @@ void JsonWriter::end() {
 }
 
 const char *JsonWriter::indent(int n) const {
-	static const char * const whitespace = "															";
+	static const char * const whitespace = "                                ";
 	return whitespace + (32 - n);
 }
 
@@ -14,6 +14,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <algorithm>
 
 #include "base/logging.h"
 #include "base/buffer.h"
@@ -111,6 +112,7 @@ namespace http {
 Client::Client() {
 	httpVersion_ = "1.1";
 	userAgent_ = USERAGENT;
+	keepAlive_ = false;
 }
 
 Client::~Client() {
@@ -211,7 +213,7 @@ int Client::SendRequestWithData(const char *method, const char *resource, const
 		"%s %s HTTP/%s\r\n"
 		"Host: %s\r\n"
 		"User-Agent: %s\r\n"
-		"Connection: close\r\n"
+		"Connection: %s\r\n"
 		"%s"
 		"\r\n";
 
@@ -219,6 +221,7 @@ int Client::SendRequestWithData(const char *method, const char *resource, const
 		method, resource, httpVersion_,
 		host_.c_str(),
 		userAgent_,
+		keepAlive_ ? "keep-alive" : "close",
 		otherHeaders ? otherHeaders : "");
 	buffer.Append(data);
 	bool flushed = buffer.FlushSocket(sock());
@@ -228,17 +231,60 @@ int Client::SendRequestWithData(const char *method, const char *resource, const
 	return 0;
 }
 
-int Client::ReadResponseHeaders(Buffer *readbuf, std::vector<std::string> &responseHeaders, float *progress) {
-	// Snarf all the data we can into RAM. A little unsafe but hey.
-	if (readbuf->Read(sock(), 4096) < 0) {
-		ELOG("Failed to read HTTP headers :(");
-		return -1;
+// Reads from the socket only until there's a full line, anything after it is left in readbuf.
+static int ReadLineCRLF(uintptr_t sock, Buffer *readbuf, std::string *line) {
+	while (readbuf->OffsetToAfterNextCRLF() < 0) {
+		if (readbuf->ReadSome((int)sock, 4096) <= 0) {
+			return -1;
+		}
 	}
+	return readbuf->TakeLineCRLF(line);
+}
 
-	// Grab the first header line that contains the http code.
+// Dechunks straight from the socket, stopping after the last chunk and its trailers so that
+// anything after it (like the next response on a kept-alive connection) is left in readbuf.
+static int ReadChunkedEntity(uintptr_t sock, Buffer *readbuf, Buffer *output) {
+	std::string line;
+	while (true) {
+		if (ReadLineCRLF(sock, readbuf, &line) < 0) {
+			return -1;
+		}
+		// Any chunk extensions after the size are ignored.
+		int chunkSize = 0;
+		if (sscanf(line.c_str(), "%x", &chunkSize) != 1 || chunkSize < 0) {
+			return -1;
+		}
+		if (chunkSize == 0) {
+			break;
+		}
+		// Each chunk's data is followed by a CRLF.
+		while (readbuf->size() < (size_t)chunkSize + 2) {
+			size_t remaining = chunkSize + 2 - readbuf->size();
+			if (readbuf->ReadSome((int)sock, std::min(remaining, (size_t)65536)) <= 0) {
+				return -1;
+			}
+		}
+		readbuf->Take(chunkSize, output->Append((size_t)chunkSize));
+		readbuf->Skip(2);
+	}
+
+	// The trailers end with an empty line.
+	do {
+		if (ReadLineCRLF(sock, readbuf, &line) < 0) {
+			return -1;
+		}
+	} while (!line.empty());
+	return 0;
+}
 
+int Client::ReadResponseHeaders(Buffer *readbuf, std::vector<std::string> &responseHeaders, float *progress) {
+	// Grab the first header line that contains the http code.
+	// Don't read past the headers, with keep-alive the connection won't close after the response.
 	std::string line;
-	readbuf->TakeLineCRLF(&line);
+	if (ReadLineCRLF(sock(), readbuf, &line) < 0) {
+		ELOG("Failed to read HTTP headers :(");
+		return -1;
+	}
 
 	int code;
 	size_t code_pos = line.find(' ');
@@ -253,7 +299,9 @@ int Client::ReadResponseHeaders(Buffer *readbuf, std::vector<std::string> &respo
 	}
 
 	while (true) {
-		int sz = readbuf->TakeLineCRLF(&line);
+		int sz = ReadLineCRLF(sock(), readbuf, &line);
+		if (sz < 0)
+			return -1;
 		if (!sz)
 			break;
 		responseHeaders.push_back(line);
@@ -269,6 +317,7 @@ int Client::ReadResponseHeaders(Buffer *readbuf, std::vector<std::string> &respo
 int Client::ReadResponseEntity(Buffer *readbuf, const std::vector<std::string> &responseHeaders, Buffer *output, float *progress) {
 	bool gzip = false;
 	bool chunked = false;
+	bool hasContentLength = false;
 	int contentLength = 0;
 	for (std::string line : responseHeaders) {
 		if (startsWithNoCase(line, "Content-Length:")) {
@@ -278,6 +327,7 @@ int Client::ReadResponseEntity(Buffer *readbuf, const std::vector<std::string> &
 			}
 			if (size_pos != line.npos) {
 				contentLength = atoi(&line[size_pos]);
+				hasContentLength = true;
 				chunked = false;
 			}
 		} else if (startsWithNoCase(line, "Content-Encoding:")) {
@@ -299,7 +349,18 @@ int Client::ReadResponseEntity(Buffer *readbuf, const std::vector<std::string> &
 		*progress = 0.1f;
 	}
 
-	if (!contentLength || !progress) {
+	if (keepAlive_ && chunked) {
+		// The connection stays open, so only read up to the last chunk.
+		if (ReadChunkedEntity(sock(), readbuf, output) < 0)
+			return -1;
+	} else if (keepAlive_ && hasContentLength) {
+		// The connection stays open, so read exactly the entity and leave anything after it.
+		while ((int)readbuf->size() < contentLength) {
+			size_t remaining = contentLength - readbuf->size();
+			if (readbuf->ReadSome(sock(), std::min(remaining, (size_t)65536)) <= 0)
+				return -1;
+		}
+	} else if (!contentLength || !progress) {
 		// No way to know how far along we are. Let's just not update the progress counter.
 		if (!readbuf->ReadAll(sock(), contentLength))
 			return -1;
@@ -310,8 +371,12 @@ int Client::ReadResponseEntity(Buffer *readbuf, const std::vector<std::string> &
 	}
 
 	// output now contains the rest of the reply. Dechunk it.
-	if (chunked) {
+	if (keepAlive_ && chunked) {
+		// Already dechunked while reading.
+	} else if (chunked) {
 		DeChunk(readbuf, output, contentLength, progress);
+	} else if (keepAlive_ && hasContentLength) {
+		readbuf->Take(contentLength, output->Append((size_t)contentLength));
 	} else {
 		output->Append(*readbuf);
 	}
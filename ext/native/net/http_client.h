@@ -72,6 +72,10 @@ class Client : public net::Connection {
 
 	const char *userAgent_;
 	const char *httpVersion_;
+	// Asks the server to keep the connection open for more requests.  Responses must then
+	// be read with the same readbuf, since it may already hold the start of the next one.
+	// A response with neither a Content-Length nor chunks still ends when the server closes.
+	bool keepAlive_;
 };
 
 // Not particularly efficient, but hey - it's a background download, that's pretty cool :P
@@ -178,3 +178,8 @@ void Profiler_GetHistory(int category, float *data, int count) {
 		data[i] = history[x].time_taken[category];
 	}
 }
+
+float Profiler_GetLastFrameTime(int category) {
+	int pos = (profiler.historyPos - 1) & (HISTORY_SIZE - 1);
+	return history[pos].time_taken[category];
+}
@@ -19,6 +19,8 @@ const char *Profiler_GetCategoryName(int i);
 int Profiler_GetNumCategories();
 int Profiler_GetHistoryLength();
 void Profiler_GetHistory(int i, float *data, int count);
+// Time spent in a category during the last frame that ended.
+float Profiler_GetLastFrameTime(int i);
 
 class ProfileThis {
 public:
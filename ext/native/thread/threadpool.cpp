@@ -3,10 +3,9 @@
 
 ///////////////////////////// WorkerThread
 
-WorkerThread::WorkerThread() : active(true), started(false) {
+WorkerThread::WorkerThread() : active(true), started(false), jobsDone(0), jobsTarget(0) {
+	// No need to wait for the thread to start, work submitted before then is counted and not lost.
 	thread = new std::thread(std::bind(&WorkerThread::WorkFunc, this));
-	doneMutex.lock();
-	while(!started) { };
 }
 
 WorkerThread::~WorkerThread() {
@@ -21,55 +20,50 @@ WorkerThread::~WorkerThread() {
 void WorkerThread::Process(const std::function<void()>& work) {
 	mutex.lock();
 	work_ = work;
+	jobsTarget++;
 	signal.notify_one();
 	mutex.unlock();
 }
 
 void WorkerThread::WaitForCompletion() {
-	done.wait(doneMutex);
+	// Only the submitting thread changes jobsTarget, so it's safe to read here.
+	doneMutex.lock();
+	while (jobsDone != jobsTarget) {
+		done.wait(doneMutex);
+	}
+	doneMutex.unlock();
 }
 
 void WorkerThread::WorkFunc() {
+	RunWorkLoop();
+}
+
+void WorkerThread::RunWorkLoop() {
 	mutex.lock();
 	started = true;
+	int handled = 0;
 	while (active) {
-		signal.wait(mutex);
-		if (active) {
-			work_();
-			doneMutex.lock();
-			done.notify_one();
-			doneMutex.unlock();
+		if (handled == jobsTarget) {
+			signal.wait(mutex);
+			continue;
 		}
+		work_();
+		handled++;
+		doneMutex.lock();
+		jobsDone = handled;
+		done.notify_one();
+		doneMutex.unlock();
 	}
+	mutex.unlock();
 }
 
 LoopWorkerThread::LoopWorkerThread() : WorkerThread(true) {
-	thread = new std::thread(std::bind(&LoopWorkerThread::WorkFunc, this));
-	doneMutex.lock();
-	while(!started) { };
+	// Not through the virtual WorkFunc, the object may still be under construction.
+	thread = new std::thread(std::bind(&LoopWorkerThread::RunWorkLoop, this));
 }
 
 void LoopWorkerThread::Process(const std::function<void(int, int)> &work, int start, int end) {
-	mutex.lock();
-	work_ = work;
-	start_ = start;
-	end_ = end;
-	signal.notify_one();
-	mutex.unlock();
-}
-
-void LoopWorkerThread::WorkFunc() {
-	mutex.lock();
-	started = true;
-	while (active) {
-		signal.wait(mutex);
-		if (active) {
-			work_(start_, end_);
-			doneMutex.lock();
-			done.notify_one();
-			doneMutex.unlock();
-		}
-	}
+	WorkerThread::Process(std::bind(work, start, end));
 }
 
 ///////////////////////////// ThreadPool
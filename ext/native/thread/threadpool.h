@@ -14,18 +14,23 @@ class WorkerThread {
 
 	// submit a new work item
 	void Process(const std::function<void()>& work);
-	// wait for a submitted work item to be completed
+	// wait for a submitted work item to be completed, must be called from the thread that submitted it
 	void WaitForCompletion();
 
 protected:
-	WorkerThread(bool ignored) : active(true), started(false) {}
+	WorkerThread(bool ignored) : active(true), started(false), jobsDone(0), jobsTarget(0) {}
 	virtual void WorkFunc();
+	// runs until the thread is stopped, calling the work once for each submitted item
+	void RunWorkLoop();
 
 	std::thread *thread; // the worker thread
 	::condition_variable signal; // used to signal new work
 	::condition_variable done; // used to signal work completion
 	::recursive_mutex mutex, doneMutex; // associated with each respective condition variable
 	volatile bool active, started;
+	// Counted rather than just signalled, so a wakeup can't be lost or mistaken for another
+	// item's. jobsTarget is guarded by mutex, jobsDone by doneMutex.
+	int jobsDone, jobsTarget;
 
 private:
 	std::function<void()> work_; // the work to be done by this thread
@@ -38,14 +43,6 @@ class LoopWorkerThread : public WorkerThread {
 public:
 	LoopWorkerThread();
 	void Process(const std::function<void(int, int)> &work, int start, int end);
-
-protected:
-	virtual void WorkFunc();
-
-private:
-	int start_;
-	int end_;
-	std::function<void(int, int)> work_; // the work to be done by this thread
 };
 
 // A thread pool manages a set of worker threads, and allows the execution of parallel loops on them
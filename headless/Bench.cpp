@@ -0,0 +1,207 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "base/basictypes.h"
+#include "base/stringutil.h"
+#include "base/timeutil.h"
+#include "file/file_util.h"
+#include "json/json_writer.h"
+#include "profiler/profiler.h"
+#include "headless/Bench.h"
+
+static const char *subsystemNames[BENCH_SUBSYSTEM_COUNT] = {
+	"cpu",
+	"hle",
+	"gpu",
+	"draw",
+	"texture",
+	"audio",
+	"other",
+};
+
+#ifdef USE_PROFILER
+static const struct {
+	const char *category;
+	BenchSubsystem subsystem;
+} categoryMap[] = {
+	{ "jit", BENCH_CPU },
+	{ "jitc", BENCH_CPU },
+	{ "advance", BENCH_CPU },
+	{ "syscall", BENCH_HLE },
+	{ "io_rw", BENCH_HLE },
+	{ "gpuloop", BENCH_GPU },
+	{ "soft_runloop", BENCH_GPU },
+	{ "flush", BENCH_DRAW },
+	{ "draw_tri", BENCH_DRAW },
+	{ "applydrawstate", BENCH_DRAW },
+	{ "vertdec", BENCH_DRAW },
+	{ "bezier", BENCH_DRAW },
+	{ "spline", BENCH_DRAW },
+	{ "shadercomp", BENCH_DRAW },
+	{ "shaderlink", BENCH_DRAW },
+	{ "decodetex", BENCH_TEXTURE },
+	{ "loadtex", BENCH_TEXTURE },
+	{ "repltex", BENCH_TEXTURE },
+	{ "mixer", BENCH_AUDIO },
+};
+
+static BenchSubsystem SubsystemForCategory(const char *name) {
+	for (size_t i = 0; i < ARRAY_SIZE(categoryMap); ++i) {
+		if (!strcmp(categoryMap[i].category, name)) {
+			return categoryMap[i].subsystem;
+		}
+	}
+	return BENCH_OTHER;
+}
+#endif
+
+void FrameBench::BeginFrame() {
+	// Whatever ran between frames isn't counted.
+	PROFILE_END_FRAME();
+	frameStart_ = real_time_now();
+}
+
+void FrameBench::EndFrame() {
+	Frame frame;
+	frame.total = real_time_now() - frameStart_;
+	memset(frame.subsystems, 0, sizeof(frame.subsystems));
+
+	double accounted = 0.0;
+#ifdef USE_PROFILER
+	PROFILE_END_FRAME();
+	// Categories don't count time spent in nested ones, so they add up.
+	for (int i = 0; i < Profiler_GetNumCategories(); ++i) {
+		BenchSubsystem subsystem = SubsystemForCategory(Profiler_GetCategoryName(i));
+		if (subsystem != BENCH_OTHER) {
+			double t = Profiler_GetLastFrameTime(i);
+			frame.subsystems[subsystem] += t;
+			accounted += t;
+		}
+	}
+#endif
+	frame.subsystems[BENCH_OTHER] = std::max(0.0, frame.total - accounted);
+	frames_.push_back(frame);
+}
+
+std::vector<double> FrameBench::Column(int subsystem) const {
+	std::vector<double> values;
+	values.reserve(frames_.size());
+	for (size_t i = 0; i < frames_.size(); ++i) {
+		values.push_back(subsystem < 0 ? frames_[i].total : frames_[i].subsystems[subsystem]);
+	}
+	return values;
+}
+
+static double Percentile(std::vector<double> values, double p) {
+	if (values.empty()) {
+		return 0.0;
+	}
+	std::sort(values.begin(), values.end());
+	size_t index = (size_t)(p * (values.size() - 1) + 0.5);
+	return values[index];
+}
+
+static double Mean(const std::vector<double> &values) {
+	double sum = 0.0;
+	for (size_t i = 0; i < values.size(); ++i) {
+		sum += values[i];
+	}
+	return values.empty() ? 0.0 : sum / values.size();
+}
+
+bool FrameBench::Write(const std::string &filename, const std::string &title) const {
+	if (endsWithNoCase(filename, ".csv")) {
+		return WriteCSV(filename);
+	}
+	return WriteJSON(filename, title);
+}
+
+bool FrameBench::WriteCSV(const std::string &filename) const {
+	FILE *f = fopen(filename.c_str(), "w");
+	if (!f) {
+		return false;
+	}
+
+	fprintf(f, "frame,total_ms");
+	for (int s = 0; s < BENCH_SUBSYSTEM_COUNT; ++s) {
+		fprintf(f, ",%s_ms", subsystemNames[s]);
+	}
+	fprintf(f, "\n");
+	for (size_t i = 0; i < frames_.size(); ++i) {
+		fprintf(f, "%d,%0.4f", (int)i, frames_[i].total * 1000.0);
+		for (int s = 0; s < BENCH_SUBSYSTEM_COUNT; ++s) {
+			fprintf(f, ",%0.4f", frames_[i].subsystems[s] * 1000.0);
+		}
+		fprintf(f, "\n");
+	}
+	fclose(f);
+	return true;
+}
+
+bool FrameBench::WriteJSON(const std::string &filename, const std::string &title) const {
+	JsonWriter writer;
+	writer.begin();
+	writer.writeString("title", title.c_str());
+	writer.writeInt("frames", (int)frames_.size());
+#ifdef USE_PROFILER
+	writer.writeBool("profiler", true);
+#else
+	writer.writeBool("profiler", false);
+#endif
+
+	// Columns rather than rows, which is also easier to plot.
+	writer.pushDict("summary_ms");
+	for (int s = -1; s < BENCH_SUBSYSTEM_COUNT; ++s) {
+		std::vector<double> values = Column(s);
+		writer.pushDict(s < 0 ? "total" : subsystemNames[s]);
+		writer.writeFloat("mean", Mean(values) * 1000.0);
+		writer.writeFloat("p50", Percentile(values, 0.5) * 1000.0);
+		writer.writeFloat("p95", Percentile(values, 0.95) * 1000.0);
+		writer.writeFloat("max", Percentile(values, 1.0) * 1000.0);
+		writer.pop();
+	}
+	writer.pop();
+
+	writer.pushDict("frame_ms");
+	for (int s = -1; s < BENCH_SUBSYSTEM_COUNT; ++s) {
+		std::vector<double> values = Column(s);
+		writer.pushArray(s < 0 ? "total" : subsystemNames[s]);
+		for (size_t i = 0; i < values.size(); ++i) {
+			writer.writeFloat(values[i] * 1000.0);
+		}
+		writer.pop();
+	}
+	writer.pop();
+	writer.end();
+
+	return writeStringToFile(true, writer.str(), filename.c_str());
+}
+
+void FrameBench::PrintSummary() const {
+	std::vector<double> total = Column(-1);
+	printf("Bench: %d frames, %0.3f ms mean, %0.3f ms p50, %0.3f ms p95, %0.3f ms max\n", (int)total.size(),
+		Mean(total) * 1000.0, Percentile(total, 0.5) * 1000.0, Percentile(total, 0.95) * 1000.0, Percentile(total, 1.0) * 1000.0);
+	printf("Bench: mean ms per frame:");
+	for (int s = 0; s < BENCH_SUBSYSTEM_COUNT; ++s) {
+		printf(" %s %0.3f", subsystemNames[s], Mean(Column(s)) * 1000.0);
+	}
+	printf("\n");
+}
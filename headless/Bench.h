@@ -0,0 +1,64 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+enum BenchSubsystem {
+	BENCH_CPU,
+	BENCH_HLE,
+	BENCH_GPU,
+	BENCH_DRAW,
+	BENCH_TEXTURE,
+	BENCH_AUDIO,
+	BENCH_OTHER,
+
+	BENCH_SUBSYSTEM_COUNT,
+};
+
+// Wall time per emulated frame, split by subsystem using the profiler categories.
+// Without USE_PROFILER, everything counts as other.
+class FrameBench {
+public:
+	FrameBench() : frameStart_(0.0) {}
+
+	void BeginFrame();
+	void EndFrame();
+
+	// Picks CSV or JSON by extension.
+	bool Write(const std::string &filename, const std::string &title) const;
+	void PrintSummary() const;
+
+	size_t Frames() const {
+		return frames_.size();
+	}
+
+private:
+	struct Frame {
+		double total;
+		double subsystems[BENCH_SUBSYSTEM_COUNT];
+	};
+
+	bool WriteCSV(const std::string &filename) const;
+	bool WriteJSON(const std::string &filename, const std::string &title) const;
+	std::vector<double> Column(int subsystem) const;
+
+	std::vector<Frame> frames_;
+	double frameStart_;
+};
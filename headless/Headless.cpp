@@ -2,6 +2,7 @@
 // See headless.txt.
 // To build on non-windows systems, just run CMake in the SDL directory, it will build both a normal ppsspp and the headless version.
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <limits>
@@ -15,6 +16,7 @@
 #include "Core/System.h"
 #include "Core/HLE/sceUtility.h"
 #include "Core/Host.h"
+#include "Core/Replay.h"
 #include "Core/SaveState.h"
 #include "Log.h"
 #include "LogManager.h"
@@ -22,8 +24,10 @@
 #include "input/input_state.h"
 #include "base/timeutil.h"
 
+#include "Bench.h"
 #include "Compare.h"
 #include "StubHost.h"
+#include "TestQueue.h"
 #ifdef _WIN32
 #include "Windows/GPU/WindowsGLContext.h"
 #include "WindowsHeadlessHost.h"
@@ -85,13 +89,20 @@ PermissionStatus System_GetPermissionStatus(SystemPermission permission) { retur
 
 InputState input_state;
 
+static const char *replayToRecord = 0;
+static const char *replayToPlay = 0;
+static bool replayFromState = false;
+static int benchFrames = 0;
+static const char *benchOutput = 0;
+
 int printUsage(const char *progname, const char *reason)
 {
 	if (reason != NULL)
 		fprintf(stderr, "Error: %s\n\n", reason);
 	fprintf(stderr, "PPSSPP Headless\n");
 	fprintf(stderr, "This is primarily meant as a non-interactive test tool.\n\n");
-	fprintf(stderr, "Usage: %s file.elf... [options]\n\n", progname);
+	fprintf(stderr, "Usage: %s file.elf... [options]\n", progname);
+	fprintf(stderr, "       %s @tests.txt [options], or @- to read the list from stdin\n\n", progname);
 	fprintf(stderr, "Options:\n");
 	fprintf(stderr, "  -m, --mount umd.cso   mount iso on umd1:\n");
 	fprintf(stderr, "  -r, --root some/path  mount path on host0: (elfs must be in here)\n");
@@ -105,11 +116,20 @@ int printUsage(const char *progname, const char *reason)
 	}
 #endif
 	fprintf(stderr, "  --timeout=SECONDS     abort test it if takes longer than SECONDS\n");
+	fprintf(stderr, "  --state=FILE          load a save state before running\n");
+	fprintf(stderr, "  --record=FILE         record input and async timing, from --state or boot\n");
+	fprintf(stderr, "  --replay=FILE         play back a recording, and stop where it ended\n");
+	fprintf(stderr, "  --bench=FRAMES        run FRAMES frames as fast as possible, and time each\n");
+	fprintf(stderr, "  --bench-output=FILE   write the frame times as .json or .csv\n");
+	fprintf(stderr, "  --no-dlcache          don't cache decoded display lists, to compare\n");
 
 	fprintf(stderr, "  -v, --verbose         show the full passed/failed result\n");
 	fprintf(stderr, "  -i                    use the interpreter\n");
 	fprintf(stderr, "  -j                    use jit (default)\n");
 	fprintf(stderr, "  -c, --compare         compare with output in file.expected\n");
+	fprintf(stderr, "  --jobs=N              run each test in its own process, N at once\n");
+	fprintf(stderr, "  --cache=FILE          skip tests that passed before and haven't changed\n");
+	fprintf(stderr, "  --junit=FILE          write JUnit style results, with times\n");
 	fprintf(stderr, "\nSee headless.txt for details.\n");
 
 	return 1;
@@ -133,6 +153,30 @@ static HeadlessHost *getHost(GPUCore gpuCore) {
 	}
 }
 
+static void StartReplay(bool status, void *cbUserData)
+{
+	if (!status)
+		fprintf(stderr, "Failed to load state, replay not started\n");
+	else if (replayToPlay && !ReplayBeginPlayback(replayToPlay))
+		fprintf(stderr, "Failed to start replay %s\n", replayToPlay);
+	else if (replayToRecord)
+		ReplayBeginRecording();
+}
+
+// Runs until that exact tick, flipping whenever the game does.
+static void RunUntilTicks(HeadlessHost *headlessHost, u64 ticks)
+{
+	while (coreState == CORE_RUNNING && CoreTiming::GetTicks() < ticks)
+	{
+		PSP_RunLoopUntil(ticks);
+		if (coreState == CORE_NEXTFRAME)
+		{
+			coreState = CORE_RUNNING;
+			headlessHost->SwapBuffers();
+		}
+	}
+}
+
 bool RunAutoTest(HeadlessHost *headlessHost, CoreParameter &coreParameter, bool autoCompare, bool verbose, double timeout)
 {
 	if (teamCityMode) {
@@ -155,6 +199,8 @@ bool RunAutoTest(HeadlessHost *headlessHost, CoreParameter &coreParameter, bool
 	TeamCityPrint("##teamcity[testStarted name='%s' captureStandardOutput='true']\n", teamCityName.c_str());
 
 	host->BootDone();
+	if (!replayFromState)
+		StartReplay(true, 0);
 
 	if (autoCompare)
 		headlessHost->SetComparisonScreenshot(ExpectedScreenshotFromFilename(coreParameter.fileToStart));
@@ -166,16 +212,38 @@ bool RunAutoTest(HeadlessHost *headlessHost, CoreParameter &coreParameter, bool
 	static double deadline;
 	deadline = time_now() + timeout;
 
+	FrameBench bench;
+	u64 benchTicks = 0;
+	if (benchFrames > 0)
+	{
+		// Get any --state loaded now, so it doesn't count as part of the first frame.
+		SaveState::Process();
+		benchTicks = CoreTiming::GetTicks();
+	}
+
 	coreState = CORE_RUNNING;
 	while (coreState == CORE_RUNNING)
 	{
-		int blockTicks = usToCycles(1000000 / 10);
-		PSP_RunLoopFor(blockTicks);
+		if (benchFrames > 0)
+		{
+			// Frames are fixed spans of emulated time, so runs compare even if the game doesn't flip every vblank.
+			benchTicks += usToCycles(1001000 / 60);
+			bench.BeginFrame();
+			RunUntilTicks(headlessHost, benchTicks);
+			bench.EndFrame();
+			if ((int)bench.Frames() >= benchFrames)
+				Core_Stop();
+		}
+		else
+		{
+			int blockTicks = usToCycles(1000000 / 10);
+			PSP_RunLoopFor(blockTicks);
 
-		// If we were rendering, this might be a nice time to do something about it.
-		if (coreState == CORE_NEXTFRAME) {
-			coreState = CORE_RUNNING;
-			headlessHost->SwapBuffers();
+			// If we were rendering, this might be a nice time to do something about it.
+			if (coreState == CORE_NEXTFRAME) {
+				coreState = CORE_RUNNING;
+				headlessHost->SwapBuffers();
+			}
 		}
 		time_update();
 		if (time_now_d() > deadline) {
@@ -187,6 +255,26 @@ bool RunAutoTest(HeadlessHost *headlessHost, CoreParameter &coreParameter, bool
 			TeamCityPrint("##teamcity[testFailed name='%s' message='Test timeout']\n", teamCityName.c_str());
 			Core_Stop();
 		}
+		// Stop on exactly the tick the recording did.
+		if (replayToPlay && ReplayIsFinished())
+			Core_Stop();
+	}
+
+	if (replayToRecord && !ReplayFinishRecording(replayToRecord))
+		fprintf(stderr, "Failed to write replay %s\n", replayToRecord);
+	if (replayToPlay && !ReplayIsFinished())
+	{
+		fprintf(stderr, "Replay %s did not play back to the end\n", replayToPlay);
+		passed = false;
+	}
+
+	if (benchFrames > 0)
+	{
+		if ((int)bench.Frames() < benchFrames)
+			fprintf(stderr, "Only ran %d of %d frames\n", (int)bench.Frames(), benchFrames);
+		bench.PrintSummary();
+		if (benchOutput && !bench.Write(benchOutput, GetTestName(coreParameter.fileToStart)))
+			fprintf(stderr, "Failed to write %s\n", benchOutput);
 	}
 
 	PSP_Shutdown();
@@ -215,6 +303,7 @@ int main(int argc, const char* argv[])
 	bool useJit = true;
 	bool autoCompare = false;
 	bool verbose = false;
+	bool useDisplayListCache = true;
 	const char *stateToLoad = 0;
 	GPUCore gpuCore = GPU_NULL;
 	
@@ -224,8 +313,12 @@ int main(int argc, const char* argv[])
 	const char *screenshotFilename = 0;
 	float timeout = std::numeric_limits<float>::infinity();
 
+	TestQueueOptions queueOptions;
+	bool useQueue = false;
 	for (int i = 1; i < argc; i++)
 	{
+		const int argStart = i;
+		bool passThrough = true;
 		if (!strcmp(argv[i], "-m") || !strcmp(argv[i], "--mount"))
 		{
 			if (++i >= argc)
@@ -273,25 +366,87 @@ int main(int argc, const char* argv[])
 			teamCityMode = true;
 		else if (!strncmp(argv[i], "--state=", strlen("--state=")) && strlen(argv[i]) > strlen("--state="))
 			stateToLoad = argv[i] + strlen("--state=");
+		else if (!strncmp(argv[i], "--bench=", strlen("--bench=")) && strlen(argv[i]) > strlen("--bench="))
+			benchFrames = atoi(argv[i] + strlen("--bench="));
+		else if (!strncmp(argv[i], "--bench-output=", strlen("--bench-output=")) && strlen(argv[i]) > strlen("--bench-output="))
+			benchOutput = argv[i] + strlen("--bench-output=");
+		else if (!strcmp(argv[i], "--no-dlcache"))
+			useDisplayListCache = false;
+		else if (!strncmp(argv[i], "--record=", strlen("--record=")) && strlen(argv[i]) > strlen("--record="))
+			replayToRecord = argv[i] + strlen("--record=");
+		else if (!strncmp(argv[i], "--replay=", strlen("--replay=")) && strlen(argv[i]) > strlen("--replay="))
+			replayToPlay = argv[i] + strlen("--replay=");
+		else if (!strncmp(argv[i], "--jobs=", strlen("--jobs=")) && strlen(argv[i]) > strlen("--jobs="))
+		{
+			queueOptions.jobs = std::max(1, atoi(argv[i] + strlen("--jobs=")));
+			useQueue = true;
+			passThrough = false;
+		}
+		else if (!strncmp(argv[i], "--cache=", strlen("--cache=")) && strlen(argv[i]) > strlen("--cache="))
+		{
+			queueOptions.cacheFilename = argv[i] + strlen("--cache=");
+			useQueue = true;
+			passThrough = false;
+		}
+		else if (!strncmp(argv[i], "--junit=", strlen("--junit=")) && strlen(argv[i]) > strlen("--junit="))
+		{
+			queueOptions.junitFilename = argv[i] + strlen("--junit=");
+			useQueue = true;
+			passThrough = false;
+		}
 		else if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h"))
 			return printUsage(argv[0], NULL);
 		else
+		{
 			testFilenames.push_back(argv[i]);
+			passThrough = false;
+		}
+
+		if (passThrough)
+		{
+			for (int j = argStart; j <= i; ++j)
+				queueOptions.args.push_back(argv[j]);
+		}
 	}
 
-	// TODO: Allow a filename here?
-	if (testFilenames.size() == 1 && testFilenames[0] == "@-")
+	if (testFilenames.size() == 1 && testFilenames[0].size() > 1 && testFilenames[0][0] == '@')
 	{
+		// A list of tests, from stdin or a file.
+		const std::string listFilename = testFilenames[0].substr(1);
+		FILE *list = listFilename == "-" ? stdin : File::OpenCFile(listFilename, "r");
+		if (!list)
+			return printUsage(argv[0], "Unable to read the list of tests");
+
 		testFilenames.clear();
 		char temp[2048];
 		temp[2047] = '\0';
 
-		while (scanf("%2047s", temp) == 1)
+		while (fscanf(list, "%2047s", temp) == 1)
 			testFilenames.push_back(temp);
+		if (list != stdin)
+			fclose(list);
 	}
 
 	if (testFilenames.empty())
 		return printUsage(argv[0], argc <= 1 ? NULL : "No executables specified");
+	if ((replayToRecord || replayToPlay) && testFilenames.size() != 1)
+		return printUsage(argv[0], "Replays need exactly one executable");
+	if (benchOutput && benchFrames <= 0)
+		return printUsage(argv[0], "--bench-output needs --bench=FRAMES");
+	if (benchFrames > 0 && testFilenames.size() != 1)
+		return printUsage(argv[0], "Benchmarks need exactly one executable");
+	if (replayToRecord && replayToPlay)
+		return printUsage(argv[0], "Can't record and play back a replay at once");
+
+	if (useQueue)
+	{
+		if (!autoCompare)
+			return printUsage(argv[0], "--jobs, --cache, and --junit need --compare");
+		queueOptions.exe = argv[0];
+		if (timeout != std::numeric_limits<float>::infinity())
+			queueOptions.timeout = timeout;
+		return RunTestQueue(queueOptions, testFilenames) == 0 ? 0 : 1;
+	}
 
 	HeadlessHost *headlessHost = getHost(gpuCore);
 	host = headlessHost;
@@ -343,6 +498,7 @@ int main(int argc, const char* argv[])
 	g_Config.iAnisotropyLevel = 8;
 #endif
 	g_Config.bVertexCache = true;
+	g_Config.bDisplayListCache = useDisplayListCache;
 	g_Config.bTrueColor = true;
 	g_Config.iLanguage = PSP_SYSTEMPARAM_LANGUAGE_ENGLISH;
 	g_Config.iTimeFormat = PSP_SYSTEMPARAM_TIME_FORMAT_24HR;
@@ -393,8 +549,10 @@ int main(int argc, const char* argv[])
 	}
 #endif
 
-	if (stateToLoad != NULL)
-		SaveState::Load(stateToLoad);
+	if (stateToLoad != NULL) {
+		SaveState::Load(stateToLoad, &StartReplay);
+		replayFromState = true;
+	}
 
 	std::vector<std::string> failedTests;
 	std::vector<std::string> passedTests;
@@ -438,5 +596,6 @@ int main(int argc, const char* argv[])
 	moncleanup();
 #endif
 
-	return 0;
+	// So scripts, and --jobs, can tell.
+	return failedTests.empty() ? 0 : 1;
 }
@@ -0,0 +1,480 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+
+#ifdef _WIN32
+#include "Common/CommonWindows.h"
+#include "util/text/utf8.h"
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "base/timeutil.h"
+#include "file/file_util.h"
+#include "thread/thread.h"
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+#include "Common/StdMutex.h"
+#include "Common/StringUtils.h"
+#include "Core/Config.h"
+#include "ext/xxhash.h"
+#include "headless/Compare.h"
+#include "headless/TestQueue.h"
+
+struct TestResult {
+	TestResult() : hash(0), passed(false), cached(false), seconds(0.0) {}
+
+	std::string filename;
+	std::string name;
+	u64 hash;
+	bool passed;
+	bool cached;
+	double seconds;
+	std::string output;
+};
+
+struct CachedResult {
+	u64 hash;
+	double seconds;
+};
+
+// How much longer than its --timeout a test gets to start up and exit, before it's killed.
+static const double TEST_KILL_GRACE = 10.0;
+// Without --timeout, a test that runs this long has surely hung.
+static const double TEST_KILL_DEFAULT = 300.0;
+
+class TestQueue {
+public:
+	TestQueue(const TestQueueOptions &options, std::vector<TestResult> &results)
+		: options_(options), results_(results), next_(0) {
+	}
+
+	void Run();
+
+private:
+	void WorkerFunc();
+	void RunTest(TestResult &result);
+
+	const TestQueueOptions &options_;
+	std::vector<TestResult> &results_;
+	std::mutex lock_;
+	size_t next_;
+};
+
+// Children must only inherit their own pipe, so nothing else starts one while it's being set up.
+static std::mutex childLock;
+
+#ifdef _WIN32
+static std::string QuoteArg(const std::string &arg) {
+	return "\"" + arg + "\"";
+}
+
+static bool RunChild(const std::vector<std::string> &args, double deadline, std::string &output, bool &killed) {
+	std::string cmdline;
+	for (size_t i = 0; i < args.size(); ++i) {
+		cmdline += (i == 0 ? "" : " ") + QuoteArg(args[i]);
+	}
+	std::wstring wcmdline = ConvertUTF8ToWString(cmdline);
+
+	SECURITY_ATTRIBUTES sa = { sizeof(sa), NULL, TRUE };
+	STARTUPINFOW si = { sizeof(si) };
+	PROCESS_INFORMATION pi;
+	HANDLE readPipe, writePipe;
+	BOOL started = FALSE;
+	{
+		std::lock_guard<std::mutex> guard(childLock);
+		if (CreatePipe(&readPipe, &writePipe, &sa, 0)) {
+			SetHandleInformation(readPipe, HANDLE_FLAG_INHERIT, 0);
+			si.dwFlags = STARTF_USESTDHANDLES;
+			si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+			si.hStdOutput = writePipe;
+			si.hStdError = writePipe;
+			started = CreateProcessW(NULL, &wcmdline[0], NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi);
+			CloseHandle(writePipe);
+			if (!started)
+				CloseHandle(readPipe);
+		}
+	}
+	if (!started) {
+		output += "Unable to run test\n";
+		return false;
+	}
+
+	// Read on another thread, so this one can wait for the deadline.
+	std::thread reader([&] {
+		char buf[4096];
+		DWORD bytes;
+		while (ReadFile(readPipe, buf, sizeof(buf), &bytes, NULL) && bytes > 0) {
+			output.append(buf, bytes);
+		}
+	});
+
+	DWORD waitMs = (DWORD)std::max(0.0, (deadline - real_time_now()) * 1000.0);
+	if (WaitForSingleObject(pi.hProcess, waitMs) == WAIT_TIMEOUT) {
+		TerminateProcess(pi.hProcess, 1);
+		WaitForSingleObject(pi.hProcess, INFINITE);
+		killed = true;
+	}
+	reader.join();
+
+	DWORD exitCode = 1;
+	GetExitCodeProcess(pi.hProcess, &exitCode);
+	CloseHandle(readPipe);
+	CloseHandle(pi.hProcess);
+	CloseHandle(pi.hThread);
+	return !killed && exitCode == 0;
+}
+#else
+static bool RunChild(const std::vector<std::string> &args, double deadline, std::string &output, bool &killed) {
+	// Built before forking, only exec is safe in the child.
+	std::vector<char *> argv;
+	for (size_t i = 0; i < args.size(); ++i) {
+		argv.push_back(const_cast<char *>(args[i].c_str()));
+	}
+	argv.push_back(nullptr);
+
+	int fds[2];
+	pid_t pid = -1;
+	{
+		std::lock_guard<std::mutex> guard(childLock);
+		if (pipe(fds) == 0) {
+			fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+			fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+			pid = fork();
+			if (pid == 0) {
+				// Its own group, so a kill gets anything it started too, and the pipe closes.
+				setpgid(0, 0);
+				dup2(fds[1], STDOUT_FILENO);
+				dup2(fds[1], STDERR_FILENO);
+				execv(argv[0], &argv[0]);
+				_exit(127);
+			}
+			close(fds[1]);
+			if (pid < 0)
+				close(fds[0]);
+			else
+				setpgid(pid, pid);
+		}
+	}
+	if (pid < 0) {
+		output += "Unable to run test\n";
+		return false;
+	}
+
+	char buf[4096];
+	for (;;) {
+		int waitMs = -1;
+		if (!killed) {
+			double left = deadline - real_time_now();
+			if (left <= 0.0) {
+				kill(-pid, SIGKILL);
+				killed = true;
+			} else {
+				waitMs = (int)(left * 1000.0) + 1;
+			}
+		}
+
+		pollfd pfd = { fds[0], POLLIN, 0 };
+		int ready = poll(&pfd, 1, waitMs);
+		if (ready == 0 || (ready < 0 && errno == EINTR)) {
+			continue;
+		}
+		ssize_t bytes = read(fds[0], buf, sizeof(buf));
+		if (bytes < 0 && errno == EINTR) {
+			continue;
+		}
+		// Once it's gone (or killed), the pipe closes.
+		if (bytes <= 0) {
+			break;
+		}
+		output.append(buf, bytes);
+	}
+	close(fds[0]);
+
+	int status = 0;
+	while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+		continue;
+	}
+	return !killed && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+#endif
+
+// Started from the PATH, argv[0] is only a name.  Then it's the running executable we want.
+static std::string ResolveExe(const std::string &exe) {
+	if (File::Exists(exe)) {
+		return exe;
+	}
+
+	std::string name = exe;
+	size_t slash = name.find_last_of("/\\");
+	if (slash != name.npos) {
+		name = name.substr(slash + 1);
+	}
+#ifdef _WIN32
+	if (!endsWithNoCase(name, ".exe")) {
+		name += ".exe";
+	}
+#endif
+	std::string path = File::GetExeDirectory() + name;
+	return File::Exists(path) ? path : exe;
+}
+
+// Leaves the hash alone if the file can't be read.
+static bool HashFile(const std::string &filename, u64 &hash) {
+	std::string data;
+	if (!readFileToString(false, filename.c_str(), data)) {
+		return false;
+	}
+	hash = XXH64(data.data(), data.size(), hash);
+	return true;
+}
+
+void TestQueue::Run() {
+	std::vector<std::thread> workers;
+	for (int i = 0; i < options_.jobs; ++i) {
+		workers.push_back(std::thread(std::bind(&TestQueue::WorkerFunc, this)));
+	}
+	for (size_t i = 0; i < workers.size(); ++i) {
+		workers[i].join();
+	}
+}
+
+void TestQueue::WorkerFunc() {
+	for (;;) {
+		TestResult *result;
+		{
+			std::lock_guard<std::mutex> guard(lock_);
+			while (next_ < results_.size() && results_[next_].cached) {
+				++next_;
+			}
+			if (next_ >= results_.size()) {
+				return;
+			}
+			result = &results_[next_++];
+		}
+
+		RunTest(*result);
+
+		// Whole outputs at once, so they don't get mixed together.
+		std::lock_guard<std::mutex> guard(lock_);
+		printf("%s:\n%s", result->filename.c_str(), result->output.c_str());
+		fflush(stdout);
+	}
+}
+
+void TestQueue::RunTest(TestResult &result) {
+	std::vector<std::string> args;
+	args.push_back(options_.exe);
+	args.insert(args.end(), options_.args.begin(), options_.args.end());
+	args.push_back(result.filename);
+
+	// It should give up on its own at --timeout, but if it hangs, it mustn't hold up the rest.
+	double allowed = options_.timeout > 0.0 ? options_.timeout + TEST_KILL_GRACE : TEST_KILL_DEFAULT;
+	double st = real_time_now();
+	bool killed = false;
+	result.passed = RunChild(args, st + allowed, result.output, killed);
+	result.seconds = real_time_now() - st;
+	if (killed) {
+		result.output += StringFromFormat("Killed after %0.1f seconds, it seems to have hung\n", result.seconds);
+	}
+}
+
+static void LoadCache(const std::string &filename, std::map<std::string, CachedResult> &cache) {
+	FILE *f = fopen(filename.c_str(), "r");
+	if (!f) {
+		return;
+	}
+
+	char line[2048];
+	while (fgets(line, sizeof(line), f)) {
+		unsigned long long hash;
+		double seconds;
+		int pos = 0;
+		if (sscanf(line, "%llx %lf %n", &hash, &seconds, &pos) >= 2 && pos > 0) {
+			std::string test = line + pos;
+			while (!test.empty() && (test.back() == '\n' || test.back() == '\r')) {
+				test.pop_back();
+			}
+			CachedResult cached = { (u64)hash, seconds };
+			cache[test] = cached;
+		}
+	}
+	fclose(f);
+}
+
+static void SaveCache(const std::string &filename, const std::vector<TestResult> &results) {
+	FILE *f = fopen(filename.c_str(), "w");
+	if (!f) {
+		fprintf(stderr, "Unable to write test cache %s\n", filename.c_str());
+		return;
+	}
+	// Only passes: a failure, even a flaky timeout, should always run again.
+	for (size_t i = 0; i < results.size(); ++i) {
+		if (results[i].passed) {
+			fprintf(f, "%016llx %0.4f %s\n", (unsigned long long)results[i].hash, results[i].seconds, results[i].filename.c_str());
+		}
+	}
+	fclose(f);
+}
+
+static std::string XMLEscape(const std::string &s) {
+	std::string escaped;
+	for (size_t i = 0; i < s.size(); ++i) {
+		switch (s[i]) {
+		case '&': escaped += "&amp;"; break;
+		case '<': escaped += "&lt;"; break;
+		case '>': escaped += "&gt;"; break;
+		case '"': escaped += "&quot;"; break;
+		default:
+			// Control characters aren't allowed in XML 1.0.
+			if ((unsigned char)s[i] >= 0x20 || s[i] == '\n' || s[i] == '\t')
+				escaped += s[i];
+			break;
+		}
+	}
+	return escaped;
+}
+
+static void WriteJUnit(const std::string &filename, const std::vector<TestResult> &results, double seconds) {
+	FILE *f = fopen(filename.c_str(), "w");
+	if (!f) {
+		fprintf(stderr, "Unable to write %s\n", filename.c_str());
+		return;
+	}
+
+	int failures = 0;
+	for (size_t i = 0; i < results.size(); ++i) {
+		failures += results[i].passed ? 0 : 1;
+	}
+
+	fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+	fprintf(f, "<testsuite name=\"pspautotests\" tests=\"%d\" failures=\"%d\" time=\"%0.3f\">\n", (int)results.size(), failures, seconds);
+	for (size_t i = 0; i < results.size(); ++i) {
+		const TestResult &result = results[i];
+		// cpu/cpu_alu/cpu_alu -> classname cpu.cpu_alu, name cpu_alu.
+		std::string classname = result.name;
+		std::string name = result.name;
+		size_t slash = classname.find_last_of('/');
+		if (slash != classname.npos) {
+			name = classname.substr(slash + 1);
+			classname = classname.substr(0, slash);
+		}
+		std::replace(classname.begin(), classname.end(), '/', '.');
+
+		fprintf(f, "  <testcase classname=\"%s\" name=\"%s\" time=\"%0.3f\"", XMLEscape(classname).c_str(), XMLEscape(name).c_str(), result.seconds);
+		if (result.passed && !result.cached) {
+			fprintf(f, "/>\n");
+		} else if (result.passed) {
+			// The time is from the run that was cached.
+			fprintf(f, ">\n    <system-out>Cached, unchanged since it passed</system-out>\n  </testcase>\n");
+		} else {
+			fprintf(f, ">\n    <failure message=\"Test failed\">%s</failure>\n  </testcase>\n", XMLEscape(result.output).c_str());
+		}
+	}
+	fprintf(f, "</testsuite>\n");
+	fclose(f);
+}
+
+int RunTestQueue(const TestQueueOptions &originalOptions, const std::vector<std::string> &tests) {
+	TestQueueOptions options = originalOptions;
+	options.exe = ResolveExe(originalOptions.exe);
+
+	// Anything that could change the results: the emulator, and how it's run.
+	u64 baseHash = XXH64(PPSSPP_GIT_VERSION, strlen(PPSSPP_GIT_VERSION), 0);
+	if (!HashFile(options.exe, baseHash) && !options.cacheFilename.empty()) {
+		// Otherwise a rebuild would keep skipping tests that now fail.
+		fprintf(stderr, "Unable to read %s to hash it, not using --cache\n", options.exe.c_str());
+		options.cacheFilename.clear();
+	}
+	for (size_t i = 0; i < options.args.size(); ++i) {
+		baseHash = XXH64(options.args[i].c_str(), options.args[i].size() + 1, baseHash);
+	}
+
+	std::map<std::string, CachedResult> cache;
+	if (!options.cacheFilename.empty()) {
+		LoadCache(options.cacheFilename, cache);
+	}
+
+	std::vector<TestResult> results(tests.size());
+	int cachedCount = 0;
+	for (size_t i = 0; i < tests.size(); ++i) {
+		TestResult &result = results[i];
+		result.filename = tests[i];
+		result.name = GetTestName(tests[i]);
+		result.hash = baseHash;
+		HashFile(tests[i], result.hash);
+		HashFile(ExpectedFromFilename(tests[i]), result.hash);
+
+		auto cached = cache.find(tests[i]);
+		if (cached != cache.end() && cached->second.hash == result.hash) {
+			result.passed = true;
+			result.cached = true;
+			result.seconds = cached->second.seconds;
+			cachedCount++;
+		}
+	}
+
+	double st = real_time_now();
+	TestQueue queue(options, results);
+	queue.Run();
+	double seconds = real_time_now() - st;
+
+	std::vector<const TestResult *> failed;
+	std::vector<const TestResult *> byTime;
+	for (size_t i = 0; i < results.size(); ++i) {
+		if (!results[i].passed)
+			failed.push_back(&results[i]);
+		if (!results[i].cached)
+			byTime.push_back(&results[i]);
+	}
+
+	printf("%d tests passed, %d tests failed, %d skipped as unchanged, in %0.2f seconds.\n", (int)(results.size() - failed.size() - cachedCount), (int)failed.size(), cachedCount, seconds);
+	if (!failed.empty()) {
+		printf("Failed tests:\n");
+		for (size_t i = 0; i < failed.size(); ++i) {
+			printf("  %s\n", failed[i]->name.c_str());
+		}
+	}
+
+	std::sort(byTime.begin(), byTime.end(), [](const TestResult *a, const TestResult *b) {
+		return a->seconds > b->seconds;
+	});
+	if (!byTime.empty()) {
+		printf("Slowest tests:\n");
+		for (size_t i = 0; i < byTime.size() && i < 10; ++i) {
+			printf("  %0.2fs %s\n", byTime[i]->seconds, byTime[i]->name.c_str());
+		}
+	}
+
+	if (!options.cacheFilename.empty()) {
+		SaveCache(options.cacheFilename, results);
+	}
+	if (!options.junitFilename.empty()) {
+		WriteJUnit(options.junitFilename, results, seconds);
+	}
+	return (int)failed.size();
+}
@@ -0,0 +1,40 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct TestQueueOptions {
+	TestQueueOptions() : jobs(1), timeout(0.0) {}
+
+	// This executable, which runs each test.  Just argv[0] is fine, even if it came from the PATH.
+	std::string exe;
+	// Passed to every test, e.g. --compare and --timeout.
+	std::vector<std::string> args;
+	int jobs;
+	// The --timeout passed along, or 0 if none.  A test still running a while after that gets killed.
+	double timeout;
+	// Tests that passed with the same binary, expected output, and emulator build are skipped.
+	std::string cacheFilename;
+	// JUnit style XML results, with the time each test took.
+	std::string junitFilename;
+};
+
+// Runs each test in its own headless process, several at once.  Returns the number that failed.
+int RunTestQueue(const TestQueueOptions &options, const std::vector<std::string> &tests);
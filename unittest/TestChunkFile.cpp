@@ -0,0 +1,212 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "base/timeutil.h"
+#include "file/file_util.h"
+#include "Common/ChunkFile.h"
+#include "Common/FileUtil.h"
+#include "unittest/UnitTest.h"
+
+// Shaped roughly like a real state: lots of small values, a few strings, and big memory.
+struct FakeState {
+	std::vector<u32> values;
+	std::vector<std::string> names;
+	std::vector<u8> ram;
+
+	void DoState(PointerWrap &p) {
+		auto s = p.Section("FakeState", 1);
+		if (!s)
+			return;
+
+		DoValues(p);
+		for (size_t i = 0; i < names.size(); ++i) {
+			p.Do(names[i]);
+		}
+		DoRam(p);
+		p.DoMarker("FakeState");
+	}
+
+	void DoValues(PointerWrap &p) {
+		auto s = p.Section("Values", 1);
+		if (!s)
+			return;
+
+		for (size_t i = 0; i < values.size(); ++i) {
+			p.Do(values[i]);
+		}
+	}
+
+	void DoRam(PointerWrap &p) {
+		auto s = p.Section("Ram", 1);
+		if (!s)
+			return;
+
+		p.DoArray(&ram[0], (int)ram.size());
+	}
+};
+
+struct FakeValuesOnly {
+	FakeState *state;
+
+	void DoState(PointerWrap &p) {
+		state->DoValues(p);
+	}
+};
+
+// What older versions wrote: one snappy blob for the whole state.
+static bool WriteOldFile(const std::string &filename, const std::vector<u8> &state) {
+	size_t compressedSize = snappy_max_compressed_length(state.size());
+	std::vector<char> compressed(compressedSize);
+	snappy_compress((const char *)&state[0], state.size(), &compressed[0], &compressedSize);
+
+	// Revision, compress, compressed size, uncompressed size, git version, title.
+	u32 header[4] = { 5, 1, (u32)compressedSize, (u32)state.size() };
+	char version[32] = "v0.9";
+	char title[128] = "Old title";
+	FILE *f = File::OpenCFile(filename, "wb");
+	if (!f)
+		return false;
+	bool success = fwrite(header, sizeof(header), 1, f) == 1 && fwrite(version, sizeof(version), 1, f) == 1;
+	success = success && fwrite(title, sizeof(title), 1, f) == 1 && fwrite(&compressed[0], compressedSize, 1, f) == 1;
+	fclose(f);
+	return success;
+}
+
+static void FillState(FakeState &state, size_t ramSize, u32 seed) {
+	srand(seed);
+	state.values.resize(20000);
+	for (size_t i = 0; i < state.values.size(); ++i) {
+		state.values[i] = rand() & 0xFF;
+	}
+	state.names.resize(100);
+	for (size_t i = 0; i < state.names.size(); ++i) {
+		char temp[64];
+		snprintf(temp, sizeof(temp), "kernel object %d", rand());
+		state.names[i] = temp;
+	}
+	state.ram.resize(ramSize);
+	for (size_t i = 0; i < state.ram.size(); ++i) {
+		state.ram[i] = (i & 0x100) ? (u8)rand() : (u8)(i >> 12);
+	}
+}
+
+static std::vector<u8> Flatten(const PointerWrapBuffer &buffer) {
+	std::vector<u8> flat;
+	for (size_t i = 0; i < buffer.BlockCount(); ++i) {
+		flat.insert(flat.end(), buffer.Block(i), buffer.Block(i) + buffer.BlockSize(i));
+	}
+	return flat;
+}
+
+bool TestChunkFile() {
+	FakeState state;
+	FillState(state, 32 * 1024 * 1024 + 123, 1);
+
+	// The old way: measure, then write.
+	double st = real_time_now();
+	size_t sz = CChunkFileReader::MeasurePtr(state);
+	std::vector<u8> twoPass(sz);
+	EXPECT_TRUE(CChunkFileReader::SavePtr(&twoPass[0], state) == CChunkFileReader::ERROR_NONE);
+	double twoPassTime = real_time_now() - st;
+
+	st = real_time_now();
+	PointerWrapBuffer buffer;
+	EXPECT_TRUE(CChunkFileReader::SaveBuffer(buffer, state) == CChunkFileReader::ERROR_NONE);
+	double onePassTime = real_time_now() - st;
+
+	EXPECT_EQ_INT((int)buffer.Size(), (int)sz);
+	EXPECT_TRUE(Flatten(buffer) == twoPass);
+
+	const std::string filename = "unittest_chunkfile.ppst";
+	st = real_time_now();
+	EXPECT_TRUE(CChunkFileReader::SaveFile(filename, "Test title", "v1.0", buffer) == CChunkFileReader::ERROR_NONE);
+	double writeTime = real_time_now() - st;
+
+	std::string title;
+	EXPECT_TRUE(CChunkFileReader::GetFileTitle(filename, &title) == CChunkFileReader::ERROR_NONE);
+	EXPECT_EQ_STR(title, std::string("Test title"));
+
+	// The index lists every section, outer ones first.
+	std::vector<PointerWrapBuffer::Section> sections;
+	EXPECT_TRUE(CChunkFileReader::GetFileSections(filename, &sections) == CChunkFileReader::ERROR_NONE);
+	EXPECT_EQ_INT((int)sections.size(), 3);
+	EXPECT_EQ_STR(std::string(sections[0].title), std::string("FakeState"));
+	EXPECT_EQ_INT(sections[0].depth, 0);
+	EXPECT_EQ_INT(sections[0].start, 0);
+	EXPECT_EQ_INT(sections[0].end, (int)sz);
+	EXPECT_EQ_STR(std::string(sections[2].title), std::string("Ram"));
+	EXPECT_EQ_INT(sections[2].depth, 1);
+
+	// And loads back.
+	FakeState loaded;
+	FillState(loaded, state.ram.size(), 2);
+	std::string reason;
+	st = real_time_now();
+	EXPECT_TRUE(CChunkFileReader::Load(filename, "v1.0", loaded, &reason) == CChunkFileReader::ERROR_NONE);
+	double loadTime = real_time_now() - st;
+	EXPECT_TRUE(loaded.values == state.values);
+	EXPECT_TRUE(loaded.names == state.names);
+	EXPECT_TRUE(loaded.ram == state.ram);
+
+	// One section can be pulled out by itself, and read with its own DoState.
+	std::vector<u8> sectionData;
+	EXPECT_TRUE(CChunkFileReader::LoadFileSection(filename, "Values", sectionData) == CChunkFileReader::ERROR_NONE);
+	EXPECT_EQ_INT((int)sectionData.size(), (int)(sections[1].end - sections[1].start));
+	FillState(loaded, 16, 3);
+	FakeValuesOnly valuesOnly = { &loaded };
+	EXPECT_TRUE(CChunkFileReader::LoadPtr(&sectionData[0], valuesOnly) == CChunkFileReader::ERROR_NONE);
+	EXPECT_TRUE(loaded.values == state.values);
+	EXPECT_TRUE(CChunkFileReader::LoadFileSection(filename, "Missing", sectionData) != CChunkFileReader::ERROR_NONE);
+
+	// A damaged chunk is caught, rather than loading garbage.
+	std::string contents;
+	EXPECT_TRUE(readFileToString(false, filename.c_str(), contents));
+	contents[contents.size() - 1000] ^= 0x20;
+	EXPECT_TRUE(writeStringToFile(false, contents, filename.c_str()));
+	EXPECT_TRUE(CChunkFileReader::Load(filename, "v1.0", loaded, &reason) == CChunkFileReader::ERROR_BAD_FILE);
+
+	// Files from older versions still load.
+	EXPECT_TRUE(WriteOldFile(filename, twoPass));
+	EXPECT_TRUE(CChunkFileReader::GetFileTitle(filename, &title) == CChunkFileReader::ERROR_NONE);
+	EXPECT_EQ_STR(title, std::string("Old title"));
+	EXPECT_TRUE(CChunkFileReader::GetFileSections(filename, &sections) == CChunkFileReader::ERROR_BAD_FILE);
+	FillState(loaded, state.ram.size(), 4);
+	st = real_time_now();
+	EXPECT_TRUE(CChunkFileReader::Load(filename, "v1.0", loaded, &reason) == CChunkFileReader::ERROR_NONE);
+	double oldLoadTime = real_time_now() - st;
+	EXPECT_TRUE(loaded.values == state.values);
+	EXPECT_TRUE(loaded.ram == state.ram);
+	File::Delete(filename);
+
+	// Empty states work too.
+	PointerWrapBuffer empty;
+	EXPECT_EQ_INT((int)empty.Size(), 0);
+	EXPECT_TRUE(CChunkFileReader::SaveFile(filename, "", "v1.0", empty) == CChunkFileReader::ERROR_NONE);
+	EXPECT_TRUE(CChunkFileReader::GetFileSections(filename, &sections) == CChunkFileReader::ERROR_NONE);
+	EXPECT_TRUE(sections.empty());
+	File::Delete(filename);
+
+	printf("ChunkFile: measure + save %0.2f ms, single pass %0.2f ms, compress + write %0.2f ms\n", twoPassTime * 1000.0, onePassTime * 1000.0, writeTime * 1000.0);
+	printf("ChunkFile: load %0.2f ms, old format %0.2f ms\n", loadTime * 1000.0, oldLoadTime * 1000.0);
+	return true;
+}
@@ -0,0 +1,112 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Common/Common.h"
+#include "Common/FileUtil.h"
+#include "Core/FileSystems/DirectoryFileSystem.h"
+#include "unittest/UnitTest.h"
+
+// Must end with a slash, like the memstick path.
+static const char *const CASE_TEST_DIR = "unittest_casecache/";
+
+// Each file gets a different size, so lookups show which host file they found.
+static bool CreateSized(DirectoryFileSystem &fs, const std::string &path, int size) {
+	u32 handle = fs.OpenFile(path, (FileAccess)(FILEACCESS_WRITE | FILEACCESS_CREATE | FILEACCESS_TRUNCATE));
+	if ((s32)handle <= 0)
+		return false;
+	std::vector<u8> data(size, 0x55);
+	bool success = fs.WriteFile(handle, &data[0], size) == (size_t)size;
+	fs.CloseFile(handle);
+	return success;
+}
+
+static int SizeOf(DirectoryFileSystem &fs, const std::string &path) {
+	PSPFileInfo info = fs.GetFileInfo(path);
+	return info.exists ? (int)info.size : -1;
+}
+
+static int CountListed(DirectoryFileSystem &fs, const std::string &dir) {
+	return (int)fs.GetDirListing(dir).size();
+}
+
+// Names are compared exactly, this is how the game sees them.
+static bool Listed(DirectoryFileSystem &fs, const std::string &dir, const std::string &name) {
+	std::vector<PSPFileInfo> listing = fs.GetDirListing(dir);
+	for (size_t i = 0; i < listing.size(); ++i) {
+		if (listing[i].name == name)
+			return true;
+	}
+	return false;
+}
+
+bool TestDirectoryCaseCache() {
+	File::DeleteDirRecursively(CASE_TEST_DIR);
+	SequentialHandleAllocator handles;
+	DirectoryFileSystem fs(&handles, CASE_TEST_DIR);
+
+	EXPECT_TRUE(fs.MkDir("/PSP/SAVEDATA/Game"));
+	EXPECT_TRUE(CreateSized(fs, "/PSP/SAVEDATA/Game/Data.Bin", 10));
+	const int listedBase = CountListed(fs, "/PSP/SAVEDATA/Game");
+
+	// Any case finds it, and the directory (now cached) doesn't remember "missing" names.
+	EXPECT_EQ_INT(SizeOf(fs, "/psp/savedata/game/DATA.BIN"), 10);
+	EXPECT_EQ_INT(SizeOf(fs, "/psp/savedata/game/other.bin"), -1);
+	EXPECT_TRUE(CreateSized(fs, "/PSP/SAVEDATA/GAME/Other.BIN", 20));
+	EXPECT_EQ_INT(SizeOf(fs, "/psp/savedata/game/other.bin"), 20);
+	EXPECT_TRUE(Listed(fs, "/psp/savedata/game", "Other.BIN"));
+	EXPECT_EQ_INT(CountListed(fs, "/psp/savedata/game"), listedBase + 1);
+
+	// Renamed: the new name is found in any case, the old one is gone.
+	EXPECT_EQ_INT(fs.RenameFile("/psp/savedata/game/OTHER.bin", "/psp/savedata/game/Moved.bin"), 0);
+	EXPECT_EQ_INT(SizeOf(fs, "/PSP/SAVEDATA/GAME/MOVED.BIN"), 20);
+	EXPECT_EQ_INT(SizeOf(fs, "/PSP/SAVEDATA/GAME/OTHER.BIN"), -1);
+	EXPECT_TRUE(Listed(fs, "/psp/savedata/game", "Moved.bin"));
+	EXPECT_EQ_INT(CountListed(fs, "/psp/savedata/game"), listedBase + 1);
+
+	// Removed, then created again in another case: it keeps the new name.
+	EXPECT_TRUE(fs.RemoveFile("/psp/savedata/game/data.bin"));
+	EXPECT_EQ_INT(SizeOf(fs, "/PSP/SAVEDATA/GAME/DATA.BIN"), -1);
+	EXPECT_TRUE(CreateSized(fs, "/PSP/SAVEDATA/GAME/dATA.bIN", 30));
+	EXPECT_EQ_INT(SizeOf(fs, "/psp/savedata/game/data.bin"), 30);
+	EXPECT_TRUE(Listed(fs, "/psp/savedata/game", "dATA.bIN"));
+	// Writing to it in yet another case must not make a second file.
+	EXPECT_TRUE(CreateSized(fs, "/psp/savedata/game/DaTa.BiN", 40));
+	EXPECT_EQ_INT(SizeOf(fs, "/PSP/SAVEDATA/GAME/DATA.BIN"), 40);
+	EXPECT_EQ_INT(CountListed(fs, "/psp/savedata/game"), listedBase + 1);
+
+	// Changes made behind its back, like a save copied in, are seen too.
+	std::string hostDir;
+	EXPECT_TRUE(fs.GetHostPath("/PSP/SAVEDATA/Game/", hostDir));
+	File::IOFile external(hostDir + "ICON0.PNG", "wb");
+	EXPECT_TRUE(external.WriteArray("png", 3));
+	external.Close();
+	EXPECT_EQ_INT(SizeOf(fs, "/psp/savedata/game/icon0.png"), 3);
+
+	// Whole directories renamed keep finding what's inside.
+	EXPECT_EQ_INT(fs.RenameFile("/psp/savedata/game", "/psp/savedata/Game2"), 0);
+	EXPECT_EQ_INT(SizeOf(fs, "/psp/savedata/game2/moved.bin"), 20);
+	EXPECT_EQ_INT(SizeOf(fs, "/psp/savedata/game/moved.bin"), -1);
+	EXPECT_FALSE(fs.GetFileInfo("/PSP/SAVEDATA/GAME").exists);
+
+	File::DeleteDirRecursively(CASE_TEST_DIR);
+	return true;
+}
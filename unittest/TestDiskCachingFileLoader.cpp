@@ -0,0 +1,243 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "base/timeutil.h"
+#include "Common/Common.h"
+#include "Common/FileUtil.h"
+#include "Core/FileLoaders/DiskCachingFileLoader.h"
+#include "unittest/UnitTest.h"
+
+static const char *const CACHE_DIR = "unittest_diskcache";
+
+static u8 PatternByte(s64 pos) {
+	return (u8)((pos >> 9) ^ pos);
+}
+
+// Serves a made up image of any size, and counts what the cache asks of it.
+class FakeBackendFileLoader : public FileLoader {
+public:
+	FakeBackendFileLoader(const std::string &path, s64 size) : path_(path), size_(size), pos_(0), reads_(0) {
+	}
+
+	bool Exists() override {
+		return true;
+	}
+	bool IsDirectory() override {
+		return false;
+	}
+	s64 FileSize() override {
+		return size_;
+	}
+	std::string Path() const override {
+		return path_;
+	}
+
+	void Seek(s64 absolutePos) override {
+		pos_ = absolutePos;
+	}
+	size_t Read(size_t bytes, size_t count, void *data) override {
+		size_t read = ReadAt(pos_, bytes, count, data);
+		pos_ += read * bytes;
+		return read;
+	}
+	size_t ReadAt(s64 absolutePos, size_t bytes, size_t count, void *data) override {
+		return ReadAt(absolutePos, bytes * count, data) / bytes;
+	}
+	size_t ReadAt(s64 absolutePos, size_t bytes, void *data) override {
+		++*reads_;
+		if (absolutePos >= size_) {
+			return 0;
+		}
+		if (absolutePos + (s64)bytes > size_) {
+			bytes = (size_t)(size_ - absolutePos);
+		}
+		u8 *p = (u8 *)data;
+		for (size_t i = 0; i < bytes; ++i) {
+			p[i] = PatternByte(absolutePos + i);
+		}
+		return bytes;
+	}
+
+	// The cache owns the backend, so the count lives with the test.
+	void SetReadCounter(int *reads) {
+		reads_ = reads;
+	}
+
+private:
+	std::string path_;
+	s64 size_;
+	s64 pos_;
+	int *reads_;
+};
+
+static DiskCachingFileLoader *OpenLoader(const std::string &path, s64 size, int *reads) {
+	FakeBackendFileLoader *backend = new FakeBackendFileLoader(path, size);
+	backend->SetReadCounter(reads);
+	return new DiskCachingFileLoader(backend);
+}
+
+static bool ReadAndCheck(DiskCachingFileLoader *loader, s64 pos, size_t bytes) {
+	std::vector<u8> data(bytes);
+	EXPECT_EQ_INT((int)loader->ReadAt(pos, bytes, &data[0]), (int)bytes);
+	for (size_t i = 0; i < bytes; ++i) {
+		if (data[i] != PatternByte(pos + i)) {
+			printf("DiskCachingFileLoader: Wrong data at %lld\n", (long long)(pos + i));
+			return false;
+		}
+	}
+	return true;
+}
+
+static void RemoveCacheFile(const std::string &path) {
+	File::Delete(std::string(CACHE_DIR) + "/" + path + ".ppdc");
+}
+
+// Small images get the smallest blocks, an 8 MB one has 512 of them.
+static bool CheckTiers() {
+	const std::string path = "unittest_diskcache_small.iso";
+	const size_t blockSize = 16384;
+	RemoveCacheFile(path);
+	DiskCachingFileLoaderCache::SetRamTierSize(4 * blockSize);
+
+	int reads = 0;
+	DiskCachingFileLoader *loader = OpenLoader(path, 8 * 1024 * 1024, &reads);
+	if (!ReadAndCheck(loader, 0, 1))
+		return false;
+	DiskCachingFileLoaderStats stats = loader->GetStats();
+	if (stats.misses == 0) {
+		// Not enough free disk space to cache anything, nothing to test.
+		printf("DiskCachingFileLoader: Cache disabled, skipping\n");
+		delete loader;
+		return true;
+	}
+
+	// Block 0 was read above.  Each of these is read from the backend, one block at a time.
+	for (int i = 1; i < 8; ++i) {
+		if (!ReadAndCheck(loader, i * blockSize + 100, 200))
+			return false;
+	}
+	stats = loader->GetStats();
+	EXPECT_EQ_INT((int)stats.misses, 8);
+	EXPECT_EQ_INT((int)stats.backendBytes, (int)(8 * blockSize));
+	EXPECT_EQ_INT((int)stats.ramHits, 0);
+	EXPECT_EQ_INT((int)stats.diskHits, 0);
+	EXPECT_EQ_INT(reads, 8);
+
+	// The last four are still in RAM.
+	if (!ReadAndCheck(loader, 7 * blockSize, blockSize))
+		return false;
+	stats = loader->GetStats();
+	EXPECT_EQ_INT((int)stats.ramHits, 1);
+	EXPECT_EQ_INT((int)stats.diskHits, 0);
+
+	// The first one was pushed out of RAM, but it's on disk, and goes back into RAM.
+	if (!ReadAndCheck(loader, 0, blockSize))
+		return false;
+	stats = loader->GetStats();
+	EXPECT_EQ_INT((int)stats.diskHits, 1);
+	if (!ReadAndCheck(loader, 0, blockSize))
+		return false;
+	stats = loader->GetStats();
+	EXPECT_EQ_INT((int)stats.ramHits, 2);
+
+	// Across two blocks, both only on disk by now.
+	if (!ReadAndCheck(loader, 2 * blockSize - 10, 20))
+		return false;
+	stats = loader->GetStats();
+	EXPECT_EQ_INT((int)stats.diskHits, 3);
+	EXPECT_EQ_INT((int)stats.misses, 8);
+	EXPECT_EQ_INT(reads, 8);
+
+	// Make block 5 hot, so it's loaded into RAM the next time the image is opened.
+	for (int i = 0; i < 4; ++i) {
+		if (!ReadAndCheck(loader, 5 * blockSize, 16))
+			return false;
+	}
+	delete loader;
+
+	reads = 0;
+	loader = OpenLoader(path, 8 * 1024 * 1024, &reads);
+	double start = real_time_now();
+	while (loader->GetStats().prefetched == 0 && real_time_now() - start < 5.0) {
+		sleep_ms(1);
+	}
+	stats = loader->GetStats();
+	EXPECT_EQ_INT((int)stats.prefetched, 1);
+	if (!ReadAndCheck(loader, 5 * blockSize, blockSize) || !ReadAndCheck(loader, 6 * blockSize, blockSize))
+		return false;
+	stats = loader->GetStats();
+	EXPECT_EQ_INT((int)stats.ramHits, 1);
+	EXPECT_EQ_INT((int)stats.diskHits, 1);
+	EXPECT_EQ_INT((int)stats.misses, 0);
+	EXPECT_EQ_INT(reads, 0);
+	delete loader;
+
+	RemoveCacheFile(path);
+	return true;
+}
+
+// Big images get bigger blocks, to keep the index small.  Nothing is read past the end.
+static bool CheckBlockSize() {
+	const std::string path = "unittest_diskcache_large.iso";
+	RemoveCacheFile(path);
+	DiskCachingFileLoaderCache::SetRamTierSize(0);
+
+	int reads = 0;
+	DiskCachingFileLoader *loader = OpenLoader(path, 2048LL * 1024 * 1024, &reads);
+	if (!ReadAndCheck(loader, 1000, 1))
+		return false;
+	DiskCachingFileLoaderStats stats = loader->GetStats();
+	if (stats.misses != 0) {
+		EXPECT_EQ_INT((int)stats.backendBytes, 65536);
+		// Without the RAM tier, hits go to disk.
+		if (!ReadAndCheck(loader, 2000, 10))
+			return false;
+		stats = loader->GetStats();
+		EXPECT_EQ_INT((int)stats.diskHits, 1);
+		EXPECT_EQ_INT((int)stats.ramHits, 0);
+	}
+	delete loader;
+	RemoveCacheFile(path);
+
+	reads = 0;
+	loader = OpenLoader(path, 40000, &reads);
+	if (!ReadAndCheck(loader, 39990, 10))
+		return false;
+	stats = loader->GetStats();
+	if (stats.misses != 0) {
+		EXPECT_EQ_INT((int)stats.backendBytes, 40000 - 32768);
+	}
+	delete loader;
+	RemoveCacheFile(path);
+	return true;
+}
+
+bool TestDiskCachingFileLoader() {
+	File::CreateFullPath(CACHE_DIR);
+	DiskCachingFileLoaderCache::SetCacheDir(CACHE_DIR);
+
+	bool result = CheckTiers() && CheckBlockSize();
+
+	DiskCachingFileLoaderCache::SetRamTierSize(32 * 1024 * 1024);
+	DiskCachingFileLoaderCache::SetCacheDir("");
+	File::DeleteDir(CACHE_DIR);
+	return result;
+}
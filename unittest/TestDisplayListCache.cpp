@@ -0,0 +1,189 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+
+#include <cstring>
+#include <vector>
+
+#include "Core/MemMap.h"
+#include "GPU/ge_constants.h"
+#include "GPU/GPUCommon.h"
+#include "GPU/GPUState.h"
+#include "GPU/Common/DisplayListCache.h"
+#include "unittest/UnitTest.h"
+
+static const u32 LIST_ADDR = 0x08800000;
+
+// Only these are store only here, like the tables the GPU backends pass in.
+static const u8 storeOnlyCommands[] = {
+	GE_CMD_VERTEXTYPE,
+	GE_CMD_CULL,
+	GE_CMD_OFFSETX,
+	GE_CMD_OFFSETY,
+	GE_CMD_TEXSCALEU,
+	GE_CMD_TEXSCALEV,
+};
+
+// What an executing command saw when it ran.
+struct ListExecution {
+	u32 op;
+	u32 diff;
+	std::vector<u32> cmdmem;
+};
+
+static void BuildCommandFlags(u8 flags[256]) {
+	// Same as GPUCommon::SetExecuteOpFlags().
+	memset(flags, FLAG_EXECUTE, 256);
+	flags[GE_CMD_JUMP] |= FLAG_WRITES_PC;
+	flags[GE_CMD_BJUMP] |= FLAG_WRITES_PC;
+	flags[GE_CMD_CALL] |= FLAG_WRITES_PC;
+	flags[GE_CMD_RET] |= FLAG_WRITES_PC;
+	flags[GE_CMD_END] |= FLAG_WRITES_PC;
+	for (size_t i = 0; i < ARRAY_SIZE(storeOnlyCommands); ++i) {
+		flags[storeOnlyCommands[i]] = 0;
+	}
+}
+
+static void Execute(u32 op, u32 diff, std::vector<ListExecution> &executed) {
+	ListExecution e;
+	e.op = op;
+	e.diff = diff;
+	e.cmdmem.assign(gstate.cmdmem, gstate.cmdmem + 256);
+	executed.push_back(e);
+}
+
+// Like the run loop without the cache, up to the next command that changes the PC.
+static void RunNormally(const u8 flags[256], u32 pc, std::vector<ListExecution> &executed) {
+	while (true) {
+		u32 op = Memory::ReadUnchecked_U32(pc);
+		u32 cmd = op >> 24;
+		if (flags[cmd] & FLAG_WRITES_PC) {
+			break;
+		}
+		u32 diff = op ^ gstate.cmdmem[cmd];
+		gstate.cmdmem[cmd] = op;
+		if (flags[cmd] & FLAG_ANY_EXECUTE) {
+			Execute(op, diff, executed);
+		}
+		pc += 4;
+	}
+}
+
+// Like GPUCommon::ReplaySegment().
+static void RunCached(const DisplayListSegment &seg, std::vector<ListExecution> &executed) {
+	for (const DisplayListStep &step : seg.steps) {
+		u32 diff = step.op ^ gstate.cmdmem[step.cmd];
+		gstate.cmdmem[step.cmd] = step.op;
+		if (step.flags & FLAG_ANY_EXECUTE) {
+			Execute(step.op, diff, executed);
+		}
+	}
+}
+
+// Runs the list both ways from the same state, and checks they end up the same.
+static bool CompareRuns(const u8 flags[256], const DisplayListSegment &seg) {
+	memset(gstate.cmdmem, 0, sizeof(gstate.cmdmem));
+	std::vector<ListExecution> expected;
+	RunNormally(flags, seg.pc, expected);
+	std::vector<u32> expectedMem(gstate.cmdmem, gstate.cmdmem + 256);
+
+	memset(gstate.cmdmem, 0, sizeof(gstate.cmdmem));
+	std::vector<ListExecution> executed;
+	RunCached(seg, executed);
+
+	EXPECT_TRUE(memcmp(&expectedMem[0], gstate.cmdmem, sizeof(gstate.cmdmem)) == 0);
+	EXPECT_EQ_INT((int)executed.size(), (int)expected.size());
+	for (size_t i = 0; i < expected.size(); ++i) {
+		EXPECT_EQ_INT(executed[i].op, expected[i].op);
+		EXPECT_EQ_INT(executed[i].diff, expected[i].diff);
+		EXPECT_TRUE(executed[i].cmdmem == expected[i].cmdmem);
+	}
+	return true;
+}
+
+static u32 Op(u8 cmd, u32 data) {
+	return ((u32)cmd << 24) | (data & 0xFFFFFF);
+}
+
+bool TestDisplayListCache() {
+	Memory::g_MemorySize = Memory::RAM_NORMAL_SIZE;
+	Memory::Init();
+
+	// Runs of store only commands, some written more than once, broken up by draws.
+	const u32 list[] = {
+		Op(GE_CMD_VERTEXTYPE, 0x11),
+		Op(GE_CMD_OFFSETX, 0x100),
+		Op(GE_CMD_VERTEXTYPE, 0x12),
+		Op(GE_CMD_OFFSETX, 0x200),
+		Op(GE_CMD_OFFSETY, 0x300),
+		Op(GE_CMD_PRIM, 0x30003),
+		Op(GE_CMD_VERTEXTYPE, 0x13),
+		Op(GE_CMD_CULL, 1),
+		Op(GE_CMD_CULL, 0),
+		Op(GE_CMD_TEXSCALEU, 0x3F8000),
+		Op(GE_CMD_PRIM, 0x30006),
+		Op(GE_CMD_TEXSCALEU, 0x400000),
+		Op(GE_CMD_TEXSCALEV, 0x400000),
+		Op(GE_CMD_END, 0),
+	};
+	const u32 words = (u32)ARRAY_SIZE(list) - 1;
+	for (size_t i = 0; i < ARRAY_SIZE(list); ++i) {
+		Memory::WriteUnchecked_U32(list[i], LIST_ADDR + (u32)i * 4);
+	}
+
+	u8 flags[256];
+	BuildCommandFlags(flags);
+	DisplayListCache cache;
+	cache.SetCommandFlags(flags);
+
+	// Decoded the second time it's seen, with the overwritten stores dropped.
+	EXPECT_TRUE(cache.Lookup(LIST_ADDR, 0x1000) == nullptr);
+	const DisplayListSegment *seg = cache.Lookup(LIST_ADDR, 0x1000);
+	EXPECT_TRUE(seg != nullptr);
+	EXPECT_EQ_INT(seg->words, words);
+	EXPECT_EQ_INT((int)seg->steps.size(), (int)words - 3);
+	RET(CompareRuns(flags, *seg));
+
+	// Not while part of it is past the stall address.
+	EXPECT_TRUE(cache.Lookup(LIST_ADDR, words - 1) == nullptr);
+
+	// Changed in memory: the old decode is dropped, and the new contents are decoded next time.
+	Memory::WriteUnchecked_U32(Op(GE_CMD_PRIM, 0x30009), LIST_ADDR + 8 * 4);
+	EXPECT_TRUE(cache.Lookup(LIST_ADDR, 0x1000) == nullptr);
+	seg = cache.Lookup(LIST_ADDR, 0x1000);
+	EXPECT_TRUE(seg != nullptr);
+	EXPECT_EQ_INT((int)seg->steps.size(), (int)words - 2);
+	RET(CompareRuns(flags, *seg));
+
+	// Invalidated by an overlapping write (even through the uncached mirror) it starts over.
+	cache.Invalidate(0x40000000 | (LIST_ADDR + 4 * 4), 4);
+	EXPECT_TRUE(cache.Lookup(LIST_ADDR, 0x1000) == nullptr);
+	EXPECT_TRUE(cache.Lookup(LIST_ADDR, 0x1000) != nullptr);
+	cache.Invalidate(LIST_ADDR + words * 4, 16);
+	EXPECT_TRUE(cache.Lookup(LIST_ADDR, 0x1000) != nullptr);
+
+	// A list that keeps changing stops being cached.
+	for (u32 i = 0; i < 4; ++i) {
+		Memory::WriteUnchecked_U32(Op(GE_CMD_OFFSETX, 0x400 + i), LIST_ADDR + 3 * 4);
+		EXPECT_TRUE(cache.Lookup(LIST_ADDR, 0x1000) == nullptr);
+	}
+	EXPECT_TRUE(cache.Lookup(LIST_ADDR, 0x1000) == nullptr);
+
+	cache.Clear();
+	Memory::Shutdown();
+	return true;
+}
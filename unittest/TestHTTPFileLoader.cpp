@@ -0,0 +1,332 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define closesocket close
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/timeutil.h"
+#include "net/resolve.h"
+#include "thread/thread.h"
+#include "Common/Common.h"
+#include "Core/FileLoaders/HTTPFileLoader.h"
+#include "unittest/UnitTest.h"
+
+// Stands in for a real server: serves one file on the loopback interface, with range
+// requests and (optionally) keep-alive, and counts what the loader asks of it.
+class LoopbackHTTPServer {
+public:
+	// How the end of each GET response is marked.
+	enum Entity {
+		ENTITY_LENGTH,
+		ENTITY_CHUNKED,
+		// No length, the connection is closed after the response.
+		ENTITY_UNTIL_CLOSE,
+	};
+
+	LoopbackHTTPServer(const std::vector<u8> &data, bool keepAlive, int latencyMs, Entity entity = ENTITY_LENGTH)
+		: data_(data), keepAlive_(keepAlive), latencyMs_(latencyMs), entity_(entity), listener_(-1), port_(0), stop_(false), connections_(0), requests_(0) {
+	}
+
+	~LoopbackHTTPServer() {
+		stop_ = true;
+		if (acceptThread_.joinable()) {
+			acceptThread_.join();
+		}
+		for (std::thread &th : connectionThreads_) {
+			th.join();
+		}
+		if (listener_ != -1) {
+			closesocket(listener_);
+		}
+	}
+
+	bool Start() {
+		listener_ = (int)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (listener_ == -1) {
+			return false;
+		}
+
+		sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = 0;
+		socklen_t len = sizeof(addr);
+		if (bind(listener_, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(listener_, 8) < 0) {
+			return false;
+		}
+		if (getsockname(listener_, (sockaddr *)&addr, &len) < 0) {
+			return false;
+		}
+		port_ = ntohs(addr.sin_port);
+
+		acceptThread_ = std::thread(&LoopbackHTTPServer::AcceptConnections, this);
+		return true;
+	}
+
+	int Port() const { return port_; }
+
+	int Connections() {
+		lock_guard guard(lock_);
+		return connections_;
+	}
+
+	int Requests() {
+		lock_guard guard(lock_);
+		return requests_;
+	}
+
+private:
+	void AcceptConnections() {
+		while (!stop_) {
+			// Don't block forever, so the server can be stopped.
+			fd_set fds;
+			FD_ZERO(&fds);
+			FD_SET(listener_, &fds);
+			timeval tv = { 0, 10000 };
+			if (select(listener_ + 1, &fds, nullptr, nullptr, &tv) <= 0) {
+				continue;
+			}
+
+			int sock = (int)accept(listener_, nullptr, nullptr);
+			if (sock == -1) {
+				continue;
+			}
+			lock_guard guard(lock_);
+			connections_++;
+			connectionThreads_.push_back(std::thread(&LoopbackHTTPServer::ServeConnection, this, sock));
+		}
+	}
+
+	void ServeConnection(int sock) {
+		std::string pending;
+		char buf[4096];
+		while (!stop_) {
+			size_t headersEnd = pending.find("\r\n\r\n");
+			if (headersEnd == pending.npos) {
+				int received = recv(sock, buf, sizeof(buf), 0);
+				if (received <= 0) {
+					break;
+				}
+				pending.append(buf, received);
+				continue;
+			}
+
+			std::string request = pending.substr(0, headersEnd);
+			pending.erase(0, headersEnd + 4);
+			{
+				lock_guard guard(lock_);
+				requests_++;
+			}
+			if (latencyMs_ != 0) {
+				sleep_ms(latencyMs_);
+			}
+			const bool head = request.compare(0, 5, "HEAD ") == 0;
+			if (!Respond(sock, request) || !keepAlive_ || (entity_ == ENTITY_UNTIL_CLOSE && !head)) {
+				break;
+			}
+		}
+		closesocket(sock);
+	}
+
+	bool Respond(int sock, const std::string &request) {
+		const bool head = request.compare(0, 5, "HEAD ") == 0;
+		long long first = 0;
+		long long last = (long long)data_.size() - 1;
+		size_t rangePos = request.find("Range: bytes=");
+		const bool ranged = !head && rangePos != request.npos;
+		if (ranged) {
+			sscanf(request.c_str() + rangePos, "Range: bytes=%lld-%lld", &first, &last);
+			last = std::min(last, (long long)data_.size() - 1);
+		}
+
+		char headers[1024];
+		if (ranged) {
+			snprintf(headers, sizeof(headers), "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes %lld-%lld/%lld\r\n", first, last, (long long)data_.size());
+		} else {
+			snprintf(headers, sizeof(headers), "HTTP/1.1 200 OK\r\nAccept-Ranges: bytes\r\n");
+		}
+		std::string response = headers;
+		const Entity entity = head ? ENTITY_LENGTH : entity_;
+		if (entity == ENTITY_LENGTH) {
+			snprintf(headers, sizeof(headers), "Content-Length: %lld\r\nConnection: %s\r\n\r\n", last - first + 1, keepAlive_ ? "keep-alive" : "close");
+		} else if (entity == ENTITY_CHUNKED) {
+			snprintf(headers, sizeof(headers), "Transfer-Encoding: chunked\r\nConnection: %s\r\n\r\n", keepAlive_ ? "keep-alive" : "close");
+		} else {
+			headers[0] = '\0';
+			response += "\r\n";
+		}
+		response += headers;
+		if (entity == ENTITY_CHUNKED) {
+			// Odd sized chunks, one with an extension, and a trailer at the end.
+			const size_t chunkSize = 3001;
+			for (long long pos = first; pos <= last; pos += chunkSize) {
+				size_t size = (size_t)std::min((long long)chunkSize, last - pos + 1);
+				snprintf(headers, sizeof(headers), pos == first ? "%x;name=value\r\n" : "%x\r\n", (int)size);
+				response += headers;
+				response.append((const char *)&data_[(size_t)pos], size);
+				response += "\r\n";
+			}
+			response += "0\r\nX-Checksum: none\r\n\r\n";
+		} else if (!head) {
+			response.append((const char *)&data_[(size_t)first], (size_t)(last - first + 1));
+		}
+
+		for (size_t pos = 0; pos < response.size(); ) {
+			int sent = send(sock, response.data() + pos, (int)(response.size() - pos), 0);
+			if (sent <= 0) {
+				return false;
+			}
+			pos += sent;
+		}
+		return true;
+	}
+
+	net::AutoInit netInit_;
+	std::vector<u8> data_;
+	bool keepAlive_;
+	int latencyMs_;
+	Entity entity_;
+	int listener_;
+	int port_;
+	volatile bool stop_;
+
+	std::thread acceptThread_;
+	std::vector<std::thread> connectionThreads_;
+	recursive_mutex lock_;
+	int connections_;
+	int requests_;
+};
+
+static bool CheckRead(HTTPFileLoader &loader, const std::vector<u8> &data, s64 pos, size_t bytes) {
+	std::vector<u8> buf(bytes);
+	size_t expected = (size_t)std::min((s64)bytes, (s64)data.size() - pos);
+	if (loader.ReadAt(pos, bytes, &buf[0]) != expected) {
+		printf("Short read at %lld: wanted %d bytes\n", (long long)pos, (int)expected);
+		return false;
+	}
+	return memcmp(&buf[0], &data[(size_t)pos], expected) == 0;
+}
+
+static std::string LoopbackURL(const LoopbackHTTPServer &server) {
+	char url[256];
+	snprintf(url, sizeof(url), "http://127.0.0.1:%d/test.iso", server.Port());
+	return url;
+}
+
+bool TestHTTPFileLoader() {
+	std::vector<u8> data(8 * 1024 * 1024 + 1234);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = (u8)(rand() >> 4);
+	}
+
+	const size_t readSize = 32 * 1024;
+	const int reads = (int)(data.size() / readSize);
+	{
+		LoopbackHTTPServer server(data, true, 1);
+		EXPECT_TRUE(server.Start());
+		HTTPFileLoader loader(LoopbackURL(server));
+		EXPECT_TRUE(loader.Exists());
+		EXPECT_EQ_INT((int)loader.FileSize(), (int)data.size());
+
+		// Streaming through the file, like a video or a level load.  These should mostly
+		// be coalesced into fewer, bigger requests, all on the connection used for HEAD.
+		double st = real_time_now();
+		for (int i = 0; i < reads; ++i) {
+			EXPECT_TRUE(CheckRead(loader, data, i * readSize, readSize));
+		}
+		double elapsed = real_time_now() - st;
+		HTTPFileLoader::Stats stats = loader.GetStats();
+		EXPECT_EQ_INT(stats.connects, 1);
+		EXPECT_TRUE(stats.requests < reads / 2);
+		EXPECT_TRUE(stats.coalescedReads > reads / 2);
+		printf("HTTPFileLoader: %d sequential reads in %d requests, %0.1f ms, request size %dKB\n", reads, stats.requests, elapsed * 1000.0, (int)(stats.requestSize / 1024));
+
+		// A big read is split over a few connections, and the end is clamped to the file.
+		EXPECT_TRUE(CheckRead(loader, data, 12345, 3 * 1024 * 1024));
+		EXPECT_TRUE(CheckRead(loader, data, data.size() - 1000, readSize));
+		u8 buf[16];
+		EXPECT_EQ_INT((int)loader.ReadAt(data.size(), sizeof(buf), buf), 0);
+		for (int i = 0; i < 64; ++i) {
+			EXPECT_TRUE(CheckRead(loader, data, rand() % data.size(), 1 + rand() % (256 * 1024)));
+		}
+
+		stats = loader.GetStats();
+		EXPECT_TRUE(stats.connects <= 4);
+		EXPECT_EQ_INT(stats.requests, server.Requests());
+	}
+
+	{
+		// A server that closes the connection after every response still works, just slower.
+		LoopbackHTTPServer server(data, false, 0);
+		EXPECT_TRUE(server.Start());
+		HTTPFileLoader loader(LoopbackURL(server));
+		EXPECT_TRUE(loader.Exists());
+		for (int i = 0; i < 16; ++i) {
+			EXPECT_TRUE(CheckRead(loader, data, i * readSize, readSize));
+		}
+		EXPECT_TRUE(CheckRead(loader, data, 100, 2 * 1024 * 1024));
+		EXPECT_EQ_INT(server.Connections(), server.Requests());
+	}
+
+	{
+		// Chunked responses end at the last chunk, so the connection (and anything pipelined
+		// on it) isn't left waiting for the server to close.
+		LoopbackHTTPServer server(data, true, 0, LoopbackHTTPServer::ENTITY_CHUNKED);
+		EXPECT_TRUE(server.Start());
+		HTTPFileLoader loader(LoopbackURL(server));
+		EXPECT_TRUE(loader.Exists());
+		for (int i = 0; i < 16; ++i) {
+			EXPECT_TRUE(CheckRead(loader, data, i * readSize, readSize));
+		}
+		EXPECT_EQ_INT(server.Connections(), 1);
+		EXPECT_TRUE(CheckRead(loader, data, 100, 2 * 1024 * 1024));
+		EXPECT_TRUE(server.Connections() <= 4);
+	}
+
+	{
+		// Without a length or chunks, each response ends when its connection closes.
+		LoopbackHTTPServer server(data, true, 0, LoopbackHTTPServer::ENTITY_UNTIL_CLOSE);
+		EXPECT_TRUE(server.Start());
+		HTTPFileLoader loader(LoopbackURL(server));
+		EXPECT_TRUE(loader.Exists());
+		for (int i = 0; i < 16; ++i) {
+			EXPECT_TRUE(CheckRead(loader, data, i * readSize, readSize));
+		}
+		EXPECT_TRUE(CheckRead(loader, data, 100, 2 * 1024 * 1024));
+	}
+
+	return true;
+}
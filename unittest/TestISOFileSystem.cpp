@@ -0,0 +1,291 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "base/timeutil.h"
+#include "thread/thread.h"
+#include "Common/Common.h"
+#include "Core/FileSystems/BlockDevices.h"
+#include "Core/FileSystems/ISOFileSystem.h"
+#include "unittest/UnitTest.h"
+
+// Builds a minimal ISO9660 image in memory with a large directory tree, so that
+// path lookups can be tested and timed without a real disc.
+class MemoryBlockDevice : public BlockDevice {
+public:
+	MemoryBlockDevice(const std::vector<u8> &data) : data_(data), reads_(0) {}
+
+	bool ReadBlock(int blockNumber, u8 *outPtr) override {
+		if ((size_t)(blockNumber + 1) * 2048 > data_.size())
+			return false;
+		memcpy(outPtr, &data_[blockNumber * 2048], 2048);
+		++reads_;
+		return true;
+	}
+	u32 GetNumBlocks() override { return (u32)(data_.size() / 2048); }
+
+	int Reads() const { return reads_; }
+
+private:
+	std::vector<u8> data_;
+	int reads_;
+};
+
+// Lets other threads run in the middle of each read, so lookups overlap.
+class YieldingBlockDevice : public MemoryBlockDevice {
+public:
+	YieldingBlockDevice(const std::vector<u8> &data) : MemoryBlockDevice(data) {}
+
+	bool ReadBlock(int blockNumber, u8 *outPtr) override {
+		std::this_thread::yield();
+		return MemoryBlockDevice::ReadBlock(blockNumber, outPtr);
+	}
+};
+
+struct SyntheticDir {
+	std::string name;
+	std::vector<SyntheticDir> dirs;
+	std::vector<std::string> files;
+	u32 sector;
+	u32 size;
+};
+
+static const u32 SYNTHETIC_FILE_SECTOR = 18;
+static const u32 SYNTHETIC_FILE_SIZE = 16;
+
+static int RecordSize(size_t nameLength) {
+	return (33 + (int)nameLength + 1) & ~1;
+}
+
+static u32 DirectorySectors(const SyntheticDir &dir) {
+	std::vector<size_t> names;
+	// The "." and ".." entries.
+	names.push_back(1);
+	names.push_back(1);
+	for (size_t i = 0; i < dir.dirs.size(); ++i)
+		names.push_back(dir.dirs[i].name.size());
+	for (size_t i = 0; i < dir.files.size(); ++i)
+		names.push_back(dir.files[i].size());
+
+	u32 sectors = 1;
+	int offset = 0;
+	for (size_t i = 0; i < names.size(); ++i) {
+		int sz = RecordSize(names[i]);
+		if (offset + sz > 2048) {
+			++sectors;
+			offset = 0;
+		}
+		offset += sz;
+	}
+	return sectors;
+}
+
+static void AssignSectors(SyntheticDir &dir, u32 &nextSector) {
+	u32 sectors = DirectorySectors(dir);
+	dir.sector = nextSector;
+	dir.size = sectors * 2048;
+	nextSector += sectors;
+	for (size_t i = 0; i < dir.dirs.size(); ++i)
+		AssignSectors(dir.dirs[i], nextSector);
+}
+
+static void Write32Both(u8 *p, u32 v) {
+	for (int i = 0; i < 4; ++i) {
+		p[i] = (u8)(v >> (i * 8));
+		p[7 - i] = (u8)(v >> (i * 8));
+	}
+}
+
+static int WriteRecord(u8 *p, const char *name, size_t nameLength, u32 sector, u32 size, bool isDir) {
+	int sz = RecordSize(nameLength);
+	memset(p, 0, sz);
+	p[0] = (u8)sz;
+	Write32Both(p + 2, sector);
+	Write32Both(p + 10, size);
+	p[25] = isDir ? 2 : 0;
+	p[32] = (u8)nameLength;
+	memcpy(p + 33, name, nameLength);
+	return sz;
+}
+
+static void WriteDirectory(std::vector<u8> &image, const SyntheticDir &dir, const SyntheticDir &parent) {
+	u32 sector = dir.sector;
+	int offset = 0;
+	auto add = [&](const char *name, size_t nameLength, u32 start, u32 size, bool isDir) {
+		if (offset + RecordSize(nameLength) > 2048) {
+			++sector;
+			offset = 0;
+		}
+		offset += WriteRecord(&image[sector * 2048 + offset], name, nameLength, start, size, isDir);
+	};
+
+	add("\x00", 1, dir.sector, dir.size, true);
+	add("\x01", 1, parent.sector, parent.size, true);
+	for (size_t i = 0; i < dir.dirs.size(); ++i) {
+		const SyntheticDir &sub = dir.dirs[i];
+		add(sub.name.c_str(), sub.name.size(), sub.sector, sub.size, true);
+	}
+	for (size_t i = 0; i < dir.files.size(); ++i)
+		add(dir.files[i].c_str(), dir.files[i].size(), SYNTHETIC_FILE_SECTOR, SYNTHETIC_FILE_SIZE, false);
+
+	for (size_t i = 0; i < dir.dirs.size(); ++i)
+		WriteDirectory(image, dir.dirs[i], dir);
+}
+
+static std::vector<u8> BuildSyntheticISO(SyntheticDir &root) {
+	// Sector 16 is the volume descriptor, 17 the terminator, 18 holds all file data.
+	u32 nextSector = SYNTHETIC_FILE_SECTOR + 1;
+	AssignSectors(root, nextSector);
+
+	std::vector<u8> image(nextSector * 2048, 0);
+	u8 *desc = &image[16 * 2048];
+	desc[0] = 1;
+	memcpy(desc + 1, "CD001", 5);
+	desc[6] = 1;
+	WriteRecord(desc + 156, "\x00", 1, root.sector, root.size, true);
+
+	u8 *term = &image[17 * 2048];
+	term[0] = (u8)0xFF;
+	memcpy(term + 1, "CD001", 5);
+
+	for (u32 i = 0; i < SYNTHETIC_FILE_SIZE; ++i)
+		image[SYNTHETIC_FILE_SECTOR * 2048 + i] = (u8)i;
+
+	WriteDirectory(image, root, root);
+	return image;
+}
+
+static void BuildTree(SyntheticDir &root, std::vector<std::string> &filePaths, int dirs, int subdirs, int files) {
+	char temp[64];
+	for (int d = 0; d < dirs; ++d) {
+		SyntheticDir dir;
+		snprintf(temp, sizeof(temp), "DIR%03d", d);
+		dir.name = temp;
+		for (int s = 0; s < subdirs; ++s) {
+			SyntheticDir sub;
+			snprintf(temp, sizeof(temp), "SUB%03d", s);
+			sub.name = temp;
+			for (int f = 0; f < files; ++f) {
+				snprintf(temp, sizeof(temp), "FILE%04d.BIN", f);
+				sub.files.push_back(temp);
+				filePaths.push_back("/" + dir.name + "/" + sub.name + "/" + temp);
+			}
+			dir.dirs.push_back(sub);
+		}
+		root.dirs.push_back(dir);
+	}
+	root.files.push_back("EBOOT.BIN");
+	filePaths.push_back("/EBOOT.BIN");
+}
+
+static void WalkTree(ISOFileSystem *iso, const std::vector<std::string> *filePaths, int *errors) {
+	for (size_t i = 0; i < filePaths->size(); ++i) {
+		const std::string &path = (*filePaths)[i];
+		if (!iso->GetFileInfo(path).exists)
+			(*errors)++;
+		// Also list the directory, which reads it in if the lookup above didn't.
+		if (iso->GetDirListing(path.substr(0, path.find_last_of('/') + 1)).empty())
+			(*errors)++;
+	}
+}
+
+// Both threads read in the same directories at the same time.
+static bool TestISOFileSystemThreads(const std::vector<u8> &image, const std::vector<std::string> &filePaths) {
+	SequentialHandleAllocator handles;
+	ISOFileSystem iso(&handles, new YieldingBlockDevice(image));
+
+	int errors[2] = { 0, 0 };
+	std::thread first(&WalkTree, &iso, &filePaths, &errors[0]);
+	std::thread second(&WalkTree, &iso, &filePaths, &errors[1]);
+	first.join();
+	second.join();
+
+	EXPECT_EQ_INT(errors[0], 0);
+	EXPECT_EQ_INT(errors[1], 0);
+	EXPECT_EQ_INT((int)iso.GetDirListing("/DIR005").size(), 16);
+	EXPECT_EQ_INT((int)iso.GetDirListing("/DIR005/SUB001").size(), 32);
+	return true;
+}
+
+bool TestISOFileSystem() {
+	SyntheticDir root;
+	std::vector<std::string> filePaths;
+	BuildTree(root, filePaths, 32, 16, 32);
+	std::vector<u8> image = BuildSyntheticISO(root);
+
+	SequentialHandleAllocator handles;
+	MemoryBlockDevice *device = new MemoryBlockDevice(image);
+	double st = real_time_now();
+	ISOFileSystem iso(&handles, device);
+	double mountTime = real_time_now() - st;
+
+	// Only the volume descriptor is read at mount, then one sector per directory on the way.
+	EXPECT_EQ_INT(device->Reads(), 1);
+	EXPECT_TRUE(iso.GetFileInfo(filePaths[0]).exists);
+	EXPECT_EQ_INT(device->Reads(), 4);
+	EXPECT_TRUE(iso.GetFileInfo(filePaths[1]).exists);
+	EXPECT_EQ_INT(device->Reads(), 4);
+
+	// Every file must be reachable, and read back the shared data.
+	for (size_t i = 0; i < filePaths.size(); ++i) {
+		u32 h = iso.OpenFile(filePaths[i], FILEACCESS_READ, "disc0:");
+		EXPECT_TRUE(h != 0);
+		iso.CloseFile(h);
+	}
+
+	u8 data[SYNTHETIC_FILE_SIZE * 2];
+	u32 h = iso.OpenFile(filePaths.back(), FILEACCESS_READ, "disc0:");
+	EXPECT_EQ_INT((int)iso.ReadFile(h, data, sizeof(data)), (int)SYNTHETIC_FILE_SIZE);
+	EXPECT_EQ_INT((int)data[SYNTHETIC_FILE_SIZE - 1], (int)(SYNTHETIC_FILE_SIZE - 1));
+	iso.CloseFile(h);
+
+	// Path forms the tree walk accepted, and ones it didn't.
+	EXPECT_TRUE(iso.GetFileInfo("DIR001/SUB002/FILE0003.BIN").exists);
+	EXPECT_TRUE(iso.GetFileInfo("./DIR001/SUB002").type == FILETYPE_DIRECTORY);
+	EXPECT_TRUE(iso.GetFileInfo("/DIR001/SUB002/").exists);
+	EXPECT_TRUE(iso.GetFileInfo("/DIR001/.").exists);
+	EXPECT_FALSE(iso.GetFileInfo("/DIR001//SUB002").exists);
+	EXPECT_FALSE(iso.GetFileInfo("/DIR001/SUB002/FILE9999.BIN").exists);
+	EXPECT_FALSE(iso.GetFileInfo("/dir001/sub002/file0003.bin").exists);
+	EXPECT_EQ_INT((int)iso.GetDirListing("/DIR005").size(), 16);
+
+	// Restricted mounts only see the requested path, whichever order it's looked up in.
+	ISOFileSystem restricted(&handles, new MemoryBlockDevice(image), "/DIR001/SUB003");
+	EXPECT_FALSE(restricted.GetFileInfo("/DIR002/SUB003/FILE0000.BIN").exists);
+	EXPECT_TRUE(restricted.GetFileInfo("/DIR001/SUB003/FILE0031.BIN").exists);
+	EXPECT_FALSE(restricted.GetFileInfo("/DIR001/SUB002").exists);
+	EXPECT_EQ_INT((int)restricted.GetDirListing("/DIR001").size(), 1);
+	EXPECT_TRUE(restricted.GetFileInfo("/EBOOT.BIN").exists);
+
+	// Now the benchmark: open every file on the disc, like a loading screen would.
+	const int rounds = 10;
+	st = real_time_now();
+	for (int r = 0; r < rounds; ++r) {
+		for (size_t i = 0; i < filePaths.size(); ++i) {
+			u32 h = iso.OpenFile(filePaths[i], FILEACCESS_READ, "disc0:");
+			iso.CloseFile(h);
+		}
+	}
+	double elapsed = real_time_now() - st;
+	printf("ISOFileSystem: %d files, mount %0.2f ms, %0.0f opens/sec\n", (int)filePaths.size(), mountTime * 1000.0, (rounds * filePaths.size()) / elapsed);
+
+	return TestISOFileSystemThreads(image, filePaths);
+}
@@ -0,0 +1,232 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "base/timeutil.h"
+#include "util/random/rng.h"
+#include "GPU/ge_constants.h"
+#include "GPU/Common/IndexGenerator.h"
+#include "unittest/UnitTest.h"
+
+struct Tri {
+	u16 i0, i1, i2;
+	bool operator ==(const Tri &other) const {
+		return i0 == other.i0 && i1 == other.i1 && i2 == other.i2;
+	}
+};
+
+static bool IsDegenerate(const Tri &t) {
+	return t.i0 == t.i1 || t.i1 == t.i2 || t.i0 == t.i2;
+}
+
+// What the GPU draws for a strip or a list, minus the triangles that can't draw anything.
+static void ExpandTriangles(std::vector<Tri> &tris, GEPrimitiveType prim, const u16 *inds, int count) {
+	if (prim == GE_PRIM_TRIANGLE_STRIP) {
+		for (int i = 0; i + 2 < count; i++) {
+			Tri t = { inds[i], inds[i + 1 + (i & 1)], inds[i + 2 - (i & 1)] };
+			if (!IsDegenerate(t))
+				tris.push_back(t);
+		}
+	} else {
+		for (int i = 0; i + 2 < count; i += 3) {
+			Tri t = { inds[i], inds[i + 1], inds[i + 2] };
+			if (!IsDegenerate(t))
+				tris.push_back(t);
+		}
+	}
+}
+
+// The reference: each primitive on its own, the plain way.
+static void ExpandPrim(std::vector<Tri> &tris, int prim, const std::vector<u16> &inds) {
+	const int n = (int)inds.size();
+	switch (prim) {
+	case GE_PRIM_TRIANGLES:
+		ExpandTriangles(tris, GE_PRIM_TRIANGLES, inds.data(), n);
+		break;
+	case GE_PRIM_TRIANGLE_STRIP:
+		ExpandTriangles(tris, GE_PRIM_TRIANGLE_STRIP, inds.data(), n);
+		break;
+	case GE_PRIM_TRIANGLE_FAN:
+		for (int i = 1; i + 1 < n; i++) {
+			Tri t = { inds[0], inds[i], inds[i + 1] };
+			if (!IsDegenerate(t))
+				tris.push_back(t);
+		}
+		break;
+	}
+}
+
+static bool CheckTriangleBatch(GMRng &rng, u16 *buffer, bool toList) {
+	IndexGenerator gen;
+	gen.Setup(buffer);
+	std::vector<Tri> expected;
+
+	// Mostly strips, since that's what gets merged, with lists and fans mixed in sometimes.
+	const bool onlyStrips = (rng.R32() & 1) != 0;
+	const int numPrims = 1 + rng.R32() % 12;
+	for (int p = 0; p < numPrims; p++) {
+		static const int mixed[3] = { GE_PRIM_TRIANGLE_STRIP, GE_PRIM_TRIANGLES, GE_PRIM_TRIANGLE_FAN };
+		const int prim = onlyStrips ? GE_PRIM_TRIANGLE_STRIP : mixed[rng.R32() % 3];
+		int numVerts = rng.R32() % 40;
+		if (prim == GE_PRIM_TRIANGLES)
+			numVerts -= numVerts % 3;
+		const int firstIndex = gen.MaxIndex();
+
+		std::vector<u16> inds(numVerts);
+		switch (rng.R32() % 3) {
+		case 0:
+			for (int i = 0; i < numVerts; i++)
+				inds[i] = firstIndex + i;
+			gen.AddPrim(prim, numVerts);
+			break;
+		case 1:
+			{
+				std::vector<u8> src(numVerts);
+				for (int i = 0; i < numVerts; i++) {
+					src[i] = rng.R32() % 24;
+					inds[i] = firstIndex + src[i];
+				}
+				gen.TranslatePrim(prim, numVerts, src.data(), 0);
+				gen.Advance(24);
+			}
+			break;
+		case 2:
+			{
+				std::vector<u16> src(numVerts);
+				for (int i = 0; i < numVerts; i++) {
+					src[i] = 100 + rng.R32() % 24;
+					inds[i] = firstIndex + src[i] - 100;
+				}
+				gen.TranslatePrim(prim, numVerts, src.data(), 100);
+				gen.Advance(24);
+			}
+			break;
+		}
+		ExpandPrim(expected, prim, inds);
+	}
+
+	if (toList) {
+		gen.ConvertToList();
+		if (gen.Prim() == GE_PRIM_TRIANGLE_STRIP) {
+			printf("IndexGenerator: ConvertToList left a strip\n");
+			return false;
+		}
+	}
+	if (onlyStrips && !toList && gen.Prim() != GE_PRIM_TRIANGLE_STRIP) {
+		printf("IndexGenerator: Strips were not kept as a strip\n");
+		return false;
+	}
+
+	std::vector<Tri> actual;
+	ExpandTriangles(actual, gen.Prim(), buffer, gen.VertexCount());
+	if (actual.size() != expected.size()) {
+		printf("IndexGenerator: %d triangles, expected %d\n", (int)actual.size(), (int)expected.size());
+		return false;
+	}
+	for (size_t i = 0; i < actual.size(); i++) {
+		if (!(actual[i] == expected[i])) {
+			printf("IndexGenerator: Triangle %d is %d %d %d, expected %d %d %d\n", (int)i, actual[i].i0, actual[i].i1, actual[i].i2, expected[i].i0, expected[i].i1, expected[i].i2);
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool CheckSequential(u16 *buffer) {
+	// Odd counts on purpose, to cover the scalar tails.
+	IndexGenerator gen;
+	gen.Setup(buffer);
+	gen.AddPrim(GE_PRIM_POINTS, 5);
+	gen.AddPrim(GE_PRIM_POINTS, 37);
+	for (int i = 0; i < 42; i++) {
+		EXPECT_EQ_INT(buffer[i], i);
+	}
+	EXPECT_EQ_INT(gen.VertexCount(), 42);
+
+	gen.Reset();
+	gen.AddPrim(GE_PRIM_LINE_STRIP, 19);
+	for (int i = 0; i < 18; i++) {
+		EXPECT_EQ_INT(buffer[i * 2], i);
+		EXPECT_EQ_INT(buffer[i * 2 + 1], i + 1);
+	}
+	EXPECT_EQ_INT(gen.VertexCount(), 36);
+
+	std::vector<u8> src(29);
+	for (int i = 0; i < 29; i++)
+		src[i] = (u8)(i * 7);
+	gen.Reset();
+	gen.Advance(1000);
+	gen.TranslatePrim(GE_PRIM_RECTANGLES, 29, src.data(), 3);
+	for (int i = 0; i < 28; i++) {
+		EXPECT_EQ_INT(buffer[i], 997 + i * 7);
+	}
+	EXPECT_EQ_INT(gen.VertexCount(), 28);
+	return true;
+}
+
+static double TimeAddPrim(IndexGenerator &gen, int prim, int numVerts, int rounds) {
+	double st = real_time_now();
+	for (int r = 0; r < rounds; r++) {
+		gen.Reset();
+		gen.AddPrim(GE_PRIM_TRIANGLES, 3);
+		gen.AddPrim(prim, numVerts);
+	}
+	return real_time_now() - st;
+}
+
+static double TimeTranslatePrim(IndexGenerator &gen, int prim, const u16 *inds, int numInds, int rounds) {
+	double st = real_time_now();
+	for (int r = 0; r < rounds; r++) {
+		gen.Reset();
+		gen.AddPrim(GE_PRIM_TRIANGLES, 3);
+		gen.TranslatePrim(prim, numInds, inds, 0);
+	}
+	return real_time_now() - st;
+}
+
+bool TestIndexGenerator() {
+	// Room for the worst case: all strips written as lists.
+	std::vector<u16> buffer(65536 * 3);
+	GMRng rng;
+	rng.Init(0x1337);
+
+	if (!CheckSequential(buffer.data()))
+		return false;
+	for (int i = 0; i < 2000; i++) {
+		if (!CheckTriangleBatch(rng, buffer.data(), (i & 1) != 0))
+			return false;
+	}
+
+	// Strips, fans and lists after something else, so they're all generated as lists.
+	const int numVerts = 60000;
+	const int rounds = 200;
+	IndexGenerator gen;
+	gen.Setup(buffer.data());
+	std::vector<u16> inds(numVerts);
+	for (int i = 0; i < numVerts; i++)
+		inds[i] = rng.R32() & 0xFFFF;
+	const double stripTime = TimeAddPrim(gen, GE_PRIM_TRIANGLE_STRIP, numVerts, rounds);
+	const double fanTime = TimeAddPrim(gen, GE_PRIM_TRIANGLE_FAN, numVerts, rounds);
+	const double listTime = TimeAddPrim(gen, GE_PRIM_TRIANGLES, numVerts, rounds);
+	const double translateTime = TimeTranslatePrim(gen, GE_PRIM_TRIANGLES, inds.data(), numVerts, rounds);
+	const double mverts = numVerts * (double)rounds / 1000000.0;
+	printf("IndexGenerator: strip %.0f, fan %.0f, list %.0f, indexed list %.0f Mverts/s\n", mverts / stripTime, mverts / fanTime, mverts / listTime, mverts / translateTime);
+	return true;
+}
@@ -0,0 +1,156 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "base/timeutil.h"
+#include "Common/Common.h"
+#include "Core/Config.h"
+#include "Core/MemSnapshot.h"
+#include "unittest/UnitTest.h"
+
+// Roughly what a game does between rewind snapshots: scattered writes to RAM, and a
+// frame or two drawn into VRAM.
+static void SimulateFrame(std::vector<u8> &ram, std::vector<u8> &vram, int writes) {
+	for (int i = 0; i < writes; ++i) {
+		ram[(rand() * 4099 + rand()) % ram.size()] += 1 + (rand() & 7);
+	}
+	for (size_t i = 0; i < vram.size() / 2; i += 4) {
+		vram[i] ^= 0x55;
+	}
+}
+
+// Captures the same frames with the pages compared on one thread and on the thread pool.
+static bool CompareThreading(const std::vector<MemSnapshot::Region> &regions, std::vector<u8> &ram, std::vector<u8> &vram) {
+	const int oldNumWorkerThreads = g_Config.iNumWorkerThreads;
+	const int rounds = 10;
+	MemSnapshot single, multi;
+	MemSnapshot::Undo singleUndo, multiUndo;
+	single.SetRegions(regions);
+	multi.SetRegions(regions);
+	single.Capture(singleUndo);
+	multi.Capture(multiUndo);
+
+	double singleTime = 0.0;
+	double multiTime = 0.0;
+	for (int i = 0; i < rounds; ++i) {
+		SimulateFrame(ram, vram, 500);
+
+		g_Config.iNumWorkerThreads = 1;
+		double st = real_time_now();
+		single.Capture(singleUndo);
+		double mid = real_time_now();
+		g_Config.iNumWorkerThreads = std::max(oldNumWorkerThreads, 2);
+		multi.Capture(multiUndo);
+		double end = real_time_now();
+
+		singleTime += mid - st;
+		multiTime += end - mid;
+		if (singleUndo.pages != multiUndo.pages || singleUndo.data != multiUndo.data) {
+			g_Config.iNumWorkerThreads = oldNumWorkerThreads;
+			printf("MemSnapshot: Threaded capture differs from single threaded\n");
+			return false;
+		}
+	}
+	g_Config.iNumWorkerThreads = oldNumWorkerThreads;
+
+	printf("MemSnapshot: capture %0.2f ms on one thread, %0.2f ms on the thread pool (%.2fx)\n", singleTime * 1000.0 / rounds, multiTime * 1000.0 / rounds, singleTime / multiTime);
+	return true;
+}
+
+bool TestMemSnapshot() {
+	std::vector<u8> ram(32 * 1024 * 1024);
+	std::vector<u8> vram(2 * 1024 * 1024);
+	std::vector<u8> scratchpad(16 * 1024);
+	for (size_t i = 0; i < ram.size(); ++i) {
+		ram[i] = (u8)(i >> 10);
+	}
+
+	std::vector<MemSnapshot::Region> regions(3);
+	regions[0].ptr = &ram[0];
+	regions[0].size = (u32)ram.size();
+	regions[1].ptr = &vram[0];
+	regions[1].size = (u32)vram.size();
+	regions[2].ptr = &scratchpad[0];
+	regions[2].size = (u32)scratchpad.size();
+
+	MemSnapshot snapshot;
+	EXPECT_FALSE(snapshot.SetRegions(regions));
+	EXPECT_TRUE(snapshot.SetRegions(regions));
+
+	const int snapshots = 20;
+	std::vector<MemSnapshot::Undo> undos(snapshots);
+	std::vector<std::vector<u8>> expected;
+	std::vector<u8> scratch;
+	double captureTime = 0.0;
+	double compressTime = 0.0;
+	size_t undoBytes = 0;
+	u32 changedPages = 0;
+
+	EXPECT_EQ_INT((int)snapshot.Capture(undos[0]), (int)((ram.size() + vram.size() + scratchpad.size()) / MemSnapshot::PAGE_BYTES));
+	EXPECT_TRUE(undos[0].pages.empty());
+	expected.push_back(ram);
+	for (int i = 1; i < snapshots; ++i) {
+		SimulateFrame(ram, vram, 500);
+		scratchpad[i * 100] = (u8)i;
+		expected.push_back(ram);
+
+		double st = real_time_now();
+		changedPages += snapshot.Capture(undos[i]);
+		double mid = real_time_now();
+		MemSnapshot::Compress(undos[i], scratch);
+		double end = real_time_now();
+
+		captureTime += mid - st;
+		compressTime += end - mid;
+		undoBytes += undos[i].data.size();
+	}
+
+	// Nothing changed, nothing saved.
+	MemSnapshot::Undo unchanged;
+	EXPECT_EQ_INT((int)snapshot.Capture(unchanged), 0);
+
+	// Now walk back through all of them.
+	double restoreTime = 0.0;
+	for (int i = snapshots - 1; i >= 0; --i) {
+		SimulateFrame(ram, vram, 100);
+		double st = real_time_now();
+		EXPECT_TRUE(snapshot.Restore());
+		snapshot.Revert(undos[i]);
+		restoreTime += real_time_now() - st;
+		EXPECT_TRUE(ram == expected[i]);
+	}
+	EXPECT_EQ_INT((int)scratchpad[100], 0);
+
+	// Moving memory invalidates the copy.
+	regions[2].ptr = &vram[0];
+	EXPECT_FALSE(snapshot.SetRegions(regions));
+	EXPECT_TRUE(snapshot.Empty());
+	EXPECT_FALSE(snapshot.Restore());
+
+	regions[2].ptr = &scratchpad[0];
+	if (!CompareThreading(regions, ram, vram))
+		return false;
+
+	const int n = snapshots - 1;
+	printf("MemSnapshot: %d pages changed per snapshot, capture %0.2f ms, compress %0.2f ms, %d KB, restore %0.2f ms\n",
+		changedPages / n, captureTime * 1000.0 / n, compressTime * 1000.0 / n, (int)(undoBytes / n / 1024), restoreTime * 1000.0 / snapshots);
+	return true;
+}
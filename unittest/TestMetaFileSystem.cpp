@@ -0,0 +1,408 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/timeutil.h"
+#include "thread/thread.h"
+#include "Common/Common.h"
+#include "Core/FileSystems/BlockDevices.h"
+#include "Core/FileSystems/ISOFileSystem.h"
+#include "Core/FileSystems/MetaFileSystem.h"
+#include "unittest/UnitTest.h"
+
+static const int ERROR_ERRNO_FILE_NOT_FOUND = 0x80010002;
+
+// Serves every filename with the same data.  Not thread safe by itself, like the real
+// file systems: MetaFileSystem must not call into it from two threads at once.
+class MemoryFileSystem : public EmptyFileSystem {
+public:
+	MemoryFileSystem(IHandleAllocator *hAlloc, const std::vector<u8> &data)
+		: hAlloc_(hAlloc), data_(data), busy_(false), overlapped_(false) {
+	}
+
+	u32 OpenFile(std::string filename, FileAccess access, const char *devicename = nullptr) override {
+		Enter();
+		u32 handle = 0;
+		if (filename.find("missing") == filename.npos) {
+			handle = hAlloc_->GetNewHandle();
+			handles_[handle] = 0;
+		}
+		Leave();
+		return handle == 0 ? (u32)ERROR_ERRNO_FILE_NOT_FOUND : handle;
+	}
+
+	void CloseFile(u32 handle) override {
+		Enter();
+		handles_.erase(handle);
+		Leave();
+	}
+
+	size_t ReadFile(u32 handle, u8 *pointer, s64 size) override {
+		Enter();
+		size_t bytes = 0;
+		auto it = handles_.find(handle);
+		if (it != handles_.end()) {
+			bytes = (size_t)std::min(size, (s64)(data_.size() - it->second));
+			memcpy(pointer, &data_[it->second], bytes);
+			it->second += bytes;
+		}
+		Leave();
+		return bytes;
+	}
+
+	size_t ReadFile(u32 handle, u8 *pointer, s64 size, int &usec) override {
+		return ReadFile(handle, pointer, size);
+	}
+
+	size_t SeekFile(u32 handle, s32 position, FileMove type) override {
+		Enter();
+		size_t pos = 0;
+		auto it = handles_.find(handle);
+		if (it != handles_.end() && type == FILEMOVE_BEGIN) {
+			it->second = std::min((size_t)position, data_.size());
+			pos = it->second;
+		}
+		Leave();
+		return pos;
+	}
+
+	bool OwnsHandle(u32 handle) override {
+		return handles_.find(handle) != handles_.end();
+	}
+
+	bool Overlapped() const {
+		return overlapped_;
+	}
+
+private:
+	void Enter() {
+		if (busy_)
+			overlapped_ = true;
+		busy_ = true;
+	}
+	void Leave() {
+		busy_ = false;
+	}
+
+	IHandleAllocator *hAlloc_;
+	std::vector<u8> data_;
+	std::map<u32, size_t> handles_;
+	volatile bool busy_;
+	volatile bool overlapped_;
+};
+
+struct GateState {
+	volatile bool entered;
+	volatile bool release;
+	volatile bool calledUnmounted;
+};
+
+// The first GetFileInfo() blocks (holding its lock) until released, so other calls queue up
+// behind it.  Notes any call made after it was no longer mounted at umd0:.
+class GateFileSystem : public EmptyFileSystem {
+public:
+	GateFileSystem(MetaFileSystem *meta, GateState *state, const std::string &name)
+		: meta_(meta), state_(state), name_(name), blocked_(false) {
+	}
+
+	PSPFileInfo GetFileInfo(std::string filename) override {
+		if (meta_->GetSystem("umd0:") != this)
+			state_->calledUnmounted = true;
+		if (!blocked_) {
+			blocked_ = true;
+			state_->entered = true;
+			while (!state_->release)
+				sleep_ms(1);
+		}
+		PSPFileInfo info;
+		info.name = name_;
+		info.exists = true;
+		return info;
+	}
+
+private:
+	MetaFileSystem *meta_;
+	GateState *state_;
+	std::string name_;
+	bool blocked_;
+};
+
+static void GetInfoFromUmd(MetaFileSystem *meta) {
+	meta->GetFileInfo("umd0:/UMD_DATA.BIN");
+}
+
+static void SwapUmd(MetaFileSystem *meta, IFileSystem *oldSystem, IFileSystem *newSystem) {
+	if (newSystem) {
+		meta->Remount(oldSystem, newSystem);
+		// Like sceUmd, which deletes the old one right after remounting.
+		delete oldSystem;
+	} else {
+		// This deletes it.
+		meta->Shutdown();
+	}
+}
+
+// One call blocks inside the mounted system, a second waits for its lock, and meanwhile it
+// gets swapped out (or everything is shut down.)  The second call must not reach it after.
+static bool TestRemountWhileWaiting(bool shutdown) {
+	GateState state = { false, false, false };
+	MetaFileSystem meta;
+	GateFileSystem *oldUmd = new GateFileSystem(&meta, &state, "old");
+	GateFileSystem *newUmd = new GateFileSystem(&meta, &state, "new");
+	meta.Mount("umd0:", oldUmd);
+
+	std::thread blocker(&GetInfoFromUmd, &meta);
+	while (!state.entered)
+		sleep_ms(1);
+	std::thread waiter(&GetInfoFromUmd, &meta);
+	std::thread swapper(&SwapUmd, &meta, oldUmd, shutdown ? nullptr : newUmd);
+	// Give both time to block on the lock before letting the first call finish.
+	sleep_ms(50);
+	state.release = true;
+	blocker.join();
+	waiter.join();
+	swapper.join();
+
+	EXPECT_FALSE(state.calledUnmounted);
+	if (shutdown) {
+		delete newUmd;
+	} else {
+		EXPECT_EQ_STR(meta.GetFileInfo("umd0:/UMD_DATA.BIN").name, std::string("new"));
+		meta.Shutdown();
+	}
+	return true;
+}
+
+struct ReaderState {
+	MetaFileSystem *meta;
+	std::string path;
+	const std::vector<u8> *data;
+	int rounds;
+	int errors;
+};
+
+static void ReadRepeatedly(ReaderState *state) {
+	std::vector<u8> buf(state->data->size());
+	for (int r = 0; r < state->rounds; ++r) {
+		u32 handle = state->meta->OpenFile(state->path, FILEACCESS_READ);
+		if (handle == 0) {
+			state->errors++;
+			continue;
+		}
+		const size_t chunk = 4096;
+		for (size_t pos = 0; pos < buf.size(); pos += chunk) {
+			state->meta->ReadFile(handle, &buf[pos], std::min(chunk, buf.size() - pos));
+		}
+		if (memcmp(&buf[0], &(*state->data)[0], buf.size()) != 0) {
+			state->errors++;
+		}
+		state->meta->CloseFile(handle);
+	}
+}
+
+// Opens and reads from that many threads at once, split over the mounted prefixes.
+static double RunReaders(MetaFileSystem &meta, const std::vector<std::string> &paths, const std::vector<u8> &data, int threads, int rounds, int &errors) {
+	std::vector<ReaderState> states(threads);
+	std::vector<std::thread> running;
+	double st = real_time_now();
+	for (int i = 0; i < threads; ++i) {
+		ReaderState &state = states[i];
+		state.meta = &meta;
+		state.path = paths[i % paths.size()];
+		state.data = &data;
+		state.rounds = rounds;
+		state.errors = 0;
+		running.push_back(std::thread(&ReadRepeatedly, &state));
+	}
+	for (size_t i = 0; i < running.size(); ++i) {
+		running[i].join();
+	}
+	double elapsed = real_time_now() - st;
+
+	for (int i = 0; i < threads; ++i) {
+		errors += states[i].errors;
+	}
+	return (threads * rounds) / elapsed;
+}
+
+// An empty disc that notes overlapping reads, like MemoryFileSystem does.
+class OverlapBlockDevice : public BlockDevice {
+public:
+	OverlapBlockDevice() : data_(32 * 2048), busy_(false), overlapped_(false) {
+		memcpy(&data_[16 * 2048 + 1], "CD001", 5);
+	}
+
+	bool ReadBlock(int blockNumber, u8 *outPtr) override {
+		if (busy_)
+			overlapped_ = true;
+		busy_ = true;
+		// Let other readers in, like waiting on a slow disc would.
+		std::this_thread::yield();
+		memcpy(outPtr, &data_[blockNumber * 2048], 2048);
+		busy_ = false;
+		return true;
+	}
+	u32 GetNumBlocks() override { return (u32)(data_.size() / 2048); }
+
+	bool Overlapped() const {
+		return overlapped_;
+	}
+
+private:
+	std::vector<u8> data_;
+	volatile bool busy_;
+	volatile bool overlapped_;
+};
+
+struct SectorReaderState {
+	MetaFileSystem *meta;
+	std::string path;
+	// umd0: reads in sectors, disc0: in bytes.
+	s64 size;
+	int rounds;
+	int errors;
+};
+
+static void ReadSectorRepeatedly(SectorReaderState *state) {
+	u8 buf[2048];
+	for (int r = 0; r < state->rounds; ++r) {
+		u32 handle = state->meta->OpenFile(state->path, FILEACCESS_READ);
+		if ((s32)handle <= 0) {
+			state->errors++;
+			continue;
+		}
+		state->meta->SeekFile(handle, 16 * (s32)state->size, FILEMOVE_BEGIN);
+		state->meta->ReadFile(handle, buf, state->size);
+		if (memcmp(buf + 1, "CD001", 5) != 0) {
+			state->errors++;
+		}
+		state->meta->CloseFile(handle);
+	}
+}
+
+// The block device mounts (umd0: and friends) wrap the disc0: file system, so they must
+// share its lock even though they're different systems.
+static bool TestISOBlockSystemPair() {
+	MetaFileSystem meta;
+	OverlapBlockDevice *device = new OverlapBlockDevice();
+	ISOFileSystem *iso = new ISOFileSystem(&meta, device);
+	ISOBlockSystem *blockSystem = new ISOBlockSystem(iso);
+	meta.Mount("umd0:", blockSystem);
+	meta.Mount("umd1:", blockSystem);
+	meta.Mount("disc0:", iso);
+	meta.Mount("umd:", blockSystem);
+
+	SectorReaderState states[4];
+	std::vector<std::thread> running;
+	for (int i = 0; i < 4; ++i) {
+		SectorReaderState &state = states[i];
+		state.meta = &meta;
+		state.path = i & 1 ? "disc0:/sce_lbn0x0_size0x10000" : (i & 2 ? "umd1:" : "umd0:");
+		state.size = i & 1 ? 2048 : 1;
+		state.rounds = 2000;
+		state.errors = 0;
+		running.push_back(std::thread(&ReadSectorRepeatedly, &state));
+	}
+	for (size_t i = 0; i < running.size(); ++i) {
+		running[i].join();
+	}
+
+	for (int i = 0; i < 4; ++i) {
+		EXPECT_EQ_INT(states[i].errors, 0);
+	}
+	EXPECT_FALSE(device->Overlapped());
+
+	meta.Shutdown();
+	return true;
+}
+
+bool TestMetaFileSystem() {
+	std::vector<u8> data(64 * 1024);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = (u8)(i * 7 + (i >> 8));
+	}
+
+	MetaFileSystem meta;
+	MemoryFileSystem *ms = new MemoryFileSystem(&meta, data);
+	MemoryFileSystem *disc = new MemoryFileSystem(&meta, data);
+	meta.Mount("ms0:", ms);
+	meta.Mount("fatms0:", ms);
+	meta.Mount("disc0:", disc);
+	meta.Mount("umd0:", disc);
+
+	// Prefix matching is case insensitive and goes through NormalizePrefix.
+	IFileSystem *system = nullptr;
+	std::string path;
+	EXPECT_TRUE(meta.MapFilePath("MS0:/PSP/GAME/EBOOT.PBP", path, &system));
+	EXPECT_TRUE(system == ms);
+	EXPECT_EQ_STR(path, std::string("/PSP/GAME/EBOOT.PBP"));
+	EXPECT_TRUE(meta.MapFilePath("umd1:/UMD_DATA.BIN", path, &system));
+	EXPECT_TRUE(system == disc);
+	EXPECT_TRUE(meta.MapFilePath("  fatms0:/x", path, &system));
+	EXPECT_TRUE(system == ms);
+	EXPECT_FALSE(meta.MapFilePath("flash0:/kd/x.prx", path, &system));
+
+	int error = 0;
+	EXPECT_EQ_INT(meta.OpenWithError(error, "ms0:/missing", FILEACCESS_READ), 0);
+	EXPECT_EQ_INT(error, ERROR_ERRNO_FILE_NOT_FOUND);
+	u32 handle = meta.OpenWithError(error, "disc0:/file", FILEACCESS_READ);
+	EXPECT_TRUE(handle != 0);
+	EXPECT_EQ_INT(error, 0);
+	EXPECT_TRUE(meta.GetHandleOwner(handle) == disc);
+	meta.CloseFile(handle);
+	EXPECT_TRUE(meta.GetHandleOwner(handle) == nullptr);
+
+	// Handles stay with their file system, even after it's unmounted from one prefix.
+	handle = meta.OpenFile("fatms0:/file", FILEACCESS_READ);
+	meta.Unmount("fatms0:", ms);
+	EXPECT_FALSE(meta.MapFilePath("fatms0:/file", path, &system));
+	EXPECT_TRUE(meta.GetHandleOwner(handle) == ms);
+	u8 first[16];
+	EXPECT_EQ_INT((int)meta.ReadFile(handle, first, sizeof(first)), (int)sizeof(first));
+	EXPECT_TRUE(memcmp(first, &data[0], sizeof(first)) == 0);
+	meta.CloseFile(handle);
+
+	std::vector<std::string> paths;
+	paths.push_back("ms0:/PSP/SAVEDATA/DATA.BIN");
+	paths.push_back("disc0:/PSP_GAME/USRDIR/DATA.BIN");
+
+	// Now the benchmark: parallel opens and reads, like a game streaming while saving.
+	const int rounds = 200;
+	int errors = 0;
+	double single = RunReaders(meta, paths, data, 1, rounds * 2, errors);
+	double parallel = RunReaders(meta, paths, data, 4, rounds, errors);
+	EXPECT_EQ_INT(errors, 0);
+	EXPECT_FALSE(ms->Overlapped());
+	EXPECT_FALSE(disc->Overlapped());
+	printf("MetaFileSystem: %0.0f opens/sec from 1 thread, %0.0f opens/sec from 4 threads\n", single, parallel);
+
+	meta.Shutdown();
+
+	if (!TestRemountWhileWaiting(false))
+		return false;
+	if (!TestRemountWhileWaiting(true))
+		return false;
+	if (!TestISOBlockSystemPair())
+		return false;
+	return true;
+}
@@ -0,0 +1,154 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "base/timeutil.h"
+#include "Common/Common.h"
+#include "Common/FileUtil.h"
+#include "Core/FileLoaders/ReadTrace.h"
+#include "unittest/UnitTest.h"
+
+static const char *const TRACE_DIR = "unittest_readtrace";
+static const char *const TRACE_IMAGE = "unittest_readtrace.iso";
+static const s64 IMAGE_SIZE = 1024LL * 1024 * 1024;
+
+static std::vector<ReadTrace::Entry> PredictAll(ReadTrace &trace) {
+	std::vector<ReadTrace::Entry> upcoming;
+	trace.Predict(upcoming, 0x7FFFFFFF);
+	return upcoming;
+}
+
+// Far apart, so none of them merge.
+static s64 ScatteredPos(int i) {
+	return 16 * 1024 * 1024 + (s64)i * 65536;
+}
+
+static bool CheckMergeAndPredict() {
+	{
+		ReadTrace trace(TRACE_IMAGE, IMAGE_SIZE);
+		// Nothing from before, so nothing to predict.
+		trace.Record(0, 2048);
+		EXPECT_TRUE(PredictAll(trace).empty());
+
+		// Sequential reads merge, up to 4 MB.
+		trace.Record(2048, 2048);
+		trace.Record(1024 * 1024, 4096);
+		trace.Record(8 * 1024 * 1024, 3 * 1024 * 1024);
+		trace.Record(11 * 1024 * 1024, 2 * 1024 * 1024);
+		for (int i = 0; i < 200; ++i) {
+			trace.Record(ScatteredPos(i), 100);
+		}
+	}
+
+	ReadTrace trace(TRACE_IMAGE, IMAGE_SIZE);
+	EXPECT_TRUE(PredictAll(trace).empty());
+
+	// Starting the same way, we should follow along.
+	trace.Record(0, 16);
+	std::vector<ReadTrace::Entry> upcoming = PredictAll(trace);
+	EXPECT_EQ_INT((int)upcoming.size(), 204);
+	EXPECT_EQ_INT((int)upcoming[0].pos, 0);
+	EXPECT_EQ_INT((int)upcoming[0].size, 4096);
+	EXPECT_EQ_INT((int)upcoming[1].pos, 1024 * 1024);
+	EXPECT_EQ_INT((int)upcoming[2].pos, 8 * 1024 * 1024);
+	EXPECT_EQ_INT((int)upcoming[2].size, 3 * 1024 * 1024);
+	EXPECT_EQ_INT((int)upcoming[3].pos, 11 * 1024 * 1024);
+	EXPECT_EQ_INT((int)upcoming[3].size, 2 * 1024 * 1024);
+	EXPECT_TRUE(upcoming[4].pos == ScatteredPos(0));
+
+	// Only as much as asked for, but at least one.
+	upcoming.clear();
+	trace.Predict(upcoming, 5000);
+	EXPECT_EQ_INT((int)upcoming.size(), 2);
+	upcoming.clear();
+	trace.Predict(upcoming, 1);
+	EXPECT_EQ_INT((int)upcoming.size(), 1);
+
+	// A read inside an entry, far beyond the search window.
+	trace.Record(ScatteredPos(150) + 50, 10);
+	upcoming = PredictAll(trace);
+	EXPECT_EQ_INT((int)upcoming.size(), 50);
+	EXPECT_TRUE(upcoming[0].pos == ScatteredPos(150));
+
+	// Inside the big merged read, found by position, then back again.
+	trace.Record(12 * 1024 * 1024, 10);
+	upcoming = PredictAll(trace);
+	EXPECT_EQ_INT((int)upcoming.size(), 201);
+	EXPECT_EQ_INT((int)upcoming[0].pos, 11 * 1024 * 1024);
+	trace.Record(ScatteredPos(10), 10);
+	EXPECT_TRUE(PredictAll(trace)[0].pos == ScatteredPos(10));
+
+	// Never read before, so we're off the path.
+	trace.Record(IMAGE_SIZE - 4096, 10);
+	EXPECT_TRUE(PredictAll(trace).empty());
+	return true;
+}
+
+static bool CheckSaveRules() {
+	// The session above was shorter, so it didn't replace the trace.
+	{
+		ReadTrace trace(TRACE_IMAGE, IMAGE_SIZE);
+		trace.Record(ScatteredPos(199), 100);
+		EXPECT_EQ_INT((int)PredictAll(trace).size(), 1);
+	}
+
+	// A different image of the same name doesn't use it.
+	ReadTrace other(TRACE_IMAGE, IMAGE_SIZE - 2048);
+	other.Record(0, 16);
+	EXPECT_TRUE(PredictAll(other).empty());
+	return true;
+}
+
+static double TimeOffTraceReads(ReadTrace &trace, int count) {
+	double st = real_time_now();
+	for (int i = 0; i < count; ++i) {
+		// Misses that aren't near anything, the worst case for the lookup.
+		trace.Record(IMAGE_SIZE - 4096 - (s64)(i & 1023) * 16, 4);
+	}
+	return real_time_now() - st;
+}
+
+bool TestReadTrace() {
+	File::CreateFullPath(TRACE_DIR);
+	ReadTrace::SetTraceDir(TRACE_DIR);
+	const std::string traceFile = std::string(TRACE_DIR) + "/" + TRACE_IMAGE + ".pptrace";
+	File::Delete(traceFile);
+
+	bool result = CheckMergeAndPredict() && CheckSaveRules();
+
+	if (result) {
+		// A full trace, to see the lookup doesn't scan all of it.
+		File::Delete(traceFile);
+		{
+			ReadTrace trace(TRACE_IMAGE, IMAGE_SIZE);
+			for (int i = 0; i < 65536; ++i) {
+				trace.Record((s64)i * 8192, 4096);
+			}
+		}
+		ReadTrace trace(TRACE_IMAGE, IMAGE_SIZE);
+		const double offTime = TimeOffTraceReads(trace, 20000);
+		printf("ReadTrace: %0.2f us per read off a 65536 entry trace\n", offTime * 1000000.0 / 20000);
+	}
+
+	File::Delete(traceFile);
+	ReadTrace::SetTraceDir("");
+	File::DeleteDir(TRACE_DIR);
+	return result;
+}
@@ -0,0 +1,146 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Common/FileUtil.h"
+#include "Core/CoreTiming.h"
+#include "Core/MIPS/MIPS.h"
+#include "Core/Replay.h"
+#include "unittest/UnitTest.h"
+
+static const char *const REPLAY_TEST_FILE = "unittest_replay.ppr";
+
+struct ReplaySample {
+	u32 buttons;
+	u8 analog[2][2];
+	bool ioReady;
+};
+
+struct ReplayFired {
+	u64 userdata;
+	u64 ticks;
+
+	bool operator == (const ReplayFired &other) const {
+		return userdata == other.userdata && ticks == other.ticks;
+	}
+};
+
+static std::vector<ReplayFired> replayFired;
+static int replayTestEvent = -1;
+
+static void ReplayTestCallback(u64 userdata, int cyclesLate) {
+	ReplayFired fired;
+	fired.userdata = userdata;
+	fired.ticks = CoreTiming::GetTicks();
+	replayFired.push_back(fired);
+}
+
+static void ReplayResetTiming() {
+	CoreTiming::Shutdown();
+	CoreTiming::Init();
+	replayTestEvent = CoreTiming::RegisterEvent("ReplayTestIo", &ReplayTestCallback);
+	replayFired.clear();
+}
+
+// Like the CPU running for a while, then CoreTiming catching up.
+static void ReplayRunCycles(int cycles) {
+	currentMIPS->downcount -= cycles;
+	CoreTiming::Advance();
+}
+
+static const int REPLAY_STEPS = 200;
+
+// What the latch and the IO checks would see at each step.  When playing, the live
+// values are all different, and events arrive earlier, so only the recording counts.
+static void ReplayRunSteps(bool live, std::vector<ReplaySample> &samples) {
+	for (int step = 0; step < REPLAY_STEPS; ++step) {
+		if (live && step % 20 == 5) {
+			// Another thread (like IO) finishing something.
+			CoreTiming::ScheduleEvent_Threadsafe(usToCycles(2 + step / 20), replayTestEvent, step);
+		} else if (!live && step % 20 == 0) {
+			CoreTiming::ScheduleEvent_Threadsafe(usToCycles(10), replayTestEvent, step + 5);
+		}
+
+		ReplaySample sample;
+		sample.buttons = live ? (step / 7) * 0x10 : 0xFFFFFFFF;
+		memset(sample.analog, live ? 128 + step / 13 : 0, sizeof(sample.analog));
+		ReplayApplyCtrl(sample.buttons, sample.analog, CoreTiming::GetTicks());
+		sample.ioReady = ReplayApplyIoReady(live ? step % 3 == 0 : step % 3 != 0, CoreTiming::GetTicks());
+		samples.push_back(sample);
+
+		ReplayRunCycles(1000 + step * 3);
+	}
+}
+
+static bool ReplaySamplesEqual(const std::vector<ReplaySample> &a, const std::vector<ReplaySample> &b) {
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); ++i) {
+		if (a[i].buttons != b[i].buttons || a[i].ioReady != b[i].ioReady)
+			return false;
+		if (memcmp(a[i].analog, b[i].analog, sizeof(a[i].analog)) != 0)
+			return false;
+	}
+	return true;
+}
+
+bool TestReplay() {
+	std::vector<ReplaySample> recorded;
+	ReplayResetTiming();
+	ReplayBeginRecording();
+	EXPECT_TRUE(ReplayIsRecording());
+	ReplayRunSteps(true, recorded);
+	std::vector<ReplayFired> recordedFired = replayFired;
+	EXPECT_TRUE(ReplayFinishRecording(REPLAY_TEST_FILE));
+	EXPECT_FALSE(ReplayIsRecording());
+	EXPECT_EQ_INT((int)recordedFired.size(), REPLAY_STEPS / 20);
+
+	// Only from the same tick it was recorded at.
+	ReplayResetTiming();
+	ReplayRunCycles(1);
+	EXPECT_FALSE(ReplayBeginPlayback(REPLAY_TEST_FILE));
+	EXPECT_FALSE(ReplayIsPlaying());
+
+	std::vector<ReplaySample> played;
+	ReplayResetTiming();
+	EXPECT_TRUE(ReplayBeginPlayback(REPLAY_TEST_FILE));
+	EXPECT_TRUE(ReplayIsPlaying());
+	ReplayRunSteps(false, played);
+	EXPECT_TRUE(ReplayIsFinished());
+
+	EXPECT_TRUE(ReplaySamplesEqual(recorded, played));
+	EXPECT_EQ_INT((int)replayFired.size(), (int)recordedFired.size());
+	EXPECT_TRUE(replayFired == recordedFired);
+
+	// A cut off file is rejected whole.
+	{
+		File::IOFile file(REPLAY_TEST_FILE, "r+b");
+		file.Resize(file.GetSize() - 1);
+	}
+	ReplayResetTiming();
+	EXPECT_FALSE(ReplayBeginPlayback(REPLAY_TEST_FILE));
+	EXPECT_FALSE(ReplayIsPlaying());
+
+	File::Delete(REPLAY_TEST_FILE);
+	CoreTiming::Shutdown();
+	return true;
+}
@@ -0,0 +1,138 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "GPU/GPUState.h"
+#include "GPU/ge_constants.h"
+#include "GPU/Common/ShaderId.h"
+#include "unittest/UnitTest.h"
+
+static ShaderID MakeID(u32 a, u32 b) {
+	ShaderID id;
+	id.d[0] = a;
+	id.d[1] = b;
+	return id;
+}
+
+static bool SameCache(const ShaderCacheFile &a, const ShaderCacheFile &b) {
+	EXPECT_EQ_INT((int)a.featureFlags, (int)b.featureFlags);
+	EXPECT_EQ_INT((int)a.driverHash, (int)b.driverHash);
+	EXPECT_EQ_INT((int)a.vertexShaders.size(), (int)b.vertexShaders.size());
+	EXPECT_EQ_INT((int)a.fragmentShaders.size(), (int)b.fragmentShaders.size());
+	EXPECT_EQ_INT((int)a.programs.size(), (int)b.programs.size());
+	EXPECT_TRUE(a.vertexShaders == b.vertexShaders);
+	EXPECT_TRUE(a.fragmentShaders == b.fragmentShaders);
+	for (size_t i = 0; i < a.programs.size(); i++) {
+		EXPECT_TRUE(a.programs[i].vsid == b.programs[i].vsid);
+		EXPECT_TRUE(a.programs[i].fsid == b.programs[i].fsid);
+		EXPECT_EQ_INT((int)a.programs[i].binaryFormat, (int)b.programs[i].binaryFormat);
+		EXPECT_TRUE(a.programs[i].binary == b.programs[i].binary);
+	}
+	return true;
+}
+
+static bool CheckCacheFile() {
+	ShaderCacheFile cache;
+	cache.featureFlags = 0x1234;
+	cache.driverHash = 0xCAFEBABE;
+	cache.vertexShaders.push_back(MakeID(1, 2));
+	cache.vertexShaders.push_back(MakeID(3, 4));
+	cache.fragmentShaders.push_back(MakeID(5, 6));
+	cache.programs.resize(2);
+	cache.programs[0].vsid = MakeID(1, 2);
+	cache.programs[0].fsid = MakeID(5, 6);
+	cache.programs[0].binaryFormat = 0x8741;
+	for (int i = 0; i < 37; i++)
+		cache.programs[0].binary.push_back((u8)(i * 3));
+	cache.programs[1].vsid = MakeID(3, 4);
+	cache.programs[1].fsid = MakeID(5, 6);
+	cache.programs[1].binaryFormat = 0;
+
+	std::vector<u8> data;
+	cache.Serialize(data);
+	ShaderCacheFile loaded;
+	EXPECT_TRUE(loaded.Deserialize(data.data(), data.size()));
+	if (!SameCache(cache, loaded))
+		return false;
+
+	// Every cut must be noticed, and must not leave anything half loaded behind.
+	for (size_t size = 0; size < data.size(); size++) {
+		if (loaded.Deserialize(data.data(), size)) {
+			printf("ShaderCache: Accepted a file truncated to %d of %d bytes\n", (int)size, (int)data.size());
+			return false;
+		}
+		EXPECT_EQ_INT((int)loaded.vertexShaders.size(), 0);
+		EXPECT_EQ_INT((int)loaded.programs.size(), 0);
+	}
+
+	std::vector<u8> bad = data;
+	bad[0] ^= 0xFF;
+	EXPECT_FALSE(loaded.Deserialize(bad.data(), bad.size()));
+	bad = data;
+	// The version follows the magic.
+	bad[4] = 99;
+	EXPECT_FALSE(loaded.Deserialize(bad.data(), bad.size()));
+
+	// Version 1 files only have the IDs.
+	const u32 header[7] = { 0x83277592, 1, 0x1234, 0, 1, 1, 1 };
+	std::vector<u8> old((const u8 *)header, (const u8 *)header + sizeof(header));
+	const ShaderID ids[3] = { MakeID(1, 2), MakeID(5, 6), MakeID(1, 2) };
+	old.insert(old.end(), (const u8 *)ids, (const u8 *)ids + sizeof(ids));
+	old.insert(old.end(), (const u8 *)&ids[1], (const u8 *)&ids[1] + sizeof(ShaderID));
+	EXPECT_TRUE(loaded.Deserialize(old.data(), old.size()));
+	EXPECT_EQ_INT((int)loaded.featureFlags, 0x1234);
+	EXPECT_EQ_INT((int)loaded.programs.size(), 1);
+	EXPECT_TRUE(loaded.programs[0].fsid == MakeID(5, 6));
+	EXPECT_EQ_INT((int)loaded.programs[0].binary.size(), 0);
+	return true;
+}
+
+// The cache is only useful if state that changes the shader changes the ID.
+static bool CheckShaderIDs() {
+	memset(&gstate, 0, sizeof(gstate));
+	const u32 vtype = GE_VTYPE_POS_FLOAT | GE_VTYPE_TC_FLOAT | GE_VTYPE_COL_8888;
+
+	ShaderID plainVS, fogVS;
+	ComputeVertexShaderID(&plainVS, vtype, true);
+	gstate.fogEnable = 1;
+	ComputeVertexShaderID(&fogVS, vtype, true);
+	EXPECT_FALSE(plainVS == fogVS);
+	gstate.fogEnable = 0;
+
+	ShaderID again;
+	ComputeVertexShaderID(&again, vtype, true);
+	EXPECT_TRUE(plainVS == again);
+
+	ShaderID plainFS, texFS;
+	ComputeFragmentShaderID(&plainFS);
+	gstate.textureMapEnable = 1;
+	ComputeFragmentShaderID(&texFS);
+	EXPECT_FALSE(plainFS == texFS);
+	gstate.textureMapEnable = 0;
+	return true;
+}
+
+bool TestShaderCache() {
+	if (!CheckCacheFile())
+		return false;
+	if (!CheckShaderIDs())
+		return false;
+	return true;
+}
@@ -0,0 +1,142 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "base/timeutil.h"
+#include "util/random/rng.h"
+#include "Core/Config.h"
+#include "GPU/GPUState.h"
+#include "GPU/ge_constants.h"
+#include "GPU/Common/SoftwareTransformCommon.h"
+#include "GPU/Common/VertexDecoderCommon.h"
+#include "unittest/UnitTest.h"
+
+static const int NUM_VERTS = 16384;
+
+static u32 ToFloat24(float f) {
+	u32 bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits >> 8;
+}
+
+// A lit, skinned character: the case that makes software transform slow.
+static void SetupLitSkinnedState(GMRng &rng) {
+	memset(&gstate, 0, sizeof(gstate));
+	for (int i = 0; i < 12; ++i) {
+		gstate.worldMatrix[i] = (i % 4 == 0) ? 1.0f : 0.0f;
+		gstate.viewMatrix[i] = (i % 4 == 0) ? 1.0f : 0.0f;
+	}
+	for (int i = 0; i < 8 * 12; ++i) {
+		gstate.boneMatrix[i] = rng.F() * 2.0f - 1.0f;
+	}
+
+	gstate.lightingEnable = 1;
+	gstate.materialupdate = 7;
+	gstate.materialspecularcoef = ToFloat24(8.0f);
+	gstate.materialalpha = 0xFF;
+	gstate.ambientcolor = 0x202020;
+	gstate.ambientalpha = 0xFF;
+	for (int l = 0; l < 4; ++l) {
+		gstate.lightEnable[l] = 1;
+		// Alternate directional and point lights, with diffuse and specular.
+		gstate.ltype[l] = ((l & 1) ? GE_LIGHTTYPE_POINT : GE_LIGHTTYPE_DIRECTIONAL) << 8 | GE_LIGHTCOMP_BOTHWITHPOWDIFFUSE;
+		for (int i = 0; i < 3; ++i) {
+			gstate.lpos[l * 3 + i] = ToFloat24(rng.F() * 4.0f - 2.0f);
+			gstate.ldir[l * 3 + i] = ToFloat24(rng.F() * 2.0f - 1.0f);
+			gstate.lcolor[l * 3 + i] = rng.R32() & 0xFFFFFF;
+		}
+		gstate.latt[l * 3 + 0] = ToFloat24(1.0f);
+		gstate.latt[l * 3 + 1] = ToFloat24(0.5f);
+		gstate.latt[l * 3 + 2] = ToFloat24(0.25f);
+	}
+	gstate.fog1 = ToFloat24(10.0f);
+	gstate.fog2 = ToFloat24(0.1f);
+
+	gstate_c.curTextureWidth = 256;
+	gstate_c.curTextureHeight = 256;
+	gstate_c.uv.uScale = 1.0f;
+	gstate_c.uv.vScale = 1.0f;
+	gstate_c.uv.uOff = 0.0f;
+	gstate_c.uv.vOff = 0.0f;
+}
+
+static double RunSoftwareTransform(const VertexDecoder &dec, u8 *decoded, std::vector<u16> &indices, std::vector<TransformedVertex> &transformed, std::vector<TransformedVertex> &expanded, int rounds) {
+	double st = real_time_now();
+	for (int i = 0; i < rounds; ++i) {
+		u16 *inds = &indices[0];
+		int maxIndex = NUM_VERTS;
+		TransformedVertex *drawBuffer = nullptr;
+		int numTrans = 0;
+		bool drawIndexed = false;
+		SoftwareTransformResult result;
+		memset(&result, 0, sizeof(result));
+		SoftwareTransform(GE_PRIM_TRIANGLES, decoded, NUM_VERTS, dec.VertexType(), inds, GE_VTYPE_IDX_NONE, dec.decFmt, maxIndex, nullptr, nullptr, &transformed[0], &expanded[0], drawBuffer, numTrans, drawIndexed, &result, 1.0f);
+	}
+	return real_time_now() - st;
+}
+
+bool TestSoftwareTransform() {
+	GMRng rng;
+	rng.Init(0x1337);
+	SetupLitSkinnedState(rng);
+
+	const bool oldSoftwareSkinning = g_Config.bSoftwareSkinning;
+	const int oldNumWorkerThreads = g_Config.iNumWorkerThreads;
+	// Leave the skinning to SoftwareTransform, like hardware transform off does.
+	g_Config.bSoftwareSkinning = false;
+
+	const u32 vtype = GE_VTYPE_POS_FLOAT | GE_VTYPE_NRM_FLOAT | GE_VTYPE_TC_FLOAT | GE_VTYPE_COL_8888 | GE_VTYPE_WEIGHT_FLOAT | (3 << GE_VTYPE_WEIGHTCOUNT_SHIFT);
+	VertexDecoderOptions options;
+	memset(&options, 0, sizeof(options));
+	VertexDecoder dec;
+	dec.SetVertexType(vtype, options);
+
+	std::vector<u8> src(dec.VertexSize() * NUM_VERTS);
+	for (size_t i = 0; i < src.size(); i += 4) {
+		float_le f = rng.F();
+		memcpy(&src[i], &f, sizeof(f));
+	}
+	std::vector<u8> decoded(dec.decFmt.stride * NUM_VERTS);
+	dec.DecodeVerts(&decoded[0], &src[0], 0, NUM_VERTS - 1);
+
+	std::vector<u16> indices(NUM_VERTS * 2);
+	for (int i = 0; i < NUM_VERTS; ++i) {
+		indices[i] = (u16)i;
+	}
+	std::vector<TransformedVertex> single(NUM_VERTS), multi(NUM_VERTS), expanded(NUM_VERTS * 4);
+
+	g_Config.iNumWorkerThreads = 1;
+	double singleTime = RunSoftwareTransform(dec, &decoded[0], indices, single, expanded, 20);
+	g_Config.iNumWorkerThreads = std::max(oldNumWorkerThreads, 2);
+	double multiTime = RunSoftwareTransform(dec, &decoded[0], indices, multi, expanded, 20);
+
+	g_Config.bSoftwareSkinning = oldSoftwareSkinning;
+	g_Config.iNumWorkerThreads = oldNumWorkerThreads;
+
+	printf("SoftwareTransform: %.1f Mverts/s on one thread, %.1f Mverts/s on the thread pool (%.2fx)\n", NUM_VERTS * 20 / singleTime / 1000000.0, NUM_VERTS * 20 / multiTime / 1000000.0, singleTime / multiTime);
+
+	// Splitting the work must not change a single bit.
+	if (memcmp(&single[0], &multi[0], sizeof(TransformedVertex) * NUM_VERTS) != 0) {
+		printf("SoftwareTransform: Threaded results differ from single threaded\n");
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,385 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "base/timeutil.h"
+#include "util/random/rng.h"
+#include "Core/Config.h"
+#include "GPU/ge_constants.h"
+#include "GPU/Common/SplineCommon.h"
+#include "unittest/UnitTest.h"
+
+static const u32 FULL_VTYPE = GE_VTYPE_POS_FLOAT | GE_VTYPE_NRM_FLOAT | GE_VTYPE_TC_FLOAT | GE_VTYPE_COL_8888;
+static const u32 POS_VTYPE = GE_VTYPE_POS_FLOAT;
+
+static void RandomControlPoints(GMRng &rng, std::vector<SimpleVertex> &points) {
+	for (SimpleVertex &p : points) {
+		p.uv[0] = rng.F();
+		p.uv[1] = rng.F();
+		p.color_32 = rng.R32();
+		p.nrm = Vec3Packedf(rng.F() - 0.5f, rng.F() - 0.5f, rng.F() + 0.5f);
+		p.pos = Vec3Packedf(rng.F() * 10.0f, rng.F() * 10.0f, rng.F() * 10.0f);
+	}
+}
+
+static void ZeroVertex(SimpleVertex &v) {
+	v.uv[0] = 0.0f;
+	v.uv[1] = 0.0f;
+	v.color_32 = 0;
+	v.nrm.SetZero();
+	v.pos.SetZero();
+}
+
+static bool Near(float a, float b, float eps) {
+	return fabsf(a - b) <= eps * std::max(1.0f, fabsf(b));
+}
+
+static bool CompareVertex(const char *name, int i, const SimpleVertex &v, const SimpleVertex &ref, u32 vtype, bool checkNormal) {
+	bool ok = true;
+	for (int c = 0; c < 3; ++c) {
+		ok = ok && Near(v.pos[c], ref.pos[c], 0.00001f);
+		// The normals are normalized with an approximate reciprocal square root.
+		if (checkNormal)
+			ok = ok && Near(v.nrm[c], ref.nrm[c], 0.002f);
+	}
+	ok = ok && Near(v.uv[0], ref.uv[0], 0.00001f) && Near(v.uv[1], ref.uv[1], 0.00001f);
+	for (int c = 0; c < 4; ++c) {
+		ok = ok && abs((int)v.color[c] - (int)ref.color[c]) <= 1;
+	}
+	if (!ok) {
+		printf("%s: vertex %d (vtype %08x) differs: pos %f %f %f / %f %f %f, uv %f %f / %f %f, color %08x / %08x\n", name, i, vtype, v.pos.x, v.pos.y, v.pos.z, ref.pos.x, ref.pos.y, ref.pos.z, v.uv[0], v.uv[1], ref.uv[0], ref.uv[1], (u32)v.color_32, (u32)ref.color_32);
+	}
+	return ok;
+}
+
+// Straightforward per-vertex evaluation, the way tesselation worked before the weight tables.
+static void RefSplineWeights(int i, float t, const float *knot, float *splineVal) {
+	knot += i + 1;
+	float f30 = (t - knot[0]) / (knot[3] - knot[0]);
+	float f41 = (t - knot[1]) / (knot[4] - knot[1]);
+	float f52 = (t - knot[2]) / (knot[5] - knot[2]);
+	float f31 = (t - knot[1]) / (knot[3] - knot[1]);
+	float f42 = (t - knot[2]) / (knot[4] - knot[2]);
+	float f32 = (t - knot[2]) / (knot[3] - knot[2]);
+
+	float a = (1 - f30) * (1 - f31);
+	float b = (f31 * f41);
+	float c = (1 - f41) * (1 - f42);
+	float d = (f42 * f52);
+
+	splineVal[0] = a - (a * f32);
+	splineVal[1] = 1 - a - b + ((a + b + c - 1) * f32);
+	splineVal[2] = b + ((1 - b - c - d) * f32);
+	splineVal[3] = d * f32;
+}
+
+static std::vector<float> RefSplineKnot(int n, int type) {
+	std::vector<float> knot(n + 8, 0.0f);
+	for (int i = 0; i < n - 1; ++i)
+		knot[i + 3] = (float)i;
+	if ((type & 1) == 0) {
+		knot[0] = -3;
+		knot[1] = -2;
+		knot[2] = -1;
+	}
+	if ((type & 2) == 0) {
+		knot[n + 2] = (float)(n - 1);
+		knot[n + 3] = (float)(n);
+		knot[n + 4] = (float)(n + 1);
+	} else {
+		knot[n + 2] = (float)(n - 2);
+		knot[n + 3] = (float)(n - 2);
+		knot[n + 4] = (float)(n - 2);
+	}
+	return knot;
+}
+
+static SimpleVertex RefSplineVertex(const SplinePatchLocal &spatch, const std::vector<float> &knot_u, const std::vector<float> &knot_v, float u, float v, u32 vtype) {
+	int iu = std::min((int)u, spatch.count_u - 4);
+	int iv = std::min((int)v, spatch.count_v - 4);
+	float wu[4], wv[4];
+	RefSplineWeights(iu, u, &knot_u[0], wu);
+	RefSplineWeights(iv, v, &knot_v[0], wv);
+
+	SimpleVertex out;
+	ZeroVertex(out);
+	float col[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int ii = 0; ii < 4; ++ii) {
+		for (int jj = 0; jj < 4; ++jj) {
+			float f = wu[ii] * wv[jj];
+			if (f <= 0.0f)
+				continue;
+			const SimpleVertex *a = spatch.points[spatch.count_u * (iv + jj) + (iu + ii)];
+			out.pos += a->pos * f;
+			out.nrm += a->nrm * f;
+			out.uv[0] += a->uv[0] * f;
+			out.uv[1] += a->uv[1] * f;
+			for (int c = 0; c < 4; ++c)
+				col[c] += a->color[c] * (1.0f / 255.0f) * f;
+		}
+	}
+	out.nrm.Normalize();
+	for (int c = 0; c < 4; ++c)
+		out.color[c] = (u8)std::min(std::max((int)floorf(col[c] * 255.0f + 0.5f), 0), 255);
+	return out;
+}
+
+static bool TestSplineMatchesReference(GMRng &rng, int count_u, int count_v, int type_u, int type_v, int tess) {
+	std::vector<SimpleVertex> points(count_u * count_v);
+	RandomControlPoints(rng, points);
+	std::vector<SimpleVertex *> pointers(points.size());
+	for (size_t i = 0; i < points.size(); ++i)
+		pointers[i] = &points[i];
+
+	SplinePatchLocal spatch;
+	spatch.points = &pointers[0];
+	spatch.tess_u = tess;
+	spatch.tess_v = tess;
+	spatch.count_u = count_u;
+	spatch.count_v = count_v;
+	spatch.type_u = type_u;
+	spatch.type_v = type_v;
+	spatch.computeNormals = false;
+	spatch.patchFacing = false;
+	spatch.primType = GE_PATCHPRIM_TRIANGLES;
+
+	const int div_s = std::max((count_u - 3) * tess, 2);
+	const int div_t = std::max((count_v - 3) * tess, 2);
+	std::vector<SimpleVertex> verts((div_s + 1) * (div_t + 1));
+	std::vector<u16> indices(div_s * div_t * 6);
+	u8 *dest = (u8 *)&verts[0];
+	int count = 0;
+	TesselateSplinePatch(dest, &indices[0], count, spatch, FULL_VTYPE, (int)verts.size());
+	if (count != div_s * div_t * 6) {
+		printf("Spline: %d indices, expected %d\n", count, div_s * div_t * 6);
+		return false;
+	}
+
+	const std::vector<float> knot_u = RefSplineKnot(count_u - 1, type_u);
+	const std::vector<float> knot_v = RefSplineKnot(count_v - 1, type_v);
+	for (int tile_v = 0; tile_v < div_t + 1; ++tile_v) {
+		float v = (float)tile_v * (float)(count_v - 3) * (1.0f / (float)div_t);
+		for (int tile_u = 0; tile_u < div_s + 1; ++tile_u) {
+			float u = (float)tile_u * (float)(count_u - 3) * (1.0f / (float)div_s);
+			const int i = tile_v * (div_s + 1) + tile_u;
+			if (!CompareVertex("Spline", i, verts[i], RefSplineVertex(spatch, knot_u, knot_v, u, v, FULL_VTYPE), FULL_VTYPE, true))
+				return false;
+		}
+	}
+	return true;
+}
+
+static inline float bern(int i, float x) {
+	switch (i) {
+	case 0: return (1 - x) * (1 - x) * (1 - x);
+	case 1: return 3 * x * (1 - x) * (1 - x);
+	case 2: return 3 * x * x * (1 - x);
+	default: return x * x * x;
+	}
+}
+
+static inline float bernDeriv(int i, float x) {
+	switch (i) {
+	case 0: return -3 * (x - 1) * (x - 1);
+	case 1: return 9 * x * x - 12 * x + 3;
+	case 2: return 3 * (2 - 3 * x) * x;
+	default: return 3 * x * x;
+	}
+}
+
+static SimpleVertex RefBezierVertex(const BezierPatch &patch, float u, float v, u32 vtype) {
+	SimpleVertex out;
+	ZeroVertex(out);
+	Vec3Packedf du(0.0f, 0.0f, 0.0f), dv(0.0f, 0.0f, 0.0f);
+	for (int row = 0; row < 4; ++row) {
+		for (int col = 0; col < 4; ++col) {
+			const Vec3Packedf &p = patch.points[row * 4 + col]->pos;
+			out.pos += p * (bern(col, u) * bern(row, v));
+			du += p * (bernDeriv(col, u) * bern(row, v));
+			dv += p * (bern(col, u) * bernDeriv(row, v));
+		}
+	}
+	out.nrm = Cross(du, dv).Normalized();
+
+	const BezierPatch::SamplingParams params(u, v);
+	const SimpleVertex *tl = patch.points[params.tl], *tr = patch.points[params.tr];
+	const SimpleVertex *bl = patch.points[params.bl], *br = patch.points[params.br];
+	for (int i = 0; i < 2; ++i) {
+		float upper = tl->uv[i] + params.fracU * (tr->uv[i] - tl->uv[i]);
+		float lower = bl->uv[i] + params.fracU * (br->uv[i] - bl->uv[i]);
+		out.uv[i] = upper + params.fracV * (lower - upper);
+	}
+	for (int c = 0; c < 4; ++c) {
+		float upper = tl->color[c] + params.fracU * (tr->color[c] - tl->color[c]);
+		float lower = bl->color[c] + params.fracU * (br->color[c] - bl->color[c]);
+		out.color[c] = (u8)floorf(upper + params.fracV * (lower - upper) + 0.5f);
+	}
+	return out;
+}
+
+static bool TestBezierMatchesReference(GMRng &rng, int count_u, int count_v, int tess) {
+	std::vector<SimpleVertex> points(count_u * count_v);
+	RandomControlPoints(rng, points);
+
+	const int num_patches_u = (count_u - 1) / 3;
+	const int num_patches_v = (count_v - 1) / 3;
+	std::vector<BezierPatch> patches(num_patches_u * num_patches_v);
+	for (int patch_u = 0; patch_u < num_patches_u; patch_u++) {
+		for (int patch_v = 0; patch_v < num_patches_v; patch_v++) {
+			BezierPatch &patch = patches[patch_u + patch_v * num_patches_u];
+			for (int point = 0; point < 16; ++point)
+				patch.points[point] = &points[(patch_u * 3 + point % 4) + (patch_v * 3 + point / 4) * count_u];
+			patch.u_index = patch_u * 3;
+			patch.v_index = patch_v * 3;
+			patch.index = patch_v * num_patches_u + patch_u;
+			patch.primType = GE_PATCHPRIM_TRIANGLES;
+			patch.computeNormals = true;
+			patch.patchFacing = false;
+		}
+	}
+
+	const int vertsPerPatch = (tess + 1) * (tess + 1);
+	std::vector<SimpleVertex> verts(vertsPerPatch * patches.size());
+	std::vector<u16> indices(tess * tess * 6 * patches.size());
+	u8 *dest = (u8 *)&verts[0];
+	u16 *inds = &indices[0];
+	int count = 0;
+	TesselateBezierPatches(dest, inds, count, tess, tess, &patches[0], (int)patches.size(), FULL_VTYPE, vertsPerPatch);
+	if (count != (int)indices.size() || inds != &indices[0] + indices.size() || dest != (u8 *)(&verts[0] + verts.size())) {
+		printf("Bezier: %d indices, expected %d\n", count, (int)indices.size());
+		return false;
+	}
+
+	for (size_t p = 0; p < patches.size(); ++p) {
+		for (int tile_v = 0; tile_v < tess + 1; ++tile_v) {
+			for (int tile_u = 0; tile_u < tess + 1; ++tile_u) {
+				const int i = (int)p * vertsPerPatch + tile_v * (tess + 1) + tile_u;
+				SimpleVertex ref = RefBezierVertex(patches[p], (float)tile_u / (float)tess, (float)tile_v / (float)tess, FULL_VTYPE);
+				if (!CompareVertex("Bezier", i, verts[i], ref, FULL_VTYPE, true))
+					return false;
+			}
+		}
+		// The indices of each patch point at its own vertices.
+		for (int j = 0; j < tess * tess * 6; ++j) {
+			int index = indices[p * tess * tess * 6 + j];
+			if (index < (int)p * vertsPerPatch || index >= (int)(p + 1) * vertsPerPatch) {
+				printf("Bezier: patch %d index %d out of range\n", (int)p, index);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// Tesselates a big surface on one thread and on the thread pool, which must give exactly the same vertices.
+static bool TestTesselateThreaded(GMRng &rng, bool bezier, u32 vtype, int tess) {
+	const int count_u = bezier ? 13 : 10;
+	const int count_v = bezier ? 13 : 10;
+	std::vector<SimpleVertex> points(count_u * count_v);
+	RandomControlPoints(rng, points);
+	std::vector<SimpleVertex *> pointers(points.size());
+	for (size_t i = 0; i < points.size(); ++i)
+		pointers[i] = &points[i];
+
+	std::vector<BezierPatch> patches(16);
+	for (int patch_idx = 0; patch_idx < 16; patch_idx++) {
+		BezierPatch &patch = patches[patch_idx];
+		for (int point = 0; point < 16; ++point)
+			patch.points[point] = &points[((patch_idx % 4) * 3 + point % 4) + ((patch_idx / 4) * 3 + point / 4) * count_u];
+		patch.u_index = (patch_idx % 4) * 3;
+		patch.v_index = (patch_idx / 4) * 3;
+		patch.index = patch_idx;
+		patch.primType = GE_PATCHPRIM_TRIANGLES;
+		patch.computeNormals = true;
+		patch.patchFacing = true;
+	}
+
+	SplinePatchLocal spatch;
+	spatch.points = &pointers[0];
+	spatch.tess_u = tess;
+	spatch.tess_v = tess;
+	spatch.count_u = count_u;
+	spatch.count_v = count_v;
+	spatch.type_u = 0;
+	spatch.type_v = 3;
+	spatch.computeNormals = true;
+	spatch.patchFacing = false;
+	spatch.primType = GE_PATCHPRIM_TRIANGLES;
+
+	const int maxVerts = 65536;
+	std::vector<SimpleVertex> results[2];
+	std::vector<u16> indices(maxVerts * 6);
+	double times[2];
+	const int oldNumWorkerThreads = g_Config.iNumWorkerThreads;
+	int numVerts = 0;
+	for (int pass = 0; pass < 2; ++pass) {
+		g_Config.iNumWorkerThreads = pass == 0 ? 1 : std::max(oldNumWorkerThreads, 2);
+		results[pass].resize(maxVerts);
+		double st = real_time_now();
+		for (int round = 0; round < 10; ++round) {
+			u8 *dest = (u8 *)&results[pass][0];
+			u16 *inds = &indices[0];
+			int count = 0;
+			if (bezier)
+				TesselateBezierPatches(dest, inds, count, tess, tess, &patches[0], (int)patches.size(), vtype, maxVerts / (int)patches.size());
+			else
+				TesselateSplinePatch(dest, inds, count, spatch, vtype, maxVerts);
+			// Splines don't move dest forward, so go by the indices.
+			numVerts = *std::max_element(&indices[0], &indices[0] + count) + 1;
+		}
+		times[pass] = real_time_now() - st;
+	}
+	g_Config.iNumWorkerThreads = oldNumWorkerThreads;
+
+	printf("%s (vtype %08x): %.1f Mverts/s on one thread, %.1f Mverts/s on the thread pool\n", bezier ? "Bezier" : "Spline", vtype, numVerts * 10 / times[0] / 1000000.0, numVerts * 10 / times[1] / 1000000.0);
+
+	if (memcmp(&results[0][0], &results[1][0], numVerts * sizeof(SimpleVertex)) != 0) {
+		printf("%s: Threaded results differ from single threaded\n", bezier ? "Bezier" : "Spline");
+		return false;
+	}
+	return true;
+}
+
+bool TestSplineCommon() {
+	GMRng rng;
+	rng.Init(0x1337);
+
+	const int oldQuality = g_Config.iSplineBezierQuality;
+	g_Config.iSplineBezierQuality = HIGH_QUALITY;
+
+	bool success = true;
+	for (int type = 0; type < 4; ++type) {
+		success = success && TestSplineMatchesReference(rng, 4, 4, type, type, 8);
+		success = success && TestSplineMatchesReference(rng, 7, 5, type, 3 - type, 6);
+	}
+	success = success && TestBezierMatchesReference(rng, 4, 4, 8);
+	success = success && TestBezierMatchesReference(rng, 10, 7, 12);
+
+	success = success && TestTesselateThreaded(rng, false, FULL_VTYPE, 16);
+	success = success && TestTesselateThreaded(rng, false, POS_VTYPE, 16);
+	success = success && TestTesselateThreaded(rng, true, FULL_VTYPE, 32);
+	success = success && TestTesselateThreaded(rng, true, POS_VTYPE, 32);
+
+	g_Config.iSplineBezierQuality = oldQuality;
+	return success;
+}
@@ -0,0 +1,178 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+
+#include <cstdio>
+#include <vector>
+
+#include "base/timeutil.h"
+#include "thread/thread.h"
+#include "Core/ThreadEventQueue.h"
+#include "unittest/UnitTest.h"
+
+enum TestEventType {
+	TEST_EVENT_INVALID,
+	TEST_EVENT_SYNC,
+	TEST_EVENT_FINISH,
+	TEST_EVENT_COUNT,
+};
+
+struct TestEvent {
+	TestEvent(TestEventType t) : type(t), producer(0), seq(0) {}
+	TestEvent(int p, int s) : type(TEST_EVENT_COUNT), producer(p), seq(s) {}
+	TestEventType type;
+	int producer;
+	int seq;
+
+	operator TestEventType() const {
+		return type;
+	}
+};
+
+class TestQueueBase {
+};
+
+typedef ThreadEventQueue<TestQueueBase, TestEvent, TestEventType, TEST_EVENT_INVALID, TEST_EVENT_SYNC, TEST_EVENT_FINISH> TestEventQueue;
+
+enum {
+	MAX_PRODUCERS = 4,
+};
+
+// Checks that each producer's events arrive complete and in the order scheduled.
+class CountingQueue : public TestEventQueue {
+public:
+	CountingQueue() : outOfOrder_(0), slowEvery_(0) {
+		for (int i = 0; i < MAX_PRODUCERS; ++i) {
+			received_[i] = 0;
+		}
+	}
+
+	int Received(int producer) {
+		return received_[producer];
+	}
+
+	int OutOfOrder() {
+		return outOfOrder_;
+	}
+
+	// Stalls the consumer now and then, so the ring fills up.
+	void SetSlowEvery(int n) {
+		slowEvery_ = n;
+	}
+
+protected:
+	void ProcessEvent(TestEvent ev) override {
+		if (ev.seq != received_[ev.producer]) {
+			outOfOrder_++;
+		}
+		received_[ev.producer]++;
+		if (slowEvery_ != 0 && ev.seq % slowEvery_ == 0) {
+			sleep_ms(1);
+		}
+	}
+
+	bool ShouldExitEventLoop() override {
+		return false;
+	}
+
+private:
+	std::atomic<int> received_[MAX_PRODUCERS];
+	std::atomic<int> outOfOrder_;
+	int slowEvery_;
+};
+
+static void RunConsumer(CountingQueue *queue) {
+	// Runs until the finish event.
+	queue->RunEventsUntil((u64)-1);
+}
+
+struct ProducerState {
+	CountingQueue *queue;
+	int producer;
+	int first;
+	int count;
+	int syncEvery;
+	int lateSyncs;
+};
+
+static void Produce(ProducerState *state) {
+	for (int i = state->first; i < state->first + state->count; ++i) {
+		state->queue->ScheduleEvent(TestEvent(state->producer, i));
+		if ((i + 1) % state->syncEvery == 0) {
+			state->queue->SyncThread(true);
+			// Everything this thread scheduled must be done, whatever the others scheduled meanwhile.
+			if (state->queue->Received(state->producer) < i + 1) {
+				state->lateSyncs++;
+			}
+		}
+	}
+}
+
+bool TestThreadEventQueue() {
+	// Without the thread, events run right away.
+	CountingQueue direct;
+	direct.ScheduleEvent(TestEvent(0, 0));
+	EXPECT_EQ_INT(direct.Received(0), 1);
+	EXPECT_FALSE(direct.HasEvents());
+
+	CountingQueue queue;
+	queue.SetThreadEnabled(true);
+
+	// Nothing takes them yet, so this overflows the ring several times over.
+	const int backlog = 3000;
+	for (int i = 0; i < backlog; ++i) {
+		queue.ScheduleEvent(TestEvent(0, i));
+	}
+	std::thread consumer(&RunConsumer, &queue);
+	queue.SyncThread(true);
+	EXPECT_EQ_INT(queue.Received(0), backlog);
+	EXPECT_EQ_INT(queue.OutOfOrder(), 0);
+
+	// Now from several threads at once, each syncing now and then, with a consumer that lags.
+	const int perProducer = 40000;
+	queue.SetSlowEvery(10000);
+	std::vector<ProducerState> states(MAX_PRODUCERS);
+	std::vector<std::thread> producers;
+	double st = real_time_now();
+	for (int i = 0; i < MAX_PRODUCERS; ++i) {
+		ProducerState &state = states[i];
+		state.queue = &queue;
+		state.producer = i;
+		state.first = i == 0 ? backlog : 0;
+		state.count = perProducer;
+		state.syncEvery = 997 + i * 250;
+		state.lateSyncs = 0;
+		producers.push_back(std::thread(&Produce, &state));
+	}
+	for (size_t i = 0; i < producers.size(); ++i) {
+		producers[i].join();
+	}
+	queue.SyncThread(true);
+	double elapsed = real_time_now() - st;
+
+	queue.FinishEventLoop();
+	consumer.join();
+
+	for (int i = 0; i < MAX_PRODUCERS; ++i) {
+		EXPECT_EQ_INT(states[i].lateSyncs, 0);
+		EXPECT_EQ_INT(queue.Received(i), states[i].first + perProducer);
+	}
+	EXPECT_EQ_INT(queue.OutOfOrder(), 0);
+	EXPECT_FALSE(queue.HasEvents());
+	printf("ThreadEventQueue: %0.0f events/sec from %d threads\n", (MAX_PRODUCERS * perProducer) / elapsed, (int)MAX_PRODUCERS);
+	return true;
+}
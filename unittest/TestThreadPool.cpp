@@ -0,0 +1,59 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstdio>
+#include <vector>
+
+#include "base/mutex.h"
+#include "thread/thread.h"
+#include "thread/threadpool.h"
+#include "unittest/UnitTest.h"
+
+// Like the GPU and emu threads when both use the global pool.
+static void RunLoops(ThreadPool *pool, int seed, int *failures) {
+	for (int round = 0; round < 2000; round++) {
+		std::vector<int> values(64, 0);
+		pool->ParallelLoop([&](int lower, int upper) {
+			for (int i = lower; i < upper; i++)
+				values[i] += i + seed;
+		}, 0, (int)values.size());
+		// Every chunk must be finished when ParallelLoop returns.
+		for (int i = 0; i < (int)values.size(); i++) {
+			if (values[i] != i + seed) {
+				(*failures)++;
+				return;
+			}
+		}
+	}
+}
+
+bool TestThreadPool() {
+	ThreadPool pool(4);
+	int failures[2] = {};
+
+	// The first user starts the workers, it must not matter which thread that is.
+	RunLoops(&pool, 0, &failures[0]);
+	std::thread other(std::bind(&RunLoops, &pool, 1, &failures[1]));
+	RunLoops(&pool, 2, &failures[0]);
+	other.join();
+
+	if (failures[0] || failures[1]) {
+		printf("ThreadPool: ParallelLoop returned before the workers were done\n");
+		return false;
+	}
+	return true;
+}
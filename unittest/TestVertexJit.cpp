@@ -15,7 +15,10 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <cmath>
+#include <vector>
 #include "base/timeutil.h"
+#include "util/random/rng.h"
 #include "Common/Common.h"
 #include "Core/Config.h"
 #include "GPU/Common/VertexDecoderCommon.h"
@@ -77,7 +80,7 @@ class VertexDecoderTestHarness {
 		dec_->DecodeVerts(dst_, src_, indexLowerBound_, indexUpperBound);
 	}
 
-	double ExecuteTimed(int vtype, int indexUpperBound, bool useJit) {
+	double ExecuteTimed(int vtype, int indexUpperBound, bool useJit, double seconds = 0.5) {
 		SetupExecute(vtype, useJit);
 
 		int total = 0;
@@ -87,12 +90,49 @@ class VertexDecoderTestHarness {
 				dec_->DecodeVerts(dst_, src_, indexLowerBound_, indexUpperBound);
 				++total;
 			}
-		} while (real_time_now() - st < 0.5);
+		} while (real_time_now() - st < seconds);
 		double elapsed = real_time_now() - st;
 
 		return total / elapsed;
 	}
 
+	// Adds count vertices of random data, keeping any floats in a sane range.
+	void AddRandom(int vtype, int count, GMRng &rng) {
+		if (needsReset_) {
+			Reset();
+		}
+
+		VertexDecoder layout;
+		layout.SetVertexType(vtype, options_);
+		const int size = layout.VertexSize();
+		for (int i = 0; i < size * count; ++i) {
+			src_[srcPos_ + i] = (u8)rng.R32();
+		}
+
+		auto randomFloats = [&](u8 *p, int n, float minValue, float maxValue) {
+			for (int i = 0; i < n; ++i) {
+				float_le f = minValue + rng.F() * (maxValue - minValue);
+				memcpy(p + i * sizeof(f), &f, sizeof(f));
+			}
+		};
+		for (int v = 0; v < count; ++v) {
+			for (int m = 0; m < layout.morphcount; ++m) {
+				u8 *p = src_ + srcPos_ + v * size + m * layout.onesize_;
+				if (layout.nrm == (GE_VTYPE_NRM_FLOAT >> GE_VTYPE_NRM_SHIFT))
+					randomFloats(p + layout.nrmoff, 3, -2.0f, 2.0f);
+				if (layout.pos == (GE_VTYPE_POS_FLOAT >> GE_VTYPE_POS_SHIFT))
+					randomFloats(p + layout.posoff, 3, -2.0f, 2.0f);
+				// Through mode texcoords are in texels, and tracked as u16 bounds.
+				if (layout.tc == (GE_VTYPE_TC_FLOAT >> GE_VTYPE_TC_SHIFT))
+					randomFloats(p + layout.tcoff, 2, layout.throughmode ? 0.0f : -2.0f, layout.throughmode ? 512.0f : 2.0f);
+				// Invalid colors can make the attributes overlap, so these go last to stay positive.
+				if (layout.weighttype == (GE_VTYPE_WEIGHT_FLOAT >> GE_VTYPE_WEIGHT_SHIFT))
+					randomFloats(p + layout.weightoff, layout.nweights, 0.0f, 1.0f);
+			}
+		}
+		srcPos_ += size * count;
+	}
+
 	void Add8(u8 x) {
 		if (needsReset_) {
 			Reset();
@@ -262,11 +302,103 @@ class VertexDecoderTestHarness {
 		return assertFailed_;
 	}
 
+	bool IsJitted() {
+		return dec_ && dec_->jitted_ != nullptr;
+	}
+
+	// Decodes the added vertices with both the steps and the jit, and compares every component.
+	// Float results may differ slightly due to operation order, and morphed colors by one.
+	bool CompareJit(const char *title, int vtype, int indexUpperBound) {
+		const int count = indexUpperBound + 1;
+
+		ResetVertexState();
+		Execute(vtype, indexUpperBound, false);
+		const DecVtxFormat fmt = dec_->decFmt;
+		const bool morph = dec_->morphcount > 1;
+		// Invalid color formats leave the color unwritten.
+		const bool validColor = dec_->col == 0 || dec_->col >= 4;
+		std::vector<u8> expected(dst_, dst_ + fmt.stride * count);
+		const KnownVertexBounds expectedBounds = gstate_c.vertBounds;
+		const bool expectedFullAlpha = gstate_c.vertexFullAlpha;
+
+		ResetVertexState();
+		Execute(vtype, indexUpperBound, true);
+		if (!IsJitted()) {
+			return true;
+		}
+
+		bool match = true;
+		for (int i = 0; i < count; ++i) {
+			const u8 *e = &expected[fmt.stride * i];
+			const u8 *r = dst_ + fmt.stride * i;
+			match = match && CompareComponent(fmt.w0fmt, e + fmt.w0off, r + fmt.w0off, 0);
+			match = match && CompareComponent(fmt.w1fmt, e + fmt.w1off, r + fmt.w1off, 0);
+			match = match && CompareComponent(fmt.uvfmt, e + fmt.uvoff, r + fmt.uvoff, 0);
+			match = match && CompareComponent(validColor ? fmt.c0fmt : (u8)DEC_NONE, e + fmt.c0off, r + fmt.c0off, morph ? 1 : 0);
+			match = match && CompareComponent(fmt.c1fmt, e + fmt.c1off, r + fmt.c1off, morph ? 1 : 0);
+			match = match && CompareComponent(fmt.nrmfmt, e + fmt.nrmoff, r + fmt.nrmoff, 0);
+			match = match && CompareComponent(fmt.posfmt, e + fmt.posoff, r + fmt.posoff, 0);
+		}
+		if (memcmp(&expectedBounds, &gstate_c.vertBounds, sizeof(expectedBounds)) != 0) {
+			match = false;
+		}
+		// A morphed alpha of 254 vs 255 would flip this.
+		if (!morph && expectedFullAlpha != gstate_c.vertexFullAlpha) {
+			match = false;
+		}
+
+		if (!match) {
+			assertFailed_ = true;
+			printf("%s: Jit and steps differ for vtype %08x\n", title, vtype);
+		}
+		return match;
+	}
+
 private:
+	static void ResetVertexState() {
+		gstate_c.vertBounds.minU = 512;
+		gstate_c.vertBounds.minV = 512;
+		gstate_c.vertBounds.maxU = 0;
+		gstate_c.vertBounds.maxV = 0;
+		gstate_c.vertexFullAlpha = true;
+	}
+
+	static bool CompareComponent(u8 fmt, const u8 *e, const u8 *r, int tolerance) {
+		switch (fmt) {
+		case DEC_NONE:
+			return true;
+		case DEC_FLOAT_1:
+		case DEC_FLOAT_2:
+		case DEC_FLOAT_3:
+		case DEC_FLOAT_4:
+			for (int i = 0; i < DecFmtSize(fmt) / 4; ++i) {
+				float_le ef, rf;
+				memcpy(&ef, e + i * 4, 4);
+				memcpy(&rf, r + i * 4, 4);
+				float scale = std::max(1.0f, std::max(fabsf(ef), fabsf(rf)));
+				if (fabsf(ef - rf) > 0.0001f * scale) {
+					return false;
+				}
+			}
+			return true;
+		default:
+			for (int i = 0; i < DecFmtSize(fmt); ++i) {
+				if (abs((int)e[i] - (int)r[i]) > tolerance) {
+					return false;
+				}
+			}
+			return true;
+		}
+	}
+
 	void SetupExecute(int vtype, bool useJit) {
 		if (dec_ != nullptr) {
 			delete dec_;
 		}
+		// Each decoder gets freshly compiled, so make sure we never run out of space.
+		if (useJit && cache_->GetSpaceLeft() < 16384) {
+			cache_->Clear();
+		}
 		dec_ = new VertexDecoder();
 		dec_->SetVertexType(vtype, options_, useJit ? cache_ : nullptr);
 		dstPos_ = 0;
@@ -627,7 +759,67 @@ static bool TestVertexFloatSkin() {
 	return !dec.HasFailed();
 }
 
-// TODO: Morph (col, pos, nrm), weights (no skin), morph + weights?
+// Runs random data through every combination of formats, comparing the jit to the steps.
+static bool TestVertexJitMatchesSteps() {
+	VertexDecoderTestHarness dec;
+	GMRng rng;
+	rng.Init(0x1337);
+
+	const bool oldSoftwareSkinning = g_Config.bSoftwareSkinning;
+	static const int colors[] = { 0, 1, 4, 5, 6, 7 };
+	int iteration = 0;
+	int missingJit = 0;
+	for (int pos = 1; pos <= 3; ++pos)
+	for (int nrm = 0; nrm <= 3; ++nrm)
+	for (int tc = 0; tc <= 3; ++tc)
+	for (size_t c = 0; c < ARRAY_SIZE(colors); ++c)
+	for (int weight = 0; weight <= 3; ++weight)
+	for (int morph = 0; morph <= 1; ++morph)
+	for (int through = 0; through <= 1; ++through) {
+		// Pick the counts and options randomly rather than multiplying the combinations further.
+		const u32 choices = rng.R32();
+		const int nweights = choices & 7;
+		const int morphcount = morph ? 1 + ((choices >> 3) % 7) : 0;
+		int vtype = (pos << GE_VTYPE_POS_SHIFT) | (nrm << GE_VTYPE_NRM_SHIFT) | (tc << GE_VTYPE_TC_SHIFT) | (colors[c] << GE_VTYPE_COL_SHIFT);
+		vtype |= (weight << GE_VTYPE_WEIGHT_SHIFT) | (nweights << GE_VTYPE_WEIGHTCOUNT_SHIFT) | (morphcount << GE_VTYPE_MORPHCOUNT_SHIFT);
+		if (through) {
+			vtype |= GE_VTYPE_THROUGH;
+		}
+
+		VertexDecoderOptions opts;
+		memset(&opts, 0, sizeof(opts));
+		opts.expandAllUVtoFloat = (choices & 0x100) != 0;
+		opts.expandAllWeightsToFloat = (choices & 0x200) != 0;
+		opts.expand8BitNormalsToFloat = (choices & 0x400) != 0;
+		g_Config.bSoftwareSkinning = (choices & 0x800) != 0;
+		++iteration;
+
+		for (int i = 0; i < 8 * 12; ++i) {
+			gstate.boneMatrix[i] = rng.F() * 4.0f - 2.0f;
+		}
+		for (int i = 0; i < 8; ++i) {
+			gstate_c.morphWeights[i] = rng.F();
+		}
+
+		dec.SetOptions(opts);
+		dec.AddRandom(vtype, 8, rng);
+		dec.CompareJit("TestVertexJitMatchesSteps", vtype, 7);
+		if (!dec.IsJitted()) {
+			++missingJit;
+		}
+	}
+	g_Config.bSoftwareSkinning = oldSoftwareSkinning;
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(ARM) || defined(ARM64)
+	// Every step has a jit version on these, so nothing should fall back.
+	if (missingJit != 0) {
+		printf("TestVertexJitMatchesSteps: %d of %d formats did not jit\n", missingJit, iteration);
+		return false;
+	}
+#endif
+
+	return !dec.HasFailed();
+}
 
 typedef bool (*VertexTestFunc)();
 
@@ -648,30 +840,49 @@ static VertexTestFunc vertdecTestFuncs[] = {
 	&TestVertex8Skin,
 	&TestVertex16Skin,
 	&TestVertexFloatSkin,
+
+	&TestVertexJitMatchesSteps,
 };
 
-bool TestVertexJit() {
+static void BenchmarkVertexFormat(const char *name, int vtype, bool softwareSkinning) {
 	VertexDecoderTestHarness dec;
-	/*for (int i = 0; i < 100; ++i) {
-		dec.AddFloat(0.5f, 1.0f, -1.0f);
-	}
-	int vtype = GE_VTYPE_POS_FLOAT;*/
-	/*for (int i = 0; i < 100; ++i) {
-		dec.Add16(32767, 0, 32768);
-	}
-	int vtype = GE_VTYPE_POS_16BIT;*/
-	for (int i = 0; i < 100; ++i) {
-		dec.Add8(127, 0, 128);
-	}
-	int vtype = GE_VTYPE_POS_8BIT;
-	double yesJit = dec.ExecuteTimed(vtype, 100, true);
-	double noJit = dec.ExecuteTimed(vtype, 100, false);
-
-	float x = dec.GetFloat();
-	float y = dec.GetFloat();
-	float z = dec.GetFloat();
-	printf("Result: %f, %f, %f\n", x, y, z);
-	printf("Jit was %fx faster than steps.\n\n", yesJit / noJit);
+	GMRng rng;
+	rng.Init(0x1337);
+
+	const bool oldSoftwareSkinning = g_Config.bSoftwareSkinning;
+	g_Config.bSoftwareSkinning = softwareSkinning;
+	for (int i = 0; i < 8 * 12; ++i) {
+		gstate.boneMatrix[i] = rng.F();
+	}
+	for (int i = 0; i < 8; ++i) {
+		gstate_c.morphWeights[i] = 1.0f / 8.0f;
+	}
+
+	dec.AddRandom(vtype, 100, rng);
+	double yesJit = dec.ExecuteTimed(vtype, 99, true, 0.05) * 100.0;
+	double noJit = dec.ExecuteTimed(vtype, 99, false, 0.05) * 100.0;
+	g_Config.bSoftwareSkinning = oldSoftwareSkinning;
+
+	printf("%-28s %8.1f Mverts/s jit, %8.1f Mverts/s steps, %5.2fx\n", name, yesJit / 1000000.0, noJit / 1000000.0, yesJit / noJit);
+}
+
+static void BenchmarkVertexFormats() {
+	BenchmarkVertexFormat("pos8", GE_VTYPE_POS_8BIT, false);
+	BenchmarkVertexFormat("pos16 tc16 col8888", GE_VTYPE_POS_16BIT | GE_VTYPE_TC_16BIT | GE_VTYPE_COL_8888, false);
+	BenchmarkVertexFormat("posf tcf col8888", GE_VTYPE_POS_FLOAT | GE_VTYPE_TC_FLOAT | GE_VTYPE_COL_8888, false);
+	BenchmarkVertexFormat("through pos16 tc16", GE_VTYPE_THROUGH | GE_VTYPE_POS_16BIT | GE_VTYPE_TC_16BIT, false);
+	BenchmarkVertexFormat("pos16 nrm8 col565", GE_VTYPE_POS_16BIT | GE_VTYPE_NRM_8BIT | GE_VTYPE_COL_565, false);
+	BenchmarkVertexFormat("pos16 nrm16 col4444", GE_VTYPE_POS_16BIT | GE_VTYPE_NRM_16BIT | GE_VTYPE_COL_4444, false);
+	BenchmarkVertexFormat("skin2 w16 pos16 nrm16 tc16", GE_VTYPE_WEIGHT_16BIT | (1 << GE_VTYPE_WEIGHTCOUNT_SHIFT) | GE_VTYPE_POS_16BIT | GE_VTYPE_NRM_16BIT | GE_VTYPE_TC_16BIT, true);
+	BenchmarkVertexFormat("skin4 w8 pos16 nrm8", GE_VTYPE_WEIGHT_8BIT | (3 << GE_VTYPE_WEIGHTCOUNT_SHIFT) | GE_VTYPE_POS_16BIT | GE_VTYPE_NRM_8BIT, true);
+	BenchmarkVertexFormat("skin8 wf posf nrmf", GE_VTYPE_WEIGHT_FLOAT | (7 << GE_VTYPE_WEIGHTCOUNT_SHIFT) | GE_VTYPE_POS_FLOAT | GE_VTYPE_NRM_FLOAT, true);
+	BenchmarkVertexFormat("morph2 pos16 col5551", (1 << GE_VTYPE_MORPHCOUNT_SHIFT) | GE_VTYPE_POS_16BIT | GE_VTYPE_COL_5551, false);
+	BenchmarkVertexFormat("morph4 posf nrmf", (3 << GE_VTYPE_MORPHCOUNT_SHIFT) | GE_VTYPE_POS_FLOAT | GE_VTYPE_NRM_FLOAT, false);
+	printf("\n");
+}
+
+bool TestVertexJit() {
+	BenchmarkVertexFormats();
 
 	bool pass = true;
 	for (size_t i = 0; i < ARRAY_SIZE(vertdecTestFuncs); ++i) {
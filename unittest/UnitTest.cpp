@@ -411,6 +411,22 @@ struct TestItem {
 bool TestArmEmitter();
 bool TestArm64Emitter();
 bool TestX64Emitter();
+bool TestISOFileSystem();
+bool TestHTTPFileLoader();
+bool TestMetaFileSystem();
+bool TestMemSnapshot();
+bool TestChunkFile();
+bool TestSoftwareTransform();
+bool TestSplineCommon();
+bool TestIndexGenerator();
+bool TestShaderCache();
+bool TestThreadPool();
+bool TestDiskCachingFileLoader();
+bool TestReadTrace();
+bool TestThreadEventQueue();
+bool TestReplay();
+bool TestDirectoryCaseCache();
+bool TestDisplayListCache();
 
 TestItem availableTests[] = {
 #if defined(ARM64) || defined(_M_X64) || defined(_M_IX86)
@@ -423,6 +439,17 @@ TestItem availableTests[] = {
 	TEST_ITEM(X64Emitter),
 #endif
 	TEST_ITEM(VertexJit),
+	TEST_ITEM(SoftwareTransform),
+	TEST_ITEM(SplineCommon),
+	TEST_ITEM(IndexGenerator),
+	TEST_ITEM(ShaderCache),
+	TEST_ITEM(ThreadPool),
+	TEST_ITEM(DiskCachingFileLoader),
+	TEST_ITEM(ReadTrace),
+	TEST_ITEM(ThreadEventQueue),
+	TEST_ITEM(Replay),
+	TEST_ITEM(DirectoryCaseCache),
+	TEST_ITEM(DisplayListCache),
 	TEST_ITEM(Asin),
 	TEST_ITEM(SinCos),
 	TEST_ITEM(VFPUSinCos),
@@ -431,6 +458,11 @@ TestItem availableTests[] = {
 	TEST_ITEM(Jit),
 	TEST_ITEM(MatrixTranspose),
 	TEST_ITEM(ParseLBN),
+	TEST_ITEM(ISOFileSystem),
+	TEST_ITEM(HTTPFileLoader),
+	TEST_ITEM(MetaFileSystem),
+	TEST_ITEM(MemSnapshot),
+	TEST_ITEM(ChunkFile),
 };
 
 int main(int argc, const char *argv[]) {